@@ -38,10 +38,28 @@ using namespace std;
 
 
 #include <boost/foreach.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/range/algorithm/find.hpp>
+#include <boost/lambda/lambda.hpp>
 
 #include <syncevo/declarations.h>
 SE_BEGIN_CXX
 
+#ifdef USE_EDS_CLIENT
+class CalendarCache : public std::map<std::string, boost::shared_ptr< eptr<icalcomponent> > >
+{
+public:
+    /** Asynchronous method call still pending. */
+    bool m_running;
+    /** The last luid requested in this query. Needed to start with the next item after it. */
+    std::string m_lastLUID;
+    /** Result of batch read. Any error here means that the call failed completely. */
+    GErrorCXX m_gerror;
+    /** A debug logging name for this query. */
+    std::string m_name;
+};
+#endif
+
 static const string
 EVOLUTION_CALENDAR_PRODID("PRODID:-//ACME//NONSGML SyncEvolution//EN"),
 EVOLUTION_CALENDAR_VERSION("VERSION:2.0");
@@ -53,6 +71,19 @@ bool EvolutionCalendarSource::LUIDs::containsLUID(const ItemID &id) const
         it->second.find(id.m_rid) != it->second.end();
 }
 
+bool EvolutionCalendarSource::LUIDs::containsChildren(const std::string &uid) const
+{
+    const_iterator it = findUID(uid);
+    if (it != end()) {
+        BOOST_FOREACH(const string &rid, it->second) {
+            if (!rid.empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void EvolutionCalendarSource::LUIDs::insertLUID(const ItemID &id)
 {
     (*this)[id.m_uid].insert(id.m_rid);
@@ -131,6 +162,35 @@ EvolutionCalendarSource::EvolutionCalendarSource(EvolutionCalendarSourceType typ
         Exception::throwError(SE_HERE, "internal error, invalid calendar type");
         break;
     }
+#ifdef USE_EDS_CLIENT
+    const char *mode = getEnv("SYNCEVOLUTION_EDS_ACCESS_MODE", "");
+    m_accessMode = boost::iequals(mode, "synchronous") ? SYNCHRONOUS :
+        boost::iequals(mode, "batched") ? BATCHED :
+        DEFAULT;
+    m_cacheMisses =
+        m_cacheStalls =
+        m_itemReads =
+        m_itemsFromDB =
+        m_itemQueries = 0;
+    m_readAheadOrder = READ_NONE;
+#endif
+}
+
+EvolutionCalendarSource::~EvolutionCalendarSource()
+{
+    // Pending operations must not complete after we got destroyed,
+    // see ~EvolutionContactSource().
+    finishItemChanges();
+#ifdef USE_EDS_CLIENT
+    // Same for reads, they also use our "this" pointer.
+    if (m_calendarCache && m_calendarCache->m_running) {
+        GRunWhile(boost::lambda::var(m_calendarCache->m_running));
+    }
+    if (m_calendarCacheNext && m_calendarCacheNext->m_running) {
+        GRunWhile(boost::lambda::var(m_calendarCacheNext->m_running));
+    }
+#endif
+    close();
 }
 
 SyncSource::Databases EvolutionCalendarSource::getDatabases()
@@ -384,6 +444,9 @@ void EvolutionCalendarSource::listAllItems(RevisionMap_t &revisions)
 {
     GErrorCXX gerror;
 #ifdef USE_EDS_CLIENT
+    flushItemChanges();
+    finishItemChanges();
+
     ECalClientView *view;
 
     if (!e_cal_client_get_view_sync (m_calendar, "#t", &view, NULL, gerror)) {
@@ -436,6 +499,9 @@ void EvolutionCalendarSource::close()
 void EvolutionCalendarSource::readItem(const string &luid, std::string &item, bool raw)
 {
     ItemID id(luid);
+#ifdef USE_EDS_CLIENT
+    waitForUID(id.m_uid);
+#endif
     item = retrieveItemAsString(id);
 }
 
@@ -580,6 +646,15 @@ EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::insertItem(co
         modprop = NULL;
     }
 
+#ifdef USE_EDS_CLIENT
+    // The decisions below depend on the current content of the
+    // calendar, so batched changes of the same UID must be stored
+    // first.
+    std::string itemUID = update ? ItemID(luid).m_uid : getItemID(subcomp).m_uid;
+    waitForUID(itemUID);
+    invalidateCachedItems(itemUID);
+#endif
+
     if (!update) {
         ItemID id = getItemID(subcomp);
         const char *uid = NULL;
@@ -610,6 +685,17 @@ EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::insertItem(co
                 m_allLUIDs.containsUID(id.m_uid)) {
                 detached = true;
             } else {
+#ifdef USE_EDS_CLIENT
+                if (m_accessMode == BATCHED &&
+                    !id.m_uid.empty() &&
+                    !m_allLUIDs.containsUID(id.m_uid)) {
+                    // No children to preserve, can be created with a
+                    // single call.
+                    m_allLUIDs.insertLUID(id);
+                    return queueBatchedInsert(m_batchedCreate, "create", id, icomp, subcomp);
+                }
+#endif
+
                 // Creating the parent while children are already in
                 // the calendar confuses EDS (at least 2.12): the
                 // parent is stored in the .ics with the old UID, but
@@ -701,23 +787,21 @@ EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::insertItem(co
             }
         }
 
-        if (isParent) {
-            // CALOBJ_MOD_THIS for parent items (UID set, no RECURRENCE-ID)
-            // is not supported by all backends: the Exchange Connector
-            // fails with it. It might be an incorrect usage of the API.
-            // Therefore we have to use CALOBJ_MOD_ALL, but that removes
-            // children.
-            bool hasChildren = false;
-            LUIDs::const_iterator it = m_allLUIDs.find(id.m_uid);
-            if (it != m_allLUIDs.end()) {
-                BOOST_FOREACH(const string &rid, it->second) {
-                    if (!rid.empty()) {
-                        hasChildren = true;
-                        break;
-                    }
-                }
-            }
+        // CALOBJ_MOD_THIS for parent items (UID set, no RECURRENCE-ID)
+        // is not supported by all backends: the Exchange Connector
+        // fails with it. It might be an incorrect usage of the API.
+        // Therefore we have to use CALOBJ_MOD_ALL, but that removes
+        // children.
+        bool hasChildren = isParent && m_allLUIDs.containsChildren(id.m_uid);
+
+#ifdef USE_EDS_CLIENT
+        if (m_accessMode == BATCHED && !hasChildren) {
+            return queueBatchedInsert(isParent ? m_batchedModifyAll : m_batchedModifyThis,
+                                      "modify", getItemID(subcomp), icomp, subcomp);
+        }
+#endif
 
+        if (isParent) {
             if (hasChildren) {
                 // Use CALOBJ_MOD_ALL and temporarily remove
                 // the children, then add them again. Otherwise they would
@@ -798,6 +882,476 @@ EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::insertItem(co
     return InsertItemResult(newluid, modTime, state);
 }
 
+#ifdef USE_EDS_CLIENT
+EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::queueBatchedInsert(PendingContainer_t &batch,
+                                                                                      const char *operation,
+                                                                                      const ItemID &id,
+                                                                                      eptr<icalcomponent> &icomp,
+                                                                                      icalcomponent *subcomp)
+{
+    std::string name = StringPrintf("%s: %s %s operation #%d",
+                                    getDisplayName().c_str(),
+                                    operation,
+                                    id.getLUID().c_str(),
+                                    m_asyncOpCounter++);
+    SE_LOG_DEBUG(name, "queueing for batched %s", operation);
+    boost::shared_ptr<Pending> pending(new Pending(id));
+    pending->m_name = name;
+    pending->m_icomp = icomp.release();
+    pending->m_subcomp = subcomp;
+    batch.push_back(pending);
+    m_pendingUIDs.insert(id.m_uid);
+    // SyncSource is going to live longer than Synthesis
+    // engine, so using "this" is safe here.
+    return InsertItemResult(boost::bind(&EvolutionCalendarSource::checkBatchedInsert, this, pending));
+}
+
+EvolutionCalendarSource::InsertItemResult EvolutionCalendarSource::checkBatchedInsert(const boost::shared_ptr<Pending> &pending)
+{
+    SE_LOG_DEBUG(pending->m_name, "checking operation: %s", pending->m_status == MODIFYING ? "waiting" : "inserted");
+    if (pending->m_status == MODIFYING) {
+        return InsertItemResult(boost::bind(&EvolutionCalendarSource::checkBatchedInsert, this, pending));
+    }
+    if (pending->m_gerror) {
+        pending->m_gerror.throwError(SE_HERE, pending->m_name);
+    }
+    string modTime = getItemModTime(pending->m_id);
+    return InsertItemResult(pending->m_id.getLUID(), modTime, ITEM_OKAY);
+}
+
+void EvolutionCalendarSource::completedCreate(const boost::shared_ptr<PendingContainer_t> &batched, gboolean success, GSList *uids, const GError *gerror) throw()
+{
+    try {
+        // Same workaround as in insertItem(): don't rely on the
+        // returned UIDs, we only batch items which have one already.
+        g_slist_free_full(uids, g_free);
+        if (!success) {
+            // Items were added to m_allLUIDs when queueing them.
+            BOOST_FOREACH (const boost::shared_ptr<Pending> &pending, *batched) {
+                m_allLUIDs.eraseLUID(pending->m_id);
+            }
+        }
+        completedModify(batched, success, gerror);
+    } catch (...) {
+        Exception::handle(HANDLE_EXCEPTION_FATAL);
+    }
+}
+
+void EvolutionCalendarSource::completedModify(const boost::shared_ptr<PendingContainer_t> &batched, gboolean success, const GError *gerror) throw()
+{
+    try {
+        // The destructor ensures that the pending operations complete
+        // before destructing the instance, so our "this" pointer is
+        // always valid here.
+        SE_LOG_DEBUG(getDisplayName(), "batch of %d items completed", (int)batched->size());
+        m_numRunningOperations--;
+        BOOST_FOREACH (const boost::shared_ptr<Pending> &pending, *batched) {
+            SE_LOG_DEBUG(pending->m_name, "completed: %s",
+                         success ? "<<successfully>>" :
+                         gerror ? gerror->message :
+                         "<<unknown failure>>");
+            m_pendingUIDs.erase(pending->m_id.m_uid);
+            if (success) {
+                // Get modification time when engine checks the item.
+                pending->m_status = REVISION;
+            } else {
+                pending->m_status = DONE;
+                pending->m_gerror = gerror;
+            }
+        }
+    } catch (...) {
+        Exception::handle(HANDLE_EXCEPTION_FATAL);
+    }
+}
+
+void EvolutionCalendarSource::flushModify(PendingContainer_t &batch, ECalObjModType mod)
+{
+    if (!batch.empty()) {
+        SE_LOG_DEBUG(getDisplayName(), "batch modify of %d items starting", (int)batch.size());
+        m_numRunningOperations++;
+        GListCXX<icalcomponent, GSList> icomps;
+        BOOST_REVERSE_FOREACH (const boost::shared_ptr<Pending> &pending, batch) {
+            icomps.push_front(pending->m_subcomp);
+        }
+        boost::shared_ptr<PendingContainer_t> batched(new PendingContainer_t);
+        std::swap(*batched, batch);
+        SYNCEVO_GLIB_CALL_ASYNC(e_cal_client_modify_objects,
+                                boost::bind(&EvolutionCalendarSource::completedModify,
+                                            this,
+                                            batched,
+                                            _1, _2),
+                                m_calendar, icomps, mod, NULL);
+    }
+}
+
+void EvolutionCalendarSource::flushItemChanges()
+{
+    if (!m_batchedCreate.empty()) {
+        SE_LOG_DEBUG(getDisplayName(), "batch create of %d items starting", (int)m_batchedCreate.size());
+        m_numRunningOperations++;
+        GListCXX<icalcomponent, GSList> icomps;
+        // Iterate backwards, push to front (cheaper for single-linked list) -> same order in the end.
+        BOOST_REVERSE_FOREACH (const boost::shared_ptr<Pending> &pending, m_batchedCreate) {
+            icomps.push_front(pending->m_subcomp);
+        }
+        // Transfer content without copying and then copy only the shared pointer.
+        boost::shared_ptr<PendingContainer_t> batched(new PendingContainer_t);
+        std::swap(*batched, m_batchedCreate);
+        SYNCEVO_GLIB_CALL_ASYNC(e_cal_client_create_objects,
+                                boost::bind(&EvolutionCalendarSource::completedCreate,
+                                            this,
+                                            batched,
+                                            _1, _2, _3),
+                                m_calendar, icomps, NULL);
+    }
+    flushModify(m_batchedModifyAll, CALOBJ_MOD_ALL);
+    flushModify(m_batchedModifyThis, CALOBJ_MOD_THIS);
+}
+
+void EvolutionCalendarSource::finishItemChanges()
+{
+    if (m_numRunningOperations) {
+        SE_LOG_DEBUG(getDisplayName(), "waiting for %d pending operations to complete", m_numRunningOperations.get());
+        while (m_numRunningOperations) {
+            g_main_context_iteration(NULL, true);
+        }
+        SE_LOG_DEBUG(getDisplayName(), "pending operations completed");
+    }
+}
+
+void EvolutionCalendarSource::waitForUID(const std::string &uid)
+{
+    if (m_pendingUIDs.find(uid) != m_pendingUIDs.end()) {
+        SE_LOG_DEBUG(getDisplayName(), "%s: storing pending changes first", uid.c_str());
+        flushItemChanges();
+        finishItemChanges();
+    }
+}
+
+void EvolutionCalendarSource::setReadAheadOrder(ReadAheadOrder order,
+                                                const ReadAheadItems &luids)
+{
+    SE_LOG_DEBUG(getDisplayName(), "reading: set order '%s', %ld luids",
+                 order == READ_NONE ? "none" :
+                 order == READ_ALL_ITEMS ? "all" :
+                 order == READ_CHANGED_ITEMS ? "changed" :
+                 order == READ_SELECTED_ITEMS ? "selected" :
+                 "???",
+                 (long)luids.size());
+    m_readAheadOrder = order;
+    m_nextLUIDs = luids;
+
+    // Throw away all cached data, for the same reasons as in
+    // EvolutionContactSource::setReadAheadOrder().
+    m_calendarCache.reset();
+    m_calendarCacheNext.reset();
+}
+
+void EvolutionCalendarSource::getReadAheadOrder(ReadAheadOrder &order,
+                                                ReadAheadItems &luids)
+{
+    order = m_readAheadOrder;
+    luids = m_nextLUIDs;
+}
+
+void EvolutionCalendarSource::checkCacheForError(boost::shared_ptr<CalendarCache> &cache)
+{
+    if (cache->m_gerror) {
+        GErrorCXX gerror;
+        std::swap(gerror, cache->m_gerror);
+        std::string name = cache->m_name;
+        cache.reset();
+        throwError(SE_HERE, StringPrintf("reading items %s", name.c_str()), gerror);
+    }
+}
+
+void EvolutionCalendarSource::invalidateCachedItems(const std::string &uid)
+{
+    invalidateCachedItems(m_calendarCache, uid);
+    invalidateCachedItems(m_calendarCacheNext, uid);
+}
+
+void EvolutionCalendarSource::invalidateCachedItems(boost::shared_ptr<CalendarCache> &cache, const std::string &uid)
+{
+    if (cache) {
+        CalendarCache::iterator it = cache->begin();
+        while (it != cache->end()) {
+            if (ItemID(it->first).m_uid == uid) {
+                SE_LOG_DEBUG(getDisplayName(), "reading: remove item %s from cache because of remove or update", it->first.c_str());
+                // Reading it later will be counted as cache miss,
+                // like in EvolutionContactSource.
+                cache->erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+icalcomponent *EvolutionCalendarSource::retrieveItemFromCache(const ItemID &id)
+{
+    std::string luid = id.getLUID();
+    SE_LOG_DEBUG(getDisplayName(), "reading: getting item %s", luid.c_str());
+
+    m_itemReads++;
+    if (m_accessMode == SYNCHRONOUS ||
+        m_readAheadOrder == READ_NONE) {
+        m_itemsFromDB++;
+        m_itemQueries++;
+        return retrieveItem(id);
+    }
+
+    eptr<icalcomponent> comp;
+    bool found = false;
+    while (!found) {
+        if (!m_calendarCache) {
+            // No current cache? In that case we must read and block below.
+            m_calendarCache = startReading(luid, START);
+        }
+        SE_LOG_DEBUG(getDisplayName(), "reading: active cache %s", m_calendarCache->m_name.c_str());
+        // Ran into a problem?
+        checkCacheForError(m_calendarCache);
+
+        // Does the cache cover our item?
+        CalendarCache::const_iterator it = m_calendarCache->find(luid);
+        if (it == m_calendarCache->end()) {
+            if (m_calendarCacheNext) {
+                SE_LOG_DEBUG(getDisplayName(), "reading: not in cache, try cache %s",
+                             m_calendarCacheNext->m_name.c_str());
+                // Throw away old cache, try with next one. This is not
+                // a cache miss (yet).
+                m_calendarCache = m_calendarCacheNext;
+                m_calendarCacheNext.reset();
+            } else {
+                SE_LOG_DEBUG(getDisplayName(), "reading: not in cache, nothing pending -> start reading");
+                // Throw away cache, start new read above.
+                m_calendarCache.reset();
+            }
+            continue;
+        }
+
+        SE_LOG_DEBUG(getDisplayName(), "reading: in %s cache", m_calendarCache->m_running ? "running" : "loaded");
+        if (m_calendarCache->m_running) {
+            m_cacheStalls++;
+            GRunWhile(boost::lambda::var(m_calendarCache->m_running));
+        }
+        // Problem?
+        checkCacheForError(m_calendarCache);
+
+        found = true;
+        SE_LOG_DEBUG(getDisplayName(), "reading: in cache, %s", it->second ? "available" : "not found");
+        if (it->second) {
+            // The caller owns and modifies the result, the cache keeps
+            // its copy in case that the item gets read again.
+            comp = icalcomponent_new_clone(*it->second);
+        }
+    }
+
+    // Can we read ahead?
+    if (!m_calendarCacheNext && !m_calendarCache->m_running) {
+        m_calendarCacheNext = startReading(m_calendarCache->m_lastLUID, CONTINUE);
+    }
+    logCacheStats(Logger::DEBUG);
+
+    if (!comp) {
+        throwError(SE_HERE, STATUS_NOT_FOUND, string("retrieving item: ") + luid);
+    }
+    return comp.release();
+}
+
+static int MaxBatchSize()
+{
+    int maxBatchSize = atoi(getEnv("SYNCEVOLUTION_EDS_BATCH_SIZE", "50"));
+    if (maxBatchSize < 1) {
+        maxBatchSize = 1;
+    }
+    return maxBatchSize;
+}
+
+/** turns arbitrary text into a string constant for an EDS sexp */
+static std::string SexpString(const std::string &str)
+{
+    std::string res;
+    res.reserve(str.size() + 2);
+    res += '"';
+    BOOST_FOREACH (char c, str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+        }
+        res += c;
+    }
+    res += '"';
+    return res;
+}
+
+boost::shared_ptr<CalendarCache> EvolutionCalendarSource::startReading(const std::string &luid, ReadingMode mode)
+{
+    SE_LOG_DEBUG(getDisplayName(), "reading: %s item %s",
+                 mode == START ? "must read" :
+                 mode == CONTINUE ? "continue after" :
+                 "???",
+                 luid.c_str());
+
+    static int maxBatchSize = MaxBatchSize();
+    std::vector<const std::string *> luids;
+    luids.reserve(maxBatchSize);
+    bool found = false;
+
+    switch (m_readAheadOrder) {
+    case READ_ALL_ITEMS:
+    case READ_CHANGED_ITEMS: {
+        const Items_t &items = getAllItems();
+        const Items_t &newItems = getNewItems();
+        const Items_t &updatedItems = getUpdatedItems();
+        Items_t::const_iterator it = items.find(luid);
+
+        // Always read the requested item, even if not found in item list?
+        if (mode == START) {
+            luids.push_back(&luid);
+        }
+        // luid is dealt with, either way.
+        if (it != items.end()) {
+            // Check that it is a valid candidate for caching, else
+            // we have a cache miss prediction.
+            if (m_readAheadOrder == READ_ALL_ITEMS ||
+                newItems.find(luid) != newItems.end() ||
+                updatedItems.find(luid) != updatedItems.end()) {
+                found = true;
+            }
+            ++it;
+        }
+        while ((int)luids.size() < maxBatchSize &&
+               it != items.end()) {
+            const std::string &luid = *it;
+            if (m_readAheadOrder == READ_ALL_ITEMS ||
+                newItems.find(luid) != newItems.end() ||
+                updatedItems.find(luid) != updatedItems.end()) {
+                luids.push_back(&luid);
+            }
+            ++it;
+        }
+        break;
+    }
+    case READ_SELECTED_ITEMS: {
+        ReadAheadItems::const_iterator it = boost::find(std::make_pair(m_nextLUIDs.begin(), m_nextLUIDs.end()), luid);
+        // Always read the requested item, even if not found in item list?
+        if (mode == START) {
+            luids.push_back(&luid);
+        }
+        // luid is dealt with, either way.
+        if (it != m_nextLUIDs.end()) {
+            found = true;
+            ++it;
+        }
+        while ((int)luids.size() < maxBatchSize &&
+               it != m_nextLUIDs.end()) {
+            luids.push_back(&*it);
+            ++it;
+        }
+        break;
+    }
+    case READ_NONE:
+        // May be reached when read-ahead was turned off while
+        // preparing for it.
+        if (mode == START) {
+            luids.push_back(&luid);
+        }
+        break;
+    }
+
+    if (m_readAheadOrder != READ_NONE &&
+        mode == START &&
+        !found) {
+        // The requested item was not on our list. Consider this
+        // a cache miss (or rather, cache prediction failure) and turn
+        // of the read-ahead.
+        m_cacheMisses++;
+        SE_LOG_DEBUG(getDisplayName(), "reading: disable read-ahead due to cache miss");
+        m_readAheadOrder = READ_NONE;
+    }
+
+    boost::shared_ptr<CalendarCache> cache;
+    if (!luids.empty()) {
+        // EDS can only search by UID. Parent and children share the
+        // UID, so all of them get returned and cached.
+        std::set<std::string> uids;
+        BOOST_FOREACH (const std::string *luid, luids) {
+            uids.insert(ItemID(*luid).m_uid);
+        }
+        std::string sexp = "(or";
+        BOOST_FOREACH (const std::string &uid, uids) {
+            sexp += " (uid? ";
+            sexp += SexpString(uid);
+            sexp += ")";
+        }
+        sexp += ")";
+
+        cache.reset(new CalendarCache);
+        cache->m_running = true;
+        cache->m_name = StringPrintf("%s-%s (%d)", luids.front()->c_str(), luids.back()->c_str(), (int)luids.size());
+        cache->m_lastLUID = *luids.back();
+        BOOST_FOREACH (const std::string *luid, luids) {
+            (*cache)[*luid];
+        }
+        m_itemsFromDB += luids.size();
+        m_itemQueries++;
+        SYNCEVO_GLIB_CALL_ASYNC(e_cal_client_get_object_list,
+                                boost::bind(&EvolutionCalendarSource::completedRead,
+                                            this,
+                                            boost::weak_ptr<CalendarCache>(cache),
+                                            _1, _2, _3),
+                                m_calendar, sexp.c_str(), NULL);
+        SE_LOG_DEBUG(getDisplayName(), "reading: started item read %s", cache->m_name.c_str());
+    }
+    return cache;
+}
+
+void EvolutionCalendarSource::completedRead(const boost::weak_ptr<CalendarCache> &cachePtr, gboolean success, GSList *icompsPtr, const GError *gerror) throw()
+{
+    try {
+        // Take over ownership of the components before doing anything else.
+        ICalComps_t icomps;
+        for (GSList *entry = icompsPtr; entry; entry = entry->next) {
+            icomps.push_back(ICalComps_t::value_type(new eptr<icalcomponent>(static_cast<icalcomponent *>(entry->data))));
+        }
+        g_slist_free(icompsPtr);
+
+        boost::shared_ptr<CalendarCache> cache = cachePtr.lock();
+        if (!cache) {
+            SE_LOG_DEBUG(getDisplayName(), "reading: item read finished, results no longer needed: %s", gerror ? gerror->message : "<<successful>>");
+            return;
+        }
+
+        SE_LOG_DEBUG(getDisplayName(), "reading: item read %s finished: %s",
+                     cache->m_name.c_str(),
+                     gerror ? gerror->message : "<<successful>>");
+        if (success) {
+            BOOST_FOREACH (const ICalComps_t::value_type &icomp, icomps) {
+                std::string luid = getItemID(*icomp).getLUID();
+                SE_LOG_DEBUG(getDisplayName(), "reading: item read %s got %s", cache->m_name.c_str(), luid.c_str());
+                (*cache)[luid] = icomp;
+            }
+        } else {
+            cache->m_gerror = gerror;
+        }
+        cache->m_running = false;
+    } catch (...) {
+        Exception::handle(HANDLE_EXCEPTION_FATAL);
+    }
+}
+
+void EvolutionCalendarSource::logCacheStats(Logger::Level level)
+{
+    SE_LOG(getDisplayName(), level,
+           "requested %d, retrieved %d from DB in %d queries, misses %d/%d (%d%%), stalls %d",
+           m_itemReads,
+           m_itemsFromDB,
+           m_itemQueries,
+           m_cacheMisses, m_itemReads, m_itemReads ? m_cacheMisses * 100 / m_itemReads : 0,
+           m_cacheStalls);
+}
+#endif
+
 EvolutionCalendarSource::ICalComps_t EvolutionCalendarSource::removeEvents(const string &uid, bool returnOnlyChildren, bool ignoreNotFound)
 {
     ICalComps_t events;
@@ -849,6 +1403,10 @@ void EvolutionCalendarSource::removeItem(const string &luid)
 {
     GErrorCXX gerror;
     ItemID id(luid);
+#ifdef USE_EDS_CLIENT
+    waitForUID(id.m_uid);
+    invalidateCachedItems(id.m_uid);
+#endif
 
     if (id.m_rid.empty()) {
         /*
@@ -1000,7 +1558,11 @@ icalcomponent *EvolutionCalendarSource::retrieveItem(const ItemID &id)
 
 string EvolutionCalendarSource::retrieveItemAsString(const ItemID &id)
 {
+#ifdef USE_EDS_CLIENT
+    eptr<icalcomponent> comp(retrieveItemFromCache(id));
+#else
     eptr<icalcomponent> comp(retrieveItem(id));
+#endif
     eptr<char> icalstr;
 
 #ifdef USE_EDS_CLIENT
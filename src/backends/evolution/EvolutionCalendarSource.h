@@ -38,6 +38,8 @@ SE_GOBJECT_TYPE(ECalClientView)
 
 SE_BEGIN_CXX
 
+class CalendarCache;
+
 /** 
  * Source type independent from ECal / ECalClient to abstract
  * the two different enums in the APIs.
@@ -81,7 +83,7 @@ class EvolutionCalendarSource : public EvolutionSyncSource,
      */
     EvolutionCalendarSource(EvolutionCalendarSourceType type,
                             const SyncSourceParams &params);
-    virtual ~EvolutionCalendarSource() { close(); }
+    virtual ~EvolutionCalendarSource();
 
     //
     // implementation of SyncSource
@@ -253,6 +255,7 @@ class EvolutionCalendarSource : public EvolutionSyncSource,
         const_iterator findUID(const std::string &uid) const { return find(uid); }
 
         bool containsLUID(const ItemID &id) const;
+        bool containsChildren(const std::string &uid) const;
         void insertLUID(const ItemID &id);
         void eraseLUID(const ItemID &id);
     } m_allLUIDs;
@@ -280,6 +283,108 @@ class EvolutionCalendarSource : public EvolutionSyncSource,
      *                              a NOT_FOUND error
      */
     ICalComps_t removeEvents(const string &uid, bool returnOnlyChildren, bool ignoreNotFound = true);
+
+#ifdef USE_EDS_CLIENT
+  private:
+    /**
+     * Chosen with SYNCEVOLUTION_EDS_ACCESS_MODE. In contrast to
+     * EvolutionContactSource, DEFAULT only enables read-ahead; writes
+     * are batched only in BATCHED mode.
+     */
+    enum AccessMode {
+        SYNCHRONOUS,
+        BATCHED,
+        DEFAULT
+    } m_accessMode;
+    InitState<int> m_asyncOpCounter;
+
+    enum AsyncStatus {
+        MODIFYING, /**< create or modify request sent */
+        REVISION,  /**< stored, modification time must be read */
+        DONE       /**< failed, see m_gerror */
+    };
+
+    struct Pending {
+        Pending(const ItemID &id) : m_id(id), m_subcomp(NULL), m_status(MODIFYING) {}
+
+        std::string m_name;
+        /** final UID and RECURRENCE-ID of the item */
+        ItemID m_id;
+        /** VCALENDAR with the item, owns m_subcomp */
+        eptr<icalcomponent> m_icomp;
+        /** VEVENT/VTODO/VJOURNAL which gets stored */
+        icalcomponent *m_subcomp;
+        AsyncStatus m_status;
+        GErrorCXX m_gerror;
+    };
+    typedef std::list< boost::shared_ptr<Pending> > PendingContainer_t;
+
+    /**
+     * Batched "create object" and "modify object" operations. Only
+     * items which can be stored with a single call are batched:
+     * new items whose UID is not in use yet and updates which
+     * don't have to preserve children. Everything else, in
+     * particular the handling of detached recurrences with existing
+     * children, goes through the synchronous code after waiting for
+     * pending operations involving the same UID.
+     *
+     * Delete is not batched because we need per-item status
+     * information - see removeItem().
+     */
+    PendingContainer_t m_batchedCreate;
+    PendingContainer_t m_batchedModifyAll;
+    PendingContainer_t m_batchedModifyThis;
+    /** UIDs of items in the batches above or in running operations */
+    std::set<std::string> m_pendingUIDs;
+    InitState<int> m_numRunningOperations;
+
+    InsertItemResult queueBatchedInsert(PendingContainer_t &batch,
+                                        const char *operation,
+                                        const ItemID &id,
+                                        eptr<icalcomponent> &icomp,
+                                        icalcomponent *subcomp);
+    InsertItemResult checkBatchedInsert(const boost::shared_ptr<Pending> &pending);
+    void completedCreate(const boost::shared_ptr<PendingContainer_t> &batched, gboolean success, /* const GStringListFreeCXX &uids */ GSList *uids, const GError *gerror) throw ();
+    void completedModify(const boost::shared_ptr<PendingContainer_t> &batched, gboolean success, const GError *gerror) throw ();
+    void flushModify(PendingContainer_t &batch, ECalObjModType mod);
+
+    /** flush and complete pending operations if one of them affects the UID */
+    void waitForUID(const std::string &uid);
+
+    virtual void flushItemChanges();
+    virtual void finishItemChanges();
+
+    // Read-ahead of item data.
+    boost::shared_ptr<CalendarCache> m_calendarCache, m_calendarCacheNext;
+    int m_cacheMisses, m_cacheStalls;
+    int m_itemReads; /**< number of readItem() calls */
+    int m_itemsFromDB; /**< number of items requested from DB (including ones not found) */
+    int m_itemQueries; /**< total number of e_cal_client_get_object_list() calls */
+
+    ReadAheadOrder m_readAheadOrder;
+    ReadAheadItems m_nextLUIDs;
+
+    void checkCacheForError(boost::shared_ptr<CalendarCache> &cache);
+    /** removes all items with the UID, changing one item may affect the others */
+    void invalidateCachedItems(const std::string &uid);
+    void invalidateCachedItems(boost::shared_ptr<CalendarCache> &cache, const std::string &uid);
+    /** like retrieveItem(), using and filling the read-ahead cache */
+    icalcomponent *retrieveItemFromCache(const ItemID &id);
+    enum ReadingMode
+    {
+        START,    /**< luid is needed, must be read  */
+        CONTINUE  /**< luid is from old request, find next ones */
+    };
+    boost::shared_ptr<CalendarCache> startReading(const std::string &luid, ReadingMode mode);
+    void completedRead(const boost::weak_ptr<CalendarCache> &cachePtr, gboolean success, GSList *icompsPtr, const GError *gerror) throw();
+    void logCacheStats(Logger::Level level);
+
+    // Use the information provided to us to implement read-ahead efficiently.
+    virtual void setReadAheadOrder(ReadAheadOrder order,
+                                   const ReadAheadItems &luids);
+    virtual void getReadAheadOrder(ReadAheadOrder &order,
+                                   ReadAheadItems &luids);
+#endif
 };
 
 SE_END_CXX
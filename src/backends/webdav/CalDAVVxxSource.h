@@ -63,6 +63,11 @@ class CalDAVVxxSource : public WebDAVSource,
     virtual std::string getContent() const { return m_content; }
     virtual bool getContentMixed() const { return true; }
 
+    // implementation of TrackingSyncSource: items are independent, may be sent in parallel
+    virtual InsertItemResult insertItem(const string &luid, const std::string &item, bool raw) {
+        return insertItemPipelined(luid, item, raw);
+    }
+
  private:
     const std::string m_content;
 };
@@ -87,6 +87,8 @@ void CardDAVSource::readItemInternal(const std::string &luid, std::string &item,
 void CardDAVSource::readItem(const std::string &luid, std::string &item, bool raw)
 {
     m_contactReads++;
+    // batch reads must not overlap with pending writes
+    finishItemChanges();
     readItemInternal(luid, item, raw);
     logCacheStats(Logger::DEBUG);
 }
@@ -278,7 +280,7 @@ void CardDAVSource::addItemToCache(boost::shared_ptr<CardDAVCache> &cache,
 CardDAVSource::InsertItemResult CardDAVSource::insertItem(const string &luid, const std::string &item, bool raw)
 {
     invalidateCachedItem(luid);
-    return WebDAVSource::insertItem(luid, item, raw);
+    return insertItemPipelined(luid, item, raw);
 }
 
 void CardDAVSource::removeItem(const string &luid)
@@ -291,6 +291,11 @@ boost::shared_ptr<Session> Session::create(const boost::shared_ptr<Settings> &se
     return m_cachedSession;
 }
 
+boost::shared_ptr<Session> Session::createUncached(const boost::shared_ptr<Settings> &settings)
+{
+    return boost::shared_ptr<Session>(new Session(settings));
+}
+
 
 int Session::getCredentials(void *userdata, const char *realm, int attempt, char *username, char *password) throw()
 {
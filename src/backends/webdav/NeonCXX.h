@@ -303,6 +303,14 @@ class Session {
      * initialization) and HTTP connection/authentication.
      */
     static boost::shared_ptr<Session> create(const boost::shared_ptr<Settings> &settings);
+
+    /**
+     * Create a new Session instance which is neither shared with nor
+     * replaces the one returned by create(). Used for additional
+     * connections to the same server which run in parallel to the
+     * main one.
+     */
+    static boost::shared_ptr<Session> createUncached(const boost::shared_ptr<Settings> &settings);
     ~Session();
 
 #ifdef HAVE_LIBNEON_OPTIONS
@@ -10,12 +10,16 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/find.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/foreach.hpp>
 
 #include <syncevo/LogRedirect.h>
 #include <syncevo/IdentityProvider.h>
+#include <syncevo/ThreadSupport.h>
 
 #include <boost/assign.hpp>
 
+#include <deque>
+
 #include <stdio.h>
 #include <errno.h>
 
@@ -50,6 +54,8 @@ private:
     std::string m_urlDescription;
     /** do change tracking without relying on CTag */
     bool m_noCTag;
+    /** do change tracking without RFC 6578 sync-collection */
+    bool m_noSyncToken;
     bool m_googleUpdateHack;
     bool m_googleAlarmHack;
     // credentials were valid in the past: stored persistently in tracking node
@@ -61,6 +67,7 @@ public:
         m_context(context),
         m_sourceConfig(sourceConfig),
         m_noCTag(false),
+        m_noSyncToken(false),
         m_googleUpdateHack(false),
         m_googleAlarmHack(false),
         m_credentialsOkay(false)
@@ -139,6 +146,7 @@ public:
     }
 
     bool noCTag() const { return m_noCTag; }
+    bool noSyncToken() const { return m_noSyncToken; }
     virtual bool googleUpdateHack() const { return m_googleUpdateHack; }
     virtual bool googleAlarmHack() const { return m_googleAlarmHack; }
 
@@ -249,7 +257,8 @@ void ContextSettings::initializeFlags(const std::string &url)
 {
     bool googleUpdate = false,
         googleAlarm = false,
-        noCTag = false;
+        noCTag = false,
+        noSyncToken = false;
 
     Neon::URI uri = Neon::URI::parse(url);
     typedef boost::split_iterator<string::iterator> string_split_iterator;
@@ -276,6 +285,8 @@ void ContextSettings::initializeFlags(const std::string &url)
                         googleAlarm = true;
                 } else if (boost::iequals(*flag, "NoCTag")) {
                     noCTag = true;
+                } else if (boost::iequals(*flag, "NoSyncToken")) {
+                    noSyncToken = true;
                 } else {
                     SE_THROW(StringPrintf("unknown SyncEvolution flag %s in URL %s",
                                           std::string(flag->begin(), flag->end()).c_str(),
@@ -293,6 +304,7 @@ void ContextSettings::initializeFlags(const std::string &url)
     m_googleUpdateHack = googleUpdate;
     m_googleAlarmHack = googleAlarm;
     m_noCTag = noCTag;
+    m_noSyncToken = noSyncToken;
 }
 
 WebDAVSource::Props_t::mapped_type & WebDAVSource::Props_t::operator [] (const WebDAVSource::Props_t::key_type &key)
@@ -320,7 +332,8 @@ WebDAVSource::Props_t::iterator WebDAVSource::Props_t::find(const WebDAVSource::
 WebDAVSource::WebDAVSource(const SyncSourceParams &params,
                            const boost::shared_ptr<Neon::Settings> &settings) :
     TrackingSyncSource(params),
-    m_settings(settings)
+    m_settings(settings),
+    m_parallelWrites(atoi(getEnv("SYNCEVOLUTION_WEBDAV_PARALLEL_WRITES", "1")))
 {
     if (!m_settings) {
         m_contextSettings.reset(new ContextSettings(params.m_context, this));
@@ -1587,6 +1600,8 @@ bool WebDAVSource::isUsable()
 
 void WebDAVSource::close()
 {
+    finishItemChanges();
+    m_pipeline.reset();
     m_session.reset();
 }
 
@@ -1783,6 +1798,7 @@ std::string WebDAVSource::databaseRevision()
     }
 
     contactServer();
+    finishItemChanges();
 
     Timespec deadline = createDeadline();
     Props_t davProps;
@@ -1808,8 +1824,29 @@ static const ne_propname getetag[] = {
 void WebDAVSource::listAllItems(RevisionMap_t &revisions)
 {
     contactServer();
+    finishItemChanges();
 
     if (!getContentMixed()) {
+        // Remember the state of the collection before listing it, so
+        // that the next sync can ask for changes since then. Changes
+        // made while listing are reported again, which is harmless.
+        if (useSyncToken()) {
+            try {
+                m_syncToken = readSyncToken();
+            } catch (const TransportStatusException &ex) {
+                if (ex.syncMLStatus() == STATUS_UNAUTHORIZED) {
+                    throw;
+                }
+                // Some servers reject the PROPFIND for a property
+                // they do not know. Continue without token, like
+                // updateAllItems() does when sync-collection fails;
+                // the next sync then lists all items again.
+                SE_LOG_DEBUG(getDisplayName(), "reading sync token failed, continuing without it: %s",
+                             ex.what());
+                m_syncToken = std::string();
+            }
+        }
+
         // Can use simple PROPFIND because we do not have to
         // double-check that each item really contains the right data.
         bool failed = false;
@@ -1948,6 +1985,180 @@ std::string WebDAVSource::findByUID(const std::string &uid,
     return "";
 }
 
+void WebDAVSource::updateAllItems(RevisionMap_t &revisions)
+{
+    contactServer();
+    finishItemChanges();
+
+    std::string token = getMetaNode().readProperty("syncToken");
+    if (!token.empty() && useSyncToken()) {
+        try {
+            m_syncToken = syncCollection(token, revisions);
+            return;
+        } catch (const TransportStatusException &ex) {
+            if (ex.syncMLStatus() == STATUS_UNAUTHORIZED) {
+                throw;
+            }
+            // Typically 403 with DAV:valid-sync-token precondition
+            // because the server has forgotten the token. Some
+            // servers use other 4xx or 5xx codes for that or for not
+            // supporting the REPORT.
+            SE_LOG_DEBUG(getDisplayName(), "sync-collection failed, falling back to listing all items: %s",
+                         ex.what());
+        }
+    }
+
+    revisions.clear();
+    listAllItems(revisions);
+}
+
+bool WebDAVSource::useSyncToken()
+{
+    // CalDAV collections may contain items which need to be filtered
+    // by content, which sync-collection cannot do.
+    return !getContentMixed() &&
+        !(m_contextSettings && m_contextSettings->noSyncToken());
+}
+
+static const ne_propname getsynctoken[] = {
+    { "DAV:", "sync-token" },
+    { NULL, NULL }
+};
+
+std::string WebDAVSource::readSyncToken()
+{
+    Timespec deadline = createDeadline();
+    Props_t davProps;
+    Neon::Session::PropfindPropCallback_t callback =
+        boost::bind(&WebDAVSource::openPropCallback,
+                    this, boost::ref(davProps), _1, _2, _3, _4);
+    SE_LOG_DEBUG(NULL, "read sync token of %s", m_calendar.m_path.c_str());
+    m_session->propfindProp(m_calendar.m_path, 0, getsynctoken, callback, deadline);
+    // Missing property = no RFC 6578 support.
+    return davProps[m_calendar.m_path]["DAV::sync-token"];
+}
+
+std::string WebDAVSource::syncCollection(const std::string &token, RevisionMap_t &revisions)
+{
+    std::string syncToken = token;
+    bool truncated;
+    Timespec deadline = createDeadline();
+    do {
+        // The token is a URI, but might contain characters which are
+        // special in XML.
+        std::string escapedToken = syncToken;
+        boost::replace_all(escapedToken, "&", "&amp;");
+        boost::replace_all(escapedToken, "<", "&lt;");
+        const std::string query =
+            "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n"
+            "<D:sync-collection xmlns:D=\"DAV:\">\n"
+            "<D:sync-token>" + escapedToken + "</D:sync-token>\n"
+            "<D:sync-level>1</D:sync-level>\n"
+            "<D:prop>\n"
+            "<D:getetag/>\n"
+            "</D:prop>\n"
+            "</D:sync-collection>\n";
+        SE_LOG_DEBUG(NULL, "ask for changes in %s since %s", m_calendar.m_path.c_str(), syncToken.c_str());
+        getSession()->startOperation("REPORT 'sync-collection'", deadline);
+        while (true) {
+            // Applying the same changes more than once when resending
+            // is harmless.
+            std::string newToken, href, etag, status;
+            truncated = false;
+            Neon::XMLParser parser;
+            initSyncCollectionParser(parser, revisions,
+                                     newToken, href, etag, status,
+                                     truncated);
+            Neon::Request report(*getSession(), "REPORT", getCalendar().m_path, query, parser);
+            report.addHeader("Depth", "0");
+            report.addHeader("Content-Type", "application/xml; charset=\"utf-8\"");
+            if (report.run()) {
+                syncToken = newToken;
+                break;
+            }
+        }
+        if (truncated) {
+            // Server sent only some of the changes, continue with
+            // the new token.
+            SE_LOG_DEBUG(NULL, "sync-collection result truncated, continuing");
+        }
+    } while (truncated && !syncToken.empty());
+
+    if (syncToken.empty()) {
+        SE_LOG_DEBUG(NULL, "no new sync token from server, next sync will list all items");
+    }
+    return syncToken;
+}
+
+void WebDAVSource::initSyncCollectionParser(Neon::XMLParser &parser,
+                                            RevisionMap_t &revisions,
+                                            std::string &newToken,
+                                            std::string &href,
+                                            std::string &etag,
+                                            std::string &status,
+                                            bool &truncated)
+{
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "multistatus", _2, _3));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "sync-token", _2, _3),
+                       boost::bind(Neon::XMLParser::append, boost::ref(newToken), _2, _3));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "response", _2, _3),
+                       Neon::XMLParser::DataCB_t(),
+                       boost::bind(&WebDAVSource::syncCollectionResponse, this,
+                                   boost::ref(revisions),
+                                   boost::ref(href), boost::ref(etag), boost::ref(status),
+                                   boost::ref(truncated)));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "href", _2, _3),
+                       boost::bind(Neon::XMLParser::append, boost::ref(href), _2, _3));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "propstat", _2, _3));
+    // Removed items have a status in the response instead of
+    // in a propstat.
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "status", _2, _3),
+                       boost::bind(Neon::XMLParser::append, boost::ref(status), _2, _3));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "prop", _2, _3));
+    parser.pushHandler(boost::bind(Neon::XMLParser::accept, "DAV:", "getetag", _2, _3),
+                       boost::bind(Neon::XMLParser::append, boost::ref(etag), _2, _3));
+}
+
+int WebDAVSource::syncCollectionResponse(RevisionMap_t &revisions,
+                                         std::string &href,
+                                         std::string &etag,
+                                         std::string &status,
+                                         bool &truncated)
+{
+    std::string luid = path2luid(Neon::URI::parse(href).m_path);
+    if (luid.empty()) {
+        // The collection itself, only reported with
+        // 507 "Insufficient Storage" when truncating the result.
+        if (status.find(" 507") != status.npos) {
+            truncated = true;
+        }
+    } else if (!etag.empty()) {
+        std::string rev = ETag2Rev(etag);
+        SE_LOG_DEBUG(NULL, "item %s = rev %s",
+                     luid.c_str(), rev.c_str());
+        revisions[luid] = rev;
+    } else if (status.find(" 404") != status.npos) {
+        SE_LOG_DEBUG(NULL, "item %s removed", luid.c_str());
+        revisions.erase(luid);
+    } else {
+        // for example a sub-collection
+        SE_LOG_DEBUG(NULL, "ignoring %s: %s", href.c_str(), status.c_str());
+    }
+
+    // clean up for next response
+    href.clear();
+    etag.clear();
+    status.clear();
+    return 0;
+}
+
+void WebDAVSource::storeSyncToken()
+{
+    if (m_syncToken.wasSet()) {
+        getMetaNode().setProperty("syncToken", m_syncToken);
+    }
+}
+
 void WebDAVSource::listAllItemsCallback(const Neon::URI &uri,
                                         const ne_prop_result_set *results,
                                         RevisionMap_t &revisions,
@@ -2043,6 +2254,7 @@ std::string WebDAVSource::luid2path(const std::string &luid)
 
 void WebDAVSource::readItem(const string &uid, std::string &item, bool raw)
 {
+    finishItemChanges();
     Timespec deadline = createDeadline();
     m_session->startOperation("GET", deadline);
     while (true) {
@@ -2068,39 +2280,304 @@ void WebDAVSource::readItem(const string &uid, std::string &item, bool raw)
     }
 }
 
-TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid, const std::string &item, bool raw)
+struct WebDAVSource::PendingWrite
 {
-    std::string new_uid;
-    std::string rev;
-    InsertItemResultState state = ITEM_OKAY;
+    PendingWrite() :
+        m_operation(NULL),
+        m_done(false),
+        m_code(0)
+    {}
+
+    /** luid passed to insertItem(), empty for new item */
+    std::string m_uid;
+    /** item data passed to insertItem() */
+    std::string m_item;
+
+    /** PUT or POST */
+    const char *m_operation;
+    /** resource name chosen for new item, same as m_uid for updates */
+    std::string m_newUID;
+    std::string m_path;
+    /** item data to be sent, possibly with modified UID */
+    std::string m_data;
+    std::string m_contentType;
+    Timespec m_deadline;
+
+    /** set once the request was sent, successfully or not */
+    bool m_done;
+    /** HTTP status of the final attempt */
+    int m_code;
+    std::string m_status;
+    std::string m_etag;
+    std::string m_location;
+    /** explanation of the exception thrown while sending, empty if none */
+    std::string m_failure;
+};
+
+/**
+ * Settings for the additional sessions of a WritePipeline.
+ * Everything is copied in the main thread when creating the
+ * pipeline, because ContextSettings and the config behind it must not
+ * be used by the pipeline threads. Each session gets its own instance.
+ */
+class PipelineSettings : public Neon::Settings
+{
+    class PipelineAuthProvider : public AuthProvider
+    {
+        Credentials m_creds;
+
+    public:
+        PipelineAuthProvider(const Credentials &creds) : m_creds(creds) {}
+
+        virtual bool methodIsSupported(AuthMethod method) const { return method == AUTH_METHOD_CREDENTIALS; }
+        virtual Credentials getCredentials() const { return m_creds; }
+        virtual std::string getOAuth2Bearer(int failedTokens, const PasswordUpdateCallback &passwordUpdateCallback) const { SE_THROW("OAuth2 not supported"); return ""; }
+        virtual std::string getUsername() const { return m_creds.m_username; }
+    };
+
+    std::string m_url;
+    bool m_verifySSLHost;
+    bool m_verifySSLCertificate;
+    std::string m_proxy;
+    Credentials m_creds;
+    boost::shared_ptr<AuthProvider> m_authProvider;
+    bool m_credentialsOkay;
+    int m_logLevel;
+    bool m_googleUpdateHack;
+    bool m_googleAlarmHack;
+    int m_timeoutSeconds;
+    int m_retrySeconds;
+
+public:
+    PipelineSettings(Neon::Settings &settings, const std::string &url) :
+        m_url(url),
+        m_verifySSLHost(settings.verifySSLHost()),
+        m_verifySSLCertificate(settings.verifySSLCertificate()),
+        m_proxy(settings.proxy()),
+        m_credentialsOkay(settings.getCredentialsOkay()),
+        m_logLevel(settings.logLevel()),
+        m_googleUpdateHack(settings.googleUpdateHack()),
+        m_googleAlarmHack(settings.googleAlarmHack()),
+        m_timeoutSeconds(settings.timeoutSeconds()),
+        m_retrySeconds(settings.retrySeconds())
+    {
+        boost::shared_ptr<AuthProvider> authProvider = settings.getAuthProvider();
+        if (authProvider &&
+            authProvider->methodIsSupported(AuthProvider::AUTH_METHOD_CREDENTIALS)) {
+            m_creds = authProvider->getCredentials();
+            m_authProvider.reset(new PipelineAuthProvider(m_creds));
+        }
+    }
+
+    virtual std::string getURL() { return m_url; }
+    virtual bool verifySSLHost() { return m_verifySSLHost; }
+    virtual bool verifySSLCertificate() { return m_verifySSLCertificate; }
+    virtual std::string proxy() { return m_proxy; }
+    virtual void getCredentials(const std::string &realm,
+                                std::string &username,
+                                std::string &password)
+    {
+        username = m_creds.m_username;
+        password = m_creds.m_password;
+    }
+    virtual boost::shared_ptr<AuthProvider> getAuthProvider() { return m_authProvider; }
+    // only needed for OAuth2, which is not used in a pipeline
+    virtual void updatePassword(const std::string &password) {}
+    // not stored permanently, the main session takes care of that
+    virtual bool getCredentialsOkay() { return m_credentialsOkay; }
+    virtual void setCredentialsOkay(bool okay) { m_credentialsOkay = okay; }
+    virtual int logLevel() { return m_logLevel; }
+    virtual bool googleUpdateHack() const { return m_googleUpdateHack; }
+    virtual bool googleAlarmHack() const { return m_googleAlarmHack; }
+    virtual int timeoutSeconds() const { return m_timeoutSeconds; }
+    virtual int retrySeconds() const { return m_retrySeconds; }
+};
+
+/**
+ * A fixed number of threads, each with its own Neon::Session, which
+ * send queued PendingWrite requests in parallel. Everything else,
+ * in particular evaluating the results, happens in the main thread.
+ */
+class WebDAVSource::WritePipeline : private boost::noncopyable
+{
+    struct Worker
+    {
+        WritePipeline *m_pipeline;
+        boost::shared_ptr<Neon::Session> m_session;
+#ifdef HAVE_THREAD_SUPPORT
+        GThread *m_thread;
+#endif
+    };
+    std::vector<Worker> m_workers;
+
+    /** protects all following members and PendingWrite::m_done */
+    DynMutex m_mutex;
+    /** signaled when new work is available, work completed, or on shutdown */
+    Cond m_cond;
+    std::deque< boost::shared_ptr<PendingWrite> > m_queue;
+    int m_running;
+    bool m_shutdown;
+
+#ifdef HAVE_THREAD_SUPPORT
+    static gpointer runWorker(gpointer data) throw ()
+    {
+        Worker *worker = static_cast<Worker *>(data);
+        worker->m_pipeline->work(*worker->m_session);
+        return NULL;
+    }
+#endif
+
+    void work(Neon::Session &session)
+    {
+        DynMutex::Guard guard = m_mutex.lock();
+        while (true) {
+            while (m_queue.empty() && !m_shutdown) {
+                m_cond.wait(m_mutex);
+            }
+            if (m_shutdown) {
+                return;
+            }
+            boost::shared_ptr<PendingWrite> write = m_queue.front();
+            m_queue.pop_front();
+            m_running++;
+            guard.unlock();
+
+            // Exceptions must be reported back to the main thread.
+            // This is done by serializing them as string, then using
+            // Exception::tryRethrow() in evaluateWrite().
+            try {
+                sendItem(session, *write);
+            } catch (...) {
+                Exception::handle(write->m_failure, HANDLE_EXCEPTION_NO_ERROR);
+            }
+
+            guard = m_mutex.lock();
+            write->m_done = true;
+            m_running--;
+            m_cond.broadcast();
+        }
+    }
+
+public:
+    WritePipeline(Neon::Settings &settings, const std::string &url, int numSessions) :
+        m_workers(numSessions),
+        m_running(0),
+        m_shutdown(false)
+    {
+        // Sessions are created here, not in the threads, because
+        // that reads the settings.
+        BOOST_FOREACH (Worker &worker, m_workers) {
+            boost::shared_ptr<Neon::Settings> workerSettings(new PipelineSettings(settings, url));
+            worker.m_pipeline = this;
+            worker.m_session = Neon::Session::createUncached(workerSettings);
+            if (workerSettings->getAuthProvider()) {
+                worker.m_session->forceAuthorization(workerSettings->getAuthProvider());
+            }
+        }
+#ifdef HAVE_THREAD_SUPPORT
+        BOOST_FOREACH (Worker &worker, m_workers) {
+            worker.m_thread = g_thread_new("webdav write", runWorker, &worker);
+        }
+#endif
+    }
+
+    ~WritePipeline()
+    {
+        DynMutex::Guard guard = m_mutex.lock();
+        m_shutdown = true;
+        m_cond.broadcast();
+        guard.unlock();
+#ifdef HAVE_THREAD_SUPPORT
+        BOOST_FOREACH (Worker &worker, m_workers) {
+            g_thread_join(worker.m_thread);
+        }
+#endif
+    }
+
+    void push(const std::vector< boost::shared_ptr<PendingWrite> > &writes)
+    {
+        DynMutex::Guard guard = m_mutex.lock();
+        m_queue.insert(m_queue.end(), writes.begin(), writes.end());
+        m_cond.broadcast();
+    }
+
+    bool isDone(const PendingWrite &write)
+    {
+        DynMutex::Guard guard = m_mutex.lock();
+        return write.m_done;
+    }
+
+    /** block until all queued writes are done */
+    void wait()
+    {
+        DynMutex::Guard guard = m_mutex.lock();
+        while (!m_queue.empty() || m_running) {
+            m_cond.wait(m_mutex);
+        }
+    }
+};
+
+bool WebDAVSource::pipelineWrites()
+{
+#ifdef HAVE_THREAD_SUPPORT
+    if (m_parallelWrites <= 1) {
+        return false;
+    }
+    // OAuth2 tokens get refreshed via callbacks which update the
+    // config; that must not happen in the pipeline threads.
+    boost::shared_ptr<AuthProvider> authProvider = m_settings->getAuthProvider();
+    return !authProvider ||
+        !authProvider->methodIsSupported(AuthProvider::AUTH_METHOD_OAUTH2);
+#else
+    return false;
+#endif
+}
+
+static const char putOperation[] = "PUT";
+static const char postOperation[] = "POST";
+
+void WebDAVSource::prepareWrite(const std::string &uid, const std::string &item, PendingWrite &write)
+{
+    write.m_uid = uid;
+    write.m_item = item;
 
     // By default use PUT. Change that to POST when creating new items
     // and server supports it. That avoids the problem of having to
     // choose a path and figuring out whether the server really used it.
-    static const char putOperation[] = "PUT";
-    static const char postOperation[] = "POST";
-    const char *operation = putOperation;
+    write.m_operation = putOperation;
     if (uid.empty()) {
         checkPostSupport();
         if (!m_postPath.empty()) {
-            operation = postOperation;
+            write.m_operation = postOperation;
         }
     }
-    Timespec deadline = createDeadline(); // no resending if left empty
-    m_session->startOperation(operation, deadline);
-    std::string result;
-    int counter = 0;
- retry:
-    counter++;
-    result = "";
+
+    std::string buffer;
+    const std::string *data;
     if (uid.empty()) {
         // Pick a resource name (done by derived classes, by default random),
         // catch unexpected conflicts via If-None-Match: *.
-        std::string buffer;
-        const std::string *data = createResourceName(item, buffer, new_uid);
-        Neon::Request req(*m_session, operation,
-                          operation == postOperation ? m_postPath : luid2path(new_uid),
-                          *data, result);
+        data = createResourceName(item, buffer, write.m_newUID);
+        write.m_path = write.m_operation == postOperation ? m_postPath : luid2path(write.m_newUID);
+    } else {
+        write.m_newUID = uid;
+        data = setResourceName(item, buffer, write.m_newUID);
+        write.m_path = luid2path(write.m_newUID);
+    }
+    write.m_data = *data;
+    write.m_contentType = contentType();
+    write.m_deadline = createDeadline(); // no resending if left empty
+}
+
+void WebDAVSource::sendItem(Neon::Session &session, PendingWrite &write)
+{
+    session.startOperation(write.m_operation, write.m_deadline);
+    std::string result;
+    int counter = 0;
+    while (true) {
+        counter++;
+        Neon::Request req(session, write.m_operation, write.m_path,
+                          write.m_data, result);
         // Clearing the idempotent flag would allow us to clearly
         // distinguish between a connection error (no changes made
         // on server) and a server failure (may or may not have
@@ -2108,7 +2585,7 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
         // first.
         //
         // But because we are going to try resending
-        // the PUT anyway in case of 5xx errors we might as well 
+        // the PUT anyway in case of 5xx errors we might as well
         // treat it like an idempotent request (which it is,
         // in a way, because we'll try to get our data onto
         // the server no matter what) and keep reusing an
@@ -2117,18 +2594,50 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
 
         // For this to work we must allow the server to overwrite
         // an item that we might have created before. Don't allow
-        // that in the first attempt. Only relevant for PUT.
-        if (operation != postOperation && counter == 1) {
+        // that in the first attempt. Only relevant for PUT of
+        // a new item.
+        if (write.m_uid.empty() &&
+            write.m_operation != postOperation &&
+            counter == 1) {
             req.addHeader("If-None-Match", "*");
         }
-        req.addHeader("Content-Type", contentType().c_str());
+        req.addHeader("Content-Type", write.m_contentType);
+        // TODO: match exactly the expected revision, aka ETag,
+        // or implement locking when updating. Note that the ETag might not be
+        // known, for example in this case:
+        // - PUT succeeds
+        // - PROPGET does not
+        // - insertItem() fails
+        // - Is retried? Might need slow sync in this case!
+        //
+        // req.addHeader("If-Match", etag);
         static const std::set<int> expected = boost::assign::list_of(412)(403);
-        if (!req.run(&expected)) {
-            goto retry;
+        if (req.run(write.m_uid.empty() ? &expected : NULL)) {
+            write.m_code = req.getStatusCode();
+            write.m_status = Neon::Status2String(req.getStatus());
+            write.m_etag = req.getResponseHeader("ETag");
+            write.m_location = req.getResponseHeader("Location");
+            return;
         }
+    }
+}
+
+TrackingSyncSource::InsertItemResult WebDAVSource::evaluateWrite(PendingWrite &write)
+{
+    if (!write.m_failure.empty()) {
+        Exception::tryRethrow(write.m_failure, true);
+    }
+
+    const std::string &item = write.m_item;
+    const Timespec &deadline = write.m_deadline;
+    std::string new_uid = write.m_newUID;
+    std::string rev;
+    InsertItemResultState state = ITEM_OKAY;
+
+    if (write.m_uid.empty()) {
         SE_LOG_DEBUG(NULL, "add item status: %s",
-                     Neon::Status2String(req.getStatus()).c_str());
-        switch (req.getStatusCode()) {
+                     write.m_status.c_str());
+        switch (write.m_code) {
         case 204:
             // stored, potentially in a different resource than requested
             // when the UID was recognized
@@ -2152,7 +2661,7 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
             //
             // Handling that would be nice (see FDO #77424), but for now we just
             // do the same as for "Precondition Failed" and search for the UID.
-            if (operation == postOperation) {
+            if (write.m_operation == postOperation) {
                 try {
                     std::string uid = extractUID(item);
                     if (!uid.empty()) {
@@ -2166,8 +2675,8 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
             }
             SE_THROW_EXCEPTION_STATUS(TransportStatusException,
                                       std::string("unexpected status for PUT: ") +
-                                      Neon::Status2String(req.getStatus()),
-                                      SyncMLStatus(req.getStatus()->code));
+                                      write.m_status,
+                                      SyncMLStatus(write.m_code));
             break;
         case 412: {
             // "Precondition Failed": our only precondition is the one about
@@ -2182,12 +2691,12 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
         default:
             SE_THROW_EXCEPTION_STATUS(TransportStatusException,
                                       std::string("unexpected status for insert: ") +
-                                      Neon::Status2String(req.getStatus()),
-                                      SyncMLStatus(req.getStatus()->code));
+                                      write.m_status,
+                                      SyncMLStatus(write.m_code));
             break;
         }
-        rev = getETag(req);
-        std::string real_luid = getLUID(req);
+        rev = ETag2Rev(write.m_etag);
+        std::string real_luid = location2LUID(write.m_location);
         if (!real_luid.empty()) {
             // Google renames the resource automatically to something of the form
             // <UID>.ics. Interestingly enough, our 1234567890!@#$%^&*()<>@dummy UID
@@ -2234,29 +2743,9 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
             }
         }
     } else {
-        new_uid = uid;
-        std::string buffer;
-        const std::string *data = setResourceName(item, buffer, new_uid);
-        Neon::Request req(*m_session, "PUT", luid2path(new_uid),
-                          *data, result);
-        // See above for discussion of idempotent and PUT.
-        // req.setFlag(NE_REQFLAG_IDEMPOTENT, 0);
-        req.addHeader("Content-Type", contentType());
-        // TODO: match exactly the expected revision, aka ETag,
-        // or implement locking. Note that the ETag might not be
-        // known, for example in this case:
-        // - PUT succeeds
-        // - PROPGET does not
-        // - insertItem() fails
-        // - Is retried? Might need slow sync in this case!
-        //
-        // req.addHeader("If-Match", etag);
-        if (!req.run()) {
-            goto retry;
-        }
         SE_LOG_DEBUG(NULL, "update item status: %s",
-                     Neon::Status2String(req.getStatus()).c_str());
-        switch (req.getStatusCode()) {
+                     write.m_status.c_str());
+        switch (write.m_code) {
         case 204:
             // the expected outcome, as we were asking for an overwrite
             break;
@@ -2268,12 +2757,12 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
         default:
             SE_THROW_EXCEPTION_STATUS(TransportStatusException,
                                       std::string("unexpected status for update: ") +
-                                      Neon::Status2String(req.getStatus()),
-                                      SyncMLStatus(req.getStatus()->code));
+                                      write.m_status,
+                                      SyncMLStatus(write.m_code));
             break;
         }
-        rev = getETag(req);
-        std::string real_luid = getLUID(req);
+        rev = ETag2Rev(write.m_etag);
+        std::string real_luid = location2LUID(write.m_location);
         if (!real_luid.empty() && real_luid != new_uid) {
             SE_THROW(StringPrintf("updating item: real luid %s does not match old luid %s",
                                   real_luid.c_str(), new_uid.c_str()));
@@ -2301,6 +2790,71 @@ TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid,
     return InsertItemResult(new_uid, rev, state);
 }
 
+TrackingSyncSource::InsertItemResult WebDAVSource::insertItem(const string &uid, const std::string &item, bool raw)
+{
+    PendingWrite write;
+    prepareWrite(uid, item, write);
+    sendItem(*m_session, write);
+    return evaluateWrite(write);
+}
+
+TrackingSyncSource::InsertItemResult WebDAVSource::insertItemPipelined(const string &uid, const std::string &item, bool raw)
+{
+    if (!pipelineWrites()) {
+        return insertItem(uid, item, raw);
+    }
+
+    if (!uid.empty() &&
+        m_pendingLUIDs.find(uid) != m_pendingLUIDs.end()) {
+        // Must not have two writes of the same resource in flight.
+        SE_LOG_DEBUG(getDisplayName(), "%s: waiting for pending write", uid.c_str());
+        finishItemChanges();
+    }
+
+    boost::shared_ptr<PendingWrite> write(new PendingWrite);
+    prepareWrite(uid, item, *write);
+    if (uid.empty() &&
+        m_pendingLUIDs.find(write->m_newUID) != m_pendingLUIDs.end()) {
+        // Same UID added twice, let the second one run into the
+        // 412 of the first one.
+        finishItemChanges();
+    }
+    m_pendingLUIDs.insert(write->m_newUID);
+    m_pendingWrites.push_back(write);
+    return InsertItemResult(boost::bind(&WebDAVSource::checkPipelinedInsert, this, write));
+}
+
+TrackingSyncSource::InsertItemResult WebDAVSource::checkPipelinedInsert(const boost::shared_ptr<PendingWrite> &write)
+{
+    if (!m_pipeline || !m_pipeline->isDone(*write)) {
+        return InsertItemResult(boost::bind(&WebDAVSource::checkPipelinedInsert, this, write));
+    }
+    return evaluateWrite(*write);
+}
+
+void WebDAVSource::flushItemChanges()
+{
+    if (!m_pendingWrites.empty()) {
+        if (!m_pipeline) {
+            SE_LOG_DEBUG(getDisplayName(), "starting %d sessions for parallel writes", m_parallelWrites);
+            m_pipeline.reset(new WritePipeline(*m_settings, m_session->getURL(), m_parallelWrites));
+        }
+        SE_LOG_DEBUG(getDisplayName(), "sending %d items in parallel", (int)m_pendingWrites.size());
+        m_pipeline->push(m_pendingWrites);
+        m_pendingWrites.clear();
+    }
+}
+
+void WebDAVSource::finishItemChanges()
+{
+    flushItemChanges();
+    if (m_pipeline && !m_pendingLUIDs.empty()) {
+        SE_LOG_DEBUG(getDisplayName(), "waiting for parallel writes to complete");
+        m_pipeline->wait();
+    }
+    m_pendingLUIDs.clear();
+}
+
 std::string WebDAVSource::ETag2Rev(const std::string &etag)
 {
     std::string res = etag;
@@ -2315,9 +2869,8 @@ std::string WebDAVSource::ETag2Rev(const std::string &etag)
     return res;
 }
 
-std::string WebDAVSource::getLUID(Neon::Request &req)
+std::string WebDAVSource::location2LUID(const std::string &location)
 {
-    std::string location = req.getResponseHeader("Location");
     if (location.empty()) {
         return location;
     } else {
@@ -2359,6 +2912,9 @@ Timespec WebDAVSource::createDeadline() const
 
 void WebDAVSource::removeItem(const string &uid)
 {
+    // DELETE is not pipelined, TrackingSyncSource::deleteItem()
+    // needs the result right away.
+    finishItemChanges();
     Timespec deadline = createDeadline();
     m_session->startOperation("DELETE", deadline);
     std::string item, result;
@@ -46,6 +46,8 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
      */
     static void replaceHTMLEntities(std::string &item);
 
+    friend class WebDAVTest;
+
  protected:
     /**
      * Initialize HTTP session and locate the right collection.
@@ -88,12 +90,14 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
     /** intercept TrackingSyncSource::beginSync() to do the expensive initialization */
     virtual void beginSync(const std::string &lastToken, const std::string &resumeToken) {
         contactServer();
+        m_syncToken = InitStateString();
         TrackingSyncSource::beginSync(lastToken, resumeToken);
     }
     /** hook into session to store infos */
     virtual std::string endSync(bool success) {
         if (success) {
              storeServerInfos();
+             storeSyncToken();
 	}
 	return TrackingSyncSource::endSync(success);
     }
@@ -104,10 +108,28 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
     /* implementation of TrackingSyncSource interface */
     virtual std::string databaseRevision();
     virtual void listAllItems(RevisionMap_t &revisions);
+    virtual void updateAllItems(RevisionMap_t &revisions);
     virtual InsertItemResult insertItem(const string &luid, const std::string &item, bool raw);
     void readItem(const std::string &luid, std::string &item, bool raw);
     virtual void removeItem(const string &uid);
 
+    /**
+     * Same as insertItem(), but the request may be sent by one of
+     * several parallel HTTP sessions in the background. The result
+     * then is a check function which is ready once
+     * finishItemChanges() has been called.
+     *
+     * Falls back to insertItem() unless enabled via
+     * SYNCEVOLUTION_WEBDAV_PARALLEL_WRITES=<number of sessions>
+     * and only usable by derived classes which don't need the
+     * result right away.
+     */
+    InsertItemResult insertItemPipelined(const string &luid, const std::string &item, bool raw);
+
+    /* implementation of SyncSource interface: send and wait for pipelined writes */
+    virtual void flushItemChanges();
+    virtual void finishItemChanges();
+
     /**
      * A resource path is turned into a locally unique ID by
      * stripping the calendar path prefix, or keeping the full
@@ -245,6 +267,32 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
      */
     InitStateString m_postPath;
 
+    /**
+     * One PUT or POST of an item, see insertItem(). Prepared and
+     * evaluated in the main thread, sent either directly or by the
+     * WritePipeline.
+     */
+    struct PendingWrite;
+    class WritePipeline;
+
+    /** maximum number of parallel sessions for item writes, <= 1 disables pipelining */
+    int m_parallelWrites;
+
+    /** created on demand by flushItemChanges() */
+    boost::shared_ptr<WritePipeline> m_pipeline;
+
+    /** writes queued by insertItemPipelined() since last flushItemChanges() */
+    std::vector< boost::shared_ptr<PendingWrite> > m_pendingWrites;
+
+    /** luids with writes not completed yet, must not be written again until then */
+    std::set<std::string> m_pendingLUIDs;
+
+    bool pipelineWrites();
+    void prepareWrite(const std::string &uid, const std::string &item, PendingWrite &write);
+    static void sendItem(Neon::Session &session, PendingWrite &write);
+    InsertItemResult evaluateWrite(PendingWrite &write);
+    InsertItemResult checkPipelinedInsert(const boost::shared_ptr<PendingWrite> &write);
+
     /**
      * Information about certain paths (path->property->value).
      * The container acts like a hash (supports indexing with unique string)
@@ -266,6 +314,52 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
     /** extract all <DAV:href>value</DAV:href> values from a set, empty if none */
     std::list<std::string> extractHREFs(const std::string &propval);
 
+    /**
+     * Result of the DAV:sync-token property, read before listing all
+     * items, or the new token from the last sync-collection
+     * REPORT. Unset if neither happened, empty if not supported.
+     * Stored persistently by endSync().
+     */
+    InitStateString m_syncToken;
+
+    /** true if the collection may be tracked via RFC 6578 sync-collection */
+    bool useSyncToken();
+
+    /** DAV:sync-token property of the collection, empty if not supported */
+    std::string readSyncToken();
+
+    /**
+     * RFC 6578 sync-collection REPORT for changes since the given
+     * (non-empty) token. Items reported as changed are updated in
+     * revisions, removed ones are erased.
+     *
+     * @return new sync token, empty if the server didn't send one
+     */
+    std::string syncCollection(const std::string &token, RevisionMap_t &revisions);
+
+    /**
+     * Set up parsing of a sync-collection REPORT result. Changed
+     * items are updated in revisions, removed ones erased, the new
+     * token is stored in newToken and truncated gets set if the
+     * server sent only some of the changes. href, etag and status
+     * hold the current response while parsing.
+     */
+    void initSyncCollectionParser(Neon::XMLParser &parser,
+                                  RevisionMap_t &revisions,
+                                  std::string &newToken,
+                                  std::string &href,
+                                  std::string &etag,
+                                  std::string &status,
+                                  bool &truncated);
+
+    int syncCollectionResponse(RevisionMap_t &revisions,
+                               std::string &href,
+                               std::string &etag,
+                               std::string &status,
+                               bool &truncated);
+
+    void storeSyncToken();
+
     void openPropCallback(Props_t &davProps,
                           const Neon::URI &uri,
                           const ne_propname *prop,
@@ -315,7 +409,12 @@ class WebDAVSource : public TrackingSyncSource, private boost::noncopyable
     /**
      * Extracts new LUID from response header, empty if not found.
      */
-    std::string getLUID(Neon::Request &req);
+    std::string getLUID(Neon::Request &req) { return location2LUID(req.getResponseHeader("Location")); }
+
+    /**
+     * Turns the value of a Location header into a LUID, empty if empty.
+     */
+    std::string location2LUID(const std::string &location);
 };
 
 SE_END_CXX
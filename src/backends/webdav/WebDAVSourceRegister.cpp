@@ -136,6 +136,7 @@ class WebDAVTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(WebDAVTest);
     CPPUNIT_TEST(testInstantiate);
     CPPUNIT_TEST(testHTMLEntities);
+    CPPUNIT_TEST(testSyncCollection);
     CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -203,6 +204,60 @@ protected:
         CPPUNIT_ASSERT_EQUAL(std::string("&#quot ;"),
                              decode("&#quot ;"));
     }
+
+    void testSyncCollection() {
+        boost::shared_ptr<TestingSyncSource> source;
+        source.reset((TestingSyncSource *)SyncSource::createTestingSource("CardDAV", "CardDAV", true));
+        WebDAVSource *dav = dynamic_cast<WebDAVSource *>(source.get());
+        CPPUNIT_ASSERT(dav);
+        dav->getCalendar() = Neon::URI::parse("http://example.com/addressbook/", true);
+
+        // changed, added and removed items plus the collection
+        // itself, reported because the result was truncated
+        const char *result =
+            "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n"
+            "<D:multistatus xmlns:D=\"DAV:\">\n"
+            "<D:response>\n"
+            "<D:href>/addressbook/changed.vcf</D:href>\n"
+            "<D:propstat><D:prop><D:getetag>\"2\"</D:getetag></D:prop>\n"
+            "<D:status>HTTP/1.1 200 OK</D:status></D:propstat>\n"
+            "</D:response>\n"
+            "<D:response>\n"
+            "<D:href>/addressbook/new%20item.vcf</D:href>\n"
+            "<D:propstat><D:prop><D:getetag>W/\"1\"</D:getetag></D:prop>\n"
+            "<D:status>HTTP/1.1 200 OK</D:status></D:propstat>\n"
+            "</D:response>\n"
+            "<D:response>\n"
+            "<D:href>/addressbook/removed.vcf</D:href>\n"
+            "<D:status>HTTP/1.1 404 Not Found</D:status>\n"
+            "</D:response>\n"
+            "<D:response>\n"
+            "<D:href>/addressbook/</D:href>\n"
+            "<D:status>HTTP/1.1 507 Insufficient Storage</D:status>\n"
+            "</D:response>\n"
+            "<D:sync-token>http://example.com/sync/2</D:sync-token>\n"
+            "</D:multistatus>\n";
+
+        SyncSourceRevisions::RevisionMap_t revisions;
+        revisions["changed.vcf"] = "1";
+        revisions["removed.vcf"] = "1";
+        revisions["unchanged.vcf"] = "1";
+        std::string newToken, href, etag, status;
+        bool truncated = false;
+        Neon::XMLParser parser;
+        dav->initSyncCollectionParser(parser, revisions,
+                                      newToken, href, etag, status,
+                                      truncated);
+        CPPUNIT_ASSERT(!ne_xml_parse(parser.get(), result, strlen(result)));
+        CPPUNIT_ASSERT(!ne_xml_parse(parser.get(), "", 0));
+
+        CPPUNIT_ASSERT_EQUAL(std::string("http://example.com/sync/2"), newToken);
+        CPPUNIT_ASSERT(truncated);
+        CPPUNIT_ASSERT_EQUAL((size_t)3, revisions.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("2"), revisions["changed.vcf"]);
+        CPPUNIT_ASSERT_EQUAL(std::string("1"), revisions["new item.vcf"]);
+        CPPUNIT_ASSERT_EQUAL(std::string("1"), revisions["unchanged.vcf"]);
+    }
 };
 
 SYNCEVOLUTION_TEST_SUITE_REGISTRATION(WebDAVTest);
@@ -20,11 +20,52 @@
 #include "filtered-view.h"
 #include <syncevo/lcs.h>
 #include <iterator>
+#include <algorithm>
 #include <syncevo/BoostHelper.h>
 
 #include <syncevo/declarations.h>
 SE_BEGIN_CXX
 
+/**
+ * Iterates over the indices in the parent view which need to be
+ * checked against a filter, starting at a certain index: either all
+ * of them or just those returned by IndividualView::getCandidates().
+ */
+class FilterCandidates
+{
+    std::vector<int> m_indices;
+    bool m_indexed;
+    std::vector<int>::const_iterator m_next;
+    int m_candidate;
+    int m_size;
+
+public:
+    FilterCandidates(IndividualView &parent, const IndividualFilter &filter, int start) :
+        m_indexed(parent.getCandidates(filter, m_indices)),
+        m_candidate(start),
+        m_size(parent.size())
+    {
+        m_next = std::lower_bound(m_indices.begin(), m_indices.end(), start);
+    }
+
+    /** stores next index and returns true, false if none left */
+    bool next(int &index)
+    {
+        if (m_indexed) {
+            if (m_next == m_indices.end()) {
+                return false;
+            }
+            index = *m_next++;
+        } else {
+            if (m_candidate >= m_size) {
+                return false;
+            }
+            index = m_candidate++;
+        }
+        return true;
+    }
+};
+
 FilteredView::FilteredView(const boost::shared_ptr<IndividualView> &parent,
                            const boost::shared_ptr<IndividualFilter> &filter) :
     m_parent(parent),
@@ -68,7 +109,9 @@ void FilteredView::doStart()
     // Add initial content. Our processing of the new contact must not
     // cause changes to the parent view, otherwise the result will not
     // be inconsistent.
-    for (int index = 0; !isFull() && index < m_parent->size(); index++) {
+    FilterCandidates candidates(*m_parent, *m_filter, 0);
+    int index;
+    while (!isFull() && candidates.next(index)) {
         addIndividual(index, *m_parent->getContact(index));
     }
 
@@ -90,12 +133,13 @@ void FilteredView::fillViewCb()
     // Can we add back contacts which were excluded because of the
     // maximum number of results?
     SE_LOG_DEBUG(NULL, "filtered view %s: fill view on idle", getName());
-    int candidate = m_local2parent.empty() ? 0 : m_local2parent.back() + 1;
+    FilterCandidates candidates(*m_parent, *m_filter,
+                                m_local2parent.empty() ? 0 : m_local2parent.back() + 1);
+    int candidate;
     while (!isFull() &&
-           candidate < m_parent->size()) {
+           candidates.next(candidate)) {
         const IndividualData *data = m_parent->getContact(candidate);
         addIndividual(candidate, *data);
-        candidate++;
     }
 }
 
@@ -118,24 +162,38 @@ void FilteredView::replaceFilter(const boost::shared_ptr<IndividualFilter> &indi
     }
     individualFilter->setMaxResults(m_filter->getMaxResults());
 
+    // The caller might not know that the new search is more strict,
+    // for example when the user just typed one more character of
+    // the search term. The filter itself might know.
+    if (!refine &&
+        (dynamic_cast<MatchAll *>(m_filter.get()) ||
+         individualFilter->isRefinementOf(*m_filter))) {
+        SE_LOG_DEBUG(NULL, "filtered view %s: new filter refines old one", getName());
+        refine = true;
+    }
+
     if (refine) {
         // Take advantage of the hint that the search is more strict:
         // we know that we can limit searching to the contacts which
         // already matched the previous search.
+        //
+        // Entries which still match are moved to the front, so
+        // the recipient of the signals always sees the kept entries
+        // up to keptIndex followed by the not yet checked ones.
         bool removed = false;
-        size_t index = 0;
-        while (index < m_local2parent.size()) {
+        size_t keptIndex = 0;
+        for (size_t index = 0; index < m_local2parent.size(); index++) {
             const IndividualData *data = m_parent->getContact(m_local2parent[index]);
             if (individualFilter->matches(*data)) {
-                // Still matched, just skip it.
-                ++index;
+                // Still matched, keep it.
+                m_local2parent[keptIndex++] = m_local2parent[index];
             } else {
                 // No longer matched, remove it.
-                m_local2parent.erase(m_local2parent.begin() + index);
-                m_removedSignal(index, *data);
+                m_removedSignal(keptIndex, *data);
                 removed = true;
             }
         }
+        m_local2parent.resize(keptIndex);
         m_filter = individualFilter;
 
         if (removed) {
@@ -173,14 +231,14 @@ void FilteredView::replaceFilter(const boost::shared_ptr<IndividualFilter> &indi
         //
         // 1. build new result list.
         Entries_t local2parent;
-        int candidate = 0;
+        FilterCandidates candidates(*m_parent, *individualFilter, 0);
+        int candidate;
         while (!isFull(local2parent, individualFilter) &&
-               candidate < m_parent->size()) {
+               candidates.next(candidate)) {
             const IndividualData *data = m_parent->getContact(candidate);
             if (individualFilter->matches(*data)) {
                 local2parent.push_back(candidate);
             }
-            candidate++;
         }
 
         // 2. morph existing one into new one.
@@ -188,70 +246,53 @@ void FilteredView::replaceFilter(const boost::shared_ptr<IndividualFilter> &indi
         // Uses the SyncEvolution longest-common-subsequence
         // algorithm.  Because all entries are different, there can be
         // only one solution and thus there is no need for a cost
-        // function to find "better" solutions.
+        // function to find "better" solutions. Because both lists
+        // are sorted by parent index, the LCS can be found by merging
+        // them in linear time, instead of the quadratic time and
+        // memory needed by the generic LCS::lcs().
         std::vector< LCS::Entry<int> > common;
         common.reserve(std::min(m_local2parent.size(), local2parent.size()));
-        LCS::lcs(m_local2parent, local2parent, std::back_inserter(common), LCS::accessor_sequence<Entries_t>());
+        LCS::lcs_sorted(m_local2parent, local2parent, std::back_inserter(common), LCS::accessor_sequence<Entries_t>());
 
         // To emit the discovered changes as "added" and "removed"
-        // signals, we need to look at identical entries.
-
-        // The "delta" here always represents the value "new = b" -
-        // "old = a" which needs to be added to the old index to get
-        // the new one. It summarizes the change signals emitted so
-        // far. For each common entry, we need to check if the delta
-        // is different from what we have told the agent so far.
-        int delta = 0;
-
-        // The "shift" is the "old modified" - "old original" that
-        // tells us how many entries were added (positive value) or
-        // removed (negative value) via signals.
-        int shift = 0;
-
+        // signals, we need to look at the gaps between identical
+        // entries. Entries in the old list which are in a gap get
+        // removed, entries in the new list get added.
+        //
         // Old and new index represent the indices of the previous
         // common element plus 1; in other words, the expected next
-        // common element.
+        // common element. The recipient's view always consists of
+        // the new entries up to newIndex followed by the old entries
+        // starting at oldIndex, so removing and adding happens at
+        // newIndex.
         size_t oldIndex = 0,
             newIndex = 0;
 
         BOOST_FOREACH (const LCS::Entry<int> &entry, common) {
-            int new_delta = (ssize_t)entry.index_b - (ssize_t)entry.index_a;
-            if (delta != new_delta) {
-                // When emitting "added" or "removed" signals,
-                // be careful about getting the original index
-                // in the old set right. It needs to be adjusted
-                // to include the already sent changes.
-                if (delta < new_delta) {
-                    size_t change = new_delta - delta;
-                    for (size_t i = 0; i < change; i++) {
-                        const IndividualData *data = m_parent->getContact(local2parent[newIndex + i]);
-                        // Keep adding at new indices, one new element
-                        // after the other.
-                        m_addedSignal(oldIndex - shift + i, *data);
-                    }
-                    shift -= change;
-                } else if (delta > new_delta) {
-                    size_t change = delta - new_delta;
-                    shift += change;
-                    for (size_t i = 0; i < change; i++) {
-                        size_t index = oldIndex - shift;
-                        const IndividualData *data = m_parent->getContact(m_local2parent[index + i]);
-                        // Keep removing at the same index, because
-                        // that's how it'll look to the recipient.
-                        m_removedSignal(index, *data);
-                    }
-                }
-                new_delta = delta;
+            // LCS indices are 1-based.
+            size_t index_a = entry.index_a - 1,
+                index_b = entry.index_b - 1;
+            for (size_t index = oldIndex; index < index_a; index++) {
+                const IndividualData *data = m_parent->getContact(m_local2parent[index]);
+                // Keep removing at the same index, because
+                // that's how it'll look to the recipient.
+                m_removedSignal(newIndex, *data);
+            }
+            for (size_t index = newIndex; index < index_b; index++) {
+                const IndividualData *data = m_parent->getContact(local2parent[index]);
+                // Keep adding at new indices, one new element
+                // after the other.
+                m_addedSignal(index, *data);
             }
-            oldIndex = entry.index_a + 1;
-            newIndex = entry.index_b + 1;
+            oldIndex = index_a + 1;
+            newIndex = index_b + 1;
         }
 
         // Now deal with entries after the latest common entry, in
         // both arrays.
         for (size_t index = oldIndex; index < m_local2parent.size(); index++) {
             const IndividualData *data = m_parent->getContact(m_local2parent[index]);
-            m_removedSignal(oldIndex - shift, *data);
+            m_removedSignal(newIndex, *data);
         }
         for (size_t index = newIndex; index < local2parent.size(); index++) {
             const IndividualData *data = m_parent->getContact(local2parent[index]);
@@ -82,6 +82,12 @@ public:
             IndividualCompare::compare(b, a) :
             IndividualCompare::compare(a, b);
     }
+
+    virtual bool createSortKey(const Criteria_t &criteria, std::string &key) const {
+        // The reversed order cannot be expressed with a key.
+        return !m_reversed &&
+            IndividualCompare::createSortKey(criteria, key);
+    }
 };
 
 boost::shared_ptr<IndividualCompare> IndividualCompare::defaultCompare()
@@ -99,6 +105,7 @@ bool IndividualData::init(const IndividualCompare *compare,
     if (compare) {
         m_criteria.clear();
         compare->createCriteria(individual, m_criteria);
+        m_hasSortKey = compare->createSortKey(m_criteria, m_sortKey);
     }
     if (locale) {
         precomputedModified = locale->precompute(individual, m_precomputed);
@@ -135,6 +142,30 @@ bool IndividualCompare::compare(const Criteria_t &a, const Criteria_t &b) const
     return false;
 }
 
+bool IndividualCompare::createSortKey(const Criteria_t &criteria, std::string &key) const
+{
+    // Each criterion gets terminated with a 0 byte. 0 and 1 bytes
+    // inside the criterion are escaped as 1 1 and 1 2, so all bytes
+    // of a criterion are larger than the terminator. That way, a
+    // shorter criterion still sorts before a longer one with the
+    // same prefix, and the next criterion is only relevant when the
+    // previous ones are equal.
+    key.clear();
+    BOOST_FOREACH (const std::string &criterion, criteria) {
+        key.reserve(key.size() + criterion.size() + 1);
+        BOOST_FOREACH (char c, criterion) {
+            if (c == '\0' || c == '\1') {
+                key += '\1';
+                key += (char)(c + 1);
+            } else {
+                key += c;
+            }
+        }
+        key += '\0';
+    }
+    return true;
+}
+
 IndividualAggregator::IndividualAggregator(const boost::shared_ptr<LocaleFactory> &locale) :
     m_locale(locale),
     m_databases(gee_hash_set_new(G_TYPE_STRING, (GBoxedCopyFunc) g_strdup, g_free, NULL, NULL, NULL, NULL, NULL, NULL), TRANSFER_REF)
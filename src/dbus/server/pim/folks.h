@@ -104,6 +104,22 @@ class IndividualCompare
      * Default implementation uses normal std::string::compare().
      */
     virtual bool compare(const Criteria_t &a, const Criteria_t &b) const;
+
+    /**
+     * Combines the criteria into a single string such that
+     * comparing two keys with std::string::compare() (= memcmp())
+     * gives the same result as compare() for the criteria. Sorting
+     * then avoids a virtual method call and iterating over the
+     * criteria for each comparison.
+     *
+     * The default implementation matches the default compare(),
+     * derived classes which change compare() must override this
+     * method, too.
+     *
+     * @retval key    the combined key
+     * @return false if not possible, compare() must be used
+     */
+    virtual bool createSortKey(const Criteria_t &criteria, std::string &key) const;
 };
 
 /**
@@ -111,6 +127,8 @@ class IndividualCompare
  */
 struct IndividualData
 {
+    IndividualData() : m_hasSortKey(false) {}
+
     /**
      * Sets all members to match the given individual, using the
      * compare instance to compute values. Both compare and locale may
@@ -125,6 +143,10 @@ struct IndividualData
     FolksIndividualCXX m_individual;
     IndividualCompare::Criteria_t m_criteria;
     LocaleFactory::Precomputed m_precomputed;
+
+    /** IndividualCompare::createSortKey() for m_criteria, if m_hasSortKey */
+    bool m_hasSortKey;
+    std::string m_sortKey;
 };
 
 /**
@@ -144,7 +166,9 @@ class IndividualDataCompare : public std::binary_function<IndividualData, Indivi
 
     bool operator () (const IndividualData &a, const IndividualData &b) const
     {
-        return m_compare->compare(a.m_criteria, b.m_criteria);
+        return a.m_hasSortKey && b.m_hasSortKey ?
+            a.m_sortKey < b.m_sortKey :
+            m_compare->compare(a.m_criteria, b.m_criteria);
     }
 };
 
@@ -178,6 +202,34 @@ class IndividualFilter
 
     /** true if the contact matches the filter */
     virtual bool matches(const IndividualData &data) const = 0;
+
+    /**
+     * Evaluates the filter with nothing but the precomputed data of
+     * a contact, without access to the FolksIndividual. Used for
+     * searching in a ViewSnapshot.
+     *
+     * @retval result    true if the contact matches the filter
+     * @return false if the filter cannot be evaluated that way
+     */
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const { return false; }
+
+    /**
+     * True if the filter only matches contacts which have a certain
+     * phone number in LocaleFactory::Precomputed::m_phoneNumbers,
+     * stored in number. Such a filter can be answered with
+     * IndividualView::getCandidates() instead of checking all
+     * contacts.
+     */
+    virtual bool getPhoneNumber(SimpleE164 &number) const { return false; }
+
+    /**
+     * True if it is certain that this filter matches only contacts
+     * which are also matched by the other filter, for example
+     * because it looks for a longer substring in the same field.
+     * Then searching can be limited to the results of the other
+     * filter. False if uncertain.
+     */
+    virtual bool isRefinementOf(const IndividualFilter &other) const { return false; }
 };
 
 /**
@@ -188,6 +240,7 @@ class MatchAll : public IndividualFilter
 {
  public:
     virtual bool matches(const IndividualData &data) const { return true; }
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const { result = true; return true; }
 };
 
 /**
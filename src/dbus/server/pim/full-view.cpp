@@ -18,6 +18,7 @@
  */
 
 #include "full-view.h"
+#include "test.h"
 
 #include <syncevo/BoostHelper.h>
 
@@ -32,6 +33,7 @@ FullView::FullView(const FolksIndividualAggregatorCXX &folks,
     m_locale(locale),
     m_localeChanged(false), // set only after explicit setLocale()
     m_isQuiescent(false),
+    m_quiescenceDelayed(false),
     // Ensure that there is a sort criteria.
     m_compare(IndividualCompare::defaultCompare())
 {
@@ -68,8 +70,15 @@ void FullView::doStart()
     }
     individuals.sort(IndividualDataCompare(m_compare));
 
-    // Copy the sorted data into the view in one go.
-    m_entries.insert(m_entries.begin(), individuals.begin(), individuals.end());
+    // Move the sorted data into the view in one go.
+    m_entries.assign(individuals);
+    std::vector<IndividualData *> entries;
+    m_entries.getValues(entries);
+    m_individuals.clear();
+    BOOST_FOREACH (IndividualData *entry, entries) {
+        m_individuals[entry->m_individual.get()] = entry;
+    }
+    rebuildPhoneIndex();
     // Avoid loop if no-one is listening.
     if (!m_addedSignal.empty()) {
         for (size_t index = 0; index < m_entries.size(); index++) {
@@ -137,11 +146,14 @@ void FullView::individualsChanged(GeeSet *added,
         }
     }
     if (added) {
-        // TODO (?): Optimize adding many new individuals by pre-sorting them,
-        // then using that information to avoid comparisons in addIndividual().
+        Batch_t batch;
+        batch.reserve(gee_collection_get_size(GEE_COLLECTION(added)));
         BOOST_FOREACH (FolksIndividual *individual, Coll(added, ADD_REF)) {
-            addIndividual(individual);
+            Entries_t::auto_type data(new IndividualData);
+            data->init(m_compare.get(), m_locale.get(), individual);
+            batch.push_back(data.release());
         }
+        doAddIndividuals(batch);
     }
 }
 
@@ -170,13 +182,15 @@ void FullView::quiescenceChanged()
     // "enter and leave quiescence state".
     if (quiescent) {
         int seconds = atoi(getEnv("SYNCEVOLUTION_PIM_DELAY_FOLKS", "0"));
-        if (seconds > 0) {
-            // Delay the quiescent state change as requested.
+        if (seconds > 0 && !m_quiescenceDelayed) {
+            // Delay the quiescent state change as requested, once
+            // per aggregator. The manager creates a new one when
+            // restarting.
             SE_LOG_DEBUG(NULL, "delay aggregrator quiescence by %d seconds", seconds);
             m_quiescenceDelay.runOnce(seconds,
                                       boost::bind(&FullView::quiescenceChanged,
                                                   this));
-            unsetenv("SYNCEVOLUTION_PIM_DELAY_FOLKS");
+            m_quiescenceDelayed = true;
             return;
         }
 
@@ -185,26 +199,46 @@ void FullView::quiescenceChanged()
     }
 }
 
-void FullView::doAddIndividual(Entries_t::auto_type &data)
+size_t FullView::doAddIndividual(Entries_t::auto_type &data, size_t hint)
 {
-    // Binary search to find insertion point.
-    Entries_t::iterator it =
-        std::lower_bound(m_entries.begin(),
-                         m_entries.end(),
-                         *data,
-                         IndividualDataCompare(m_compare));
-    size_t index = it - m_entries.begin();
-    it = m_entries.insert(it, data.release());
+    // Check the hint, otherwise use binary search to find
+    // insertion point.
+    IndividualDataCompare compare(m_compare);
+    size_t index;
+    if (hint <= m_entries.size() &&
+        (hint == 0 || !compare(*data, m_entries[hint - 1])) &&
+        (hint == m_entries.size() || !compare(m_entries[hint], *data))) {
+        index = hint;
+    } else {
+        index = m_entries.lowerBound(*data, compare);
+    }
+    IndividualData *entry = data.release();
+    m_entries.insert(index, entry);
+    m_individuals[entry->m_individual.get()] = entry;
+    addToPhoneIndex(*entry);
     SE_LOG_DEBUG(NULL, "full view: added at #%ld/%ld", (long)index, (long)m_entries.size());
-    m_addedSignal(index, *it);
+    m_addedSignal(index, *entry);
     waitForIdle();
 
     // Monitor individual for changes.
-    it->m_individual.connectSignal<void (GObject *gobject,
+    entry->m_individual.connectSignal<void (GObject *gobject,
                                          GParamSpec *pspec)>("notify",
                                                              boost::bind(&FullView::individualModified,
                                                                          m_self,
                                                                          _1, _2));
+    return index;
+}
+
+void FullView::doAddIndividuals(Batch_t &batch)
+{
+    // Sort in reverse order, because pop_back() is the efficient
+    // way of taking entries out of the batch.
+    batch.sort(boost::bind<bool>(IndividualDataCompare(m_compare), _2, _1));
+    size_t hint = 0;
+    while (!batch.empty()) {
+        Entries_t::auto_type data(batch.pop_back().release());
+        hint = doAddIndividual(data, hint) + 1;
+    }
 }
 
 void FullView::addIndividual(FolksIndividual *individual)
@@ -214,39 +248,56 @@ void FullView::addIndividual(FolksIndividual *individual)
     doAddIndividual(data);
 }
 
+size_t FullView::findIndividual(FolksIndividual *individual) const
+{
+    // Pointer comparison is sufficient, libfolks will not change
+    // instances without announcing it.
+    Individuals_t::const_iterator it = m_individuals.find(individual);
+    return it == m_individuals.end() ?
+        Entries_t::npos :
+        m_entries.getIndex(it->second);
+}
+
 void FullView::modifyIndividual(FolksIndividual *individual)
 {
-    // Brute-force search for the individual. Pointer comparison is
-    // sufficient, libfolks will not change instances without
-    // announcing it.
-    for (Entries_t::iterator it = m_entries.begin();
-         it != m_entries.end();
-         ++it) {
-        if (it->m_individual.get() == individual) {
-            size_t index = it - m_entries.begin();
+    Batch_t moved;
+    doModifyIndividual(individual, moved);
+    doAddIndividuals(moved);
+}
 
-            Entries_t::auto_type data(new IndividualData);
-            data->init(m_compare.get(), m_locale.get(), individual);
-            if (data->m_criteria != it->m_criteria &&
-                ((it != m_entries.begin() && !m_compare->compare((it - 1)->m_criteria, data->m_criteria)) ||
-                 (it + 1 != m_entries.end() && !m_compare->compare(data->m_criteria, (it + 1)->m_criteria)))) {
-                // Sort criteria changed in such a way that the old
-                // sorting became invalid => move the entry. Do it
-                // as simple as possible, because this is not expected
-                // to happen often.
-                SE_LOG_DEBUG(NULL, "full view: temporarily removed at #%ld/%ld", (long)index, (long)m_entries.size());
-                Entries_t::auto_type old = m_entries.release(it);
-                m_removedSignal(index, *old);
-                doAddIndividual(data);
-            } else {
-                SE_LOG_DEBUG(NULL, "full view: modified at #%ld/%ld", (long)index, (long)m_entries.size());
-                // Use potentially modified pre-computed data.
-                m_entries.replace(it, data.release());
-                m_modifiedSignal(index, *it);
-                waitForIdle();
-            }
-            return;
+void FullView::doModifyIndividual(FolksIndividual *individual, Batch_t &moved)
+{
+    size_t index = findIndividual(individual);
+    if (index != Entries_t::npos) {
+        const IndividualData &current = m_entries[index];
+        Entries_t::auto_type data(new IndividualData);
+        data->init(m_compare.get(), m_locale.get(), individual);
+        IndividualDataCompare compare(m_compare);
+        if (data->m_criteria != current.m_criteria &&
+            ((index > 0 && !compare(m_entries[index - 1], *data)) ||
+             (index + 1 < m_entries.size() && !compare(*data, m_entries[index + 1])))) {
+            // Sort criteria changed in such a way that the old
+            // sorting became invalid => move the entry. Do it
+            // as simple as possible, because this is not expected
+            // to happen often.
+            SE_LOG_DEBUG(NULL, "full view: temporarily removed at #%ld/%ld", (long)index, (long)m_entries.size());
+            removeFromPhoneIndex(current);
+            m_individuals.erase(individual);
+            Entries_t::auto_type old = m_entries.release(index);
+            m_removedSignal(index, *old);
+            moved.push_back(data.release());
+        } else {
+            SE_LOG_DEBUG(NULL, "full view: modified at #%ld/%ld", (long)index, (long)m_entries.size());
+            // Use potentially modified pre-computed data.
+            removeFromPhoneIndex(current);
+            IndividualData *entry = data.release();
+            m_entries.replace(index, entry);
+            m_individuals[individual] = entry;
+            addToPhoneIndex(*entry);
+            m_modifiedSignal(index, *entry);
+            waitForIdle();
         }
+        return;
     }
     // Not a bug: individual might have been removed before we got
     // around to processing the modification notification.
@@ -255,32 +306,93 @@ void FullView::modifyIndividual(FolksIndividual *individual)
 
 void FullView::removeIndividual(FolksIndividual *individual)
 {
-    for (Entries_t::iterator it = m_entries.begin();
-         it != m_entries.end();
-         ++it) {
-        if (it->m_individual.get() == individual) {
-            size_t index = it - m_entries.begin();
-            SE_LOG_DEBUG(NULL, "full view: removed at #%ld/%ld", (long)index, (long)m_entries.size());
-            Entries_t::auto_type data = m_entries.release(it);
-            m_removedSignal(index, *data);
-            waitForIdle();
-            return;
-        }
+    size_t index = findIndividual(individual);
+    if (index != Entries_t::npos) {
+        SE_LOG_DEBUG(NULL, "full view: removed at #%ld/%ld", (long)index, (long)m_entries.size());
+        removeFromPhoneIndex(m_entries[index]);
+        m_individuals.erase(individual);
+        Entries_t::auto_type data = m_entries.release(index);
+        m_removedSignal(index, *data);
+        waitForIdle();
+        return;
     }
     // A bug?!
     SE_LOG_DEBUG(NULL, "full view: individual to be removed not found");
 }
 
+void FullView::addToPhoneIndex(const IndividualData &data)
+{
+    BOOST_FOREACH (const SimpleE164 &number, data.m_precomputed.m_phoneNumbers) {
+        m_phoneIndex.insert(std::make_pair(number.m_nationalNumber, &data));
+    }
+}
+
+void FullView::removeFromPhoneIndex(const IndividualData &data)
+{
+    BOOST_FOREACH (const SimpleE164 &number, data.m_precomputed.m_phoneNumbers) {
+        std::pair<PhoneIndex_t::iterator, PhoneIndex_t::iterator> range =
+            m_phoneIndex.equal_range(number.m_nationalNumber);
+        for (PhoneIndex_t::iterator it = range.first;
+             it != range.second;
+             ++it) {
+            if (it->second == &data) {
+                // Remove only one entry, the same number might
+                // be listed more than once.
+                m_phoneIndex.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+void FullView::rebuildPhoneIndex()
+{
+    m_phoneIndex.clear();
+    std::vector<IndividualData *> entries;
+    m_entries.getValues(entries);
+    BOOST_FOREACH (const IndividualData *data, entries) {
+        addToPhoneIndex(*data);
+    }
+}
+
+bool FullView::getCandidates(const IndividualFilter &filter, std::vector<int> &indices)
+{
+    SimpleE164 number;
+    if (!filter.getPhoneNumber(number)) {
+        return false;
+    }
+
+    // Country code gets checked by the filter.
+    std::pair<PhoneIndex_t::const_iterator, PhoneIndex_t::const_iterator> range =
+        m_phoneIndex.equal_range(number.m_nationalNumber);
+    for (PhoneIndex_t::const_iterator it = range.first;
+         it != range.second;
+         ++it) {
+        size_t index = m_entries.getIndex(it->second);
+        if (index != Entries_t::npos) {
+            indices.push_back(index);
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    SE_LOG_DEBUG(NULL, "full view: %ld candidates for phone number %s",
+                 (long)indices.size(), number.toString().c_str());
+    return true;
+}
+
 void FullView::onIdle()
 {
     SE_LOG_DEBUG(NULL, "full view: process is idle");
 
-    // Process delayed contact modifications.
+    // Process delayed contact modifications. Contacts which
+    // need to be moved get added back together at the end.
+    Batch_t moved;
     BOOST_FOREACH (const FolksIndividualCXX &individual,
                    m_pendingModifications) {
-        modifyIndividual(const_cast<FolksIndividual *>(individual.get()));
+        doModifyIndividual(const_cast<FolksIndividual *>(individual.get()), moved);
     }
     m_pendingModifications.clear();
+    doAddIndividuals(moved);
 
     // If not quiescent at the moment, then we can rely on getting
     // that signal triggered by folks and don't need to send it now.
@@ -306,8 +418,8 @@ void FullView::setCompare(const boost::shared_ptr<IndividualCompare> &compare)
 
     // Make a copy of the original order. The actual instances
     // continue to be owned by m_entries.
-    boost::scoped_array<IndividualData *> old(new IndividualData *[m_entries.size()]);
-    memcpy(old.get(), m_entries.c_array(), sizeof(IndividualData *) * m_entries.size());
+    std::vector<IndividualData *> old;
+    m_entries.getValues(old);
 
     // Change sort criteria and sort.
     // Optionally also re-compute locale-dependent values, if
@@ -315,14 +427,18 @@ void FullView::setCompare(const boost::shared_ptr<IndividualCompare> &compare)
     LocaleFactory *locale = m_localeChanged ? m_locale.get() : NULL;
     m_localeChanged = false;
     boost::dynamic_bitset<size_t> modified(locale ? m_entries.size() : 0);
-    for (size_t i = 0; i < m_entries.size(); i++ ) {
-        IndividualData &data = m_entries[i];
+    for (size_t i = 0; i < old.size(); i++ ) {
+        IndividualData &data = *old[i];
         bool preComputedModified = data.init(m_compare.get(), locale, data.m_individual);
         if (locale && preComputedModified) {
             modified.set(i);
         }
     }
     m_entries.sort(IndividualDataCompare(m_compare));
+    if (locale) {
+        // Phone numbers might have been parsed differently.
+        rebuildPhoneIndex();
+    }
 
     // Now check for changes.
     for (size_t index = 0; index < m_entries.size(); index++) {
@@ -344,5 +460,65 @@ void FullView::setCompare(const boost::shared_ptr<IndividualCompare> &compare)
     }
 }
 
+#ifdef ENABLE_UNIT_TESTS
+
+class RankTreeTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(RankTreeTest);
+    CPPUNIT_TEST(sorted);
+    CPPUNIT_TEST_SUITE_END();
+
+    struct Less
+    {
+        bool operator () (const int &a, const int &b) const { return a < b; }
+    };
+
+    void check(const RankTree<int> &tree, const std::vector<int> &expected)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected.size(), tree.size());
+        for (size_t index = 0; index < expected.size(); index++) {
+            CPPUNIT_ASSERT_EQUAL(expected[index], tree[index]);
+            CPPUNIT_ASSERT_EQUAL(index, tree.getIndex(&tree[index]));
+        }
+    }
+
+    void sorted()
+    {
+        RankTree<int> tree;
+        std::vector<int> expected;
+        // Insert in pseudo-random order.
+        for (int i = 0; i < 1000; i++) {
+            int value = (i * 7919) % 1000;
+            tree.insert(tree.lowerBound(value, Less()), new int(value));
+            expected.insert(std::lower_bound(expected.begin(), expected.end(), value), value);
+        }
+        check(tree, expected);
+
+        // Remove at every second position of the shrinking tree:
+        // each release shifts the following entries down by one, so
+        // this removes entries 0, 3, 6, ... of the original order.
+        for (size_t index = 0; index < tree.size(); index += 2) {
+            RankTree<int>::auto_type value = tree.release(index);
+            CPPUNIT_ASSERT_EQUAL(expected[index], *value);
+            expected.erase(expected.begin() + index);
+            CPPUNIT_ASSERT_EQUAL(RankTree<int>::npos, tree.getIndex(value.get()));
+        }
+        check(tree, expected);
+
+        // Invert order.
+        for (size_t index = 0; index < tree.size(); index++) {
+            tree.replace(index, new int(-tree[index]));
+            expected[index] = -expected[index];
+        }
+        check(tree, expected);
+        tree.sort(Less());
+        std::sort(expected.begin(), expected.end());
+        check(tree, expected);
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(RankTreeTest);
+
+#endif // ENABLE_UNIT_TESTS
+
 SE_END_CXX
 
@@ -21,6 +21,9 @@
 #define INCL_SYNCEVO_DBUS_SERVER_FULL_VIEW
 
 #include "view.h"
+#include "rank-tree.h"
+
+#include <map>
 
 #include <syncevo/declarations.h>
 SE_BEGIN_CXX
@@ -39,18 +42,49 @@ class FullView : public IndividualView
     Timeout m_waitForIdle;
     std::set<FolksIndividualCXX> m_pendingModifications;
     Timeout m_quiescenceDelay;
+    /** SYNCEVOLUTION_PIM_DELAY_FOLKS was applied to m_folks */
+    bool m_quiescenceDelayed;
 
     /**
-     * Sorted vector. Sort order is maintained by this class.
+     * Sorted entries. Sort order is maintained by this class.
+     * A RankTree instead of a vector, because adding, moving and
+     * removing entries happens a lot while libfolks is busy.
      */
-    typedef boost::ptr_vector<IndividualData> Entries_t;
+    typedef RankTree<IndividualData> Entries_t;
     Entries_t m_entries;
 
+    /**
+     * Finds the entry of an individual without searching through
+     * all entries.
+     */
+    typedef std::map<const FolksIndividual *, IndividualData *> Individuals_t;
+    Individuals_t m_individuals;
+
     /**
      * The sort object to be used.
      */
     boost::shared_ptr<IndividualCompare> m_compare;
 
+    /**
+     * Maps the national part of each phone number in
+     * Precomputed::m_phoneNumbers to the entries which have that
+     * number, for caller ID lookups via getCandidates(). The country
+     * code is not part of the key because a number without country
+     * code matches numbers with any country code.
+     */
+    typedef std::multimap<SimpleE164::NationalNumber_t, const IndividualData *> PhoneIndex_t;
+    PhoneIndex_t m_phoneIndex;
+
+    void addToPhoneIndex(const IndividualData &data);
+    void removeFromPhoneIndex(const IndividualData &data);
+    void rebuildPhoneIndex();
+
+    /**
+     * Index of the entry for the individual in m_entries,
+     * Entries_t::npos if not found.
+     */
+    size_t findIndividual(FolksIndividual *individual) const;
+
     FullView(const FolksIndividualAggregatorCXX &folks,
              const boost::shared_ptr<LocaleFactory> &locale);
     void init(const boost::shared_ptr<FullView> &self);
@@ -69,8 +103,30 @@ class FullView : public IndividualView
     /**
      * Adds the new individual to m_entries, transfers ownership
      * (data == NULL afterwards).
+     *
+     * @param hint    the entry is likely to belong at this index,
+     *                which then avoids the binary search
+     * @return index of the new entry
+     */
+    size_t doAddIndividual(Entries_t::auto_type &data, size_t hint = 0);
+
+    /** new entries which are not in m_entries yet */
+    typedef boost::ptr_vector<IndividualData> Batch_t;
+
+    /**
+     * Adds several new entries in increasing order, empties the
+     * batch. The resulting "added" signals then have increasing
+     * indices, which allows combining them in ViewResource, and
+     * finding the insertion point is often trivial.
+     */
+    void doAddIndividuals(Batch_t &batch);
+
+    /**
+     * Updates the entry of a modified individual. If it needs to be
+     * moved, it gets removed and the new entry is added to the
+     * batch.
      */
-    void doAddIndividual(Entries_t::auto_type &data);
+    void doModifyIndividual(FolksIndividual *individual, Batch_t &moved);
 
  public:
     /**
@@ -144,6 +200,7 @@ class FullView : public IndividualView
     virtual void doStart();
     virtual int size() const { return (int)m_entries.size(); }
     virtual const IndividualData *getContact(int index) { return (index >= 0 && (unsigned)index < m_entries.size()) ? &m_entries[index] : NULL; }
+    virtual bool getCandidates(const IndividualFilter &filter, std::vector<int> &indices);
 };
 
 SE_END_CXX
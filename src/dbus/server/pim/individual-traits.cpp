@@ -984,51 +984,117 @@ void Details2Persona(const Result<void ()> &result, const PersonaDetails &detail
     Details2PersonaStep(NULL, pending);
 }
 
-void FolksIndividual2DBus(const FolksIndividualCXX &individual, GDBusCXX::builder_type &builder)
+/** maps D-Bus property names to IndividualProperty */
+static const struct {
+    const char *m_name;
+    IndividualProperty m_property;
+} INDIVIDUAL_PROPERTIES[] = {
+    { CONTACT_HASH_FULL_NAME, INDIVIDUAL_FULL_NAME },
+    { CONTACT_HASH_NICKNAME, INDIVIDUAL_NICKNAME },
+    { CONTACT_HASH_STRUCTURED_NAME, INDIVIDUAL_STRUCTURED_NAME },
+    { CONTACT_HASH_ALIAS, INDIVIDUAL_ALIAS },
+    { CONTACT_HASH_PHOTO, INDIVIDUAL_PHOTO },
+    { CONTACT_HASH_BIRTHDAY, INDIVIDUAL_BIRTHDAY },
+    { CONTACT_HASH_LOCATION, INDIVIDUAL_LOCATION },
+    { CONTACT_HASH_EMAILS, INDIVIDUAL_EMAILS },
+    { CONTACT_HASH_PHONES, INDIVIDUAL_PHONES },
+    { CONTACT_HASH_URLS, INDIVIDUAL_URLS },
+    { CONTACT_HASH_NOTES, INDIVIDUAL_NOTES },
+    { CONTACT_HASH_ADDRESSES, INDIVIDUAL_ADDRESSES },
+    { CONTACT_HASH_ROLES, INDIVIDUAL_ROLES },
+    { CONTACT_HASH_GROUPS, INDIVIDUAL_GROUPS },
+    { CONTACT_HASH_SOURCE, INDIVIDUAL_SOURCE },
+    { CONTACT_HASH_ID, INDIVIDUAL_ID },
+    { NULL, INDIVIDUAL_ALL }
+};
+
+unsigned int DBus2IndividualProperties(const std::vector<std::string> &names)
+{
+    if (names.empty()) {
+        return INDIVIDUAL_ALL;
+    }
+    unsigned int properties = 0;
+    BOOST_FOREACH (const std::string &name, names) {
+        int i;
+        for (i = 0; INDIVIDUAL_PROPERTIES[i].m_name; i++) {
+            if (name == INDIVIDUAL_PROPERTIES[i].m_name) {
+                properties |= INDIVIDUAL_PROPERTIES[i].m_property;
+                break;
+            }
+        }
+        if (!INDIVIDUAL_PROPERTIES[i].m_name) {
+            SE_THROW("unknown contact property: " + name);
+        }
+    }
+    return properties;
+}
+
+void FolksIndividual2DBus(const FolksIndividualCXX &individual, GDBusCXX::builder_type &builder,
+                          unsigned int properties)
 {
     g_variant_builder_open(&builder, G_VARIANT_TYPE(INDIVIDUAL_DICT)); // dict
 
     FolksNameDetails *name = FOLKS_NAME_DETAILS(individual.get());
-    SerializeFolks(builder, name, folks_name_details_get_full_name,
-                   CONTACT_HASH_FULL_NAME);
-    SerializeFolks(builder, name, folks_name_details_get_nickname,
-                   CONTACT_HASH_NICKNAME);
-    SerializeFolks(builder, name, folks_name_details_get_structured_name,
-                   CONTACT_HASH_STRUCTURED_NAME);
+    if (properties & INDIVIDUAL_FULL_NAME) {
+        SerializeFolks(builder, name, folks_name_details_get_full_name,
+                       CONTACT_HASH_FULL_NAME);
+    }
+    if (properties & INDIVIDUAL_NICKNAME) {
+        SerializeFolks(builder, name, folks_name_details_get_nickname,
+                       CONTACT_HASH_NICKNAME);
+    }
+    if (properties & INDIVIDUAL_STRUCTURED_NAME) {
+        SerializeFolks(builder, name, folks_name_details_get_structured_name,
+                       CONTACT_HASH_STRUCTURED_NAME);
+    }
 
     // gconstpointer folks_abstract_field_details_get_value (FolksAbstractFieldDetails* self);
 
-    FolksAliasDetails *alias = FOLKS_ALIAS_DETAILS(individual.get());
-    SerializeFolks(builder, alias, folks_alias_details_get_alias,
-                   CONTACT_HASH_ALIAS);
+    if (properties & INDIVIDUAL_ALIAS) {
+        FolksAliasDetails *alias = FOLKS_ALIAS_DETAILS(individual.get());
+        SerializeFolks(builder, alias, folks_alias_details_get_alias,
+                       CONTACT_HASH_ALIAS);
+    }
 
-    FolksAvatarDetails *avatar = FOLKS_AVATAR_DETAILS(individual.get());
-    SerializeFolks(builder, avatar, folks_avatar_details_get_avatar,
-                   CONTACT_HASH_PHOTO);
+    if (properties & INDIVIDUAL_PHOTO) {
+        FolksAvatarDetails *avatar = FOLKS_AVATAR_DETAILS(individual.get());
+        SerializeFolks(builder, avatar, folks_avatar_details_get_avatar,
+                       CONTACT_HASH_PHOTO);
+    }
 
-    FolksBirthdayDetails *birthday = FOLKS_BIRTHDAY_DETAILS(individual.get());
-    SerializeFolks(builder, birthday, folks_birthday_details_get_birthday,
-                   CONTACT_HASH_BIRTHDAY);
-    // const gchar* folks_birthday_details_get_calendar_event_id (FolksBirthdayDetails* self);
+    if (properties & INDIVIDUAL_BIRTHDAY) {
+        FolksBirthdayDetails *birthday = FOLKS_BIRTHDAY_DETAILS(individual.get());
+        SerializeFolks(builder, birthday, folks_birthday_details_get_birthday,
+                       CONTACT_HASH_BIRTHDAY);
+        // const gchar* folks_birthday_details_get_calendar_event_id (FolksBirthdayDetails* self);
+    }
 
-    FolksLocationDetails *location = FOLKS_LOCATION_DETAILS(individual.get());
-    SerializeFolks(builder, location, folks_location_details_get_location,
-                   CONTACT_HASH_LOCATION);
+    if (properties & INDIVIDUAL_LOCATION) {
+        FolksLocationDetails *location = FOLKS_LOCATION_DETAILS(individual.get());
+        SerializeFolks(builder, location, folks_location_details_get_location,
+                       CONTACT_HASH_LOCATION);
+    }
 
-    FolksEmailDetails *emails = FOLKS_EMAIL_DETAILS(individual.get());
-    SerializeFolks(builder, emails, folks_email_details_get_email_addresses,
-                   (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
-                   CONTACT_HASH_EMAILS);
+    if (properties & INDIVIDUAL_EMAILS) {
+        FolksEmailDetails *emails = FOLKS_EMAIL_DETAILS(individual.get());
+        SerializeFolks(builder, emails, folks_email_details_get_email_addresses,
+                       (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
+                       CONTACT_HASH_EMAILS);
+    }
 
-    FolksPhoneDetails *phones = FOLKS_PHONE_DETAILS(individual.get());
-    SerializeFolks(builder, phones, folks_phone_details_get_phone_numbers,
-                   (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
-                   CONTACT_HASH_PHONES);
+    if (properties & INDIVIDUAL_PHONES) {
+        FolksPhoneDetails *phones = FOLKS_PHONE_DETAILS(individual.get());
+        SerializeFolks(builder, phones, folks_phone_details_get_phone_numbers,
+                       (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
+                       CONTACT_HASH_PHONES);
+    }
 
-    FolksUrlDetails *urls = FOLKS_URL_DETAILS(individual.get());
-    SerializeFolks(builder, urls, folks_url_details_get_urls,
-                   (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
-                   CONTACT_HASH_URLS);
+    if (properties & INDIVIDUAL_URLS) {
+        FolksUrlDetails *urls = FOLKS_URL_DETAILS(individual.get());
+        SerializeFolks(builder, urls, folks_url_details_get_urls,
+                       (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL,
+                       CONTACT_HASH_URLS);
+    }
 
     // Doesn't work like this, folks_im_details_get_im_addresses returns
     // a GeeMultiMap, not a GeeList. Not required anyway.
@@ -1036,32 +1102,44 @@ void FolksIndividual2DBus(const FolksIndividualCXX &individual, GDBusCXX::builde
     // SerializeFolks(builder, im, folks_im_details_get_im_addresses,
     //                (GeeCollCXX<FolksAbstractFieldDetails *>*)NULL, "im");
 
-    FolksNoteDetails *notes = FOLKS_NOTE_DETAILS(individual.get());
-    SerializeFolks(builder, notes, folks_note_details_get_notes,
-                   (GeeCollCXX<FolksNoteFieldDetails *>*)NULL,
-                   CONTACT_HASH_NOTES);
+    if (properties & INDIVIDUAL_NOTES) {
+        FolksNoteDetails *notes = FOLKS_NOTE_DETAILS(individual.get());
+        SerializeFolks(builder, notes, folks_note_details_get_notes,
+                       (GeeCollCXX<FolksNoteFieldDetails *>*)NULL,
+                       CONTACT_HASH_NOTES);
+    }
 
-    FolksPostalAddressDetails *postal = FOLKS_POSTAL_ADDRESS_DETAILS(individual.get());
-    SerializeFolks(builder, postal, folks_postal_address_details_get_postal_addresses,
-                   (GeeCollCXX<FolksPostalAddressFieldDetails *>*)NULL,
-                   CONTACT_HASH_ADDRESSES);
+    if (properties & INDIVIDUAL_ADDRESSES) {
+        FolksPostalAddressDetails *postal = FOLKS_POSTAL_ADDRESS_DETAILS(individual.get());
+        SerializeFolks(builder, postal, folks_postal_address_details_get_postal_addresses,
+                       (GeeCollCXX<FolksPostalAddressFieldDetails *>*)NULL,
+                       CONTACT_HASH_ADDRESSES);
+    }
 
-    FolksRoleDetails *roles = FOLKS_ROLE_DETAILS(individual.get());
-    SerializeFolks(builder, roles, folks_role_details_get_roles,
-                   (GeeCollCXX<FolksRoleFieldDetails *>*)NULL,
-                   CONTACT_HASH_ROLES);
+    if (properties & INDIVIDUAL_ROLES) {
+        FolksRoleDetails *roles = FOLKS_ROLE_DETAILS(individual.get());
+        SerializeFolks(builder, roles, folks_role_details_get_roles,
+                       (GeeCollCXX<FolksRoleFieldDetails *>*)NULL,
+                       CONTACT_HASH_ROLES);
+    }
 
-    FolksGroupDetails *groups = FOLKS_GROUP_DETAILS(individual.get());
-    SerializeFolks(builder, groups, folks_group_details_get_groups,
-                   (GeeStringCollection*)NULL,
-                   CONTACT_HASH_GROUPS);
+    if (properties & INDIVIDUAL_GROUPS) {
+        FolksGroupDetails *groups = FOLKS_GROUP_DETAILS(individual.get());
+        SerializeFolks(builder, groups, folks_group_details_get_groups,
+                       (GeeStringCollection*)NULL,
+                       CONTACT_HASH_GROUPS);
+    }
 
-    SerializeFolks(builder, individual.get(), folks_individual_get_personas,
-                   (GeeCollCXX<FolksPersona *>*)NULL,
-                   CONTACT_HASH_SOURCE);
+    if (properties & INDIVIDUAL_SOURCE) {
+        SerializeFolks(builder, individual.get(), folks_individual_get_personas,
+                       (GeeCollCXX<FolksPersona *>*)NULL,
+                       CONTACT_HASH_SOURCE);
+    }
 
-    SerializeFolks(builder, individual.get(), folks_individual_get_id,
-                   CONTACT_HASH_ID);
+    if (properties & INDIVIDUAL_ID) {
+        SerializeFolks(builder, individual.get(), folks_individual_get_id,
+                       CONTACT_HASH_ID);
+    }
 
 #if 0
     // Not exposed via D-Bus.
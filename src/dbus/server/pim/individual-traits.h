@@ -34,8 +34,56 @@
 #include <syncevo/declarations.h>
 SE_BEGIN_CXX
 
+/**
+ * Top-level contact properties as bits in a mask, see
+ * org._01.pim.contacts.ViewControl.ReadContactRange().
+ */
+enum IndividualProperty {
+    INDIVIDUAL_FULL_NAME = 1<<0,
+    INDIVIDUAL_NICKNAME = 1<<1,
+    INDIVIDUAL_STRUCTURED_NAME = 1<<2,
+    INDIVIDUAL_ALIAS = 1<<3,
+    INDIVIDUAL_PHOTO = 1<<4,
+    INDIVIDUAL_BIRTHDAY = 1<<5,
+    INDIVIDUAL_LOCATION = 1<<6,
+    INDIVIDUAL_EMAILS = 1<<7,
+    INDIVIDUAL_PHONES = 1<<8,
+    INDIVIDUAL_URLS = 1<<9,
+    INDIVIDUAL_NOTES = 1<<10,
+    INDIVIDUAL_ADDRESSES = 1<<11,
+    INDIVIDUAL_ROLES = 1<<12,
+    INDIVIDUAL_GROUPS = 1<<13,
+    INDIVIDUAL_SOURCE = 1<<14,
+    INDIVIDUAL_ID = 1<<15,
+    INDIVIDUAL_ALL = (1<<16) - 1
+};
+
+/**
+ * Turns property names as used in the D-Bus dict into a mask.
+ * An empty list selects all properties, unknown names
+ * cause an exception.
+ */
+unsigned int DBus2IndividualProperties(const std::vector<std::string> &names);
+
+/**
+ * A FolksIndividual of which only some properties are to be
+ * sent via D-Bus.
+ */
+struct IndividualProjection
+{
+    IndividualProjection(const FolksIndividualCXX &individual = FolksIndividualCXX(),
+                         unsigned int properties = INDIVIDUAL_ALL) :
+        m_individual(individual),
+        m_properties(properties)
+    {}
+
+    FolksIndividualCXX m_individual;
+    unsigned int m_properties;
+};
+
 void DBus2PersonaDetails(GDBusCXX::ExtractArgs &context, GDBusCXX::reader_type &iter, PersonaDetails &details);
-void FolksIndividual2DBus(const FolksIndividualCXX &individual, GDBusCXX::builder_type &builder);
+void FolksIndividual2DBus(const FolksIndividualCXX &individual, GDBusCXX::builder_type &builder,
+                          unsigned int properties = INDIVIDUAL_ALL);
 void Details2Persona(const Result<void ()> &result, const PersonaDetails &details, FolksPersona *persona);
 
 SE_END_CXX
@@ -69,6 +117,21 @@ namespace GDBusCXX {
         }
     };
 
+    /**
+     * Same D-Bus type as a full FolksIndividual, with less entries.
+     */
+    template <> struct dbus_traits<IndividualProjection> :
+        public dbus_traits< std::map<std::string, boost::variant<std::string> >  >
+    {
+        typedef IndividualProjection host_type;
+        typedef const IndividualProjection &arg_type;
+
+        static void append(GDBusCXX::builder_type &builder, arg_type projection)
+        {
+            FolksIndividual2DBus(projection.m_individual, builder, projection.m_properties);
+        }
+    };
+
     /**
      * The corresponding mapping from D-Bus to a GeeMap for add_persona_from_details.
      * See http://telepathy.freedesktop.org/doc/folks/vala/Folks.PersonaStore.add_persona_from_details.html
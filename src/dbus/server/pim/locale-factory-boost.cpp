@@ -23,6 +23,7 @@
 
 #include "locale-factory.h"
 #include "folks.h"
+#include "test.h"
 
 #include <libebook/libebook.h>
 
@@ -36,6 +37,8 @@
 #include <unicode/bytestream.h>
 #include <unicode/locid.h>
 
+#include <typeinfo>
+
 SE_GLIB_TYPE(EBookQuery, e_book_query)
 
 SE_BEGIN_CXX
@@ -237,12 +240,8 @@ public:
         m_mode(mode)
     {
         if (mode & TRANSLITERATE) {
-            UErrorCode status = U_ZERO_ERROR;
-            m_transliterator.reset(Transliterator::createInstance ("Any-Latin", UTRANS_FORWARD, status));
-            if (!m_transliterator ||
-                U_FAILURE(status)) {
-                SE_LOG_WARNING(NULL, "creating ICU Any-Latin Transliterator failed, error code %s; falling back to not transliterating", u_errorName(status));
-                m_transliterator.reset();
+            m_transliterator.reset(createTransliterator());
+            if (!m_transliterator) {
                 mode ^= TRANSLITERATE;
                 m_mode = mode;
             }
@@ -253,9 +252,46 @@ public:
             break;
         default:
             m_searchValueTransformed = transform(m_searchValue);
+            addTrigrams(m_searchValueTransformed, m_searchTrigrams);
+            sortTrigrams(m_searchTrigrams);
             break;
         }
         m_searchValueTel = normalizePhoneText(m_searchValue.c_str());
+        addTrigrams(m_searchValueTel, m_searchTrigramsTel);
+        sortTrigrams(m_searchTrigramsTel);
+    }
+
+    typedef bool (AnyContainsBoost::*Operation_t)(const char *text) const;
+
+    /** Any-Latin transliterator, NULL and a warning if not available */
+    static icu::Transliterator *createTransliterator()
+    {
+        UErrorCode status = U_ZERO_ERROR;
+        icu::Transliterator *transliterator = Transliterator::createInstance("Any-Latin", UTRANS_FORWARD, status);
+        if (!transliterator ||
+            U_FAILURE(status)) {
+            SE_LOG_WARNING(NULL, "creating ICU Any-Latin Transliterator failed, error code %s; falling back to not transliterating", u_errorName(status));
+            delete transliterator;
+            transliterator = NULL;
+        }
+        return transliterator;
+    }
+
+    /** appends the trigrams of the text, sortTrigrams() must be called afterwards */
+    static void addTrigrams(const std::string &text, LocaleFactory::Precomputed::Trigrams &trigrams)
+    {
+        for (size_t i = 0; i + 3 <= text.size(); i++) {
+            trigrams.push_back(((unsigned int)(unsigned char)text[i] << 16) |
+                               ((unsigned int)(unsigned char)text[i + 1] << 8) |
+                               (unsigned int)(unsigned char)text[i + 2]);
+        }
+    }
+
+    /** turns the trigrams into a sorted set */
+    static void sortTrigrams(LocaleFactory::Precomputed::Trigrams &trigrams)
+    {
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
     }
 
     /**
@@ -265,8 +301,9 @@ public:
                              size_t start);
 
     /** simplify according to mode */
-    std::string transform(const char *in) const;
+    std::string transform(const char *in) const { return transform(in, m_mode, m_transliterator.get()); }
     std::string transform(const std::string &in) const { return transform(in.c_str()); }
+    static std::string transform(const char *in, int mode, const icu::Transliterator *transliterator);
 
     /**
      * The search text is not necessarily a full phone number,
@@ -403,8 +440,145 @@ public:
         return boost::ends_with(tel, m_searchValueTel);
     }
 
+    /**
+     * Applies one of the text or telephone operations to the
+     * precomputed values of a field.
+     *
+     * @retval result   true if one of the values matched
+     * @return false if the precomputed values cannot be used
+     *         with the mode of this filter
+     */
+    bool matchesField(const LocaleFactory::Precomputed &precomputed,
+                      LocaleFactory::Precomputed::Field field,
+                      Operation_t operation,
+                      bool &result) const
+    {
+        bool tel = field == LocaleFactory::Precomputed::TEL;
+        if (precomputed.m_textMode == -1 ||
+            (!tel && precomputed.m_textMode != m_mode)) {
+            return false;
+        }
+
+        result = false;
+        if (!mightMatch(precomputed, tel)) {
+            return true;
+        }
+        const std::string &value = tel ? m_searchValueTel : m_searchValueTransformed;
+        BOOST_FOREACH (const LocaleFactory::Precomputed::Text &text, precomputed.m_texts) {
+            if (text.m_field == field &&
+                compare(operation, text.m_value, value)) {
+                result = true;
+                break;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Cheap check against the trigram set. False if the search value
+     * cannot be part of any of the precomputed values.
+     */
+    bool mightMatch(const LocaleFactory::Precomputed &precomputed, bool tel) const
+    {
+        const LocaleFactory::Precomputed::Trigrams &trigrams = tel ? m_searchTrigramsTel : m_searchTrigrams;
+        return std::includes(precomputed.m_trigrams.begin(), precomputed.m_trigrams.end(),
+                             trigrams.begin(), trigrams.end());
+    }
+
+    /**
+     * The comparison done by the filter, with the semantic of
+     * containsSearchText() for 'any-contains'.
+     */
+    virtual Operation_t getOperation() const { return &AnyContainsBoost::containsSearchText; }
+
+    /**
+     * Same field and flags and a search value which is more
+     * specific for the operation, like a longer substring for
+     * 'contains'. The values get compared after normalizing them.
+     */
+    virtual bool isRefinementOf(const IndividualFilter &other) const
+    {
+        const AnyContainsBoost *filter = dynamic_cast<const AnyContainsBoost *>(&other);
+        Operation_t operation = getOperation();
+        if (!filter ||
+            typeid(*filter) != typeid(*this) ||
+            filter->m_mode != m_mode ||
+            filter->getOperation() != operation) {
+            return false;
+        }
+        bool tel = operation == &AnyContainsBoost::containsSearchTel ||
+            operation == &AnyContainsBoost::isSearchTel ||
+            operation == &AnyContainsBoost::beginsWithSearchTel ||
+            operation == &AnyContainsBoost::endsWithSearchTel;
+        if (typeid(*this) == typeid(AnyContainsBoost)) {
+            // Checks both text and phone numbers.
+            return compare(operation, m_searchValueTel, filter->m_searchValueTel) &&
+                compare(operation, getSearchValue(), filter->getSearchValue());
+        } else if (tel) {
+            return compare(operation, m_searchValueTel, filter->m_searchValueTel);
+        } else {
+            return compare(operation, getSearchValue(), filter->getSearchValue());
+        }
+    }
+
+    /** search value as used for comparisons with text */
+    const std::string &getSearchValue() const { return m_mode == EXACT ? m_searchValue : m_searchValueTransformed; }
+
+    /** operation applied to values which are already normalized */
+    static bool compare(Operation_t operation, const std::string &text, const std::string &value)
+    {
+        if (operation == &AnyContainsBoost::containsSearchText ||
+            operation == &AnyContainsBoost::containsSearchTel) {
+            return boost::contains(text, value);
+        } else if (operation == &AnyContainsBoost::isSearchText ||
+                   operation == &AnyContainsBoost::isSearchTel) {
+            return boost::equals(text, value);
+        } else if (operation == &AnyContainsBoost::beginsWithSearchText ||
+                   operation == &AnyContainsBoost::beginsWithSearchTel) {
+            return boost::starts_with(text, value);
+        } else {
+            return boost::ends_with(text, value);
+        }
+    }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        if (precomputed.m_textMode == -1 ||
+            precomputed.m_textMode != m_mode) {
+            return false;
+        }
+
+        // Substring search in the normalized names, emails and
+        // phone numbers. Addresses are also in the precomputed
+        // texts, but not part of 'any-contains'.
+        result = false;
+        bool text = mightMatch(precomputed, false);
+        bool tel = mightMatch(precomputed, true);
+        if (text || tel) {
+            BOOST_FOREACH (const LocaleFactory::Precomputed::Text &entry, precomputed.m_texts) {
+                if (entry.m_field == LocaleFactory::Precomputed::TEL) {
+                    if (tel && boost::contains(entry.m_value, m_searchValueTel)) {
+                        result = true;
+                        break;
+                    }
+                } else if (entry.m_field < LocaleFactory::Precomputed::TEL) {
+                    if (text && boost::contains(entry.m_value, m_searchValueTransformed)) {
+                        result = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
+
         FolksIndividual *individual = data.m_individual.get();
         FolksNameDetails *name = FOLKS_NAME_DETAILS(individual);
         const char *fullname = folks_name_details_get_full_name(name);
@@ -459,22 +633,23 @@ private:
     std::string m_searchValue;
     std::string m_searchValueTransformed;
     std::string m_searchValueTel;
+    LocaleFactory::Precomputed::Trigrams m_searchTrigrams, m_searchTrigramsTel;
     int m_mode;
     // const bool (*m_contains)(const std::string &, const std::string &, const std::locale &);
 };
 
-std::string AnyContainsBoost::transform(const char *in) const
+std::string AnyContainsBoost::transform(const char *in, int mode, const icu::Transliterator *transliterator)
 {
     icu::UnicodeString unicode = icu::UnicodeString::fromUTF8(in);
-    if (m_mode & TRANSLITERATE) {
-        m_transliterator->transliterate(unicode);
+    if (mode & TRANSLITERATE) {
+        transliterator->transliterate(unicode);
     }
-    if (m_mode & CASE_INSENSITIVE) {
+    if (mode & CASE_INSENSITIVE) {
         unicode.foldCase();
     }
     std::string utf8;
     unicode.toUTF8String(utf8);
-    if (m_mode & ACCENT_INSENSITIVE) {
+    if (mode & ACCENT_INSENSITIVE) {
         // Haven't found an easy way to do this with ICU.
         // Use e_util_utf8_remove_accents(), which also ensures
         // consistency with EDS.
@@ -524,8 +699,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::FULL_NAME, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksNameDetails *name = FOLKS_NAME_DETAILS(individual);
         const char *fullname = folks_name_details_get_full_name(name);
@@ -547,8 +733,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::NICKNAME, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksNameDetails *name = FOLKS_NAME_DETAILS(individual);
         const char *fullname = folks_name_details_get_nickname(name);
@@ -570,8 +767,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::FAMILY_NAME, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksStructuredName *fn =
             folks_name_details_get_structured_name(FOLKS_NAME_DETAILS(individual));
@@ -598,8 +806,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::GIVEN_NAME, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksStructuredName *fn =
             folks_name_details_get_structured_name(FOLKS_NAME_DETAILS(individual));
@@ -626,8 +845,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::ADDITIONAL_NAMES, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksStructuredName *fn =
             folks_name_details_get_structured_name(FOLKS_NAME_DETAILS(individual));
@@ -654,8 +884,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::EMAIL, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksEmailDetails *emailDetails = FOLKS_EMAIL_DETAILS(individual);
         GeeSet *emails = folks_email_details_get_email_addresses(emailDetails);
@@ -683,8 +924,19 @@ public:
     {
     }
 
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        return matchesField(precomputed, LocaleFactory::Precomputed::TEL, m_operation, result);
+    }
+
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksPhoneDetails *phoneDetails = FOLKS_PHONE_DETAILS(individual);
         GeeSet *phones = folks_phone_details_get_phone_numbers(phoneDetails);
@@ -703,19 +955,33 @@ class FilterAddr : public AnyContainsBoost
 {
 protected:
     bool (AnyContainsBoost::*m_operation)(const char *text) const;
+    LocaleFactory::Precomputed::Field m_field;
 
 public:
     FilterAddr(const std::locale &locale,
                const std::string &searchValue,
                int mode,
-               bool (AnyContainsBoost::*operation)(const char *text) const) :
+               bool (AnyContainsBoost::*operation)(const char *text) const,
+               LocaleFactory::Precomputed::Field field) :
         AnyContainsBoost(locale, searchValue, mode),
-        m_operation(operation)
+        m_operation(operation),
+        m_field(field)
+    {
+    }
+
+    virtual Operation_t getOperation() const { return m_operation; }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
     {
+        return matchesField(precomputed, m_field, m_operation, result);
     }
 
     virtual bool matches(const IndividualData &data) const
     {
+        bool result;
+        if (matchesPrecomputed(data.m_precomputed, result)) {
+            return result;
+        }
         FolksIndividual *individual = data.m_individual.get();
         FolksPostalAddressDetails *addressDetails = FOLKS_POSTAL_ADDRESS_DETAILS(individual);
         GeeSet *addresses = folks_postal_address_details_get_postal_addresses(addressDetails);
@@ -739,7 +1005,7 @@ public:
                     const std::string &searchValue,
                     int mode,
                     bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_PO_BOX)
     {
     }
 
@@ -757,7 +1023,7 @@ public:
                         const std::string &searchValue,
                         int mode,
                         bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_EXTENSION)
     {
     }
 
@@ -775,7 +1041,7 @@ public:
                      const std::string &searchValue,
                      int mode,
                      bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_STREET)
     {
     }
 
@@ -793,7 +1059,7 @@ public:
                        const std::string &searchValue,
                        int mode,
                        bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_LOCALITY)
     {
     }
 
@@ -811,7 +1077,7 @@ public:
                      const std::string &searchValue,
                      int mode,
                      bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_REGION)
     {
     }
 
@@ -829,7 +1095,7 @@ public:
                          const std::string &searchValue,
                          int mode,
                          bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_POSTAL_CODE)
     {
     }
 
@@ -847,7 +1113,7 @@ public:
                       const std::string &searchValue,
                       int mode,
                       bool (AnyContainsBoost::*operation)(const char *text) const) :
-        FilterAddr(locale, searchValue, mode, operation)
+        FilterAddr(locale, searchValue, mode, operation, LocaleFactory::Precomputed::ADDR_COUNTRY)
     {
     }
 
@@ -905,17 +1171,32 @@ public:
 
     virtual bool matches(const IndividualData &data) const
     {
-        BOOST_FOREACH(const SimpleE164 &number, data.m_precomputed.m_phoneNumbers) {
+        bool result;
+        matchesPrecomputed(data.m_precomputed, result);
+        return result;
+    }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        result = false;
+        BOOST_FOREACH(const SimpleE164 &number, precomputed.m_phoneNumbers) {
             // National part must always match, country code only if
             // set explicitly in both (NSN_MATCH in libphonenumber,
             // EQUALS_NATIONAL_PHONE_NUMBER in EDS).
             if (number.m_nationalNumber == m_number.m_nationalNumber &&
                 (!number.m_countryCode || !m_number.m_countryCode ||
                  number.m_countryCode == m_number.m_countryCode)) {
-                return true;
+                result = true;
+                break;
             }
         }
-        return false;
+        return true;
+    }
+
+    virtual bool getPhoneNumber(SimpleE164 &number) const
+    {
+        number = m_number;
+        return true;
     }
 
     virtual std::string getEBookFilter() const
@@ -1002,12 +1283,30 @@ public:
 
 class LocaleFactoryBoost : public LocaleFactory
 {
+    friend class PrecomputedTextTest;
+
     const i18n::phonenumbers::PhoneNumberUtil &m_phoneNumberUtil;
     bool m_edsSupportsPhoneNumbers;
     std::locale m_locale;
     std::string m_country;
     std::string m_defaultCountryCode;
     PhoneNumberLogger m_logger;
+    boost::shared_ptr<icu::Transliterator> m_transliterator;
+    int m_textMode;
+
+    /** normalize field value for Precomputed::m_texts */
+    void addText(Precomputed &precomputed, Precomputed::Field field, const char *value) const
+    {
+        if (value) {
+            Precomputed::Text text;
+            text.m_field = field;
+            text.m_value = field == Precomputed::TEL ?
+                AnyContainsBoost::normalizePhoneText(value) :
+                AnyContainsBoost::transform(value, m_textMode, m_transliterator.get());
+            precomputed.m_texts.push_back(text);
+            AnyContainsBoost::addTrigrams(text.m_value, precomputed.m_trigrams);
+        }
+    }
 
 public:
     LocaleFactoryBoost() :
@@ -1015,8 +1314,17 @@ public:
         m_edsSupportsPhoneNumbers(e_phone_number_is_supported() && !getenv("SYNCEVOLUTION_PIM_EDS_NO_E164")),
         m_locale(genLocale()),
         m_country(std::use_facet<boost::locale::info>(m_locale).country()),
-        m_defaultCountryCode(StringPrintf("+%d", m_phoneNumberUtil.GetCountryCodeForRegion(m_country)))
+        m_defaultCountryCode(StringPrintf("+%d", m_phoneNumberUtil.GetCountryCodeForRegion(m_country))),
+        m_transliterator(AnyContainsBoost::createTransliterator()),
+        m_textMode(AnyContainsBoost::ALL)
     {
+        // Precomputed texts match text filters with the default
+        // mode, which must be reduced the same way as in
+        // AnyContainsBoost when transliterating is not possible.
+        if (!m_transliterator) {
+            m_textMode ^= AnyContainsBoost::TRANSLITERATE;
+        }
+
         // Redirect output of libphonenumber and make it a bit quieter
         // than it is by default. We map fatal libphonenumber errors
         // to ERROR and everything else to DEBUG.
@@ -1184,6 +1492,11 @@ public:
         return res ? res : LocaleFactory::createFilter(filter, level);
     }
 
+    virtual std::string getName() const
+    {
+        return std::use_facet<boost::locale::info>(m_locale).name();
+    }
+
     virtual bool precompute(FolksIndividual *individual, Precomputed &precomputed) const
     {
         LocaleFactory::Precomputed old;
@@ -1196,6 +1509,7 @@ public:
             const gchar *value =
                 reinterpret_cast<const gchar *>(folks_abstract_field_details_get_value(phone));
             if (value) {
+                addText(precomputed, Precomputed::TEL, value);
                 if (m_edsSupportsPhoneNumbers) {
                     // Check X-EVOLUTION-E164 (made lowercase by folks!).
                     //
@@ -1263,7 +1577,41 @@ public:
             }
         }
 
-        // Now check if any phone number changed.
+        // Text of all fields which can be searched with AnyContainsBoost
+        // and its derived filters, already in the form used for
+        // comparisons.
+        precomputed.m_textMode = m_textMode;
+        FolksNameDetails *name = FOLKS_NAME_DETAILS(individual);
+        addText(precomputed, Precomputed::FULL_NAME, folks_name_details_get_full_name(name));
+        addText(precomputed, Precomputed::NICKNAME, folks_name_details_get_nickname(name));
+        FolksStructuredName *fn = folks_name_details_get_structured_name(name);
+        if (fn) {
+            addText(precomputed, Precomputed::FAMILY_NAME, folks_structured_name_get_family_name(fn));
+            addText(precomputed, Precomputed::GIVEN_NAME, folks_structured_name_get_given_name(fn));
+            addText(precomputed, Precomputed::ADDITIONAL_NAMES, folks_structured_name_get_additional_names(fn));
+        }
+        FolksEmailDetails *emailDetails = FOLKS_EMAIL_DETAILS(individual);
+        GeeSet *emails = folks_email_details_get_email_addresses(emailDetails);
+        BOOST_FOREACH (FolksAbstractFieldDetails *email, GeeCollCXX<FolksAbstractFieldDetails *>(emails, ADD_REF)) {
+            addText(precomputed, Precomputed::EMAIL,
+                    reinterpret_cast<const gchar *>(folks_abstract_field_details_get_value(email)));
+        }
+        FolksPostalAddressDetails *addressDetails = FOLKS_POSTAL_ADDRESS_DETAILS(individual);
+        GeeSet *addresses = folks_postal_address_details_get_postal_addresses(addressDetails);
+        BOOST_FOREACH (FolksPostalAddressFieldDetails *address, GeeCollCXX<FolksPostalAddressFieldDetails *>(addresses, ADD_REF)) {
+            FolksPostalAddress *addr =
+                const_cast<FolksPostalAddress *>(reinterpret_cast<const FolksPostalAddress *>(folks_abstract_field_details_get_value(FOLKS_ABSTRACT_FIELD_DETAILS(address))));
+            addText(precomputed, Precomputed::ADDR_PO_BOX, folks_postal_address_get_po_box(addr));
+            addText(precomputed, Precomputed::ADDR_EXTENSION, folks_postal_address_get_extension(addr));
+            addText(precomputed, Precomputed::ADDR_STREET, folks_postal_address_get_street(addr));
+            addText(precomputed, Precomputed::ADDR_LOCALITY, folks_postal_address_get_locality(addr));
+            addText(precomputed, Precomputed::ADDR_REGION, folks_postal_address_get_region(addr));
+            addText(precomputed, Precomputed::ADDR_POSTAL_CODE, folks_postal_address_get_postal_code(addr));
+            addText(precomputed, Precomputed::ADDR_COUNTRY, folks_postal_address_get_country(addr));
+        }
+        AnyContainsBoost::sortTrigrams(precomputed.m_trigrams);
+
+        // Now check if any phone number or text changed.
         return old != precomputed;
     }
 };
@@ -1273,4 +1621,516 @@ boost::shared_ptr<LocaleFactory> LocaleFactory::createFactory()
     return boost::shared_ptr<LocaleFactory>(new LocaleFactoryBoost());
 }
 
+#ifdef ENABLE_UNIT_TESTS
+
+/**
+ * Compares sorting with the individual criteria against sorting
+ * with the combined sort key, for each sort order and synthetic
+ * names. Creating FolksIndividuals is not possible here, so the
+ * criteria are created the same way as in createCriteria().
+ */
+class CompareBoostTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(CompareBoostTest);
+    CPPUNIT_TEST(sortKeys);
+    CPPUNIT_TEST_SUITE_END();
+
+    class CriteriaCompare
+    {
+        const IndividualCompare &m_compare;
+    public:
+        CriteriaCompare(const IndividualCompare &compare) : m_compare(compare) {}
+        bool operator () (const IndividualData *a, const IndividualData *b) const { return m_compare.compare(a->m_criteria, b->m_criteria); }
+    };
+
+    class KeyCompare
+    {
+        IndividualDataCompare m_compare;
+    public:
+        KeyCompare(const boost::shared_ptr<IndividualCompare> &compare) : m_compare(compare) {}
+        bool operator () (const IndividualData *a, const IndividualData *b) const { return m_compare(*a, *b); }
+    };
+
+    void sortKeys()
+    {
+        static const char *syllables[] = { "an", "Ber", "cé", "Do", "el", "fü", "Gra", "hin", "Ïs", "jo", "ka", "Lö" };
+        static const size_t numSyllables = sizeof(syllables) / sizeof(syllables[0]);
+        static const size_t numIndividuals = 10000;
+        std::locale locale = boost::locale::generator()("en_US.UTF-8");
+        static const char *orders[] = { "first/last", "last/first", "fullname" };
+
+        BOOST_FOREACH (const char *order, orders) {
+            boost::shared_ptr<CompareBoost> compare;
+            if (!strcmp(order, "first/last")) {
+                compare.reset(new CompareFirstLastBoost(locale));
+            } else if (!strcmp(order, "last/first")) {
+                compare.reset(new CompareLastFirstBoost(locale));
+            } else {
+                compare.reset(new CompareFullnameBoost(locale));
+            }
+
+            boost::ptr_vector<IndividualData> individuals;
+            unsigned int seed = 1;
+            for (size_t i = 0; i < numIndividuals; i++) {
+                std::string given, family;
+                for (int s = 0; s < 3; s++) {
+                    given += syllables[(seed = seed * 1103515245 + 12345) / 65536 % numSyllables];
+                    family += syllables[(seed = seed * 1103515245 + 12345) / 65536 % numSyllables];
+                }
+                individuals.push_back(new IndividualData);
+                IndividualData &data = individuals.back();
+                if (!strcmp(order, "first/last")) {
+                    data.m_criteria.push_back(compare->transform(given));
+                    data.m_criteria.push_back(compare->transform(family));
+                } else if (!strcmp(order, "last/first")) {
+                    data.m_criteria.push_back(compare->transform(family));
+                    data.m_criteria.push_back(compare->transform(given));
+                } else {
+                    data.m_criteria.push_back(compare->transform(given + " " + family));
+                }
+                data.m_hasSortKey = compare->createSortKey(data.m_criteria, data.m_sortKey);
+                CPPUNIT_ASSERT(data.m_hasSortKey);
+            }
+
+            std::vector<IndividualData *> byCriteria, byKey;
+            for (size_t i = 0; i < individuals.size(); i++) {
+                byCriteria.push_back(&individuals[i]);
+            }
+            byKey = byCriteria;
+
+            Timespec start = Timespec::monotonic();
+            std::sort(byCriteria.begin(), byCriteria.end(), CriteriaCompare(*compare));
+            Timespec middle = Timespec::monotonic();
+            std::sort(byKey.begin(), byKey.end(), KeyCompare(compare));
+            Timespec end = Timespec::monotonic();
+            SE_LOG_INFO(NULL, "sorting %ld individuals %s: %.3fs with criteria, %.3fs with sort keys",
+                        (long)numIndividuals, order,
+                        (middle - start).duration(),
+                        (end - middle).duration());
+
+            for (size_t i = 0; i < numIndividuals; i++) {
+                // Same criteria, but not necessarily the same instances.
+                CPPUNIT_ASSERT(byCriteria[i]->m_criteria == byKey[i]->m_criteria);
+            }
+        }
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(CompareBoostTest);
+
+/**
+ * Builds a filter expression: Terms("contains") << "full-name" << "foo".
+ */
+class Terms
+{
+    std::vector<LocaleFactory::Filter_t> m_terms;
+public:
+    Terms(const char *operation) { m_terms.push_back(std::string(operation)); }
+    Terms &operator << (const char *term) { m_terms.push_back(std::string(term)); return *this; }
+    Terms &operator << (const Terms &terms) { m_terms.push_back(terms.m_terms); return *this; }
+    operator LocaleFactory::Filter_t () const { return m_terms; }
+};
+
+/**
+ * A filter which claims to refine another one makes
+ * FilteredView::replaceFilter() check only the contacts which matched
+ * before, so a wrong "true" would silently drop matches.
+ */
+class FilterRefinementTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(FilterRefinementTest);
+    CPPUNIT_TEST(positive);
+    CPPUNIT_TEST(negative);
+    CPPUNIT_TEST_SUITE_END();
+
+    boost::shared_ptr<LocaleFactory> m_factory;
+
+    /** true if filter b refines filter a */
+    bool refines(const LocaleFactory::Filter_t &b, const LocaleFactory::Filter_t &a)
+    {
+        if (!m_factory) {
+            m_factory = LocaleFactory::createFactory();
+        }
+        boost::shared_ptr<IndividualFilter> filterA = m_factory->createFilter(a, 0);
+        boost::shared_ptr<IndividualFilter> filterB = m_factory->createFilter(b, 0);
+        return filterB->isRefinementOf(*filterA);
+    }
+
+    void positive()
+    {
+        // Longer search values.
+        CPPUNIT_ASSERT(refines(Terms("contains") << "full-name" << "abc",
+                               Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(refines(Terms("contains") << "full-name" << "ab",
+                               Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(refines(Terms("contains") << "full-name" << "xABcx",
+                               Terms("contains") << "full-name" << "abc"));
+        CPPUNIT_ASSERT(refines(Terms("begins-with") << "emails/value" << "john.doe",
+                               Terms("begins-with") << "emails/value" << "john"));
+        CPPUNIT_ASSERT(refines(Terms("ends-with") << "addresses/locality" << "Hamburg",
+                               Terms("ends-with") << "addresses/locality" << "burg"));
+        CPPUNIT_ASSERT(refines(Terms("is") << "nickname" << "Joe",
+                               Terms("is") << "nickname" << "joe"));
+        CPPUNIT_ASSERT(refines(Terms("contains") << "phones/value" << "089-1234",
+                               Terms("contains") << "phones/value" << "8912"));
+        CPPUNIT_ASSERT(refines(Terms("any-contains") << "abc",
+                               Terms("any-contains") << "ab"));
+        CPPUNIT_ASSERT(refines(Terms("any-contains") << "ab" << "case-sensitive",
+                               Terms("any-contains") << "a" << "case-sensitive"));
+
+        // Narrower 'or': fewer and/or more specific alternatives.
+        CPPUNIT_ASSERT(refines(Terms("or") <<
+                               (Terms("contains") << "full-name" << "abc"),
+                               Terms("or") <<
+                               (Terms("contains") << "full-name" << "ab") <<
+                               (Terms("contains") << "emails/value" << "ab")));
+        CPPUNIT_ASSERT(refines(Terms("or") <<
+                               (Terms("contains") << "full-name" << "abc") <<
+                               (Terms("contains") << "emails/value" << "abc"),
+                               Terms("or") <<
+                               (Terms("contains") << "full-name" << "ab") <<
+                               (Terms("contains") << "emails/value" << "ab")));
+
+        // Narrower 'and': more and/or more specific conditions.
+        CPPUNIT_ASSERT(refines(Terms("and") <<
+                               (Terms("contains") << "full-name" << "abc") <<
+                               (Terms("contains") << "emails/value" << "x"),
+                               Terms("and") <<
+                               (Terms("contains") << "full-name" << "ab")));
+    }
+
+    void negative()
+    {
+        // Shorter or different search value.
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "ab",
+                                Terms("contains") << "full-name" << "abc"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "abd",
+                                Terms("contains") << "full-name" << "abc"));
+        CPPUNIT_ASSERT(!refines(Terms("begins-with") << "full-name" << "xab",
+                                Terms("begins-with") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("ends-with") << "full-name" << "abx",
+                                Terms("ends-with") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("is") << "full-name" << "abc",
+                                Terms("is") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "phones/value" << "891",
+                                Terms("contains") << "phones/value" << "8912"));
+        CPPUNIT_ASSERT(!refines(Terms("any-contains") << "a",
+                                Terms("any-contains") << "ab"));
+
+        // Different mode.
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "abc" << "case-sensitive",
+                                Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "abc",
+                                Terms("contains") << "full-name" << "ab" << "accent-sensitive"));
+        CPPUNIT_ASSERT(!refines(Terms("any-contains") << "abc" << "case-sensitive",
+                                Terms("any-contains") << "ab"));
+
+        // Different field.
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "nickname" << "abc",
+                                Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "addresses/street" << "abc",
+                                Terms("contains") << "addresses/locality" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "abc",
+                                Terms("any-contains") << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("any-contains") << "abc",
+                                Terms("contains") << "full-name" << "ab"));
+
+        // Different operation.
+        CPPUNIT_ASSERT(!refines(Terms("is") << "full-name" << "abc",
+                                Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("contains") << "full-name" << "abc",
+                                Terms("is") << "full-name" << "abc"));
+        CPPUNIT_ASSERT(!refines(Terms("begins-with") << "full-name" << "abc",
+                                Terms("contains") << "full-name" << "ab"));
+        CPPUNIT_ASSERT(!refines(Terms("is") << "phones/value" << "1234",
+                                Terms("contains") << "phones/value" << "123"));
+
+        // 'or' with an additional or a less specific alternative.
+        CPPUNIT_ASSERT(!refines(Terms("or") <<
+                                (Terms("contains") << "full-name" << "abc") <<
+                                (Terms("contains") << "emails/value" << "abc"),
+                                Terms("or") <<
+                                (Terms("contains") << "full-name" << "ab")));
+        CPPUNIT_ASSERT(!refines(Terms("or") <<
+                                (Terms("contains") << "full-name" << "a"),
+                                Terms("or") <<
+                                (Terms("contains") << "full-name" << "ab")));
+
+        // 'and' with a missing or a less specific condition.
+        CPPUNIT_ASSERT(!refines(Terms("and") <<
+                                (Terms("contains") << "full-name" << "abc"),
+                                Terms("and") <<
+                                (Terms("contains") << "full-name" << "ab") <<
+                                (Terms("contains") << "emails/value" << "x")));
+        CPPUNIT_ASSERT(!refines(Terms("and") <<
+                                (Terms("contains") << "full-name" << "a"),
+                                Terms("and") <<
+                                (Terms("contains") << "full-name" << "ab")));
+
+        // An empty 'and' matches nothing, adding conditions
+        // widens the search.
+        CPPUNIT_ASSERT(!refines(Terms("and") <<
+                                (Terms("contains") << "full-name" << "abc"),
+                                Terms("and")));
+        CPPUNIT_ASSERT(refines(Terms("and"),
+                               Terms("and")));
+
+        // 'or' against 'and' with the same sub-filters.
+        CPPUNIT_ASSERT(!refines(Terms("and") <<
+                                (Terms("contains") << "full-name" << "abc"),
+                                Terms("or") <<
+                                (Terms("contains") << "full-name" << "abc")));
+        CPPUNIT_ASSERT(!refines(Terms("or") <<
+                                (Terms("contains") << "full-name" << "abc"),
+                                Terms("and") <<
+                                (Terms("contains") << "full-name" << "abc")));
+
+        // Logic operation against a plain filter.
+        CPPUNIT_ASSERT(!refines(Terms("and") <<
+                                (Terms("contains") << "full-name" << "abc"),
+                                Terms("contains") << "full-name" << "ab"));
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(FilterRefinementTest);
+
+/**
+ * Text filters answer from the precomputed, normalized field values
+ * when possible. That must give the same result as normalizing the
+ * field value for each comparison, which is what the filters do
+ * without precomputed data. In particular the trigram check must not
+ * reject contacts which match.
+ */
+class PrecomputedTextTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(PrecomputedTextTest);
+    CPPUNIT_TEST(fields);
+    CPPUNIT_TEST(anyContains);
+    CPPUNIT_TEST_SUITE_END();
+
+    struct Value
+    {
+        LocaleFactory::Precomputed::Field m_field;
+        const char *m_value;
+    };
+
+    /** all field values of a contact, terminated by NULL */
+    typedef const Value *Contact_t;
+
+    static const Value *getContact(size_t index)
+    {
+        static const Value contact0[] = {
+            { LocaleFactory::Precomputed::FULL_NAME, "Jürgen Müller-Lüdenscheidt" },
+            { LocaleFactory::Precomputed::GIVEN_NAME, "Jürgen" },
+            { LocaleFactory::Precomputed::FAMILY_NAME, "Müller-Lüdenscheidt" },
+            { LocaleFactory::Precomputed::ADDITIONAL_NAMES, "Ömer" },
+            { LocaleFactory::Precomputed::NICKNAME, "JÜ" },
+            { LocaleFactory::Precomputed::EMAIL, "Juergen.Mueller@Example.COM" },
+            { LocaleFactory::Precomputed::EMAIL, "jm@example.org" },
+            { LocaleFactory::Precomputed::TEL, "+49 (89) 1234-567" },
+            { LocaleFactory::Precomputed::TEL, "0176/FOO-BAR" },
+            { LocaleFactory::Precomputed::ADDR_STREET, "Straße des 17. Juni 1" },
+            { LocaleFactory::Precomputed::ADDR_LOCALITY, "München" },
+            { LocaleFactory::Precomputed::ADDR_POSTAL_CODE, "80331" },
+            { LocaleFactory::Precomputed::ADDR_COUNTRY, "Deutschland" },
+            { LocaleFactory::Precomputed::FULL_NAME, NULL }
+        };
+        static const Value contact1[] = {
+            { LocaleFactory::Precomputed::FULL_NAME, "Ζωή Παπαδοπούλου" },
+            { LocaleFactory::Precomputed::GIVEN_NAME, "Ζωή" },
+            { LocaleFactory::Precomputed::FAMILY_NAME, "Παπαδοπούλου" },
+            { LocaleFactory::Precomputed::NICKNAME, "Иван" },
+            { LocaleFactory::Precomputed::EMAIL, "zoe@example.gr" },
+            { LocaleFactory::Precomputed::TEL, "+30 21 0123 4567" },
+            { LocaleFactory::Precomputed::ADDR_PO_BOX, "PO 12" },
+            { LocaleFactory::Precomputed::ADDR_EXTENSION, "c/o Ωmega" },
+            { LocaleFactory::Precomputed::ADDR_LOCALITY, "Αθήνα" },
+            { LocaleFactory::Precomputed::ADDR_REGION, "Attikí" },
+            { LocaleFactory::Precomputed::FULL_NAME, NULL }
+        };
+        static const Value contact2[] = {
+            { LocaleFactory::Precomputed::FULL_NAME, "王小明" },
+            { LocaleFactory::Precomputed::NICKNAME, "" },
+            { LocaleFactory::Precomputed::TEL, "555-1234 ext. 9" },
+            { LocaleFactory::Precomputed::FULL_NAME, NULL }
+        };
+        static const Value *contacts[] = { contact0, contact1, contact2 };
+        return index < sizeof(contacts) / sizeof(contacts[0]) ? contacts[index] : NULL;
+    }
+
+    /** mixed case, accents, transliteration, phone digits, short terms */
+    static const char **getTerms()
+    {
+        static const char *terms[] = {
+            "jürgen", "JURGEN", "juergen", "Müller-Lü", "muller", "LÜDEN", "dt", "mer",
+            "jü", "JU", "j", "ü", "", " ",
+            "@example", "EXAMPLE.com", ".org", "jm@",
+            "89", "891234", "89 1234", "(89)1234-5", "+49-89", "1234567", "foo", "FOOBAR",
+            "3662", "0176", "4", "-",
+            "strasse", "straße", "17. juni", "munchen", "MÜNCHEN", "803", "land",
+            "zoe", "ΖΩΉ", "Ζωη", "papado", "poulou", "ivan", "iva", "Ива", "athina", "athena",
+            "attiki", "po 1", "c/o", "omega", "Ωm",
+            "wang", "xiao ming", "王", "小明", "555", "ext", "12349", "xyz",
+            NULL
+        };
+        return terms;
+    }
+
+    /** field names as used in filters */
+    static const char *getFieldName(LocaleFactory::Precomputed::Field field)
+    {
+        switch (field) {
+        case LocaleFactory::Precomputed::FULL_NAME: return "full-name";
+        case LocaleFactory::Precomputed::NICKNAME: return "nickname";
+        case LocaleFactory::Precomputed::FAMILY_NAME: return "structured-name/family";
+        case LocaleFactory::Precomputed::GIVEN_NAME: return "structured-name/given";
+        case LocaleFactory::Precomputed::ADDITIONAL_NAMES: return "structured-name/additional";
+        case LocaleFactory::Precomputed::EMAIL: return "emails/value";
+        case LocaleFactory::Precomputed::TEL: return "phones/value";
+        case LocaleFactory::Precomputed::ADDR_PO_BOX: return "addresses/po-box";
+        case LocaleFactory::Precomputed::ADDR_EXTENSION: return "addresses/extension";
+        case LocaleFactory::Precomputed::ADDR_STREET: return "addresses/street";
+        case LocaleFactory::Precomputed::ADDR_LOCALITY: return "addresses/locality";
+        case LocaleFactory::Precomputed::ADDR_REGION: return "addresses/region";
+        case LocaleFactory::Precomputed::ADDR_POSTAL_CODE: return "addresses/postal-code";
+        case LocaleFactory::Precomputed::ADDR_COUNTRY: return "addresses/country";
+        }
+        return NULL;
+    }
+
+    /** same texts as LocaleFactoryBoost::precompute() for an individual with these values */
+    static void precompute(const LocaleFactoryBoost &factory, Contact_t contact, LocaleFactory::Precomputed &precomputed)
+    {
+        precomputed.m_textMode = factory.m_textMode;
+        for (const Value *value = contact; value->m_value; value++) {
+            factory.addText(precomputed, value->m_field, value->m_value);
+        }
+        AnyContainsBoost::sortTrigrams(precomputed.m_trigrams);
+    }
+
+    /** answer of the filter without precomputed data */
+    static bool matchesValues(const AnyContainsBoost &filter,
+                              Contact_t contact,
+                              LocaleFactory::Precomputed::Field field)
+    {
+        AnyContainsBoost::Operation_t operation = filter.getOperation();
+        for (const Value *value = contact; value->m_value; value++) {
+            if (value->m_field == field &&
+                (filter.*operation)(value->m_value)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fields()
+    {
+        LocaleFactoryBoost factory;
+        static const char *operations[] = { "contains", "is", "begins-with", "ends-with" };
+        // Only filters with the default flags can use the precomputed texts.
+        static const char *flags[] = { NULL, "case-sensitive", "accent-sensitive", "no-transliteration" };
+        size_t precomputedMatches = 0;
+
+        Contact_t contact;
+        for (size_t index = 0; (contact = getContact(index)) != NULL; index++) {
+            LocaleFactory::Precomputed precomputed;
+            precompute(factory, contact, precomputed);
+            for (int field = LocaleFactory::Precomputed::FULL_NAME;
+                 field <= LocaleFactory::Precomputed::ADDR_COUNTRY;
+                 field++) {
+                bool tel = field == LocaleFactory::Precomputed::TEL;
+                BOOST_FOREACH (const char *operation, operations) {
+                    BOOST_FOREACH (const char *flag, flags) {
+                        if (tel && flag) {
+                            // Not supported for 'phones/value'.
+                            continue;
+                        }
+                        for (const char **term = getTerms(); *term; term++) {
+                            Terms terms(operation);
+                            terms << getFieldName((LocaleFactory::Precomputed::Field)field) << *term;
+                            if (flag) {
+                                terms << flag;
+                            }
+                            boost::shared_ptr<IndividualFilter> filter = factory.createFilter(terms, 0);
+                            const AnyContainsBoost *text = dynamic_cast<const AnyContainsBoost *>(filter.get());
+                            CPPUNIT_ASSERT(text);
+                            std::string description = StringPrintf("contact #%ld, %s", (long)index,
+                                                                   LocaleFactory::Filter2String(terms).c_str());
+                            bool result;
+                            bool usable = text->matchesPrecomputed(precomputed, result);
+                            if (tel || !flag) {
+                                CPPUNIT_ASSERT_MESSAGE(description, usable);
+                                CPPUNIT_ASSERT_EQUAL_MESSAGE(description,
+                                                             matchesValues(*text, contact, (LocaleFactory::Precomputed::Field)field),
+                                                             result);
+                                if (result) {
+                                    precomputedMatches++;
+                                }
+                            } else {
+                                CPPUNIT_ASSERT_MESSAGE(description, !usable);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        // Guard against both code paths failing in the same way.
+        CPPUNIT_ASSERT(precomputedMatches > 100);
+    }
+
+    void anyContains()
+    {
+        LocaleFactoryBoost factory;
+        Contact_t contact;
+        for (size_t index = 0; (contact = getContact(index)) != NULL; index++) {
+            LocaleFactory::Precomputed precomputed;
+            precompute(factory, contact, precomputed);
+            for (const char **term = getTerms(); *term; term++) {
+                Terms terms("any-contains");
+                terms << *term;
+                boost::shared_ptr<IndividualFilter> filter = factory.createFilter(terms, 0);
+                const AnyContainsBoost *text = dynamic_cast<const AnyContainsBoost *>(filter.get());
+                CPPUNIT_ASSERT(text);
+
+                // Names, emails and phone numbers, like AnyContainsBoost::matches().
+                bool expected = false;
+                for (const Value *value = contact; value->m_value && !expected; value++) {
+                    if (value->m_field == LocaleFactory::Precomputed::TEL) {
+                        expected = text->containsSearchTel(value->m_value);
+                    } else if (value->m_field < LocaleFactory::Precomputed::TEL) {
+                        expected = text->containsSearchText(value->m_value);
+                    }
+                }
+                bool result;
+                std::string description = StringPrintf("contact #%ld, %s", (long)index,
+                                                       LocaleFactory::Filter2String(terms).c_str());
+                CPPUNIT_ASSERT_MESSAGE(description, text->matchesPrecomputed(precomputed, result));
+                CPPUNIT_ASSERT_EQUAL_MESSAGE(description, expected, result);
+            }
+        }
+
+        // A few results which must hold regardless of the implementation.
+        LocaleFactory::Precomputed precomputed;
+        precompute(factory, getContact(0), precomputed);
+        static const char *matching[] = { "JURGEN", "müller-lü", "891234", "3662", "jü", "" };
+        BOOST_FOREACH (const char *term, matching) {
+            bool result = false;
+            Terms terms("any-contains");
+            terms << term;
+            CPPUNIT_ASSERT(factory.createFilter(terms, 0)->matchesPrecomputed(precomputed, result));
+            CPPUNIT_ASSERT_MESSAGE(term, result);
+        }
+        if (factory.m_textMode & AnyContainsBoost::TRANSLITERATE) {
+            precomputed = LocaleFactory::Precomputed();
+            precompute(factory, getContact(1), precomputed);
+            bool result = false;
+            Terms terms("any-contains");
+            terms << "ivan";
+            CPPUNIT_ASSERT(factory.createFilter(terms, 0)->matchesPrecomputed(precomputed, result));
+            CPPUNIT_ASSERT(result);
+        }
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(PrecomputedTextTest);
+
+#endif // ENABLE_UNIT_TESTS
+
 SE_END_CXX
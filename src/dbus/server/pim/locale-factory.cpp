@@ -26,6 +26,7 @@
 
 #include <boost/lexical_cast.hpp>
 #include <sstream>
+#include <typeinfo>
 
 SE_BEGIN_CXX
 
@@ -55,6 +56,17 @@ bool LocaleFactory::Precomputed::operator == (const LocaleFactory::Precomputed &
         ++ita;
         ++itb;
     }
+    // m_trigrams are derived from m_texts, no need to compare them.
+    if (other.m_textMode != m_textMode ||
+        other.m_texts.size() != m_texts.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < m_texts.size(); i++) {
+        if (other.m_texts[i].m_field != m_texts[i].m_field ||
+            other.m_texts[i].m_value != m_texts[i].m_value) {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -131,6 +143,30 @@ class LogicFilter : public IndividualFilter
 {
 protected:
     std::vector< boost::shared_ptr<IndividualFilter> > m_subFilter;
+
+    /**
+     * True if the other filter is the same kind of logic filter and
+     * the first sub-filters here refine the corresponding ones there.
+     *
+     * @param count    number of sub-filters which need to be compared
+     */
+    bool refinesSubFilters(const IndividualFilter &other, size_t count) const
+    {
+        const LogicFilter *logic = dynamic_cast<const LogicFilter *>(&other);
+        if (!logic ||
+            typeid(*logic) != typeid(*this) ||
+            count > m_subFilter.size() ||
+            count > logic->m_subFilter.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!m_subFilter[i]->isRefinementOf(*logic->m_subFilter[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
 public:
     void addFilter(const boost::shared_ptr<IndividualFilter> &filter) { m_subFilter.push_back(filter); }
 };
@@ -147,6 +183,30 @@ public:
         }
         return false;
     }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        bool matched = false;
+        BOOST_FOREACH (const boost::shared_ptr<IndividualFilter> &filter, m_subFilter) {
+            bool subResult;
+            if (!filter->matchesPrecomputed(precomputed, subResult)) {
+                return false;
+            }
+            matched = matched || subResult;
+        }
+        result = matched;
+        return true;
+    }
+
+    virtual bool isRefinementOf(const IndividualFilter &other) const
+    {
+        // Each alternative must be more specific, and
+        // alternatives may be dropped, but not added.
+        const OrFilter *filter = dynamic_cast<const OrFilter *>(&other);
+        return filter &&
+            m_subFilter.size() <= filter->m_subFilter.size() &&
+            refinesSubFilters(other, m_subFilter.size());
+    }
 };
 
 class AndFilter : public LogicFilter
@@ -163,6 +223,44 @@ public:
         // Does not match if empty, just like 'or'.
         return !m_subFilter.empty();
     }
+
+    virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+    {
+        bool matched = !m_subFilter.empty();
+        BOOST_FOREACH (const boost::shared_ptr<IndividualFilter> &filter, m_subFilter) {
+            bool subResult;
+            if (!filter->matchesPrecomputed(precomputed, subResult)) {
+                return false;
+            }
+            matched = matched && subResult;
+        }
+        result = matched;
+        return true;
+    }
+
+    virtual bool getPhoneNumber(SimpleE164 &number) const
+    {
+        // All sub-filters must match, so one of them which
+        // is limited to a phone number limits the whole filter.
+        BOOST_FOREACH (const boost::shared_ptr<IndividualFilter> &filter, m_subFilter) {
+            if (filter->getPhoneNumber(number)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    virtual bool isRefinementOf(const IndividualFilter &other) const
+    {
+        // Each condition must be more specific, and conditions
+        // may be added, but not removed. An empty 'and' matches
+        // nothing, so adding conditions to it widens the search.
+        const AndFilter *filter = dynamic_cast<const AndFilter *>(&other);
+        return filter &&
+            m_subFilter.size() >= filter->m_subFilter.size() &&
+            (!filter->m_subFilter.empty() || m_subFilter.empty()) &&
+            refinesSubFilters(other, filter->m_subFilter.size());
+    }
 };
 
 boost::shared_ptr<IndividualFilter> LocaleFactory::createFilter(const Filter_t &filter, int level)
@@ -92,6 +92,13 @@ class LocaleFactory
      */
     static boost::shared_ptr<LocaleFactory> createFactory();
 
+    /**
+     * Identifies the locale (and thus sorting and normalization) used
+     * by the factory, for example "de_DE.UTF-8". Data computed by
+     * one factory can be reused by another one with the same name.
+     */
+    virtual std::string getName() const = 0;
+
     /**
      * Creates a compare instance or throws an error when that is not
      * possible.
@@ -154,8 +161,54 @@ class LocaleFactory
      */
     struct Precomputed
     {
+        Precomputed() : m_textMode(-1) {}
+
         typedef std::vector<SimpleE164> PhoneNumbers;
         PhoneNumbers m_phoneNumbers;
+
+        /** fields whose text is cached in m_texts */
+        enum Field {
+            FULL_NAME,
+            NICKNAME,
+            FAMILY_NAME,
+            GIVEN_NAME,
+            ADDITIONAL_NAMES,
+            EMAIL,
+            TEL,
+            ADDR_PO_BOX,
+            ADDR_EXTENSION,
+            ADDR_STREET,
+            ADDR_LOCALITY,
+            ADDR_REGION,
+            ADDR_POSTAL_CODE,
+            ADDR_COUNTRY
+        };
+
+        /**
+         * Value of one field, normalized like the search value of a
+         * text filter with the default flags (case folded, accents
+         * removed, transliterated). TEL values are reduced to digits
+         * instead.
+         */
+        struct Text
+        {
+            Field m_field;
+            std::string m_value;
+        };
+        typedef std::vector<Text> Texts;
+        Texts m_texts;
+
+        /** implementation specific normalization used for m_texts, -1 if not set */
+        int m_textMode;
+
+        /**
+         * Sorted set of all trigrams (three consecutive bytes) in
+         * m_texts. A search value can only be found in one of the
+         * texts if all of its trigrams are in this set.
+         */
+        typedef std::vector<unsigned int> Trigrams;
+        Trigrams m_trigrams;
+
         bool operator == (const Precomputed &other) const;
         bool operator != (const Precomputed &other) const { return !(*this == other); }
     };
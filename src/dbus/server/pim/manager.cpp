@@ -24,6 +24,7 @@
 #include "full-view.h"
 #include "merge-view.h"
 #include "edsf-view.h"
+#include "snapshot.h"
 #include "../resource.h"
 #include "../client.h"
 #include "../session.h"
@@ -83,6 +84,7 @@ Manager::Manager(const boost::shared_ptr<Server> &server) :
     m_server(server),
     m_locale(LocaleFactory::createFactory()),
     m_localedListener(LocaledListener::create()),
+    m_snapshotDelay(atoi(getEnv("SYNCEVOLUTION_PIM_SNAPSHOT_DELAY", "10"))),
     emitSyncProgress(*this, "SyncProgress")
 {
     // Update our own environment and sorting on each locale change.
@@ -142,6 +144,7 @@ void Manager::init()
         initSorting(m_sortOrder);
     }
     initDatabases();
+    initSnapshot();
 
     add(this, &Manager::start, "Start");
     add(this, &Manager::stop, "Stop");
@@ -262,6 +265,7 @@ void Manager::runInMainVoid(const boost::function<void ()> &operation)
 void Manager::initFolks()
 {
     m_folks = IndividualAggregator::create(m_locale);
+    m_folks->getMainView()->m_quiescenceSignal.connect(boost::bind(&Manager::mainViewQuiescent, this));
 }
 
 void Manager::initSorting(const std::string &order)
@@ -290,10 +294,68 @@ void Manager::localeChanged()
     // changing the sort order.
     initSorting(m_sortOrder);
 
+    // Precomputed data in the snapshot is for the old locale.
+    m_snapshot.reset();
+
     // Now update views.
     m_localeChanged(m_locale);
 }
 
+std::string Manager::getSnapshotKey() const
+{
+    return m_locale->getName() + " " + m_sortOrder;
+}
+
+std::string Manager::getSnapshotFilename()
+{
+    return SubstEnvironment("${XDG_CACHE_HOME}/syncevolution/pim-manager-snapshot");
+}
+
+void Manager::initSnapshot()
+{
+    try {
+        m_snapshot = ViewSnapshot::read(getSnapshotFilename(), getSnapshotKey());
+    } catch (...) {
+        std::string explanation;
+        Exception::handle(explanation, HANDLE_EXCEPTION_NO_ERROR);
+        SE_LOG_WARNING(NULL, "Reading snapshot of contacts failed, searching will have to wait for folks: %s",
+                       explanation.c_str());
+    }
+}
+
+void Manager::mainViewQuiescent()
+{
+    // The unified address book is complete, searches no longer
+    // need the snapshot.
+    m_snapshot.reset();
+
+    // Write the new snapshot later, to avoid doing it repeatedly
+    // while contacts still get modified.
+    if (!m_snapshotTimeout) {
+        m_snapshotTimeout.runOnce(m_snapshotDelay,
+                                  boost::bind(&Manager::writeSnapshot, this));
+    }
+}
+
+void Manager::writeSnapshot()
+{
+    try {
+        boost::shared_ptr<FullView> view = m_folks->getMainView();
+        if (!view->isQuiescent()) {
+            // Will be called again via mainViewQuiescent().
+            return;
+        }
+        std::string filename = getSnapshotFilename();
+        mkdir_p(getDirname(filename));
+        ViewSnapshot::write(filename, getSnapshotKey(), *view);
+    } catch (...) {
+        std::string explanation;
+        Exception::handle(explanation, HANDLE_EXCEPTION_NO_ERROR);
+        SE_LOG_WARNING(NULL, "Writing snapshot of contacts failed: %s",
+                       explanation.c_str());
+    }
+}
+
 boost::shared_ptr<Manager> Manager::create(const boost::shared_ptr<Server> &server)
 {
     boost::shared_ptr<Manager> manager(new Manager(server));
@@ -343,6 +405,7 @@ void Manager::stop()
         initFolks();
         initDatabases();
         initSorting(m_sortOrder);
+        initSnapshot();
 
         if (m_preventingAutoTerm) {
             // Allow auto shutdown again.
@@ -379,6 +442,8 @@ void Manager::setSortOrder(const std::string &order)
     m_configNode->writeProperty(MANAGER_CONFIG_SORT_PROPERTY, InitStateString(order, true));
     m_configNode->flush();
     m_sortOrder = order;
+    // Stored order no longer matches.
+    m_snapshot.reset();
 }
 
 std::string Manager::getSortOrder()
@@ -411,6 +476,23 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
         std::deque<std::string> m_ids;
         const GDBusCXX::DBusClientCall0 *m_call;
     } m_pendingChange, m_lastChange;
+
+    /** changes which could not be merged, in the order in which they must be sent */
+    std::deque<Change> m_changes;
+    /** number of change calls sent to the agent without a reply yet */
+    int m_pendingCalls;
+    /** sendChanges() keeps changes in m_changes while m_pendingCalls reaches this */
+    int m_maxPendingCalls;
+    /**
+     * Seconds to wait before sending changes which could not be
+     * merged, in case that more changes follow. 0 for sending
+     * right away, < 0 for waiting until the process is idle.
+     */
+    int m_changeDelay;
+    Timeout m_changeTimeout;
+    /** Quiescent() must be sent once m_changes is empty */
+    bool m_quiescentPending;
+
     GDBusCXX::DBusClientCall0 m_quiescent;
     GDBusCXX::DBusClientCall0 m_contactsModified,
         m_contactsAdded,
@@ -434,6 +516,10 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
         m_locale(locale),
         m_owner(owner),
         m_filter(filter),
+        m_pendingCalls(0),
+        m_maxPendingCalls(std::max(1, atoi(getEnv("SYNCEVOLUTION_PIM_VIEW_MAX_PENDING", "10")))),
+        m_changeDelay(atoi(getEnv("SYNCEVOLUTION_PIM_VIEW_CHANGE_DELAY", "0"))),
+        m_quiescentPending(false),
 
         // use ViewAgent interface
         m_quiescent(m_viewAgent, "Quiescent"),
@@ -452,16 +538,16 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
                                       const V &ids)
     {
         // Changes get aggregated inside handleChange().
+        m_pendingCalls++;
         call.start(getObject(),
                    start,
                    ids,
-                   boost::bind(ViewResource::sendDone,
+                   boost::bind(ViewResource::changeDone,
                                m_self,
                                _1,
                                &call == &m_contactsModified ? "ContactsModified()" :
                                &call == &m_contactsAdded ? "ContactsAdded()" :
-                               &call == &m_contactsRemoved ? "ContactsRemoved()" : "???",
-                               true));
+                               &call == &m_contactsRemoved ? "ContactsRemoved()" : "???"));
     }
 
     /**
@@ -627,8 +713,17 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
             return;
         }
 
-        // Cannot merge changes.
-        flushChanges();
+        // Cannot merge changes. Sending the pending one may get
+        // delayed further, see sendChanges().
+        queueChange();
+        if (m_changeDelay) {
+            if (!m_changeTimeout) {
+                m_changeTimeout.runOnce(m_changeDelay,
+                                        boost::bind(&ViewResource::sendChanges, this, false));
+            }
+        } else {
+            sendChanges(false);
+        }
 
         // Now remember requested change.
         m_pendingChange.m_call = &call;
@@ -637,35 +732,181 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
         m_pendingChange.m_ids.push_back(id);
     }
 
-    /** Clear pending state and flush. */
-    void flushChanges()
+    /**
+     * Move pending change to m_changes, for sending with sendChanges(),
+     * unless it can be folded into a change which is still queued.
+     */
+    void queueChange()
+    {
+        if (!m_pendingChange.m_ids.empty()) {
+            m_lastChange = m_pendingChange;
+            if (coalesceChange(m_pendingChange)) {
+                m_pendingChange.m_ids.clear();
+            } else {
+                m_changes.push_back(Change());
+                std::swap(m_changes.back(), m_pendingChange);
+            }
+        }
+    }
+
+    /**
+     * Fold a change into the queued changes which have not been sent
+     * yet, so that a slow agent does not make m_changes grow with
+     * each change. The start index of the change gets rebased over
+     * the queued changes, newest first, until it reaches the one
+     * which covers the same individuals:
+     * - "modified" inside an "added" or "modified" range only
+     *   updates the IDs in that range,
+     * - "removed" of a single individual inside an "added" range
+     *   drops it from that range; the queued changes after it
+     *   get rebased over the removal.
+     * Rebasing stops at the first change which overlaps only
+     * partially.
+     *
+     * @return true if the change was folded into m_changes
+     */
+    bool coalesceChange(const Change &change)
+    {
+        int count = change.m_ids.size();
+        if (!(change.m_call == &m_contactsModified ||
+              (change.m_call == &m_contactsRemoved && count == 1))) {
+            return false;
+        }
+
+        // Position of the change in the state after m_changes[i],
+        // for those changes which it got rebased over.
+        std::vector<int> starts(m_changes.size());
+        int start = change.m_start;
+        for (int i = (int)m_changes.size() - 1; i >= 0; i--) {
+            Change &queued = m_changes[i];
+            int queuedCount = queued.m_ids.size();
+            starts[i] = start;
+            bool inside = start >= queued.m_start &&
+                start + count <= queued.m_start + queuedCount;
+            bool below = start + count <= queued.m_start;
+            bool above = start >= queued.m_start + queuedCount;
+            if (queued.m_call == &m_contactsRemoved) {
+                // Indices refer to the state before the removal.
+                // Individuals which were there already cannot be
+                // inside the removed range.
+                if (start >= queued.m_start) {
+                    start += queuedCount;
+                } else if (!below) {
+                    return false;
+                }
+                continue;
+            }
+            if (inside && change.m_call == &m_contactsModified) {
+                SE_LOG_DEBUG(NULL, "queue change %s: modified #%d + %d is part of queued change #%d + %d",
+                             getPath(),
+                             change.m_start, count,
+                             queued.m_start, queuedCount);
+                for (int e = 0; e < count; e++) {
+                    queued.m_ids[start - queued.m_start + e] = change.m_ids[e];
+                }
+                return true;
+            }
+            if (inside &&
+                queued.m_call == &m_contactsAdded &&
+                queued.m_ids[start - queued.m_start] == change.m_ids.front()) {
+                SE_LOG_DEBUG(NULL, "queue change %s: removed #%d cancels queued 'added' #%d + %d",
+                             getPath(),
+                             change.m_start,
+                             queued.m_start, queuedCount);
+                queued.m_ids.erase(queued.m_ids.begin() + (start - queued.m_start));
+                // Later changes no longer see the individual.
+                for (int l = i + 1; l < (int)m_changes.size(); l++) {
+                    Change &later = m_changes[l];
+                    int removed = later.m_call == &m_contactsRemoved ?
+                        starts[l - 1] : // before the later change
+                        starts[l];
+                    if (later.m_start > removed) {
+                        later.m_start--;
+                    }
+                }
+                if (queued.m_ids.empty()) {
+                    m_changes.erase(m_changes.begin() + i);
+                }
+                return true;
+            }
+            if (queued.m_call == &m_contactsAdded && above) {
+                start -= queuedCount;
+            } else if (!below && !above) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Send queued changes. Unless all of them are requested, only
+     * as many calls are made as allowed by m_maxPendingCalls. The
+     * rest gets sent as the agent replies, so a slow agent cannot
+     * make the server pile up D-Bus messages. Instead, changes
+     * accumulate here in a compact form.
+     */
+    void sendChanges(bool all)
     {
-        int count = m_pendingChange.m_ids.size();
-        if (count) {
+        m_changeTimeout.deactivate();
+        while (!m_changes.empty() &&
+               (all || m_pendingCalls < m_maxPendingCalls)) {
+            const Change &change = m_changes.front();
             SE_LOG_DEBUG(NULL, "send change %s: %s, #%d + %d",
                          getPath(),
-                         m_pendingChange.m_call == &m_contactsModified ? "modified" :
-                         m_pendingChange.m_call == &m_contactsAdded ? "added" :
-                         m_pendingChange.m_call == &m_contactsRemoved ? "remove" : "???",
-                         m_pendingChange.m_start, count);
-            m_lastChange = m_pendingChange;
-            m_pendingChange.m_ids.clear();
-            sendChange(*m_lastChange.m_call,
-                       m_lastChange.m_start,
-                       m_lastChange.m_ids);
+                         change.m_call == &m_contactsModified ? "modified" :
+                         change.m_call == &m_contactsAdded ? "added" :
+                         change.m_call == &m_contactsRemoved ? "remove" : "???",
+                         change.m_start, (int)change.m_ids.size());
+            sendChange(*change.m_call,
+                       change.m_start,
+                       change.m_ids);
+            m_changes.pop_front();
         }
+        if (!m_changes.empty()) {
+            SE_LOG_DEBUG(NULL, "send change %s: %d changes waiting for %d replies",
+                         getPath(), (int)m_changes.size(), m_pendingCalls);
+        } else if (m_quiescentPending) {
+            m_quiescentPending = false;
+            m_quiescent.start(getObject(),
+                              boost::bind(ViewResource::sendDone,
+                                          m_self,
+                                          _1,
+                                          "Quiescent()",
+                                          false));
+        }
+    }
+
+    /** Clear pending state and send everything, regardless of flow control. */
+    void flushChanges()
+    {
+        queueChange();
+        sendChanges(true);
     }
 
-    /** Current state is stable. Flush and tell agent. */
+    /**
+     * Current state is stable. Flush and tell agent, once
+     * all changes were sent.
+     */
     void quiescent()
     {
-        flushChanges();
-        m_quiescent.start(getObject(),
-                          boost::bind(ViewResource::sendDone,
-                                      m_self,
-                                      _1,
-                                      "Quiescent()",
-                                      false));
+        queueChange();
+        m_quiescentPending = true;
+        sendChanges(false);
+    }
+
+    /** Reply to a change call, sends more changes. */
+    static void changeDone(const boost::weak_ptr<ViewResource> &self,
+                           const std::string &error,
+                           const char *method)
+    {
+        boost::shared_ptr<ViewResource> r = self.lock();
+        if (r) {
+            r->m_pendingCalls--;
+            if (error.empty()) {
+                r->sendChanges(false);
+            }
+        }
+        sendDone(self, error, method, true);
     }
 
     /**
@@ -694,6 +935,7 @@ class ViewResource : public Resource, public GDBusCXX::DBusObjectHelper
 
         // activate D-Bus interface
         add(this, &ViewResource::readContacts, "ReadContacts");
+        add(this, &ViewResource::readContactRange, "ReadContactRange");
         add(this, &ViewResource::close, "Close");
         add(this, &ViewResource::refineSearch, "RefineSearch");
         add(this, &ViewResource::replaceSearch, "ReplaceSearch");
@@ -771,19 +1013,45 @@ public:
             // data for it.
             flushChanges();
             m_view->readContacts(ids, contacts);
-            // Discard the information about the previous 'modified' signal
-            // if the client now has data in that range. Necessary because
-            // otherwise future 'modified' signals for that range might get
-            // suppressed in handleChange().
-            int modifiedCount = m_lastChange.m_ids.size();
-            if (m_lastChange.m_call == &m_contactsModified &&
-                modifiedCount) {
-                BOOST_FOREACH (const IndividualView::Contacts::value_type &entry, contacts) {
-                    int index = entry.first;
-                    if (index >= m_lastChange.m_start && index < m_lastChange.m_start + modifiedCount) {
-                        m_lastChange.m_ids.clear();
-                        break;
-                    }
+            contactsRead(contacts);
+        }
+    }
+
+    typedef std::vector< std::pair<int, IndividualProjection> > ProjectedContacts;
+
+    /** ViewControl.ReadContactRange() */
+    void readContactRange(int start, int count, const std::vector<std::string> &properties,
+                          ProjectedContacts &projected)
+    {
+        unsigned int mask = DBus2IndividualProperties(properties);
+        if (count > 0) {
+            flushChanges();
+            IndividualView::Contacts contacts;
+            m_view->readContacts(start, count, contacts);
+            contactsRead(contacts);
+            projected.reserve(contacts.size());
+            BOOST_FOREACH (const IndividualView::Contacts::value_type &entry, contacts) {
+                projected.push_back(std::make_pair(entry.first, IndividualProjection(entry.second, mask)));
+            }
+        }
+    }
+
+    /**
+     * Discard the information about the previous 'modified' signal
+     * if the client now has data in that range. Necessary because
+     * otherwise future 'modified' signals for that range might get
+     * suppressed in handleChange().
+     */
+    void contactsRead(const IndividualView::Contacts &contacts)
+    {
+        int modifiedCount = m_lastChange.m_ids.size();
+        if (m_lastChange.m_call == &m_contactsModified &&
+            modifiedCount) {
+            BOOST_FOREACH (const IndividualView::Contacts::value_type &entry, contacts) {
+                int index = entry.first;
+                if (index >= m_lastChange.m_start && index < m_lastChange.m_start + modifiedCount) {
+                    m_lastChange.m_ids.clear();
+                    break;
                 }
             }
         }
@@ -928,27 +1196,49 @@ void Manager::doSearch(const ESourceRegistryCXX &registry,
     view = FilteredView::create(view, individualFilter);
     view->setName(StringPrintf("filtered view%u", ViewResource::getNextViewNumber()));
 
-    SE_LOG_DEBUG(NULL, "preparing %s: EDS search term is '%s', active address books %s",
+    // EDS query per address book.
+    std::map<std::string, std::string> queries;
+    if (!ebookFilter.empty()) {
+        BOOST_FOREACH (const std::string &uuid, m_enabledEBooks) {
+            queries[uuid] = ebookFilter;
+        }
+    } else if (!quiescent && m_snapshot) {
+        // Look up matching contacts in the snapshot and fetch
+        // just those from EDS.
+        ViewSnapshot::Contacts contacts;
+        if (m_snapshot->search(*individualFilter, contacts)) {
+            typedef std::pair<const std::string, std::vector<std::string> > Entry_t;
+            BOOST_FOREACH (const Entry_t &entry, contacts) {
+                if (m_enabledEBooks.find(entry.first) != m_enabledEBooks.end()) {
+                    queries[entry.first] = ViewSnapshot::createEBookQuery(entry.second);
+                }
+            }
+        }
+    }
+
+    SE_LOG_DEBUG(NULL, "preparing %s: EDS search term is '%s', %ld address books searched directly, active address books %s",
                  view->getName(),
                  ebookFilter.c_str(),
+                 (long)queries.size(),
                  boost::join(m_enabledEBooks, " ").c_str());
-    if (!ebookFilter.empty() && !m_enabledEBooks.empty()) {
+    if (!queries.empty()) {
         // Set up direct searching in all active address books.
         // These searches are done once, so don't bother to deal
         // with future changes to the active address books or
         // the sort order.
         MergeView::Searches searches;
-        searches.reserve(m_enabledEBooks.size());
+        searches.reserve(queries.size());
         boost::shared_ptr<IndividualCompare> compare =
             m_sortOrder.empty() ?
             IndividualCompare::defaultCompare() :
             m_locale->createCompare(m_sortOrder);
 
-        BOOST_FOREACH (const std::string &uuid, m_enabledEBooks) {
+        typedef std::pair<const std::string, std::string> Query_t;
+        BOOST_FOREACH (const Query_t &query, queries) {
             searches.push_back(EDSFView::create(registry,
-                                                uuid,
-                                                ebookFilter));
-            searches.back()->setName(StringPrintf("eds view %s %s", uuid.c_str(), ebookFilter.c_str()));
+                                                query.first,
+                                                query.second));
+            searches.back()->setName(StringPrintf("eds view %s %s", query.first.c_str(), query.second.c_str()));
         }
         boost::shared_ptr<MergeView> merge(MergeView::create(view,
                                                              searches,
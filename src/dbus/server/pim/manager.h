@@ -35,6 +35,7 @@
 SE_BEGIN_CXX
 
 class LocaledListener;
+class ViewSnapshot;
 
 /**
  * Implementation of org._01.pim.contacts.Manager.
@@ -58,6 +59,17 @@ class Manager : public GDBusCXX::DBusObjectHelper
      */
     std::set<std::string> m_enabledEBooks;
 
+    /**
+     * Snapshot of the main view from a previous run, used by
+     * doSearch() until the main view is quiescent. NULL if not
+     * available or no longer needed.
+     */
+    boost::shared_ptr<ViewSnapshot> m_snapshot;
+    /** writes a new snapshot some time after the main view became quiescent */
+    Timeout m_snapshotTimeout;
+    /** seconds to wait before writing, from SYNCEVOLUTION_PIM_SNAPSHOT_DELAY */
+    int m_snapshotDelay;
+
     typedef std::list< std::pair< boost::shared_ptr<GDBusCXX::Result>, boost::shared_ptr<Session> > > Pending_t;
     /** holds the references to pending session requests, see runInSession() */
     Pending_t m_pending;
@@ -69,6 +81,13 @@ class Manager : public GDBusCXX::DBusObjectHelper
     void initSorting(const std::string &order);
     void localeChanged();
 
+    /** identifies locale and sort order of a ViewSnapshot */
+    std::string getSnapshotKey() const;
+    static std::string getSnapshotFilename();
+    void initSnapshot();
+    void mainViewQuiescent();
+    void writeSnapshot();
+
     typedef boost::signals2::signal<void (const boost::shared_ptr<LocaleFactory> &locale)> LocaleChangedSignal;
     LocaleChangedSignal m_localeChanged;
 
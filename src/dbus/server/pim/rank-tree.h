@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef INCL_SYNCEVO_DBUS_SERVER_PIM_RANK_TREE
+#define INCL_SYNCEVO_DBUS_SERVER_PIM_RANK_TREE
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+/**
+ * A sequence of heap-allocated instances, owned by the container,
+ * which is accessed by position (= rank) like a boost::ptr_vector.
+ * In contrast to a vector, inserting and removing in the middle
+ * only take O(log n) instead of shifting O(n) pointers around,
+ * at the cost of O(log n) instead of O(1) for accessing by position.
+ *
+ * Implemented as a treap (binary search tree with random heap
+ * priorities) where each node knows the size of its subtree. The
+ * position of a certain instance can be determined in O(log n),
+ * too.
+ *
+ * Keeping entries sorted is the responsibility of the user, see
+ * lowerBound() and sort().
+ */
+template <class T> class RankTree : private boost::noncopyable
+{
+    struct Node
+    {
+        T *m_value;
+        Node *m_left, *m_right, *m_parent;
+        size_t m_size;
+        unsigned long m_priority;
+    };
+    Node *m_root;
+    unsigned long m_seed;
+
+    /** finds node for an instance in getIndex() */
+    typedef std::map<const T *, Node *> Nodes_t;
+    Nodes_t m_nodes;
+
+    static size_t size(const Node *node) { return node ? node->m_size : 0; }
+
+    /** recalculate size after children changed, fix their parent link */
+    static void update(Node *node)
+    {
+        node->m_size = 1 + size(node->m_left) + size(node->m_right);
+        if (node->m_left) {
+            node->m_left->m_parent = node;
+        }
+        if (node->m_right) {
+            node->m_right->m_parent = node;
+        }
+    }
+
+    /** concatenates two trees */
+    static Node *merge(Node *a, Node *b)
+    {
+        if (!a) {
+            return b;
+        }
+        if (!b) {
+            return a;
+        }
+        if (a->m_priority > b->m_priority) {
+            a->m_right = merge(a->m_right, b);
+            update(a);
+            return a;
+        } else {
+            b->m_left = merge(a, b->m_left);
+            update(b);
+            return b;
+        }
+    }
+
+    /** first count entries of node go into left, the rest into right */
+    static void split(Node *node, size_t count, Node *&left, Node *&right)
+    {
+        if (!node) {
+            left = right = NULL;
+        } else if (size(node->m_left) >= count) {
+            split(node->m_left, count, left, node->m_left);
+            update(node);
+            right = node;
+        } else {
+            split(node->m_right, count - size(node->m_left) - 1, node->m_right, right);
+            update(node);
+            left = node;
+        }
+    }
+
+    /** deletes nodes and, if requested, also the instances */
+    static void destroy(Node *node, bool values)
+    {
+        if (node) {
+            destroy(node->m_left, values);
+            destroy(node->m_right, values);
+            if (values) {
+                delete node->m_value;
+            }
+            delete node;
+        }
+    }
+
+    static void collect(const Node *node, std::vector<T *> &values)
+    {
+        if (node) {
+            collect(node->m_left, values);
+            values.push_back(node->m_value);
+            collect(node->m_right, values);
+        }
+    }
+
+    Node *nodeAt(size_t index) const
+    {
+        Node *node = m_root;
+        while (true) {
+            size_t left = size(node->m_left);
+            if (index < left) {
+                node = node->m_left;
+            } else if (index == left) {
+                return node;
+            } else {
+                index -= left + 1;
+                node = node->m_right;
+            }
+        }
+    }
+
+    /** simple linear congruential generator, randomness is not critical */
+    unsigned long nextPriority()
+    {
+        m_seed = m_seed * 1103515245 + 12345;
+        return m_seed;
+    }
+
+    void setRoot(Node *root)
+    {
+        m_root = root;
+        if (m_root) {
+            m_root->m_parent = NULL;
+        }
+    }
+
+    /** append instances without sorting, takes ownership */
+    void append(const std::vector<T *> &values)
+    {
+        for (typename std::vector<T *>::const_iterator it = values.begin();
+             it != values.end();
+             ++it) {
+            insert(size(), *it);
+        }
+    }
+
+    /** adapts a compare functor for T to T * */
+    template <class C> class DerefCompare
+    {
+        C m_compare;
+    public:
+        DerefCompare(const C &compare) : m_compare(compare) {}
+        bool operator () (const T *a, const T *b) const { return m_compare(*a, *b); }
+    };
+
+ public:
+    typedef std::auto_ptr<T> auto_type;
+
+    /** returned by getIndex() for unknown instances */
+    static const size_t npos = (size_t)-1;
+
+    RankTree() : m_root(NULL), m_seed(1) {}
+    ~RankTree() { clear(); }
+
+    size_t size() const { return size(m_root); }
+    bool empty() const { return !m_root; }
+
+    /** deletes all instances */
+    void clear()
+    {
+        destroy(m_root, true);
+        m_root = NULL;
+        m_nodes.clear();
+    }
+
+    /** access by position, which must be valid */
+    T &operator [] (size_t index) { return *nodeAt(index)->m_value; }
+    const T &operator [] (size_t index) const { return *nodeAt(index)->m_value; }
+
+    /** current position of an instance owned by the container, npos if not found */
+    size_t getIndex(const T *value) const
+    {
+        typename Nodes_t::const_iterator it = m_nodes.find(value);
+        if (it == m_nodes.end()) {
+            return npos;
+        }
+        const Node *node = it->second;
+        size_t index = size(node->m_left);
+        while (node->m_parent) {
+            if (node == node->m_parent->m_right) {
+                index += size(node->m_parent->m_left) + 1;
+            }
+            node = node->m_parent;
+        }
+        return index;
+    }
+
+    /**
+     * Binary search in a sorted tree: position of the first entry
+     * which is not less than value (= where value needs to be
+     * inserted).
+     */
+    template <class C> size_t lowerBound(const T &value, const C &compare) const
+    {
+        size_t index = 0;
+        const Node *node = m_root;
+        while (node) {
+            if (compare(*node->m_value, value)) {
+                index += size(node->m_left) + 1;
+                node = node->m_right;
+            } else {
+                node = node->m_left;
+            }
+        }
+        return index;
+    }
+
+    /** insert at position (0 to size()), takes ownership */
+    void insert(size_t index, T *value)
+    {
+        Node *node = new Node;
+        node->m_value = value;
+        node->m_left = node->m_right = node->m_parent = NULL;
+        node->m_size = 1;
+        node->m_priority = nextPriority();
+        m_nodes[value] = node;
+
+        Node *left, *right;
+        split(m_root, index, left, right);
+        setRoot(merge(merge(left, node), right));
+    }
+
+    /** removes entry at position, returns ownership */
+    auto_type release(size_t index)
+    {
+        Node *left, *middle, *right;
+        split(m_root, index, left, middle);
+        split(middle, 1, middle, right);
+        setRoot(merge(left, right));
+        auto_type value(middle->m_value);
+        m_nodes.erase(middle->m_value);
+        delete middle;
+        return value;
+    }
+
+    /** replaces entry at position, returns ownership of old one */
+    auto_type replace(size_t index, T *value)
+    {
+        Node *node = nodeAt(index);
+        auto_type old(node->m_value);
+        m_nodes.erase(node->m_value);
+        node->m_value = value;
+        m_nodes[value] = node;
+        return old;
+    }
+
+    /**
+     * Replaces current content with the sorted entries of a
+     * ptr_vector, in O(n log n). Takes ownership of those, the
+     * ptr_vector is empty afterwards.
+     */
+    void assign(boost::ptr_vector<T> &values)
+    {
+        clear();
+        std::vector<T *> pointers(values.size());
+        for (size_t i = pointers.size(); i > 0; i--) {
+            pointers[i - 1] = values.pop_back().release();
+        }
+        append(pointers);
+    }
+
+    /** all instances in their current order, ownership remains with the container */
+    void getValues(std::vector<T *> &values) const
+    {
+        values.reserve(values.size() + size());
+        collect(m_root, values);
+    }
+
+    /** sort with a compare functor for T */
+    template <class C> void sort(const C &compare)
+    {
+        std::vector<T *> values;
+        getValues(values);
+        std::sort(values.begin(), values.end(), DerefCompare<C>(compare));
+        destroy(m_root, false);
+        m_root = NULL;
+        m_nodes.clear();
+        append(values);
+    }
+};
+
+template <class T> const size_t RankTree<T>::npos;
+
+SE_END_CXX
+
+#endif // INCL_SYNCEVO_DBUS_SERVER_PIM_RANK_TREE
@@ -0,0 +1,579 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "snapshot.h"
+#include "view.h"
+#include "test.h"
+
+#include <libebook/libebook.h>
+
+#include <syncevo/SafeOstream.h>
+#include <syncevo/GuardFD.h>
+#include <syncevo/Exception.h>
+#include <syncevo/BoostHelper.h>
+
+#include <boost/foreach.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+SE_GLIB_TYPE(EBookQuery, e_book_query)
+
+SE_BEGIN_CXX
+
+static const char MAGIC[] = "SEPIMV01";
+static const size_t MAGIC_LEN = sizeof(MAGIC) - 1;
+
+/**
+ * Searches which match more contacts than this are not worth
+ * answering with one EDS query per contact. They have to wait
+ * for folks instead.
+ */
+static const size_t MAX_CONTACTS = 100;
+
+static void appendUInt32(std::string &buffer, size_t value)
+{
+    buffer += (char)(value & 0xFF);
+    buffer += (char)((value >> 8) & 0xFF);
+    buffer += (char)((value >> 16) & 0xFF);
+    buffer += (char)((value >> 24) & 0xFF);
+}
+
+static void appendString(std::string &buffer, const std::string &value)
+{
+    appendUInt32(buffer, value.size());
+    buffer += value;
+}
+
+static bool parseUInt32(const unsigned char *&pos, const unsigned char *end, size_t &value)
+{
+    if (end - pos < 4) {
+        return false;
+    }
+    value = (size_t)pos[0] |
+        ((size_t)pos[1] << 8) |
+        ((size_t)pos[2] << 16) |
+        ((size_t)pos[3] << 24);
+    pos += 4;
+    return true;
+}
+
+static bool parseString(const unsigned char *&pos, const unsigned char *end, std::string &value)
+{
+    size_t len;
+    if (!parseUInt32(pos, end, len) ||
+        (size_t)(end - pos) < len) {
+        return false;
+    }
+    value.assign((const char *)pos, len);
+    pos += len;
+    return true;
+}
+
+void ViewSnapshot::write(const std::string &filename,
+                         const std::string &key,
+                         IndividualView &view)
+{
+    ViewSnapshot snapshot;
+    int size = view.size();
+    snapshot.m_entries.reserve(size);
+    for (int index = 0; index < size; index++) {
+        const IndividualData *data = view.getContact(index);
+        if (!data) {
+            continue;
+        }
+
+        std::vector< std::pair<std::string, std::string> > contacts;
+        GeeCollCXX<FolksPersona *> personas(folks_individual_get_personas(data->m_individual), ADD_REF);
+        BOOST_FOREACH (FolksPersona *persona, personas) {
+            const gchar *uid = folks_persona_get_uid(persona);
+            if (uid) {
+                gchar *backend, *storeID, *personaID;
+                folks_persona_split_uid(uid, &backend, &storeID, &personaID);
+                PlainGStr tmp1(backend), tmp2(storeID), tmp3(personaID);
+                if (!strcmp(backend, "eds")) {
+                    contacts.push_back(std::make_pair(std::string(storeID), std::string(personaID)));
+                }
+            }
+        }
+        if (contacts.empty()) {
+            continue;
+        }
+
+        snapshot.m_entries.push_back(Entry());
+        snapshot.m_entries.back().m_precomputed = data->m_precomputed;
+        snapshot.m_entries.back().m_contacts.swap(contacts);
+    }
+    SE_LOG_DEBUG(NULL, "%s: %ld of %d individuals have EDS contacts",
+                 filename.c_str(), (long)snapshot.size(), size);
+    snapshot.save(filename, key);
+}
+
+void ViewSnapshot::save(const std::string &filename,
+                        const std::string &key) const
+{
+    std::string buffer(MAGIC, MAGIC_LEN);
+    appendString(buffer, key);
+    appendUInt32(buffer, m_entries.size());
+    BOOST_FOREACH (const Entry &entry, m_entries) {
+        const LocaleFactory::Precomputed &precomputed = entry.m_precomputed;
+        appendUInt32(buffer, (size_t)precomputed.m_textMode);
+        appendUInt32(buffer, precomputed.m_phoneNumbers.size());
+        BOOST_FOREACH (const SimpleE164 &number, precomputed.m_phoneNumbers) {
+            appendUInt32(buffer, (size_t)number.m_countryCode);
+            appendUInt32(buffer, (size_t)(number.m_nationalNumber >> 32));
+            appendUInt32(buffer, (size_t)(number.m_nationalNumber & 0xFFFFFFFF));
+        }
+        appendUInt32(buffer, precomputed.m_texts.size());
+        BOOST_FOREACH (const LocaleFactory::Precomputed::Text &text, precomputed.m_texts) {
+            appendUInt32(buffer, text.m_field);
+            appendString(buffer, text.m_value);
+        }
+        appendUInt32(buffer, precomputed.m_trigrams.size());
+        BOOST_FOREACH (unsigned int trigram, precomputed.m_trigrams) {
+            appendUInt32(buffer, trigram);
+        }
+        appendUInt32(buffer, entry.m_contacts.size());
+        typedef std::pair<std::string, std::string> Contact_t;
+        BOOST_FOREACH (const Contact_t &contact, entry.m_contacts) {
+            appendString(buffer, contact.first);
+            appendString(buffer, contact.second);
+        }
+    }
+
+    SafeOstream file(filename);
+    file.write(buffer.data(), buffer.size());
+    if (file.fail()) {
+        SE_THROW(std::string("error writing ") + filename + ": " + strerror(errno));
+    }
+    SE_LOG_DEBUG(NULL, "%s: stored %ld individuals, %ld bytes",
+                 filename.c_str(), (long)m_entries.size(), (long)buffer.size());
+}
+
+boost::shared_ptr<ViewSnapshot> ViewSnapshot::read(const std::string &filename,
+                                                   const std::string &key)
+{
+    boost::shared_ptr<ViewSnapshot> snapshot;
+
+    GuardFD fd(open(filename.c_str(), O_RDONLY));
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            Exception::throwError(SE_HERE, filename, errno);
+        }
+        return snapshot;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb)) {
+        Exception::throwError(SE_HERE, filename, errno);
+    }
+    if ((size_t)sb.st_size < MAGIC_LEN) {
+        return snapshot;
+    }
+    void *mapptr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapptr == MAP_FAILED) {
+        Exception::throwError(SE_HERE, filename + ": mmap()", errno);
+    }
+    const unsigned char *start = static_cast<const unsigned char *>(mapptr);
+    const unsigned char *end = start + sb.st_size;
+    const unsigned char *pos = start + MAGIC_LEN;
+    std::string fileKey;
+    size_t numEntries;
+    if (memcmp(start, MAGIC, MAGIC_LEN) ||
+        !parseString(pos, end, fileKey) ||
+        !parseUInt32(pos, end, numEntries)) {
+        SE_LOG_DEBUG(NULL, "%s: not a valid snapshot", filename.c_str());
+    } else if (fileKey != key) {
+        SE_LOG_DEBUG(NULL, "%s: ignoring snapshot for '%s', need '%s'",
+                     filename.c_str(), fileKey.c_str(), key.c_str());
+    } else {
+        snapshot.reset(new ViewSnapshot);
+        // Each entry needs at least five numbers, so a corrupt
+        // count cannot trigger a huge allocation.
+        snapshot->m_entries.reserve(std::min(numEntries, (size_t)(end - pos) / 20));
+        for (size_t i = 0; i < numEntries; i++) {
+            snapshot->m_entries.push_back(Entry());
+            LocaleFactory::Precomputed &precomputed = snapshot->m_entries.back().m_precomputed;
+            std::vector< std::pair<std::string, std::string> > &contacts = snapshot->m_entries.back().m_contacts;
+            size_t value, count;
+            bool valid = parseUInt32(pos, end, value);
+            precomputed.m_textMode = (int32_t)value;
+            valid = valid && parseUInt32(pos, end, count);
+            for (size_t e = 0; valid && e < count; e++) {
+                SimpleE164 number;
+                size_t high, low;
+                valid = parseUInt32(pos, end, value) &&
+                    parseUInt32(pos, end, high) &&
+                    parseUInt32(pos, end, low);
+                number.m_countryCode = (SimpleE164::CountryCode_t)value;
+                number.m_nationalNumber = ((SimpleE164::NationalNumber_t)high << 32) | low;
+                precomputed.m_phoneNumbers.push_back(number);
+            }
+            valid = valid && parseUInt32(pos, end, count);
+            for (size_t e = 0; valid && e < count; e++) {
+                LocaleFactory::Precomputed::Text text;
+                valid = parseUInt32(pos, end, value) &&
+                    value <= LocaleFactory::Precomputed::ADDR_COUNTRY &&
+                    parseString(pos, end, text.m_value);
+                text.m_field = (LocaleFactory::Precomputed::Field)value;
+                precomputed.m_texts.push_back(text);
+            }
+            valid = valid && parseUInt32(pos, end, count);
+            for (size_t e = 0; valid && e < count; e++) {
+                valid = parseUInt32(pos, end, value);
+                precomputed.m_trigrams.push_back(value);
+            }
+            valid = valid && parseUInt32(pos, end, count);
+            for (size_t e = 0; valid && e < count; e++) {
+                std::pair<std::string, std::string> contact;
+                valid = parseString(pos, end, contact.first) &&
+                    parseString(pos, end, contact.second);
+                contacts.push_back(contact);
+            }
+            if (!valid) {
+                SE_LOG_DEBUG(NULL, "%s: truncated snapshot, entry #%ld", filename.c_str(), (long)i);
+                snapshot.reset();
+                break;
+            }
+        }
+    }
+    munmap(mapptr, sb.st_size);
+
+    if (snapshot) {
+        SE_LOG_DEBUG(NULL, "%s: read snapshot with %ld individuals", filename.c_str(), (long)snapshot->size());
+    }
+    return snapshot;
+}
+
+bool ViewSnapshot::search(const IndividualFilter &filter, Contacts &contacts) const
+{
+    size_t numContacts = 0;
+    size_t numResults = 0;
+    BOOST_FOREACH (const Entry &entry, m_entries) {
+        if (!filter.isIncluded(numResults)) {
+            break;
+        }
+        bool matches;
+        if (!filter.matchesPrecomputed(entry.m_precomputed, matches)) {
+            return false;
+        }
+        if (matches) {
+            numContacts += entry.m_contacts.size();
+            if (numContacts > MAX_CONTACTS) {
+                return false;
+            }
+            typedef std::pair<std::string, std::string> Contact_t;
+            BOOST_FOREACH (const Contact_t &contact, entry.m_contacts) {
+                contacts[contact.first].push_back(contact.second);
+            }
+            numResults++;
+        }
+    }
+    return true;
+}
+
+std::string ViewSnapshot::createEBookQuery(const std::vector<std::string> &uids)
+{
+    std::vector<EBookQuery *> queries;
+    queries.reserve(uids.size());
+    BOOST_FOREACH (const std::string &uid, uids) {
+        queries.push_back(e_book_query_field_test(E_CONTACT_UID, E_BOOK_QUERY_IS, uid.c_str()));
+    }
+    // e_book_query_or() unrefs the sub-queries.
+    EBookQueryCXX query(queries.size() == 1 ?
+                        queries[0] :
+                        e_book_query_or(queries.size(), &queries[0], TRUE),
+                        TRANSFER_REF);
+    PlainGStr str(e_book_query_to_string(query.get()));
+    return str.get();
+}
+
+#ifdef ENABLE_UNIT_TESTS
+
+class ViewSnapshotTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ViewSnapshotTest);
+    CPPUNIT_TEST(roundTrip);
+    CPPUNIT_TEST(invalid);
+    CPPUNIT_TEST(key);
+    CPPUNIT_TEST(search);
+    CPPUNIT_TEST_SUITE_END();
+
+    typedef ViewSnapshot::Entry Entry;
+
+    std::string m_filename;
+
+    /** matches contacts with a certain text in one of their precomputed fields */
+    class MatchText : public IndividualFilter
+    {
+        std::string m_text;
+
+    public:
+        MatchText(const std::string &text) : m_text(text) {}
+
+        virtual bool matches(const IndividualData &data) const { return false; }
+        virtual bool matchesPrecomputed(const LocaleFactory::Precomputed &precomputed, bool &result) const
+        {
+            result = false;
+            BOOST_FOREACH (const LocaleFactory::Precomputed::Text &text, precomputed.m_texts) {
+                if (text.m_value.find(m_text) != text.m_value.npos) {
+                    result = true;
+                }
+            }
+            return true;
+        }
+    };
+
+    /** a filter which needs the FolksIndividual */
+    class MatchNone : public IndividualFilter
+    {
+    public:
+        virtual bool matches(const IndividualData &data) const { return false; }
+    };
+
+    /**
+     * Entry #i has the text "contact <i>" and contacts in address
+     * books "a" and, with multiple contacts, "b".
+     */
+    static ViewSnapshot createSnapshot(size_t numEntries, size_t numContacts)
+    {
+        ViewSnapshot snapshot;
+        for (size_t i = 0; i < numEntries; i++) {
+            snapshot.m_entries.push_back(Entry());
+            LocaleFactory::Precomputed &precomputed = snapshot.m_entries.back().m_precomputed;
+            precomputed.m_textMode = 7;
+            LocaleFactory::Precomputed::Text text;
+            text.m_field = LocaleFactory::Precomputed::FULL_NAME;
+            text.m_value = StringPrintf("contact %ld", (long)i);
+            precomputed.m_texts.push_back(text);
+            for (size_t e = 0; e < numContacts; e++) {
+                snapshot.m_entries.back().m_contacts.push_back(std::make_pair(std::string(e ? "b" : "a"),
+                                                                              StringPrintf("uid-%ld-%ld", (long)i, (long)e)));
+            }
+        }
+        return snapshot;
+    }
+
+    void writeFile(const std::string &content)
+    {
+        std::ofstream out(m_filename.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(content.data(), content.size());
+        out.close();
+        CPPUNIT_ASSERT(out.good());
+    }
+
+public:
+    void setUp()
+    {
+        m_filename = "ViewSnapshotTest.bin";
+        unlink(m_filename.c_str());
+    }
+
+    void tearDown()
+    {
+        unlink(m_filename.c_str());
+    }
+
+private:
+    void roundTrip()
+    {
+        ViewSnapshot snapshot;
+        snapshot.save(m_filename, "de_DE last/first");
+        boost::shared_ptr<ViewSnapshot> copy = ViewSnapshot::read(m_filename, "de_DE last/first");
+        CPPUNIT_ASSERT(copy);
+        CPPUNIT_ASSERT_EQUAL((size_t)0, copy->size());
+
+        snapshot.m_entries.resize(3);
+        LocaleFactory::Precomputed &precomputed = snapshot.m_entries[0].m_precomputed;
+        precomputed.m_textMode = 7;
+        SimpleE164 number;
+        number.m_countryCode = 49;
+        number.m_nationalNumber = 891234567;
+        precomputed.m_phoneNumbers.push_back(number);
+        // Needs more than 32 bits.
+        number.m_countryCode = 1;
+        number.m_nationalNumber = 98765432109876ULL;
+        precomputed.m_phoneNumbers.push_back(number);
+        LocaleFactory::Precomputed::Text text;
+        text.m_field = LocaleFactory::Precomputed::FULL_NAME;
+        text.m_value = "jurgen muller";
+        precomputed.m_texts.push_back(text);
+        text.m_field = LocaleFactory::Precomputed::ADDR_COUNTRY;
+        text.m_value = std::string("embedded\0nul", 12);
+        precomputed.m_texts.push_back(text);
+        text.m_field = LocaleFactory::Precomputed::TEL;
+        text.m_value = "";
+        precomputed.m_texts.push_back(text);
+        precomputed.m_trigrams.push_back(0);
+        precomputed.m_trigrams.push_back(0x6a7572);
+        precomputed.m_trigrams.push_back(0xFFFFFFFF);
+        snapshot.m_entries[0].m_contacts.push_back(std::make_pair(std::string("system-address-book"), std::string("pas-id-1")));
+        snapshot.m_entries[0].m_contacts.push_back(std::make_pair(std::string("pim-manager-foo"), std::string("pas-id-2")));
+        // Entry #1 has nothing but contacts.
+        snapshot.m_entries[1].m_contacts.push_back(std::make_pair(std::string("pim-manager-foo"), std::string("pas-id-3")));
+        // Entry #2 is the same as #0.
+        snapshot.m_entries[2] = snapshot.m_entries[0];
+
+        snapshot.save(m_filename, "de_DE last/first");
+        copy = ViewSnapshot::read(m_filename, "de_DE last/first");
+        CPPUNIT_ASSERT(copy);
+        CPPUNIT_ASSERT_EQUAL(snapshot.size(), copy->size());
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            CPPUNIT_ASSERT(snapshot.m_entries[i].m_precomputed == copy->m_entries[i].m_precomputed);
+            // Not covered by Precomputed::operator ==.
+            CPPUNIT_ASSERT(snapshot.m_entries[i].m_precomputed.m_trigrams == copy->m_entries[i].m_precomputed.m_trigrams);
+            CPPUNIT_ASSERT(snapshot.m_entries[i].m_contacts == copy->m_entries[i].m_contacts);
+        }
+    }
+
+    void invalid()
+    {
+        // Missing file.
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+
+        // Garbage.
+        writeFile("");
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+        writeFile("SEPIMV0");
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+        writeFile("BEGIN:VCARD\r\nVERSION:3.0\r\nN:Doe;John\r\nEND:VCARD\r\n");
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+
+        // All shorter versions of a valid file must be rejected.
+        createSnapshot(3, 2).save(m_filename, "de_DE last/first");
+        std::string content;
+        CPPUNIT_ASSERT(ReadFile(m_filename, content));
+        for (size_t len = 0; len < content.size(); len++) {
+            writeFile(content.substr(0, len));
+            CPPUNIT_ASSERT_MESSAGE(StringPrintf("%ld of %ld bytes", (long)len, (long)content.size()),
+                                   !ViewSnapshot::read(m_filename, "de_DE last/first"));
+        }
+        writeFile(content);
+        CPPUNIT_ASSERT(ViewSnapshot::read(m_filename, "de_DE last/first"));
+
+        // Different magic.
+        std::string modified = content;
+        modified[7] = '2';
+        writeFile(modified);
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+
+        // Huge number of entries.
+        modified = content;
+        size_t offset = 8 + 4 + strlen("de_DE last/first");
+        modified.replace(offset, 4, "\xFF\xFF\xFF\xFF");
+        writeFile(modified);
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+
+        // Invalid field.
+        ViewSnapshot snapshot = createSnapshot(1, 1);
+        snapshot.m_entries[0].m_precomputed.m_texts[0].m_field = (LocaleFactory::Precomputed::Field)(LocaleFactory::Precomputed::ADDR_COUNTRY + 1);
+        snapshot.save(m_filename, "de_DE last/first");
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first"));
+    }
+
+    void key()
+    {
+        createSnapshot(3, 1).save(m_filename, "de_DE last/first");
+        CPPUNIT_ASSERT(ViewSnapshot::read(m_filename, "de_DE last/first"));
+        // Different locale.
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "en_US last/first"));
+        // Different sort order.
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE first/last"));
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, "de_DE last/first "));
+        CPPUNIT_ASSERT(!ViewSnapshot::read(m_filename, ""));
+    }
+
+    void search()
+    {
+        ViewSnapshot snapshot = createSnapshot(150, 1);
+        ViewSnapshot::Contacts contacts;
+
+        // Limited by the filter.
+        MatchAll all;
+        all.setMaxResults(10);
+        CPPUNIT_ASSERT(snapshot.search(all, contacts));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, contacts.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)10, contacts["a"].size());
+        for (size_t i = 0; i < 10; i++) {
+            CPPUNIT_ASSERT_EQUAL(StringPrintf("uid-%ld-0", (long)i), contacts["a"][i]);
+        }
+
+        // Limited by MAX_CONTACTS.
+        contacts.clear();
+        all.setMaxResults(MAX_CONTACTS);
+        CPPUNIT_ASSERT(snapshot.search(all, contacts));
+        CPPUNIT_ASSERT_EQUAL(MAX_CONTACTS, contacts["a"].size());
+        contacts.clear();
+        all.setMaxResults(MAX_CONTACTS + 1);
+        CPPUNIT_ASSERT(!snapshot.search(all, contacts));
+        contacts.clear();
+        all.setMaxResults(-1);
+        CPPUNIT_ASSERT(!snapshot.search(all, contacts));
+
+        // Order of the snapshot: "contact 1", "contact 10", ..., "contact 149".
+        contacts.clear();
+        MatchText text("contact 1");
+        CPPUNIT_ASSERT(snapshot.search(text, contacts));
+        CPPUNIT_ASSERT_EQUAL((size_t)61, contacts["a"].size());
+        CPPUNIT_ASSERT_EQUAL(std::string("uid-1-0"), contacts["a"][0]);
+        CPPUNIT_ASSERT_EQUAL(std::string("uid-10-0"), contacts["a"][1]);
+        CPPUNIT_ASSERT_EQUAL(std::string("uid-149-0"), contacts["a"][60]);
+        contacts.clear();
+        text.setMaxResults(2);
+        CPPUNIT_ASSERT(snapshot.search(text, contacts));
+        CPPUNIT_ASSERT_EQUAL((size_t)2, contacts["a"].size());
+        CPPUNIT_ASSERT_EQUAL(std::string("uid-10-0"), contacts["a"][1]);
+
+        // No match.
+        contacts.clear();
+        MatchText none("xyz");
+        CPPUNIT_ASSERT(snapshot.search(none, contacts));
+        CPPUNIT_ASSERT(contacts.empty());
+
+        // Filter without support for precomputed data.
+        contacts.clear();
+        MatchNone folks;
+        CPPUNIT_ASSERT(!snapshot.search(folks, contacts));
+
+        // MAX_CONTACTS counts contacts, not individuals.
+        snapshot = createSnapshot(150, 2);
+        contacts.clear();
+        all.setMaxResults(MAX_CONTACTS / 2);
+        CPPUNIT_ASSERT(snapshot.search(all, contacts));
+        CPPUNIT_ASSERT_EQUAL((size_t)2, contacts.size());
+        CPPUNIT_ASSERT_EQUAL(MAX_CONTACTS / 2, contacts["a"].size());
+        CPPUNIT_ASSERT_EQUAL(MAX_CONTACTS / 2, contacts["b"].size());
+        CPPUNIT_ASSERT_EQUAL(std::string("uid-0-1"), contacts["b"][0]);
+        contacts.clear();
+        all.setMaxResults(MAX_CONTACTS / 2 + 1);
+        CPPUNIT_ASSERT(!snapshot.search(all, contacts));
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(ViewSnapshotTest);
+
+#endif // ENABLE_UNIT_TESTS
+
+SE_END_CXX
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+/**
+ * A compact copy of the sorted main view, written to disk when the
+ * unified address book is complete and read again at startup. While
+ * folks is still loading, searches can be answered from it by
+ * fetching just the matching contacts from EDS.
+ */
+
+#ifndef INCL_SYNCEVO_DBUS_SERVER_PIM_SNAPSHOT
+#define INCL_SYNCEVO_DBUS_SERVER_PIM_SNAPSHOT
+
+#include "locale-factory.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+class IndividualView;
+class IndividualFilter;
+
+class ViewSnapshot
+{
+ public:
+    /** EDS address book UUID -> UIDs of contacts in it */
+    typedef std::map< std::string, std::vector<std::string> > Contacts;
+
+    /**
+     * Stores the precomputed data and the EDS contacts of each
+     * individual in the view, in the order of the view. Individuals
+     * without EDS contacts are skipped because they could not be
+     * found again via EDS. Throws an error when writing fails.
+     *
+     * @param filename    file which gets replaced atomically
+     * @param key         identifies locale and sort order, see read()
+     * @param view        a quiescent, sorted view
+     */
+    static void write(const std::string &filename,
+                      const std::string &key,
+                      IndividualView &view);
+
+    /**
+     * Maps the file into memory and parses it.
+     *
+     * @param key         must be the same as when writing the file,
+     *                    otherwise precomputed data and order do not
+     *                    match the current locale and sort order
+     * @return NULL if the file is missing, invalid or has a different key
+     */
+    static boost::shared_ptr<ViewSnapshot> read(const std::string &filename,
+                                                const std::string &key);
+
+    /**
+     * Finds the contacts of all individuals which match the filter,
+     * in the order of the snapshot and limited by the filter's
+     * maximum number of results.
+     *
+     * @return false if the filter cannot be evaluated with
+     *         precomputed data or matches too many contacts to
+     *         fetch them individually
+     */
+    bool search(const IndividualFilter &filter, Contacts &contacts) const;
+
+    /**
+     * EBook query which matches exactly the given contacts.
+     */
+    static std::string createEBookQuery(const std::vector<std::string> &uids);
+
+    /** number of individuals */
+    size_t size() const { return m_entries.size(); }
+
+ private:
+    friend class ViewSnapshotTest;
+
+    struct Entry
+    {
+        LocaleFactory::Precomputed m_precomputed;
+        /** address book UUID + contact UID */
+        std::vector< std::pair<std::string, std::string> > m_contacts;
+    };
+    std::vector<Entry> m_entries;
+
+    /** stores m_entries in the format expected by read() */
+    void save(const std::string &filename, const std::string &key) const;
+};
+
+SE_END_CXX
+
+#endif // INCL_SYNCEVO_DBUS_SERVER_PIM_SNAPSHOT
@@ -258,6 +258,51 @@ class ContactsView(dbus.service.Object, unittest.TestCase):
                                            error_handler=lambda error: self.errors.append(x))
           step([], 0)
 
+class SlowContactsView(ContactsView):
+     '''A ViewAgent which replies to change calls only after a delay,
+     to check the flow control in the server.'''
+
+     def __init__(self, manager, delay=0.5):
+          ContactsView.__init__(self, manager)
+          self.delay = delay
+          # Change calls without a reply yet, current and highest number.
+          self.outstanding = 0
+          self.maxOutstanding = 0
+          self.timeouts = []
+
+     def delayReply(self, handler, reply):
+          self.outstanding = self.outstanding + 1
+          self.maxOutstanding = max(self.maxOutstanding, self.outstanding)
+          handler()
+          def done():
+               self.outstanding = self.outstanding - 1
+               self.timeouts.remove(timeout)
+               timeout.destroy()
+               reply()
+               return False
+          timeout = glib.Timeout(int(self.delay * 1000))
+          timeout.set_callback(done)
+          timeout.attach(loop.get_context())
+          self.timeouts.append(timeout)
+
+     @dbus.service.method(dbus_interface='org._01.pim.contacts.ViewAgent',
+                          in_signature='oias', out_signature='',
+                          async_callbacks=('reply', 'error'))
+     def ContactsModified(self, view, start, ids, reply, error):
+          self.delayReply(lambda: ContactsView.ContactsModified(self, view, start, ids), reply)
+
+     @dbus.service.method(dbus_interface='org._01.pim.contacts.ViewAgent',
+                          in_signature='oias', out_signature='',
+                          async_callbacks=('reply', 'error'))
+     def ContactsAdded(self, view, start, ids, reply, error):
+          self.delayReply(lambda: ContactsView.ContactsAdded(self, view, start, ids), reply)
+
+     @dbus.service.method(dbus_interface='org._01.pim.contacts.ViewAgent',
+                          in_signature='oias', out_signature='',
+                          async_callbacks=('reply', 'error'))
+     def ContactsRemoved(self, view, start, ids, reply, error):
+          self.delayReply(lambda: ContactsView.ContactsRemoved(self, view, start, ids), reply)
+
 class Watchdog():
      '''Send D-Bus queries regularly to the daemon and measure response time.'''
      def __init__(self, test, manager, threshold=0.1, interval=0.2):
@@ -1989,6 +2034,23 @@ END:VCARD
                          contact,
                          sortLists=True)
 
+        # Read the same contact by position, with just some properties.
+        # Reading beyond the end of the view is not an error.
+        contacts = self.view.view.ReadContactRange(0, 10, ['full-name', 'nickname', 'id'])
+        self.assertEqual(1, len(contacts))
+        index, contact = contacts[0]
+        self.assertEqual(0, index)
+        self.assertEqual(self.view.contacts[0]['id'], contact['id'])
+        contact['id'] = '<stripped>'
+        self.assertEqual({'full-name': 'John Doe',
+                          'nickname': 'user1',
+                          'id': '<stripped>'},
+                         contact)
+        self.assertEqual([], self.view.view.ReadContactRange(1, 10, []))
+        with self.assertRaisesRegexp(dbus.DBusException,
+                                     r'unknown contact property: no-such-property'):
+             self.view.view.ReadContactRange(0, 1, ['no-such-property'])
+
     def addressbooks(self):
         entries = os.listdir(os.path.join(os.environ["XDG_DATA_HOME"], "evolution", "addressbook"))
         entries.sort();
@@ -2798,6 +2860,43 @@ END:VCARD
                        (),
                        )
 
+    @timeout(60)
+    @property("ENV", "LC_TYPE=de_DE.UTF-8 LC_ALL=de_DE.UTF-8 LANG=de_DE.UTF-8 SYNCEVOLUTION_PIM_VIEW_MAX_PENDING=1 SYNCEVOLUTION_PIM_VIEW_CHANGE_DELAY=-1")
+    def testFilterGermanyFlowControl(self):
+         '''TestContacts.testFilterGermanyFlowControl - same as testFilterGermany, with changes delayed until idle and sent one at a time'''
+         self.doFilter((u'Göbel', u'Goethe', u'Göthe', u'Götz', u'Goldmann'),
+                       (([['any-contains', 'go']], (u'Göbel', u'Goethe', u'Göthe', u'Götz', u'Goldmann')),
+                        ([['any-contains', 'goe']], (u'Goethe',)),
+                        ),
+                       )
+
+         # The agent replies slowly. The server must keep the changes
+         # which cannot be merged and send them one at a time, then
+         # Quiescent() once all of them were sent.
+         view = SlowContactsView(self.manager)
+         view.search([['any-contains', 'go']])
+         self.runUntil('"go" search',
+                       check=lambda: self.assertEqual([], view.errors),
+                       until=lambda: view.quiescentCount > 0)
+         self.assertEqual([('added', 0, 5),
+                           ('quiescent',)],
+                          view.events)
+
+         # Refining removes Göbel at #0 and then Göthe, Götz and
+         # Goldmann after Goethe. These removals cannot be merged.
+         view.events = []
+         view.quiescentCount = 0
+         view.view.RefineSearch([['any-contains', 'goe']])
+         self.runUntil('"goe" refinement',
+                       check=lambda: self.assertEqual([], view.errors),
+                       until=lambda: view.quiescentCount > 0)
+         self.assertEqual([('removed', 0, 1),
+                           ('removed', 1, 3),
+                           ('quiescent',)],
+                          view.events)
+         self.assertEqual(1, len(view.contacts))
+         self.assertEqual(1, view.maxOutstanding)
+
     @timeout(60)
     @property("ENV", "LC_TYPE=zh_CN.UTF-8 LANG=zh_CN.UTF-8")
     def testLocaled(self):
@@ -4359,6 +4458,109 @@ END:VCARD''']):
                   ],
                          self.view.events)
 
+    @timeout(90)
+    @property("ENV", "LC_TYPE=de_DE.UTF-8 LC_ALL=de_DE.UTF-8 LANG=de_DE.UTF-8 SYNCEVOLUTION_PIM_DELAY_FOLKS=5 SYNCEVOLUTION_PIM_SNAPSHOT_DELAY=1")
+    def testFilterStartupSnapshot(self):
+        '''TestContacts.testFilterStartupSnapshot - text search while folks still loads, answered via the snapshot from the previous run'''
+        self.setUpView(search=None)
+        snapshot = os.path.join(os.environ['XDG_CACHE_HOME'], 'syncevolution', 'pim-manager-snapshot')
+        self.assertFalse(os.path.exists(snapshot))
+
+        # Insert new contacts.
+        for i, contact in enumerate([u'''BEGIN:VCARD
+VERSION:3.0
+N:Zoo;Abraham
+NICKNAME:Ace
+TEL:1234
+EMAIL:az@example.com
+END:VCARD''',
+
+u'''BEGIN:VCARD
+VERSION:3.0
+N:Yeah;Benjamin
+EMAIL:benjamin@example.com
+END:VCARD''',
+
+u'''BEGIN:VCARD
+VERSION:3.0
+FN:Charly 'Chárleß' Xing
+N:Xing;Charly
+EMAIL:charly@example.org
+END:VCARD''']):
+             item = os.path.join(self.contacts, 'contact%d.vcf' % i)
+             output = codecs.open(item, "w", "utf-8")
+             output.write(contact)
+             output.close()
+        logging.log('inserting contacts')
+        out, err, returncode = self.runCmdline(['--import', self.contacts, '@' + self.managerPrefix + self.uid, 'local'])
+
+        # Load all contacts. Once folks is done, the snapshot
+        # gets written.
+        self.view.search([])
+        self.runUntil('all contacts',
+                      check=lambda: self.assertEqual([], self.view.errors),
+                      until=lambda: self.view.quiescentCount > 0)
+        self.assertEqual(3, len(self.view.contacts))
+        self.runUntil('snapshot',
+                      check=lambda: self.assertEqual([], self.view.errors),
+                      until=lambda: os.path.exists(snapshot))
+
+        # Restart with a new aggregator, which is delayed again.
+        # The snapshot gets read in the process.
+        self.view.close()
+        self.manager.Stop()
+        self.assertEqual(False, self.manager.IsRunning())
+
+        # Text searches have no EDS query. While folks is not
+        # quiescent, the matching contacts must be found in the
+        # snapshot and get fetched from EDS by UID.
+        views = []
+        for search in [[['any-contains', 'example.com']],
+                       [['any-contains', 'chárleß']]]:
+             view = ContactsView(self.manager)
+             view.search(search)
+             views.append(view)
+        self.runUntil('snapshot results',
+                      check=lambda: [self.assertEqual([], view.errors) for view in views],
+                      until=lambda: not [view for view in views if view.quiescentCount == 0])
+        # Only the first results are in, so these came from EDS.
+        self.assertEqual([1, 1], [view.quiescentCount for view in views])
+        self.assertEqual([2, 1], [len(view.contacts) for view in views])
+        views[0].read(0, 2)
+        views[1].read(0, 1)
+        self.runUntil('snapshot data',
+                      check=lambda: [self.assertEqual([], view.errors) for view in views],
+                      until=lambda: views[0].haveData(0, 2) and views[1].haveData(0, 1))
+        early = [[contact['structured-name']['given'] for contact in view.contacts] for view in views]
+        self.assertEqual([[u'Benjamin', u'Abraham'], [u'Charly']], early)
+
+        # Wait for final results from folks. Must be the same.
+        self.runUntil('folks results',
+                      check=lambda: [self.assertEqual([], view.errors) for view in views],
+                      until=lambda: not [view for view in views if view.quiescentCount < 2])
+        self.assertEqual([2, 1], [len(view.contacts) for view in views])
+        views[0].read(0, 2)
+        views[1].read(0, 1)
+        self.runUntil('folks data',
+                      check=lambda: [self.assertEqual([], view.errors) for view in views],
+                      until=lambda: views[0].haveData(0, 2) and views[1].haveData(0, 1))
+        final = [[contact['structured-name']['given'] for contact in view.contacts] for view in views]
+        self.assertEqual(early, final)
+
+        # Nothing changed when folks became active.
+        self.assertEqual([
+                  ('added', 0, 2),
+                  ('quiescent',),
+                  ('quiescent',),
+                  ],
+                         views[0].events)
+        self.assertEqual([
+                  ('added', 0, 1),
+                  ('quiescent',),
+                  ('quiescent',),
+                  ],
+                         views[1].events)
+
     @timeout(60)
     def testDeadAgent(self):
         '''TestContacts.testDeadAgent - an error from the agent kills the view'''
@@ -88,5 +88,20 @@ void IndividualView::readContacts(const std::vector<std::string> &ids, Contacts
     }
 }
 
+void IndividualView::readContacts(int start, int count, Contacts &contacts)
+{
+    contacts.clear();
+    int total = size();
+    if (start < 0 || start >= total || count <= 0) {
+        return;
+    }
+    // start + count might overflow, both come from D-Bus.
+    int end = count > total - start ? total : start + count;
+    contacts.reserve(end - start);
+    for (int index = start; index < end; index++) {
+        contacts.push_back(std::make_pair(index, getContact(index)->m_individual));
+    }
+}
+
 SE_END_CXX
 
@@ -139,9 +139,26 @@ class IndividualView : public View
     /** read a set of contacts - see org.01.pim.contacts.ViewControl.ReadContacts() */
     virtual void readContacts(const std::vector<std::string> &ids, Contacts &contacts);
 
+    /**
+     * read contacts by position, from start to start + count - 1,
+     * limited to the current size - see
+     * org.01.pim.contacts.ViewControl.ReadContactRange()
+     */
+    virtual void readContacts(int start, int count, Contacts &contacts);
+
     /** returns access to one individual or an empty pointer if outside of the current range */
     virtual const IndividualData *getContact(int index) = 0;
 
+    /**
+     * Finds the indices of all individuals which might match the
+     * filter, in increasing order, without checking all of them.
+     * The result may contain individuals which do not match,
+     * so IndividualFilter::matches() must still be called.
+     *
+     * @return false if not supported for the view or filter
+     */
+    virtual bool getCandidates(const IndividualFilter &filter, std::vector<int> &indices) { return false; }
+
  protected:
     void findContact(const std::string &id, int hint, int &index, FolksIndividualCXX &individual);
 };
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <config.h>
+#include <syncevo/BackupPack.h>
+#include <syncevo/Exception.h>
+#include <syncevo/util.h>
+
+#ifdef HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <sstream>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+static const char MAGIC[] = "SEPACK01";
+static const size_t MAGIC_LEN = sizeof(MAGIC) - 1;
+
+static const char METHOD_RAW = 'R';
+static const char METHOD_ZLIB = 'Z';
+
+/** method + raw length + stored length */
+static const size_t HEADER_LEN = 1 + 4 + 4;
+
+static void appendUInt32(std::string &buffer, size_t value)
+{
+    buffer += (char)(value & 0xFF);
+    buffer += (char)((value >> 8) & 0xFF);
+    buffer += (char)((value >> 16) & 0xFF);
+    buffer += (char)((value >> 24) & 0xFF);
+}
+
+static size_t parseUInt32(const char *pos)
+{
+    const unsigned char *upos = reinterpret_cast<const unsigned char *>(pos);
+    return (size_t)upos[0] |
+        ((size_t)upos[1] << 8) |
+        ((size_t)upos[2] << 16) |
+        ((size_t)upos[3] << 24);
+}
+
+BackupPackWriter::BackupPackWriter(const std::string &filename) :
+    m_filename(filename),
+    m_out(filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary),
+    m_offset(MAGIC_LEN),
+    m_numChunks(0)
+{
+    m_out.write(MAGIC, MAGIC_LEN);
+    if (m_out.fail()) {
+        SE_THROW(std::string("error writing ") + m_filename + ": " + strerror(errno));
+    }
+}
+
+size_t BackupPackWriter::append(const std::string &data)
+{
+    std::string chunk;
+    chunk.reserve(HEADER_LEN + data.size());
+#ifdef HAVE_ZLIB
+    uLongf len = compressBound(data.size());
+    std::string compressed;
+    compressed.resize(len);
+    if (compress2((Bytef *)&compressed[0], &len,
+                  (const Bytef *)data.c_str(), data.size(),
+                  Z_DEFAULT_COMPRESSION) == Z_OK &&
+        len < data.size()) {
+        chunk += METHOD_ZLIB;
+        appendUInt32(chunk, data.size());
+        appendUInt32(chunk, len);
+        chunk.append(compressed, 0, len);
+        return appendChunk(chunk);
+    }
+    // not compressible, store as it is
+#endif
+    chunk += METHOD_RAW;
+    appendUInt32(chunk, data.size());
+    appendUInt32(chunk, data.size());
+    chunk += data;
+    return appendChunk(chunk);
+}
+
+size_t BackupPackWriter::appendChunk(const std::string &chunk)
+{
+    size_t offset = m_offset;
+    m_out.write(chunk.c_str(), chunk.size());
+    if (m_out.fail()) {
+        SE_THROW(std::string("error writing ") + m_filename + ": " + strerror(errno));
+    }
+    m_offset += chunk.size();
+    m_numChunks++;
+    return offset;
+}
+
+void BackupPackWriter::close()
+{
+    m_out.close();
+    if (m_out.fail()) {
+        SE_THROW(std::string("error writing ") + m_filename + ": " + strerror(errno));
+    }
+}
+
+std::ifstream &BackupPackReader::getPack(const std::string &pack)
+{
+    boost::shared_ptr<std::ifstream> &in = m_packs[pack];
+    if (!in) {
+        std::string filename = m_dirname + "/" + pack;
+        in.reset(new std::ifstream(filename.c_str(), std::ios::in | std::ios::binary));
+        char magic[MAGIC_LEN];
+        in->read(magic, MAGIC_LEN);
+        if (in->fail() || memcmp(magic, MAGIC, MAGIC_LEN)) {
+            in.reset();
+            SE_THROW(std::string("not a valid backup pack: ") + filename);
+        }
+    }
+    return *in;
+}
+
+void BackupPackReader::parseLocation(const std::string &location, std::string &pack, size_t &offset)
+{
+    size_t colon = location.rfind(':');
+    char *end;
+    if (colon == location.npos ||
+        colon == 0 ||
+        colon + 1 == location.size() ||
+        (offset = strtoul(location.c_str() + colon + 1, &end, 10), *end)) {
+        SE_THROW(std::string("invalid location of item in backup pack: ") + location);
+    }
+    pack = location.substr(0, colon);
+}
+
+void BackupPackReader::readChunk(const std::string &pack, size_t offset, std::string &chunk)
+{
+    std::ifstream &in = getPack(pack);
+    char header[HEADER_LEN];
+    in.clear();
+    in.seekg(offset);
+    in.read(header, HEADER_LEN);
+    if (in.fail() ||
+        (header[0] != METHOD_RAW && header[0] != METHOD_ZLIB)) {
+        SE_THROW(StringPrintf("%s/%s: invalid chunk at offset %ld",
+                              m_dirname.c_str(), pack.c_str(), (long)offset));
+    }
+    size_t stored = parseUInt32(header + 5);
+    chunk.resize(HEADER_LEN + stored);
+    memcpy(&chunk[0], header, HEADER_LEN);
+    if (stored) {
+        in.read(&chunk[HEADER_LEN], stored);
+    }
+    if (in.fail()) {
+        SE_THROW(StringPrintf("%s/%s: truncated chunk at offset %ld",
+                              m_dirname.c_str(), pack.c_str(), (long)offset));
+    }
+}
+
+void BackupPackReader::readItem(const std::string &location, std::string &data)
+{
+    std::string pack;
+    size_t offset;
+    parseLocation(location, pack, offset);
+    std::string chunk;
+    readChunk(pack, offset, chunk);
+
+    size_t raw = parseUInt32(chunk.c_str() + 1);
+    if (chunk[0] == METHOD_RAW) {
+        data.assign(chunk, HEADER_LEN, chunk.npos);
+        return;
+    }
+#ifdef HAVE_ZLIB
+    data.resize(raw);
+    uLongf len = raw;
+    if (uncompress(raw ? (Bytef *)&data[0] : NULL, &len,
+                   (const Bytef *)chunk.c_str() + HEADER_LEN, chunk.size() - HEADER_LEN) != Z_OK ||
+        len != raw) {
+        SE_THROW(StringPrintf("%s/%s: corrupt chunk at offset %ld",
+                              m_dirname.c_str(), pack.c_str(), (long)offset));
+    }
+#else
+    SE_THROW(StringPrintf("%s/%s: compressed chunk at offset %ld, but compiled without zlib support (%ld bytes)",
+                          m_dirname.c_str(), pack.c_str(), (long)offset, (long)raw));
+#endif
+}
+
+BackupItemReader::BackupItemReader(const std::string &dirname,
+                                   const boost::shared_ptr<const ConfigNode> &node) :
+    m_dirname(dirname),
+    m_node(node)
+{
+    if (m_node->readProperty("backupformat") == "pack") {
+        m_packs.reset(new BackupPackReader(m_dirname));
+    }
+}
+
+long BackupItemReader::getNumItems() const
+{
+    long numitems = 0;
+    std::string strval = m_node->readProperty("numitems");
+    std::stringstream stream(strval);
+    stream >> numitems;
+    return numitems;
+}
+
+bool BackupItemReader::readItem(long counter, std::string &data)
+{
+    if (m_packs) {
+        std::string location = m_node->readProperty(StringPrintf("%ld-chunk", counter));
+        if (location.empty()) {
+            return false;
+        }
+        m_packs->readItem(location, data);
+        return true;
+    } else {
+        return ReadFile(StringPrintf("%s/%ld", m_dirname.c_str(), counter), data);
+    }
+}
+
+bool BackupItemReader::isPack(const std::string &dirname)
+{
+    boost::shared_ptr<ConfigNode> node = ConfigNode::createFileNode(dirname + ".ini");
+    return node->readProperty("backupformat") == "pack";
+}
+
+void BackupItemReader::extract(const std::string &dirname, const std::string &targetdir)
+{
+    BackupItemReader reader(dirname, ConfigNode::createFileNode(dirname + ".ini"));
+    rm_r(targetdir);
+    mkdir_p(targetdir);
+    long numitems = reader.getNumItems();
+    std::string data;
+    for (long counter = 1; counter <= numitems; counter++) {
+        if (!reader.readItem(counter, data)) {
+            continue;
+        }
+        std::string filename = StringPrintf("%s/%ld", targetdir.c_str(), counter);
+        std::ofstream out(filename.c_str());
+        out.write(data.c_str(), data.size());
+        out.close();
+        if (out.fail()) {
+            SE_THROW(std::string("error writing ") + filename + ": " + strerror(errno));
+        }
+    }
+}
+
+SE_END_CXX
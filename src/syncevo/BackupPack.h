@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef INCL_SYNCEVO_BACKUP_PACK
+# define INCL_SYNCEVO_BACKUP_PACK
+
+#include <syncevo/ConfigNode.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <string>
+#include <map>
+#include <fstream>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+/**
+ * Pack files are an alternative storage for the item data of a
+ * database backup made by ItemCache, selected with
+ * SYNCEVOLUTION_BACKUP_FORMAT=pack. Instead of one file per item,
+ * the backup directory contains a few pack files with the
+ * (zlib-compressed, if available) item data.
+ *
+ * Items which are unchanged compared to the previous backup are not
+ * stored again. Instead the pack file of the previous backup gets
+ * hard-linked into the new backup directory. Packs thus are shared
+ * across sessions; the link count of the file is the reference
+ * count which keeps a pack alive while LogDir::expire() removes
+ * sessions. A pack of which only a small part is still needed is
+ * not linked, the needed chunks get copied into the new pack
+ * instead.
+ *
+ * The .ini node of such a backup contains, in addition to the
+ * normal ItemCache properties:
+ * - backupformat = pack
+ * - <counter>-chunk = <pack file name>:<offset>
+ * - pack-<pack file name> = <total number of chunks in the pack>
+ *
+ * File format of a pack (all integers are 32 bit little endian):
+ * - magic "SEPACK01"
+ * - chunks: <method> <raw length> <stored length> <stored data>
+ *   where method is 'R' (raw) or 'Z' (zlib)
+ */
+class BackupPackWriter : private boost::noncopyable
+{
+    std::string m_filename;
+    std::ofstream m_out;
+    size_t m_offset;
+    size_t m_numChunks;
+
+ public:
+    /** creates a new pack file, throws errors */
+    BackupPackWriter(const std::string &filename);
+
+    /** stores item data, returns the offset of the new chunk */
+    size_t append(const std::string &data);
+
+    /** stores a chunk as returned by BackupPackReader::readChunk() */
+    size_t appendChunk(const std::string &chunk);
+
+    /** number of chunks written so far */
+    size_t getNumChunks() const { return m_numChunks; }
+
+    /** flushes the file and checks for errors */
+    void close();
+};
+
+/**
+ * Read access to pack files in a backup directory.
+ * Keeps the files open while the instance exists.
+ */
+class BackupPackReader : private boost::noncopyable
+{
+    std::string m_dirname;
+    std::map<std::string, boost::shared_ptr<std::ifstream> > m_packs;
+
+    std::ifstream &getPack(const std::string &pack);
+
+ public:
+    BackupPackReader(const std::string &dirname) : m_dirname(dirname) {}
+
+    /** reads a complete chunk (header and stored data) */
+    void readChunk(const std::string &pack, size_t offset, std::string &chunk);
+
+    /** reads and decodes the item data at a "<pack>:<offset>" location */
+    void readItem(const std::string &location, std::string &data);
+
+    /** splits "<pack>:<offset>", throws error if malformed */
+    static void parseLocation(const std::string &location, std::string &pack, size_t &offset);
+};
+
+/**
+ * Read access to the items in a backup made by ItemCache, regardless
+ * of the format of the backup.
+ */
+class BackupItemReader : private boost::noncopyable
+{
+    std::string m_dirname;
+    boost::shared_ptr<const ConfigNode> m_node;
+    boost::shared_ptr<BackupPackReader> m_packs;
+
+ public:
+    /**
+     * @param dirname    backup directory
+     * @param node       meta information about the backup, usually <dirname>.ini
+     */
+    BackupItemReader(const std::string &dirname,
+                     const boost::shared_ptr<const ConfigNode> &node);
+
+    /** true if the backup uses pack files */
+    bool isPack() const { return m_packs; }
+
+    /** number of items in the backup */
+    long getNumItems() const;
+
+    /** reads data of item #counter (1 to getNumItems()), false if not found */
+    bool readItem(long counter, std::string &data);
+
+    /** true if the backup in dirname (with dirname + ".ini") uses pack files */
+    static bool isPack(const std::string &dirname);
+
+    /**
+     * Stores the items of the backup as files 1 to n in targetdir,
+     * like the traditional backup format. Used for tools which
+     * only understand that format.
+     */
+    static void extract(const std::string &dirname, const std::string &targetdir);
+};
+
+SE_END_CXX
+#endif // INCL_SYNCEVO_BACKUP_PACK
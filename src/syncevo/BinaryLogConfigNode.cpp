@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <config.h>
+#include "test.h"
+#include <syncevo/BinaryLogConfigNode.h>
+#include <syncevo/IniConfigNode.h>
+#include <syncevo/ConfigFilter.h>
+#include <syncevo/SafeOstream.h>
+#include <syncevo/Exception.h>
+#include <syncevo/GuardFD.h>
+#include <syncevo/util.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <boost/foreach.hpp>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+static const char MAGIC[] = "SEBLOG01";
+static const size_t MAGIC_LEN = sizeof(MAGIC) - 1;
+
+static const char RECORD_SET = 'S';
+static const char RECORD_DELETE = 'D';
+
+/**
+ * Compact when the file has this many records more than twice
+ * the number of keys. Keeps the file size linear in the number of
+ * keys while amortizing the cost of rewriting it over many flushes.
+ */
+static const size_t COMPACT_SLACK = 100;
+
+static void appendUInt32(std::string &buffer, size_t value)
+{
+    buffer += (char)(value & 0xFF);
+    buffer += (char)((value >> 8) & 0xFF);
+    buffer += (char)((value >> 16) & 0xFF);
+    buffer += (char)((value >> 24) & 0xFF);
+}
+
+static bool parseUInt32(const unsigned char *&pos, const unsigned char *end, size_t &value)
+{
+    if (end - pos < 4) {
+        return false;
+    }
+    value = (size_t)pos[0] |
+        ((size_t)pos[1] << 8) |
+        ((size_t)pos[2] << 16) |
+        ((size_t)pos[3] << 24);
+    pos += 4;
+    return true;
+}
+
+static void appendSet(std::string &buffer, const std::string &property, const std::string &value)
+{
+    buffer += RECORD_SET;
+    appendUInt32(buffer, property.size());
+    appendUInt32(buffer, value.size());
+    buffer += property;
+    buffer += value;
+}
+
+static void appendDelete(std::string &buffer, const std::string &property)
+{
+    buffer += RECORD_DELETE;
+    appendUInt32(buffer, property.size());
+    buffer += property;
+}
+
+BinaryLogConfigNode::BinaryLogConfigNode(const std::string &path,
+                                         const std::string &fileName,
+                                         const std::string &iniFileName,
+                                         bool readonly) :
+    m_path(path),
+    m_fileName(fileName),
+    m_iniFileName(iniFileName),
+    m_readonly(readonly)
+{
+    read();
+}
+
+void BinaryLogConfigNode::read()
+{
+    m_props.clear();
+    m_modified.clear();
+    m_records = 0;
+    m_compact = false;
+    m_migrate = false;
+
+    std::string filename = getName();
+    GuardFD fd(open(filename.c_str(), O_RDONLY));
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            Exception::throwError(SE_HERE, filename, errno);
+        }
+        // must be created from scratch in flush()
+        m_compact = true;
+        readIni();
+        return;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb)) {
+        Exception::throwError(SE_HERE, filename, errno);
+    }
+    if ((size_t)sb.st_size < MAGIC_LEN) {
+        // empty or incomplete file: start from scratch
+        m_compact = true;
+        return;
+    }
+    void *mapptr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapptr == MAP_FAILED) {
+        Exception::throwError(SE_HERE, filename + ": mmap()", errno);
+    }
+    const unsigned char *start = static_cast<const unsigned char *>(mapptr);
+    const unsigned char *end = start + sb.st_size;
+    if (memcmp(start, MAGIC, MAGIC_LEN)) {
+        munmap(mapptr, sb.st_size);
+        SE_THROW(filename + ": not a SyncEvolution binary log file");
+    }
+
+    const unsigned char *pos = start + MAGIC_LEN;
+    while (pos < end) {
+        const unsigned char *record = pos;
+        char type = *pos++;
+        size_t keylen, valuelen = 0;
+        if ((type != RECORD_SET && type != RECORD_DELETE) ||
+            !parseUInt32(pos, end, keylen) ||
+            (type == RECORD_SET && !parseUInt32(pos, end, valuelen)) ||
+            (size_t)(end - pos) < keylen ||
+            (size_t)(end - pos) - keylen < valuelen) {
+            SE_LOG_DEBUG(NULL, "%s: ignoring incomplete record at offset %ld",
+                         filename.c_str(), (long)(record - start));
+            m_compact = true;
+            break;
+        }
+        std::string key((const char *)pos, keylen);
+        pos += keylen;
+        if (type == RECORD_SET) {
+            m_props[key].assign((const char *)pos, valuelen);
+            pos += valuelen;
+        } else {
+            m_props.erase(key);
+        }
+        m_records++;
+    }
+    munmap(mapptr, sb.st_size);
+}
+
+void BinaryLogConfigNode::readIni()
+{
+    if (m_iniFileName.empty()) {
+        return;
+    }
+    IniHashConfigNode ini(m_path, m_iniFileName, true);
+    if (ini.exists()) {
+        ConfigProps props;
+        ini.readProperties(props);
+        BOOST_FOREACH(const StringPair &prop, props) {
+            m_props.insert(prop);
+        }
+        SE_LOG_DEBUG(NULL, "%s: read %ld entries from %s, will be converted in next flush",
+                     getName().c_str(), (long)m_props.size(), ini.getName().c_str());
+        m_migrate = true;
+    }
+}
+
+void BinaryLogConfigNode::remember(const std::string &property)
+{
+    if (m_modified.find(property) == m_modified.end()) {
+        std::map<std::string, std::string>::const_iterator it = m_props.find(property);
+        m_modified[property] = it == m_props.end() ?
+            InitStateString() :
+            InitStateString(it->second, true);
+    }
+}
+
+void BinaryLogConfigNode::flush()
+{
+    if (m_modified.empty()) {
+        return;
+    }
+    if (m_readonly) {
+        SE_THROW(getName() + ": internal error: flushing read-only config node not allowed");
+    }
+
+    if (m_compact ||
+        m_records + m_modified.size() > 2 * m_props.size() + COMPACT_SLACK) {
+        compact();
+    } else {
+        append();
+    }
+    m_modified.clear();
+
+    if (m_migrate) {
+        std::string ini = m_path + "/" + m_iniFileName;
+        if (unlink(ini.c_str()) && errno != ENOENT) {
+            Exception::throwError(SE_HERE, ini, errno);
+        }
+        m_migrate = false;
+    }
+}
+
+void BinaryLogConfigNode::compact()
+{
+    std::string buffer(MAGIC, MAGIC_LEN);
+    typedef std::pair<const std::string, std::string> Prop_t;
+    BOOST_FOREACH(const Prop_t &prop, m_props) {
+        appendSet(buffer, prop.first, prop.second);
+    }
+
+    mkdir_p(m_path);
+    {
+        SafeOstream file(getName());
+        file.write(buffer.data(), buffer.size());
+    }
+    m_records = m_props.size();
+    m_compact = false;
+}
+
+void BinaryLogConfigNode::append()
+{
+    std::string buffer;
+    size_t records = 0;
+    typedef std::pair<const std::string, InitStateString> Modified_t;
+    BOOST_FOREACH(const Modified_t &modified, m_modified) {
+        const std::string &property = modified.first;
+        const InitStateString &old = modified.second;
+        std::map<std::string, std::string>::const_iterator it = m_props.find(property);
+        if (it == m_props.end()) {
+            if (old.wasSet()) {
+                appendDelete(buffer, property);
+                records++;
+            }
+        } else if (!old.wasSet() || old.get() != it->second) {
+            appendSet(buffer, property, it->second);
+            records++;
+        }
+    }
+    if (!records) {
+        // modifications cancelled each other out
+        return;
+    }
+
+    std::string filename = getName();
+    GuardFD fd(open(filename.c_str(), O_WRONLY|O_APPEND));
+    if (fd < 0) {
+        Exception::throwError(SE_HERE, filename, errno);
+    }
+    const char *data = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The file may contain a partial record now, which
+            // read() will ignore. Force a rewrite next time.
+            m_compact = true;
+            Exception::throwError(SE_HERE, filename, errno);
+        }
+        data += written;
+        remaining -= written;
+    }
+    m_records += records;
+}
+
+void BinaryLogConfigNode::reload()
+{
+    read();
+}
+
+InitStateString BinaryLogConfigNode::readProperty(const std::string &property) const
+{
+    std::map<std::string, std::string>::const_iterator it = m_props.find(property);
+    if (it != m_props.end()) {
+        return InitStateString(it->second, true);
+    } else {
+        return InitStateString();
+    }
+}
+
+void BinaryLogConfigNode::writeProperty(const std::string &property,
+                                        const InitStateString &value,
+                                        const std::string &comment)
+{
+    // we only store explicitly set properties
+    if (!value.wasSet()) {
+        removeProperty(property);
+        return;
+    }
+    std::map<std::string, std::string>::iterator it = m_props.find(property);
+    if (it == m_props.end()) {
+        remember(property);
+        m_props.insert(StringPair(property, value));
+    } else if (it->second != value) {
+        remember(property);
+        it->second = value;
+    }
+}
+
+void BinaryLogConfigNode::readProperties(ConfigProps &props) const
+{
+    BOOST_FOREACH(const StringPair &prop, m_props) {
+        props.insert(ConfigProps::value_type(prop.first, InitStateString(prop.second, true)));
+    }
+}
+
+void BinaryLogConfigNode::removeProperty(const std::string &property)
+{
+    std::map<std::string, std::string>::iterator it = m_props.find(property);
+    if (it != m_props.end()) {
+        remember(property);
+        m_props.erase(it);
+    }
+}
+
+void BinaryLogConfigNode::clear()
+{
+    // Remembering the old values is what allows the typical
+    // "clear, then set everything again" sequence to end up
+    // without any new records.
+    typedef std::pair<const std::string, std::string> Prop_t;
+    BOOST_FOREACH(const Prop_t &prop, m_props) {
+        remember(prop.first);
+    }
+    m_props.clear();
+}
+
+bool BinaryLogConfigNode::exists() const
+{
+    std::string filename = getName();
+    if (!access(filename.c_str(), F_OK)) {
+        return true;
+    }
+    if (!m_iniFileName.empty()) {
+        std::string ini = m_path + "/" + m_iniFileName;
+        return !access(ini.c_str(), F_OK);
+    }
+    return false;
+}
+
+#ifdef ENABLE_UNIT_TESTS
+
+class BinaryLogConfigNodeTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(BinaryLogConfigNodeTest);
+    CPPUNIT_TEST(append);
+    CPPUNIT_TEST(compaction);
+    CPPUNIT_TEST(truncated);
+    CPPUNIT_TEST(migrate);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string m_testDir;
+
+    std::string dump(const ConfigNode &node) {
+        ConfigProps props;
+        node.readProperties(props);
+        return props;
+    }
+
+    off_t fileSize(const std::string &filename) {
+        struct stat sb;
+        CPPUNIT_ASSERT(!stat(filename.c_str(), &sb));
+        return sb.st_size;
+    }
+
+public:
+    void setUp() {
+        m_testDir = "BinaryLogConfigNodeTest";
+        rm_r(m_testDir);
+    }
+
+private:
+    void append() {
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", "", false);
+            CPPUNIT_ASSERT(!node.exists());
+            node.setProperty("foo", "bar");
+            node.setProperty("empty", "");
+            node.setProperty("binary", std::string("a\nb\0c", 5));
+            node.flush();
+            CPPUNIT_ASSERT(node.exists());
+        }
+        off_t size = fileSize(m_testDir + "/.other.bin");
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", "", false);
+            CPPUNIT_ASSERT_EQUAL(std::string("a\nb\0c", 5), node.readProperty("binary").get());
+            CPPUNIT_ASSERT(node.readProperty("empty").wasSet());
+            node.setProperty("foo", "xyz");
+            node.removeProperty("empty");
+            // changed and restored: no record needed
+            node.setProperty("binary", "abc");
+            node.setProperty("binary", std::string("a\nb\0c", 5));
+            node.flush();
+        }
+        // set "foo" and delete "empty" got appended
+        CPPUNIT_ASSERT_EQUAL(size + (1 + 4 + 4 + 3 + 3) + (1 + 4 + 5), fileSize(m_testDir + "/.other.bin"));
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", "", true);
+            CPPUNIT_ASSERT_EQUAL(std::string("a\nb\0c", 5), node.readProperty("binary").get());
+            CPPUNIT_ASSERT_EQUAL(std::string("xyz"), node.readProperty("foo").get());
+            CPPUNIT_ASSERT(!node.readProperty("empty").wasSet());
+        }
+    }
+
+    void compaction() {
+        BinaryLogConfigNode node(m_testDir, ".other.bin", "", false);
+        node.setProperty("foo", "bar");
+        node.flush();
+        off_t size = fileSize(m_testDir + "/.other.bin");
+        for (int i = 0; i < 1000; i++) {
+            node.setProperty("foo", StringPrintf("%04d", i));
+            node.flush();
+        }
+        // file must have been rewritten several times instead of
+        // growing to 1000 records
+        CPPUNIT_ASSERT(fileSize(m_testDir + "/.other.bin") < size + 200 * (1 + 4 + 4 + 3 + 4));
+
+        node.clear();
+        node.flush();
+        BinaryLogConfigNode reread(m_testDir, ".other.bin", "", true);
+        CPPUNIT_ASSERT_EQUAL(std::string(""), dump(reread));
+    }
+
+    void truncated() {
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", "", false);
+            node.setProperty("foo", "bar");
+            node.setProperty("hello", "world");
+            node.flush();
+        }
+        std::string filename = m_testDir + "/.other.bin";
+        CPPUNIT_ASSERT(!truncate(filename.c_str(), fileSize(filename) - 1));
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", "", false);
+            CPPUNIT_ASSERT_EQUAL(std::string("foo = bar"), dump(node));
+            node.setProperty("hello", "again");
+            node.flush();
+        }
+        BinaryLogConfigNode node(m_testDir, ".other.bin", "", true);
+        CPPUNIT_ASSERT_EQUAL(std::string("foo = bar\nhello = again"), dump(node));
+    }
+
+    void migrate() {
+        {
+            IniHashConfigNode ini(m_testDir, ".other.ini", false);
+            ini.setProperty("foo", "bar");
+            ini.setProperty("item-1", "rev-1");
+            ini.flush();
+        }
+        {
+            BinaryLogConfigNode node(m_testDir, ".other.bin", ".other.ini", false);
+            CPPUNIT_ASSERT(node.exists());
+            CPPUNIT_ASSERT_EQUAL(std::string("foo = bar\nitem-1 = rev-1"), dump(node));
+            node.setProperty("item-2", "rev-2");
+            node.flush();
+        }
+        CPPUNIT_ASSERT(access((m_testDir + "/.other.ini").c_str(), F_OK));
+        BinaryLogConfigNode node(m_testDir, ".other.bin", ".other.ini", true);
+        CPPUNIT_ASSERT_EQUAL(std::string("foo = bar\nitem-1 = rev-1\nitem-2 = rev-2"), dump(node));
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(BinaryLogConfigNodeTest);
+
+#endif // ENABLE_UNIT_TESTS
+
+SE_END_CXX
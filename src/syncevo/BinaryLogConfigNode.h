@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef INCL_EVOLUTION_BINARY_LOG_CONFIG_NODE
+# define INCL_EVOLUTION_BINARY_LOG_CONFIG_NODE
+
+#include <syncevo/ConfigNode.h>
+
+#include <string>
+#include <map>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+/**
+ * A config node for large, frequently updated sets of key/value
+ * pairs, like the change tracking information of a sync source.
+ *
+ * In contrast to IniHashConfigNode, flush() does not serialize the
+ * whole content again. Instead each modified key is appended as one
+ * binary record to the file. The file gets rewritten ("compacted")
+ * only when it contains considerably more records than there are
+ * keys. The file is memory-mapped and replayed into an in-memory map
+ * when opening the node.
+ *
+ * File format (all integers are 32 bit little endian):
+ * - magic "SEBLOG01"
+ * - records: 'S' <key length> <value length> <key> <value>  (set)
+ *            'D' <key length> <key>                         (delete)
+ *
+ * A truncated record at the end of the file (interrupted write) is
+ * ignored; the next flush() with modifications rewrites the file.
+ *
+ * If the file does not exist yet, the content of an .ini file with
+ * the same information (as written by IniHashConfigNode) is read
+ * instead. The first flush() with modifications then writes the
+ * binary file and removes the .ini file.
+ */
+class BinaryLogConfigNode : public ConfigNode {
+    std::string m_path;
+    std::string m_fileName;
+    std::string m_iniFileName;
+    bool m_readonly;
+
+    /** current content */
+    std::map<std::string, std::string> m_props;
+
+    /**
+     * Keys modified since the last read() or flush(), with
+     * their value as stored in the file: unset if the file
+     * does not contain the key.
+     */
+    std::map<std::string, InitStateString> m_modified;
+
+    /** number of records in the file */
+    size_t m_records;
+
+    /** rewrite file in next flush() instead of appending */
+    bool m_compact;
+
+    /** remove m_iniFileName after next successful flush() */
+    bool m_migrate;
+
+    void read();
+    void readIni();
+    void remember(const std::string &property);
+    void compact();
+    void append();
+
+ public:
+    /**
+     * @param path         directory name
+     * @param fileName     name of binary file inside that directory
+     * @param iniFileName  name of .ini file in the same directory which is
+     *                     to be used when the binary file does not exist;
+     *                     may be empty
+     * @param readonly     do not create or write file
+     */
+    BinaryLogConfigNode(const std::string &path,
+                        const std::string &fileName,
+                        const std::string &iniFileName,
+                        bool readonly);
+
+    /* keep underlying methods visible; our own setProperty() would hide them */
+    using ConfigNode::setProperty;
+
+    virtual std::string getName() const { return m_path + "/" + m_fileName; }
+    virtual bool isVolatile() const { return false; }
+    virtual void flush();
+    virtual void reload();
+    virtual InitStateString readProperty(const std::string &property) const;
+    virtual void writeProperty(const std::string &property,
+                               const InitStateString &value,
+                               const std::string &comment = "");
+    virtual void readProperties(ConfigProps &props) const;
+    virtual void removeProperty(const std::string &property);
+    virtual void clear();
+    virtual bool exists() const;
+    virtual bool isReadOnly() const { return m_readonly; }
+};
+
+SE_END_CXX
+#endif // INCL_EVOLUTION_BINARY_LOG_CONFIG_NODE
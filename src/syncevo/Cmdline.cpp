@@ -23,6 +23,7 @@
 #include <syncevo/FilterConfigNode.h>
 #include <syncevo/VolatileConfigNode.h>
 #include <syncevo/IniConfigNode.h>
+#include <syncevo/BinaryLogConfigNode.h>
 #include <syncevo/SyncSource.h>
 #include <syncevo/SyncContext.h>
 #include <syncevo/util.h>
@@ -4166,8 +4167,8 @@ protected:
             boost::replace_first(expected, "# databaseFormat = ", "databaseFormat = text/vcard");
             boost::replace_first(expected,
                                  "peers/scheduleworld/sources/addressbook/config.ini",
-                                 "peers/scheduleworld/sources/addressbook/.other.ini:foo = bar\n"
-                                 "peers/scheduleworld/sources/addressbook/.other.ini:foo2 = bar2\n"
+                                 "peers/scheduleworld/sources/addressbook/.other.bin:foo = bar\n"
+                                 "peers/scheduleworld/sources/addressbook/.other.bin:foo2 = bar2\n"
                                  "peers/scheduleworld/sources/addressbook/config.ini");
             boost::replace_first(expected,
                                  "peers/scheduleworld/config.ini",
@@ -4964,6 +4965,18 @@ private:
                 } else {
                     scanFiles(root, dir + (dir.empty() ? "" : "/") + entry, peer, out, onlyProps);
                 }
+            } else if (boost::ends_with(entry, ".bin")) {
+                // binary change tracking node, dump as <key> = <value>
+                BinaryLogConfigNode node(newroot, entry, "", true);
+                ConfigProps props;
+                node.readProperties(props);
+                BOOST_FOREACH(const StringPair &prop, props) {
+                    if (dir.size()) {
+                        out << dir << "/";
+                    }
+                    out << entry << ":";
+                    out << prop.first << " = " << prop.second << '\n';
+                }
             } else {
                 ifstream in;
                 in.exceptions(ios_base::badbit /* failbit must not trigger exception because is set when reaching eof ?! */);
@@ -0,0 +1,728 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <config.h>
+#include "test.h"
+#include <syncevo/DumpCompare.h>
+#include <syncevo/BackupPack.h>
+#include <syncevo/SyncSource.h>
+#include <syncevo/Exception.h>
+#include <syncevo/util.h>
+#include <syncevo/lcs.h>
+
+#include <pcrecpp.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <list>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+/**
+ * Regular expression based normalization, applied to the whole
+ * item in the order of the table. Same as in synccompare, minus
+ * the server specific rules.
+ */
+struct NormalizationRule {
+    const char *m_pattern;
+    const char *m_rewrite;
+};
+
+static const NormalizationRule rules[] = {
+    // Reduce \N to \n (both are allowed in vCard 3.0).
+    { "\\\\N", "\\\\n" },
+    // ignore blank lines
+    { "\n{2,}", "\n" },
+    // undo line continuation
+    { "\n[ \t]", "" },
+    // ignore charset specifications, assume UTF-8
+    { ";CHARSET=\"?UTF-8\"?", "" },
+    // the distinction between an empty and a missing property
+    // is vague and handled differently, so ignore empty properties
+    { "^[^:\n]*:;*\n", "" },
+    // VALUE=DATE is the default
+    { "^(EXDATE|BDAY);VALUE=DATE:", "\\1:" },
+    // default opacity is OPAQUE
+    { "^TRANSP:OPAQUE\n", "" },
+    // remove default VALUE=DATE-TIME
+    { "^(DTSTART|DTEND)([^:\n]*);VALUE=DATE-TIME", "\\1\\2" },
+    // remove default LANGUAGE=en-US
+    { "^([^:\n]*);LANGUAGE=en-US", "\\1" },
+    // normalize values which look like a date to YYYYMMDD because the hyphen is optional
+    { ":(\\d{4})-(\\d{2})-(\\d{2})", ":\\1\\2\\3" },
+    // mailto is case insensitive
+    { "^((?:ATTENDEE|ORGANIZER).*):[Mm][Aa][Ii][Ll][Tt][Oo]:", "\\1:mailto:" },
+    // remove fields which may differ
+    { "^(?:PRODID|CREATED|DTSTAMP|LAST-MODIFIED|REV)(?:;X-VOBJ-FLOATINGTIME-ALLOWED=(?:TRUE|FALSE))?:.*\n", "" },
+    // remove optional properties and parameters
+    { "^(?:METHOD|X-WSS-[A-Z]*|X-WR-[A-Z]*|CALSCALE|X-KDE-ICAL-IMPLEMENTATION-VERSION|X-KDE-KCALCORE-ENABLED):.*\n", "" },
+    { "^(ATTENDEE[^:\n]*);X-UID=[^;:\n]*", "\\1" },
+    // trailing line break(s) in a DESCRIPTION may or may not be
+    // removed or added by servers
+    { "^DESCRIPTION:(.*?)(?:\\\\n)+$", "DESCRIPTION:\\1" },
+    // added by EDS, can be recreated
+    { "^(\\w+)([^:\n]*);X-EVOLUTION-ENDDATE=[0-9TZ]*", "\\1\\2" },
+    // treat X-MOZILLA-HTML=FALSE as if the property didn't exist
+    { "^X-MOZILLA-HTML:FALSE\n", "" },
+    // ignore VALARM ACTION:NONE
+    { "^BEGIN:VALARM\n(?:.*\n)*?ACTION:NONE\n(?:.*\n)*?END:VALARM\n", "" },
+    { NULL, NULL }
+};
+
+/** additional rules for iCalendar 2.0 VEVENT/VTODO/VJOURNAL */
+static const NormalizationRule icalRules[] = {
+    // CLASS=PUBLIC is the default
+    { "^CLASS:PUBLIC\n", "" },
+    // RELATED=START and VALUE=DURATION are the default
+    { "^TRIGGER([^\n:]*);RELATED=START", "TRIGGER\\1" },
+    { "^TRIGGER([^\n:]*);VALUE=DURATION", "TRIGGER\\1" },
+    // INDIVIDUAL is default for CUTYPE
+    { ";CUTYPE=INDIVIDUAL([;:])", "\\1" },
+    { NULL, NULL }
+};
+
+typedef std::list< std::pair<boost::shared_ptr<pcrecpp::RE>, std::string> > CompiledRules;
+
+static const CompiledRules &compile(const NormalizationRule *table, CompiledRules &compiled)
+{
+    if (compiled.empty()) {
+        for (int i = 0; table[i].m_pattern; i++) {
+            compiled.push_back(std::make_pair(boost::shared_ptr<pcrecpp::RE>(new pcrecpp::RE(table[i].m_pattern,
+                                                                                             pcrecpp::RE_Options().set_multiline(true))),
+                                              std::string(table[i].m_rewrite)));
+        }
+    }
+    return compiled;
+}
+
+static void applyRules(const CompiledRules &compiled, std::string &text)
+{
+    BOOST_FOREACH (const CompiledRules::value_type &rule, compiled) {
+        rule.first->GlobalReplace(rule.second, &text);
+    }
+}
+
+/**
+ * Splits the parameters of a property, sorts them and uses
+ * quotation marks only where needed. TYPE=A,B becomes TYPE=A;TYPE=B
+ * with upper case values.
+ */
+static std::string normalizeParameters(const std::string &line)
+{
+    size_t colon = line.find(':');
+    size_t semicolon = line.find(';');
+    if (semicolon == line.npos || semicolon > colon) {
+        return line;
+    }
+
+    std::vector<std::string> params;
+    bool quoted = false;
+    size_t start = semicolon + 1;
+    size_t i;
+    for (i = start; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"') {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ';' || c == ':') {
+            std::string param = line.substr(start, i - start);
+            size_t equal = param.find('=');
+            std::string name = param.substr(0, equal);
+            std::string value = equal == param.npos ? "" : param.substr(equal + 1);
+            boost::trim_if(value, boost::is_any_of("\""));
+            if (boost::iequals(name, "TYPE")) {
+                std::vector<std::string> types;
+                boost::split(types, value, boost::is_any_of(","));
+                BOOST_FOREACH (const std::string &type, types) {
+                    params.push_back(name + "=" + boost::to_upper_copy(type));
+                }
+            } else if (value.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") == value.npos) {
+                params.push_back(name + "=" + value);
+            } else {
+                params.push_back(name + "=\"" + value + "\"");
+            }
+            start = i + 1;
+            if (c == ':') {
+                break;
+            }
+        }
+    }
+    std::sort(params.begin(), params.end());
+    return line.substr(0, semicolon) + ";" + boost::join(params, ";") + ":" +
+        (start <= line.size() ? line.substr(start) : "");
+}
+
+/**
+ * Line based normalization: parameters, CATEGORIES, EXDATE, RRULE.
+ */
+static void normalizeLines(std::string &text)
+{
+    std::vector<std::string> lines;
+    boost::split(lines, text, boost::is_any_of("\n"));
+    std::vector<std::string> result;
+    result.reserve(lines.size());
+    std::vector<std::string> categories;
+    size_t categoriesPos = 0;
+
+    BOOST_FOREACH (std::string &line, lines) {
+        if (line.empty()) {
+            continue;
+        }
+        if (boost::starts_with(line, "CATEGORIES:")) {
+            // merge all CATEGORIES into one, order is irrelevant
+            std::vector<std::string> values;
+            std::string value = line.substr(strlen("CATEGORIES:"));
+            boost::split(values, value, boost::is_any_of(","));
+            if (categories.empty()) {
+                categoriesPos = result.size();
+                result.push_back("");
+            }
+            categories.insert(categories.end(), values.begin(), values.end());
+            continue;
+        }
+        line = normalizeParameters(line);
+        size_t colon = line.find(':');
+        if (boost::starts_with(line, "EXDATE") && colon != line.npos) {
+            // multiple EXDATEs may be joined into one, use separate properties
+            std::vector<std::string> values;
+            std::string value = line.substr(colon + 1);
+            boost::split(values, value, boost::is_any_of(","));
+            BOOST_FOREACH (const std::string &value, values) {
+                result.push_back(line.substr(0, colon + 1) + value);
+            }
+            continue;
+        }
+        if (boost::starts_with(line, "RRULE") && colon != line.npos) {
+            // sort parts, INTERVAL=1 is the default
+            std::vector<std::string> parts;
+            std::string value = line.substr(colon + 1);
+            boost::split(parts, value, boost::is_any_of(";"));
+            parts.erase(std::remove(parts.begin(), parts.end(), std::string("INTERVAL=1")), parts.end());
+            std::sort(parts.begin(), parts.end());
+            line = line.substr(0, colon + 1) + boost::join(parts, ";");
+        }
+        result.push_back(line);
+    }
+    if (!categories.empty()) {
+        std::sort(categories.begin(), categories.end());
+        result[categoriesPos] = "CATEGORIES:" + boost::join(categories, ",");
+    }
+    text = boost::join(result, "\n");
+    text += "\n";
+}
+
+/** a line or nested block inside a BEGIN/END block, see formatItem() */
+struct FormattedLine
+{
+    size_t m_indent;
+    bool m_important;
+    std::string m_text;
+
+    bool operator < (const FormattedLine &other) const {
+        // more indented last, less important last
+        return m_indent < other.m_indent ||
+            (m_indent == other.m_indent &&
+             (m_important > other.m_important ||
+              (m_important == other.m_important && m_text < other.m_text)));
+    }
+};
+
+/**
+ * Folds lines to width, indents inner BEGIN/END blocks and sorts
+ * the lines inside each block so that N resp. SUMMARY come first
+ * and nested blocks last.
+ */
+static std::string formatItem(const std::string &text, size_t width)
+{
+    std::vector<std::string> lines;
+    boost::split(lines, text, boost::is_any_of("\n"));
+    std::vector< std::vector<FormattedLine> > stack(1);
+    BOOST_FOREACH (const std::string &line, lines) {
+        if (line.empty()) {
+            continue;
+        }
+        if (boost::starts_with(line, "BEGIN:")) {
+            stack.push_back(std::vector<FormattedLine>());
+        }
+
+        size_t indent = stack.size() >= 2 ? 2 * (stack.size() - 2) : 0;
+        std::string spaces(indent, ' ');
+        size_t thiswidth = width > 1 + indent ? width - 1 - indent : 1;
+        FormattedLine formatted;
+        formatted.m_indent = indent;
+        formatted.m_important = boost::starts_with(line, "N:") || boost::starts_with(line, "SUMMARY:");
+        for (size_t pos = 0; pos < line.size(); pos += thiswidth) {
+            if (pos) {
+                formatted.m_text += "\n" + spaces + " ";
+            } else {
+                formatted.m_text += spaces;
+            }
+            formatted.m_text += line.substr(pos, thiswidth);
+        }
+        stack.back().push_back(formatted);
+
+        if (boost::starts_with(line, "END:") && stack.size() > 1) {
+            std::vector<FormattedLine> block;
+            block.swap(stack.back());
+            stack.pop_back();
+            FormattedLine combined;
+            combined.m_indent = indent;
+            combined.m_important = false;
+            combined.m_text = block.front().m_text;
+            std::sort(block.begin() + 1, block.end() - (block.size() > 1 ? 1 : 0));
+            for (size_t i = 1; i < block.size(); i++) {
+                combined.m_text += "\n" + block[i].m_text;
+            }
+            stack.back().push_back(combined);
+        }
+    }
+
+    // unbalanced BEGIN/END: return what we have
+    std::string result;
+    BOOST_FOREACH (const std::vector<FormattedLine> &block, stack) {
+        BOOST_FOREACH (const FormattedLine &line, block) {
+            if (!result.empty()) {
+                result += "\n";
+            }
+            result += line.m_text;
+        }
+    }
+    return result;
+}
+
+static void normalizeItem(std::string &text, size_t width)
+{
+    static CompiledRules compiledRules, compiledIcalRules;
+    static const pcrecpp::RE vcardUID("^UID:[^\n]*\n", pcrecpp::RE_Options().set_multiline(true));
+
+    applyRules(compile(rules, compiledRules), text);
+    // UID may differ, but only in vCards and journal entries
+    if (boost::contains(text, "BEGIN:VCARD") ||
+        boost::contains(text, "BEGIN:VJOURNAL")) {
+        vcardUID.GlobalReplace("", &text);
+    }
+    if (boost::contains(text, "BEGIN:VEVENT") ||
+        boost::contains(text, "BEGIN:VTODO") ||
+        boost::contains(text, "BEGIN:VJOURNAL")) {
+        applyRules(compile(icalRules, compiledIcalRules), text);
+    }
+    normalizeLines(text);
+    text = formatItem(text, width);
+}
+
+void DumpCompare::normalize(const std::string &item, size_t width, std::vector<std::string> &items)
+{
+    std::string text = item;
+    boost::erase_all(text, "\r");
+    if (!boost::ends_with(text, "\n")) {
+        text += "\n";
+    }
+
+    size_t first = text.find("BEGIN:VEVENT");
+    if (first != text.npos &&
+        text.find("BEGIN:VEVENT", first + 1) != text.npos) {
+        // remove multiple events from calendar item, then inject
+        // every single one back into the calendar
+        std::vector<std::string> events;
+        size_t start;
+        while ((start = text.find("BEGIN:VEVENT")) != text.npos) {
+            size_t end = text.find("END:VEVENT\n", start);
+            if (end == text.npos) {
+                break;
+            }
+            end += strlen("END:VEVENT\n");
+            events.push_back(text.substr(start, end - start));
+            text.erase(start, end - start);
+        }
+        size_t insert = text.rfind("END:VCALENDAR");
+        if (insert == text.npos) {
+            insert = text.size();
+        }
+        BOOST_FOREACH (const std::string &event, events) {
+            std::string calendar = text;
+            calendar.insert(insert, event);
+            normalizeItem(calendar, width);
+            items.push_back(calendar);
+        }
+    } else {
+        normalizeItem(text, width);
+        items.push_back(text);
+    }
+}
+
+DumpCompare::DumpCompare(const Legend &legend, size_t columns) :
+    m_legend(legend),
+    m_columns(columns)
+{
+    if (!m_columns) {
+        const char *env = getenv("COLUMNS");
+        m_columns = env ? atoi(env) : 0;
+        if (m_columns < 20) {
+            m_columns = 80;
+        }
+    }
+    m_singleWidth = (m_columns - 3) / 2;
+    m_columns = m_singleWidth * 2 + 3;
+}
+
+void DumpCompare::readItems(BackupItemReader &reader, const std::vector<long> &counters, std::vector<std::string> &items)
+{
+    std::string data;
+    BOOST_FOREACH (long counter, counters) {
+        if (reader.readItem(counter, data)) {
+            normalize(data, m_singleWidth, items);
+        }
+    }
+    std::sort(items.begin(), items.end());
+}
+
+std::string DumpCompare::pad(const std::string &line)
+{
+    return line.size() < m_singleWidth ?
+        line + std::string(m_singleWidth - line.size(), ' ') :
+        line;
+}
+
+/** pairs changed items: UID if available, otherwise N or SUMMARY */
+static std::string itemKey(const std::string &item)
+{
+    static const pcrecpp::RE uid("^\\s*(UID:.*)$", pcrecpp::RE_Options().set_multiline(true));
+    static const pcrecpp::RE name("^\\s*((?:N|SUMMARY):.*)$", pcrecpp::RE_Options().set_multiline(true));
+    std::string key;
+    if (uid.PartialMatch(item, &key) ||
+        name.PartialMatch(item, &key)) {
+        return key;
+    }
+    return "";
+}
+
+void DumpCompare::printRecord(const std::vector<std::string> &oldLines,
+                              const std::vector<std::string> &newLines,
+                              std::ostream &out)
+{
+    // Diff lines, then mark each line as old (o), new (n) or
+    // unchanged (u), like synccompare does.
+    typedef std::vector< LCS::Entry<std::string> > Common;
+    Common common;
+    LCS::lcs(oldLines, newLines, std::back_inserter(common), LCS::accessor_sequence< std::vector<std::string> >());
+    std::vector< std::pair<char, std::string> > marked;
+    size_t i = 0, j = 0;
+    BOOST_FOREACH (const Common::value_type &entry, common) {
+        while (i + 1 < entry.index_a) {
+            marked.push_back(std::make_pair('o', oldLines[i++]));
+        }
+        while (j + 1 < entry.index_b) {
+            marked.push_back(std::make_pair('n', newLines[j++]));
+        }
+        marked.push_back(std::make_pair('u', oldLines[i]));
+        i++;
+        j++;
+    }
+    while (i < oldLines.size()) {
+        marked.push_back(std::make_pair('o', oldLines[i++]));
+    }
+    while (j < newLines.size()) {
+        marked.push_back(std::make_pair('n', newLines[j++]));
+    }
+
+    // convert into side-by-side output
+    std::string spaces(m_singleWidth, ' ');
+    std::list<std::string> buffer;
+    typedef std::pair<char, std::string> Marked_t;
+    BOOST_FOREACH (const Marked_t &line, marked) {
+        switch (line.first) {
+        case 'u':
+            while (!buffer.empty()) {
+                out << pad(buffer.front()) << " <\n";
+                buffer.pop_front();
+            }
+            out << pad(line.second) << "   " << line.second << "\n";
+            break;
+        case 'o':
+            // preserve in buffer for potential merging with "n"
+            buffer.push_back(line.second);
+            break;
+        default:
+            if (!buffer.empty()) {
+                out << pad(buffer.front()) << " | " << line.second << "\n";
+                buffer.pop_front();
+            } else {
+                out << spaces << " > " << line.second << "\n";
+            }
+            break;
+        }
+    }
+    while (!buffer.empty()) {
+        out << pad(buffer.front()) << " <\n";
+        buffer.pop_front();
+    }
+    out << std::string(m_columns, '-') << "\n";
+}
+
+bool DumpCompare::compare(const std::string &oldDir, const std::string &newDir, std::ostream &out)
+{
+    if (!isDir(oldDir)) {
+        SE_THROW(oldDir + ": database dump not found");
+    }
+    if (!isDir(newDir)) {
+        SE_THROW(newDir + ": database dump not found");
+    }
+    boost::shared_ptr<ConfigNode> oldNode = ConfigNode::createFileNode(oldDir + ".ini");
+    boost::shared_ptr<ConfigNode> newNode = ConfigNode::createFileNode(newDir + ".ini");
+    BackupItemReader oldReader(oldDir, oldNode);
+    BackupItemReader newReader(newDir, newNode);
+
+    // Don't read items which are known to be identical because
+    // they have the same hash.
+    std::map< std::string, std::list<long> > oldByHash;
+    std::vector<long> oldCounters, newCounters;
+    long numitems = oldReader.getNumItems();
+    for (long counter = 1; counter <= numitems; counter++) {
+        std::stringstream key;
+        key << counter << ItemCache::m_hashSuffix;
+        std::string hash = oldNode->readProperty(key.str());
+        if (hash.empty()) {
+            oldCounters.push_back(counter);
+        } else {
+            oldByHash[hash].push_back(counter);
+        }
+    }
+    numitems = newReader.getNumItems();
+    for (long counter = 1; counter <= numitems; counter++) {
+        std::stringstream key;
+        key << counter << ItemCache::m_hashSuffix;
+        std::string hash = newNode->readProperty(key.str());
+        std::map< std::string, std::list<long> >::iterator it;
+        if (!hash.empty() &&
+            (it = oldByHash.find(hash)) != oldByHash.end() &&
+            !it->second.empty()) {
+            it->second.pop_front();
+        } else {
+            newCounters.push_back(counter);
+        }
+    }
+    for (std::map< std::string, std::list<long> >::const_iterator it = oldByHash.begin();
+         it != oldByHash.end();
+         ++it) {
+        oldCounters.insert(oldCounters.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(oldCounters.begin(), oldCounters.end());
+
+    std::vector<std::string> oldItems, newItems;
+    readItems(oldReader, oldCounters, oldItems);
+    readItems(newReader, newCounters, newItems);
+
+    // ignore items which are identical after normalization
+    std::vector<std::string> removed, added;
+    std::set_difference(oldItems.begin(), oldItems.end(),
+                        newItems.begin(), newItems.end(),
+                        std::back_inserter(removed));
+    std::set_difference(newItems.begin(), newItems.end(),
+                        oldItems.begin(), oldItems.end(),
+                        std::back_inserter(added));
+    if (removed.empty() && added.empty()) {
+        return false;
+    }
+
+    out << StringPrintf("%*s | %s\n", (int)m_singleWidth, m_legend.m_left.c_str(), m_legend.m_right.c_str());
+    out << StringPrintf("%*s <\n", (int)m_singleWidth, m_legend.m_removed.c_str());
+    out << StringPrintf("%*s > %s\n", (int)m_singleWidth, "", m_legend.m_added.c_str());
+    out << std::string(m_columns, '-') << "\n";
+
+    // pair old and new version of modified items
+    std::multimap<std::string, size_t> addedByKey;
+    for (size_t i = 0; i < added.size(); i++) {
+        std::string key = itemKey(added[i]);
+        if (!key.empty()) {
+            addedByKey.insert(std::make_pair(key, i));
+        }
+    }
+    std::vector<bool> printed(added.size(), false);
+    std::vector<std::string> oldLines, newLines;
+    BOOST_FOREACH (const std::string &item, removed) {
+        boost::split(oldLines, item, boost::is_any_of("\n"));
+        newLines.clear();
+        std::string key = itemKey(item);
+        std::multimap<std::string, size_t>::iterator it;
+        if (!key.empty() &&
+            (it = addedByKey.find(key)) != addedByKey.end()) {
+            boost::split(newLines, added[it->second], boost::is_any_of("\n"));
+            printed[it->second] = true;
+            addedByKey.erase(it);
+        }
+        printRecord(oldLines, newLines, out);
+    }
+    oldLines.clear();
+    for (size_t i = 0; i < added.size(); i++) {
+        if (!printed[i]) {
+            boost::split(newLines, added[i], boost::is_any_of("\n"));
+            printRecord(oldLines, newLines, out);
+        }
+    }
+
+    return true;
+}
+
+#ifdef ENABLE_UNIT_TESTS
+
+class DumpCompareTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(DumpCompareTest);
+    CPPUNIT_TEST(normalizeVCard);
+    CPPUNIT_TEST(normalizeEvents);
+    CPPUNIT_TEST(compareDumps);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string m_testDir;
+
+    void dump(const std::string &name, const std::string &counter, const std::string &item) {
+        std::string dir = m_testDir + "/" + name;
+        mkdir_p(dir);
+        std::ofstream out((dir + "/" + counter).c_str());
+        out << item;
+        out.close();
+        CPPUNIT_ASSERT(out.good());
+        boost::shared_ptr<ConfigNode> node = ConfigNode::createFileNode(dir + ".ini");
+        long numitems = 0;
+        node->getProperty("numitems", numitems);
+        numitems++;
+        node->setProperty("numitems", numitems);
+        node->flush();
+    }
+
+public:
+    void setUp() {
+        m_testDir = "DumpCompareTest";
+        rm_r(m_testDir);
+    }
+
+private:
+    void normalizeVCard() {
+        std::vector<std::string> items;
+        DumpCompare::normalize("BEGIN:VCARD\r\n"
+                               "VERSION:3.0\r\n"
+                               "UID:foo\r\n"
+                               "REV:20140101T000000Z\r\n"
+                               "TEL;TYPE=work,voice:123\r\n"
+                               "CATEGORIES:b\r\n"
+                               "N:Doe;Jo\r\n"
+                               " hn\r\n"
+                               "NOTE:\r\n"
+                               "CATEGORIES:a\r\n"
+                               "END:VCARD\r\n",
+                               80,
+                               items);
+        CPPUNIT_ASSERT_EQUAL((size_t)1, items.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("BEGIN:VCARD\n"
+                                         "N:Doe;John\n"
+                                         "CATEGORIES:a,b\n"
+                                         "TEL;TYPE=VOICE;TYPE=WORK:123\n"
+                                         "VERSION:3.0\n"
+                                         "END:VCARD"),
+                             items[0]);
+    }
+
+    void normalizeEvents() {
+        std::vector<std::string> items;
+        DumpCompare::normalize("BEGIN:VCALENDAR\n"
+                               "VERSION:2.0\n"
+                               "BEGIN:VEVENT\n"
+                               "UID:1\n"
+                               "SUMMARY:parent\n"
+                               "DTSTAMP:20140101T000000Z\n"
+                               "RRULE:INTERVAL=1;FREQ=DAILY;COUNT=2\n"
+                               "END:VEVENT\n"
+                               "BEGIN:VEVENT\n"
+                               "UID:1\n"
+                               "SUMMARY:child\n"
+                               "RECURRENCE-ID:20140102T000000Z\n"
+                               "CLASS:PUBLIC\n"
+                               "END:VEVENT\n"
+                               "END:VCALENDAR\n",
+                               80,
+                               items);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, items.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("BEGIN:VCALENDAR\n"
+                                         "VERSION:2.0\n"
+                                         "  BEGIN:VEVENT\n"
+                                         "  SUMMARY:parent\n"
+                                         "  RRULE:COUNT=2;FREQ=DAILY\n"
+                                         "  UID:1\n"
+                                         "  END:VEVENT\n"
+                                         "END:VCALENDAR"),
+                             items[0]);
+        CPPUNIT_ASSERT_EQUAL(std::string("BEGIN:VCALENDAR\n"
+                                         "VERSION:2.0\n"
+                                         "  BEGIN:VEVENT\n"
+                                         "  SUMMARY:child\n"
+                                         "  RECURRENCE-ID:20140102T000000Z\n"
+                                         "  UID:1\n"
+                                         "  END:VEVENT\n"
+                                         "END:VCALENDAR"),
+                             items[1]);
+    }
+
+    void compareDumps() {
+        dump("one", "1", "BEGIN:VCARD\nN:Doe;John\nFN:John Doe\nREV:1\nEND:VCARD\n");
+        dump("one", "2", "BEGIN:VCARD\nN:Smith;Jane\nFN:Jane Smith\nEND:VCARD\n");
+        // only REV differs
+        dump("two", "1", "BEGIN:VCARD\nN:Doe;John\nFN:John Doe\nREV:2\nEND:VCARD\n");
+        dump("two", "2", "BEGIN:VCARD\nN:Smith;Jane\nFN:Jane Miller\nEND:VCARD\n");
+        dump("two", "3", "BEGIN:VCARD\nN:Other;Joe\nEND:VCARD\n");
+
+        DumpCompare compare(DumpCompare::Legend(), 43);
+        std::ostringstream out;
+        CPPUNIT_ASSERT(!compare.compare(m_testDir + "/one", m_testDir + "/one", out));
+        CPPUNIT_ASSERT(out.str().empty());
+        CPPUNIT_ASSERT(compare.compare(m_testDir + "/one", m_testDir + "/two", out));
+        CPPUNIT_ASSERT_EQUAL(std::string("         before sync | after sync\n"
+                                         " removed during sync <\n"
+                                         "                     > added during sync\n"
+                                         "-------------------------------------------\n"
+                                         "BEGIN:VCARD            BEGIN:VCARD\n"
+                                         "N:Smith;Jane           N:Smith;Jane\n"
+                                         "FN:Jane Smith        | FN:Jane Miller\n"
+                                         "END:VCARD              END:VCARD\n"
+                                         "-------------------------------------------\n"
+                                         "                     > BEGIN:VCARD\n"
+                                         "                     > N:Other;Joe\n"
+                                         "                     > END:VCARD\n"
+                                         "-------------------------------------------\n"),
+                             out.str());
+    }
+};
+
+SYNCEVOLUTION_TEST_SUITE_REGISTRATION(DumpCompareTest);
+
+#endif // ENABLE_UNIT_TESTS
+
+SE_END_CXX
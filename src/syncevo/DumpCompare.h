@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef INCL_SYNCEVO_DUMP_COMPARE
+# define INCL_SYNCEVO_DUMP_COMPARE
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <syncevo/declarations.h>
+SE_BEGIN_CXX
+
+class BackupItemReader;
+
+/**
+ * Compares two database dumps made by ItemCache and prints the
+ * differences in the same side-by-side format as "synccompare
+ * <dir1> <dir2>", without forking the Perl script.
+ *
+ * Items with the same hash in both dumps are known to be identical
+ * and are not read at all. The remaining items get normalized
+ * (unfolded lines, default values and volatile properties like
+ * DTSTAMP removed, properties sorted) with the subset of the
+ * synccompare rules which applies when no CLIENT_TEST_SERVER is
+ * set. Normalized items which are still identical are ignored, the
+ * others get paired and diffed line by line.
+ */
+class DumpCompare
+{
+ public:
+    /** legend printed above the differences, like CLIENT_TEST_LEFT_NAME etc. for synccompare */
+    struct Legend {
+        std::string m_left, m_right, m_removed, m_added;
+        Legend(const std::string &left = "before sync",
+               const std::string &right = "after sync",
+               const std::string &removed = "removed during sync",
+               const std::string &added = "added during sync") :
+            m_left(left),
+            m_right(right),
+            m_removed(removed),
+            m_added(added)
+        {}
+    };
+
+    /**
+     * @param legend    names used in the output
+     * @param columns   total width of output, 0 for $COLUMNS or 80
+     */
+    DumpCompare(const Legend &legend, size_t columns = 0);
+
+    /**
+     * Compares the two dumps in the backup directories, with
+     * the meta information in <dir>.ini. Throws an error if one of
+     * them cannot be read.
+     *
+     * @return true if differences were found and written to out
+     */
+    bool compare(const std::string &oldDir, const std::string &newDir, std::ostream &out);
+
+    /**
+     * Normalizes one vCard or iCalendar item. iCalendar items with
+     * more than one VEVENT get split into one item per VEVENT.
+     *
+     * @param item     item data
+     * @param width    maximum length of lines, longer lines get folded
+     * @retval items   normalized items, appended
+     */
+    static void normalize(const std::string &item, size_t width, std::vector<std::string> &items);
+
+ private:
+    Legend m_legend;
+    size_t m_columns;
+    size_t m_singleWidth;
+
+    void readItems(BackupItemReader &reader, const std::vector<long> &counters, std::vector<std::string> &items);
+    void printRecord(const std::vector<std::string> &oldLines,
+                     const std::vector<std::string> &newLines,
+                     std::ostream &out);
+    std::string pad(const std::string &line);
+};
+
+SE_END_CXX
+#endif // INCL_SYNCEVO_DUMP_COMPARE
@@ -22,6 +22,7 @@
 
 #include <syncevo/FileConfigTree.h>
 #include <syncevo/IniConfigNode.h>
+#include <syncevo/BinaryLogConfigNode.h>
 #include <syncevo/util.h>
 
 #include <boost/foreach.hpp>
@@ -59,9 +60,29 @@ void FileConfigTree::reload()
     }
 }
 
+/**
+ * change tracking files as created by FileConfigTree::open():
+ * .other[_<id>].bin, .other[_<id>].ini from older releases and
+ * their temporary files (.# prefix, see SafeOstream)
+ */
+static bool isTrackingFile(const string &path)
+{
+    string name = getBasename(path);
+    if (boost::starts_with(name, ".#")) {
+        name.erase(0, 2);
+    }
+    if (boost::ends_with(name, "~")) {
+        name.resize(name.size() - 1);
+    }
+    return (boost::starts_with(name, ".other.") ||
+            boost::starts_with(name, ".other_")) &&
+        (boost::ends_with(name, ".bin") ||
+         boost::ends_with(name, ".ini"));
+}
+
 /**
  * remove config files, backup files of config files (with ~ at
- * the end) and empty directories
+ * the end), change tracking files and empty directories
  */
 static bool rm_filter(const string &path, bool isDir)
 {
@@ -75,8 +96,7 @@ static bool rm_filter(const string &path, bool isDir)
             boost::ends_with(path, "/config.ini~") ||
             boost::ends_with(path, "/config.txt") ||
             boost::ends_with(path, "/config.txt~") ||
-            boost::ends_with(path, "/.other.ini") ||
-            boost::ends_with(path, "/.other.ini~") ||
+            isTrackingFile(path) ||
             boost::ends_with(path, "/.server.ini") ||
             boost::ends_with(path, "/.server.ini~") ||
             boost::ends_with(path, "/.internal.ini") ||
@@ -155,7 +175,7 @@ boost::shared_ptr<ConfigNode> FileConfigTree::open(const string &path,
                 filename += "_";
                 filename += otherId;
             }
-            filename += ".ini";
+            filename += ".bin";
         }
     } else {
         filename = type == server ? ".server.ini" :
@@ -168,6 +188,11 @@ boost::shared_ptr<ConfigNode> FileConfigTree::open(const string &path,
     NodeCache_t::iterator found = m_nodes.find(fullname);
     if (found != m_nodes.end()) {
         return found->second;
+    } else if (type == other && m_layout != SyncConfig::SYNC4J_LAYOUT) {
+        // change tracking: binary log, converted from the older .ini file
+        string iniFilename = filename.substr(0, filename.size() - 4) + ".ini";
+        boost::shared_ptr<ConfigNode> node(new BinaryLogConfigNode(fullpath, filename, iniFilename, m_readonly));
+        return m_nodes[fullname] = node;
     } else if(type != other && type != server) {
         boost::shared_ptr<ConfigNode> node(new IniFileConfigNode(fullpath, filename, m_readonly));
         return m_nodes[fullname] = node;
@@ -30,6 +30,7 @@
 #include <syncevo/MultiplexConfigNode.h>
 #include <syncevo/SingleFileConfigTree.h>
 #include <syncevo/IniConfigNode.h>
+#include <syncevo/BinaryLogConfigNode.h>
 #include <syncevo/Cmdline.h>
 #include <syncevo/lcs.h>
 #include <syncevo/ThreadSupport.h>
@@ -42,6 +43,7 @@
 #include <algorithm>
 #include <functional>
 #include <queue>
+#include <fstream>
 
 #include <unistd.h>
 #include "config.h"
@@ -1247,12 +1249,13 @@ SyncSourceNodes SyncConfig::getSyncSourceNodes(const string &name,
         // Local sync: overwrite per-peer nodes with nodes inside the
         // parents tree. Otherwise different configs syncing locally
         // against the same context end up sharing .internal.ini and
-        // .other.ini files inside that context.
+        // .other.bin files inside that context.
         string path = m_redirectPeerRootPath + "/sources/" + lower;
-        trackingNode.reset(new IniHashConfigNode(path,
-                                                 ".other.ini",
-                                                 false));
-        trackingNode = m_tree->add(path + "/.other.ini", trackingNode);
+        trackingNode.reset(new BinaryLogConfigNode(path,
+                                                   ".other.bin",
+                                                   ".other.ini",
+                                                   false));
+        trackingNode = m_tree->add(path + "/.other.bin", trackingNode);
         if (peerPath.empty()) {
             hiddenPeerNode = peerNode;
         } else {
@@ -3415,6 +3418,7 @@ bool SecondsConfigProperty::parseDuration(const string &value, string &error, un
 class SyncConfigTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(SyncConfigTest);
     CPPUNIT_TEST(normalize);
+    CPPUNIT_TEST(removeTracking);
     CPPUNIT_TEST(parseDuration);
     CPPUNIT_TEST(propertySpec);
     CPPUNIT_TEST_SUITE_END();
@@ -3472,6 +3476,46 @@ private:
                              SyncConfig::normalizeConfigString("foo", SyncConfig::NORMALIZE_LONG_FORMAT));
     }
 
+    void removeTracking()
+    {
+        ScopedEnvChange xdg("XDG_CONFIG_HOME", "CmdlineTest");
+        ScopedEnvChange home("HOME", "CmdlineTest");
+
+        rm_r("CmdlineTest");
+
+        // Change tracking data must be removed together with the
+        // config resp. source, otherwise a new one with the same name
+        // would inherit it. Also covers an interrupted write.
+        std::string peerDir = "CmdlineTest/syncevolution/default/peers/foo";
+        std::string sourceDir = "CmdlineTest/syncevolution/other/peers/foo/sources/addressbook";
+        {
+            SyncConfig config("foo"), other("foo@other");
+            config.setLogLevel(10);
+            other.setLogLevel(10);
+            config.getSyncSourceNodes("addressbook").getTrackingNode()->setProperty("luid", "rev");
+            config.getSyncSourceNodes("calendar", "id").getTrackingNode()->setProperty("luid", "rev");
+            other.getSyncSourceNodes("addressbook").getTrackingNode()->setProperty("luid", "rev");
+            config.flush();
+            other.flush();
+        }
+        CPPUNIT_ASSERT(!access((peerDir + "/sources/addressbook/.other.bin").c_str(), F_OK));
+        CPPUNIT_ASSERT(!access((peerDir + "/sources/calendar/.other_id.bin").c_str(), F_OK));
+        CPPUNIT_ASSERT(!access((sourceDir + "/.other.bin").c_str(), F_OK));
+        {
+            std::ofstream partial((sourceDir + "/.#.other.bin").c_str());
+            partial << "partial";
+        }
+        CPPUNIT_ASSERT(!access((sourceDir + "/.#.other.bin").c_str(), F_OK));
+
+        SyncConfig("foo@other").removeSyncSource("addressbook");
+        CPPUNIT_ASSERT(!isDir(sourceDir));
+        CPPUNIT_ASSERT(SyncConfig("foo@other").getSyncSourceNodes("addressbook").getTrackingNode()->readProperty("luid").empty());
+
+        SyncConfig("foo").remove();
+        CPPUNIT_ASSERT(!isDir(peerDir));
+        CPPUNIT_ASSERT(SyncConfig("foo").getSyncSourceNodes("calendar", "id").getTrackingNode()->readProperty("luid").empty());
+    }
+
     void parseDuration()
     {
         string error;
@@ -39,10 +39,13 @@
 #include <syncevo/SoupTransportAgent.h>
 #include <syncevo/ObexTransportAgent.h>
 #include <syncevo/LocalTransportAgent.h>
+#include <syncevo/BackupPack.h>
+#include <syncevo/DumpCompare.h>
 
 #include <list>
 #include <memory>
 #include <vector>
+#include <set>
 #include <sstream>
 #include <fstream>
 #include <iomanip>
@@ -833,7 +836,23 @@ public:
 #endif
 
     /**
-     * Compare two database dumps just based on their inodes.
+     * Collect the item hashes stored for a database dump.
+     */
+    static void getItemHashes(const string &dir, multiset<string> &hashes)
+    {
+        boost::shared_ptr<ConfigNode> node = ConfigNode::createFileNode(dir + ".ini");
+        long numitems = 0;
+        node->getProperty("numitems", numitems);
+        for (long counter = 1; counter <= numitems; counter++) {
+            stringstream key;
+            key << counter << ItemCache::m_hashSuffix;
+            hashes.insert(node->readProperty(key.str()));
+        }
+    }
+
+    /**
+     * Compare two database dumps just based on their inodes,
+     * or based on the item hashes if one of them uses pack files.
      * @return true    if inodes differ
      */
     static bool haveDifferentContent(const string &sourceName,
@@ -844,6 +863,14 @@ public:
     {
         string first = firstDir + "/" + sourceName + "." + firstSuffix;
         string second = secondDir + "/" + sourceName + "." + secondSuffix;
+        if (BackupItemReader::isPack(first) ||
+            BackupItemReader::isPack(second)) {
+            // Items in pack files have no inode of their own.
+            multiset<string> firstHashes, secondHashes;
+            getItemHashes(first, firstHashes);
+            getItemHashes(second, secondHashes);
+            return firstHashes != secondHashes;
+        }
         ReadDir firstContent(first);
         ReadDir secondContent(second);
         set<ino_t> firstInodes;
@@ -1328,7 +1355,7 @@ public:
                           const string &oldSuffix, const string &newSuffix,
                           const string &excludeSource,
                           const string &intro = "Local data changes to be applied remotely during synchronization:\n",
-                          const string &config = "CLIENT_TEST_LEFT_NAME='after last sync' CLIENT_TEST_RIGHT_NAME='current data' CLIENT_TEST_REMOVED='removed since last sync' CLIENT_TEST_ADDED='added since last sync'") {
+                          const DumpCompare::Legend &legend = DumpCompare::Legend("after last sync", "current data", "removed since last sync", "added since last sync")) {
         if (m_logLevel <= LOGGING_SUMMARY) {
             return false;
         }
@@ -1374,20 +1401,17 @@ public:
             }
             string newDir = databaseName(*source, newSuffix);
             SE_LOG_SHOW(NULL, "*** %s ***", source->getDisplayName().c_str());
-            string cmd = string("env CLIENT_TEST_COMPARISON_FAILED=10 " + config + " synccompare '" ) +
-                oldDir + "' '" + newDir + "'";
-            int ret = Execute(cmd, EXECUTE_NO_STDERR);
-            switch (ret == -1 ? ret :
-                    WIFEXITED(ret) ? WEXITSTATUS(ret) :
-                    -1) {
-            case 0:
-                SE_LOG_SHOW(NULL, "no changes");
-                break;
-            case 10:
-                break;
-            default:
+            try {
+                DumpCompare compare(legend);
+                std::ostringstream out;
+                if (compare.compare(oldDir, newDir, out)) {
+                    SE_LOG_SHOW(NULL, "%s", out.str().c_str());
+                } else {
+                    SE_LOG_SHOW(NULL, "no changes");
+                }
+            } catch (...) {
+                Exception::handle(HANDLE_EXCEPTION_NO_ERROR);
                 SE_LOG_SHOW(NULL, "Comparison was impossible.");
-                break;
             }
         }
         SE_LOG_SHOW(NULL, "\n");
@@ -1505,7 +1529,7 @@ public:
                                      "before", "after", "",
                                      StringPrintf("\nData modified %s during synchronization:\n",
                                                   m_client.isLocalSync() ? m_client.getContextName().c_str() : "locally"),
-                                     "CLIENT_TEST_LEFT_NAME='before sync' CLIENT_TEST_RIGHT_NAME='after sync' CLIENT_TEST_REMOVED='removed during sync' CLIENT_TEST_ADDED='added during sync'");
+                                     DumpCompare::Legend("before sync", "after sync", "removed during sync", "added during sync"));
                 }
 
                 // now remove some old logdirs
@@ -2082,11 +2106,16 @@ bool SyncContext::displaySourceProgress(SyncSource &source,
                            event.m_extra2);
         break;
     case sysync::PEV_DSSTATS_S:
-        /* datastore statistics for server slowsync  (extra1=# slowsync matches) */
+        /* datastore statistics for server slowsync  (extra1=# slowsync matches,
+           extra2=# compares avoided by match index) */
         source.setItemStat(SyncSource::ITEM_REMOTE,
                            SyncSource::ITEM_ANY,
                            SyncSource::ITEM_MATCH,
                            event.m_extra1);
+        source.setItemStat(SyncSource::ITEM_REMOTE,
+                           SyncSource::ITEM_ANY,
+                           SyncSource::ITEM_MATCH_SKIPPED,
+                           event.m_extra2);
         break;
     case sysync::PEV_DSSTATS_C:
         /* datastore statistics for server conflicts (extra1=# server won,
@@ -3108,10 +3137,53 @@ SyncContext::analyzeSyncMLMessage(const char *data, size_t len,
     return info;
 }
 
+namespace {
+    /**
+     * An engine which was initialized without datastores and without
+     * session log dir only depends on the XML config and the engine
+     * type (client or server). syncevo-dbus-server needs such an
+     * engine for each incoming SyncML message
+     * (SyncContext::analyzeSyncMLMessage()). Parsing the config is
+     * the main part of the startup cost, so the most recently
+     * initialized engine is kept and reused as long as the config
+     * does not change.
+     *
+     * Intentionally never freed, to avoid destroying an engine
+     * while libsynthesis is already shutting down at exit.
+     */
+    struct CachedEngine {
+        bool m_serverMode;
+        unsigned long m_hash;
+        std::string m_xml;
+        SharedEngine m_engine;
+    };
+    CachedEngine *cachedEngine;
+}
+
 void SyncContext::initEngine(bool isSync)
 {
+    Timespec start = Timespec::monotonic();
     string xml, configname;
     getConfigXML(isSync, xml, configname);
+    Timespec generated = Timespec::monotonic();
+
+    // Sync sessions use a log dir and datastores, don't cache those.
+    bool cacheable = !isSync &&
+        (!m_sourceListPtr ||
+         (m_sourceListPtr->empty() && m_sourceListPtr->getLogdir().empty()));
+    unsigned long hash = cacheable ? Hash(xml) : 0;
+    if (cacheable &&
+        cachedEngine &&
+        cachedEngine->m_serverMode == m_serverMode &&
+        cachedEngine->m_hash == hash &&
+        cachedEngine->m_xml == xml) {
+        m_engine = cachedEngine->m_engine;
+        SE_LOG_DEBUG(NULL, "engine startup: XML config %.3fs, reused engine with unchanged config (hash %lu)",
+                     (generated - start).duration(),
+                     hash);
+        return;
+    }
+
     try {
         m_engine.InitEngineXML(xml.c_str());
     } catch (const BadSynthesisResult &ex) {
@@ -3123,6 +3195,20 @@ void SyncContext::initEngine(bool isSync)
                      xml.c_str());
         throw;
     }
+    Timespec parsed = Timespec::monotonic();
+    SE_LOG_DEBUG(NULL, "engine startup: XML config %.3fs, parsing %.3fs (%ld bytes)",
+                 (generated - start).duration(),
+                 (parsed - generated).duration(),
+                 (long)xml.size());
+    if (cacheable) {
+        if (!cachedEngine) {
+            cachedEngine = new CachedEngine;
+        }
+        cachedEngine->m_serverMode = m_serverMode;
+        cachedEngine->m_hash = hash;
+        cachedEngine->m_xml = xml;
+        cachedEngine->m_engine = m_engine;
+    }
     if (isSync &&
         getLogLevel() >= 5) {
         SE_LOG_DEV(NULL, "Full XML configuration:\n%s", xml.c_str());
@@ -4667,10 +4753,7 @@ void SyncContext::restore(const string &dirname, RestoreDatabase database)
         sourceList.dumpDatabases("current", NULL);
         sourceList.dumpLocalChanges(dirname, "current", datadump, "",
                                     "Data changes to be applied locally during restore:\n",
-                                    "CLIENT_TEST_LEFT_NAME='current data' "
-                                    "CLIENT_TEST_REMOVED='after restore' " 
-                                    "CLIENT_TEST_REMOVED='to be removed' "
-                                    "CLIENT_TEST_ADDED='to be added'");
+                                    DumpCompare::Legend("current data", "after restore", "to be removed", "to be added"));
     }
 
     SyncReport report;
@@ -4868,6 +4951,7 @@ private:
     CPPUNIT_TEST(testSessionNoChanges);
     CPPUNIT_TEST(testSessionChanges);
     CPPUNIT_TEST(testMultipleSessions);
+    CPPUNIT_TEST(testPackFormat);
     CPPUNIT_TEST(testExpire);
     CPPUNIT_TEST_SUITE_END();
 
@@ -5069,6 +5153,69 @@ private:
                                                      seconddir, "before"));
     }
 
+    // read all items in a database dump, sorted
+    vector<string> readDump(const string &dir) {
+        vector<string> items;
+        BackupItemReader reader(dir, ConfigNode::createFileNode(dir + ".ini"));
+        string data;
+        for (long counter = 1; counter <= reader.getNumItems(); counter++) {
+            CPPUNIT_ASSERT(reader.readItem(counter, data));
+            items.push_back(data);
+        }
+        sort(items.begin(), items.end());
+        return items;
+    }
+
+    void testPackFormat() {
+        ScopedEnvChange config("XDG_CONFIG_HOME", "LogDirTest/config");
+        ScopedEnvChange cache("XDG_CACHE_HOME", "LogDirTest/cache");
+        ScopedEnvChange format("SYNCEVOLUTION_BACKUP_FORMAT", "pack");
+
+        string dir = session(false, STATUS_OK, "file_event", ".one", ".two", (char *)0);
+        string seconddir = session(false, STATUS_OK, "file_event", ".two", ".one", (char *)0);
+        string before = dir + "/file_event.before";
+        string after = dir + "/file_event.after";
+        string secondBefore = seconddir + "/file_event.before";
+        string secondAfter = seconddir + "/file_event.after";
+        CPPUNIT_ASSERT(BackupItemReader::isPack(before));
+        CPPUNIT_ASSERT(BackupItemReader::isPack(secondAfter));
+
+        CPPUNIT_ASSERT(LogDir::haveDifferentContent("file_event",
+                                                    dir, "before",
+                                                    dir, "after"));
+        CPPUNIT_ASSERT(!LogDir::haveDifferentContent("file_event",
+                                                     dir, "after",
+                                                     seconddir, "before"));
+        CPPUNIT_ASSERT(!LogDir::haveDifferentContent("file_event",
+                                                     dir, "before",
+                                                     seconddir, "after"));
+
+        vector<string> items = readDump(getLogData() + "/file_event.two");
+        CPPUNIT_ASSERT_EQUAL((size_t)2, items.size());
+        CPPUNIT_ASSERT(items == readDump(after));
+        CPPUNIT_ASSERT(items == readDump(secondBefore));
+        CPPUNIT_ASSERT(readDump(before) == readDump(secondAfter));
+
+        // unchanged data is shared with the previous session
+        bool linked = false;
+        ReadDir content(secondBefore);
+        BOOST_FOREACH(const string &name, content) {
+            struct stat buf;
+            string fullpath = secondBefore + "/" + name;
+            CPPUNIT_ASSERT(!stat(fullpath.c_str(), &buf));
+            if (buf.st_nlink > 1) {
+                linked = true;
+            }
+        }
+        CPPUNIT_ASSERT(linked);
+
+        // extracting restores the traditional format
+        BackupItemReader::extract(secondBefore, getLogData() + "/file_event.unpacked");
+        CPPUNIT_ASSERT(!BackupItemReader::isPack(getLogData() + "/file_event.unpacked"));
+        ReadDir unpacked(getLogData() + "/file_event.unpacked");
+        CPPUNIT_ASSERT_EQUAL(items.size(), (size_t)distance(unpacked.begin(), unpacked.end()));
+    }
+
     void testExpire() {
         ScopedEnvChange config("XDG_CONFIG_HOME", "LogDirTest/config");
         ScopedEnvChange cache("XDG_CACHE_HOME", "LogDirTest/cache");
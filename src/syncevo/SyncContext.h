@@ -651,6 +651,10 @@ class SyncContext : public SyncConfig {
     /**
      * generate XML configuration and (re)initialize engine with it
      *
+     * Engines without datastores and log dir are cached and get
+     * reused instead of parsing the same config again. The time
+     * needed for generating and parsing the config is logged.
+     *
      * @param isSync       the XML config will be used for the final engine used for syncing, not just logging
      */
     void initEngine(bool isSync);
@@ -539,6 +539,7 @@ namespace {
                                          "conflict_duplicated",
                                          "sent",
                                          "received",
+                                         "match_skipped",
                                          NULL };
 
     int toIndex(const char * const names[],
@@ -919,6 +920,16 @@ void SyncReport::prettyPrint(std::ostream &out, int flags) const
                 << "|\n";
         }
 
+        int total_skipped = source.getItemStat(SyncSourceReport::ITEM_REMOTE,
+                                               SyncSourceReport::ITEM_ANY,
+                                               SyncSourceReport::ITEM_MATCH_SKIPPED);
+        if (total_skipped) {
+            stringstream line;
+            line << total_skipped << " item comparison(s) avoided";
+            out << '|' << align(' ', line.str(), text_width, name_column)
+                << "|\n";
+        }
+
         if (source.m_backupBefore.isAvailable() ||
             source.m_backupAfter.isAvailable()) {
             std::stringstream backup;
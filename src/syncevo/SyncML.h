@@ -374,6 +374,7 @@ class SyncSourceReport {
         ITEM_CONFLICT_DUPLICATED, /**< conflicts resolved by duplicating item, ANY state, REMOTE */
         ITEM_SENT_BYTES,          /**< number of sent bytes, ANY, LOCAL */
         ITEM_RECEIVED_BYTES,      /**< number of received bytes, ANY, LOCAL */
+        ITEM_MATCH_SKIPPED,       /**< number of item comparisons avoided by slow sync match index, ANY state, REMOTE */
         ITEM_RESULT_MAX
     };
     static std::string ResultToString(ItemResult result);
@@ -27,6 +27,7 @@
 #include <syncevo/SyncContext.h>
 #include <syncevo/util.h>
 #include <syncevo/SuspendFlags.h>
+#include <syncevo/BackupPack.h>
 
 #include <syncevo/SynthesisEngine.h>
 #include <synthesis/SDK_util.h>
@@ -998,6 +999,18 @@ void ItemCache::init(const SyncSource::Operations::ConstBackupInfo &oldBackup,
     m_legacy = legacy;
     m_backup = newBackup;
     m_hash2counter.clear();
+    m_hash2location.clear();
+    m_oldPackChunks.clear();
+    m_pack = boost::iequals(getEnv("SYNCEVOLUTION_BACKUP_FORMAT", ""), "pack");
+    if (m_pack) {
+        // Must be different from the names of all packs that might
+        // get linked into the new backup: use session and backup
+        // directory names.
+        string session, backup;
+        splitPath(m_backup.m_dirname, session, backup);
+        m_packName = getBasename(session) + "-" + backup + ".pack";
+    }
+    startPack();
     m_dirname = oldBackup.m_dirname;
     if (m_dirname.empty() || !oldBackup.m_node) {
         return;
@@ -1007,16 +1020,46 @@ void ItemCache::init(const SyncSource::Operations::ConstBackupInfo &oldBackup,
     if (!oldBackup.m_node->getProperty("numitems", numitems)) {
         return;
     }
+    // Chunks in an old pack backup can be reused. Old backups with
+    // one file per item only provide hashes, which are not needed
+    // in pack mode.
+    bool reuseChunks = m_pack &&
+        oldBackup.m_node->readProperty("backupformat") == "pack";
     for (long counter = 1; counter <= numitems; counter++) {
         stringstream key;
         key << counter << m_hashSuffix;
         Hash_t hash;
         if (oldBackup.m_node->getProperty(key.str(), hash)) {
             m_hash2counter[hash] = counter;
+            if (reuseChunks) {
+                string location = oldBackup.m_node->readProperty(StringPrintf("%ld-chunk", counter));
+                if (!location.empty()) {
+                    m_hash2location[hash] = location;
+                }
+            }
+        }
+    }
+    if (reuseChunks) {
+        ConfigProps props;
+        oldBackup.m_node->readProperties(props);
+        BOOST_FOREACH (const StringPair &entry, props) {
+            if (boost::starts_with(entry.first, "pack-")) {
+                m_oldPackChunks[entry.first.substr(strlen("pack-"))] = atol(entry.second.c_str());
+            }
         }
     }
 }
 
+void ItemCache::startPack()
+{
+    m_newHash2location.clear();
+    m_locations.clear();
+    m_packWriter.reset();
+    if (m_pack) {
+        m_packWriter.reset(new BackupPackWriter(m_backup.m_dirname + "/" + m_packName));
+    }
+}
+
 void ItemCache::reset()
 {
     // clean directory and start counting at 1 again
@@ -1024,6 +1067,7 @@ void ItemCache::reset()
     rm_r(m_backup.m_dirname);
     mkdir_p(m_backup.m_dirname);
     m_backup.m_node->clear();
+    startPack();
 }
 
 string ItemCache::getFilename(Hash_t hash)
@@ -1049,11 +1093,42 @@ const char *ItemCache::m_hashSuffix =
 void ItemCache::backupItem(const std::string &item,
                            const std::string &uid,
                            const std::string &rev)
+{
+    ItemCache::Hash_t hash = hashFunc(item);
+    if (m_pack) {
+        backupItemPack(hash, item);
+    } else {
+        backupItemFile(hash, item);
+    }
+
+    stringstream key;
+    key << m_counter << "-uid";
+    m_backup.m_node->setProperty(key.str(), uid);
+    if (m_legacy) {
+        // clear() does not remove the existing content, which was
+        // intended here. This should have been key.str(""). As a
+        // result, keys for -rev are longer than intended because they
+        // start with the -uid part. We cannot change it now, because
+        // that would break compatibility with nodes that use the
+        // older, longer keys for -rev.
+        // key.clear();
+    } else {
+        key.str("");
+    }
+    key << m_counter << "-rev";
+    m_backup.m_node->setProperty(key.str(), rev);
+    key.str("");
+    key << m_counter << ItemCache::m_hashSuffix;
+    m_backup.m_node->setProperty(key.str(), hash);
+
+    m_counter++;
+}
+
+void ItemCache::backupItemFile(const Hash_t &hash, const std::string &item)
 {
     stringstream filename;
     filename << m_backup.m_dirname << "/" << m_counter;
 
-    ItemCache::Hash_t hash = hashFunc(item);
     string oldfilename = getFilename(hash);
     if (!oldfilename.empty()) {
         // found old file with same content, reuse it via hardlink
@@ -1077,32 +1152,116 @@ void ItemCache::backupItem(const std::string &item,
             SE_THROW(string("error writing ") + filename.str() + ": " + strerror(errno));
         }
     }
+}
 
-    stringstream key;
-    key << m_counter << "-uid";
-    m_backup.m_node->setProperty(key.str(), uid);
-    if (m_legacy) {
-        // clear() does not remove the existing content, which was
-        // intended here. This should have been key.str(""). As a
-        // result, keys for -rev are longer than intended because they
-        // start with the -uid part. We cannot change it now, because
-        // that would break compatibility with nodes that use the
-        // older, longer keys for -rev.
-        // key.clear();
+void ItemCache::backupItemPack(const Hash_t &hash, const std::string &item)
+{
+    string location;
+    std::map<Hash_t, string>::const_iterator it = m_newHash2location.find(hash);
+    if (it != m_newHash2location.end()) {
+        // same content already stored in the new backup
+        location = it->second;
     } else {
-        key.str("");
+        it = m_hash2location.find(hash);
+        if (it != m_hash2location.end()) {
+            // stored in old backup, finalizePack() decides whether
+            // the old pack gets linked or the chunk copied
+            location = it->second;
+        } else {
+            location = StringPrintf("%s:%lu", m_packName.c_str(),
+                                    (unsigned long)m_packWriter->append(item));
+        }
+        m_newHash2location[hash] = location;
     }
-    key << m_counter << "-rev";
-    m_backup.m_node->setProperty(key.str(), rev);
-    key.str("");
-    key << m_counter << ItemCache::m_hashSuffix;
-    m_backup.m_node->setProperty(key.str(), hash);
+    m_locations.push_back(location);
+}
 
-    m_counter++;
+void ItemCache::finalizePack()
+{
+    // Count how many different chunks of each old pack are still needed.
+    std::map<string, long> numChunks;
+    for (std::map<Hash_t, string>::const_iterator it = m_newHash2location.begin();
+         it != m_newHash2location.end();
+         ++it) {
+        string pack;
+        size_t offset;
+        BackupPackReader::parseLocation(it->second, pack, offset);
+        if (pack != m_packName) {
+            numChunks[pack]++;
+        }
+    }
+
+    // Link old packs which are still needed to a large extent, copy
+    // the chunks from the others. This keeps the number of packs and
+    // the amount of unused data in them bounded.
+    std::set<string> copy;
+    for (std::map<string, long>::const_iterator it = numChunks.begin();
+         it != numChunks.end();
+         ++it) {
+        const string &pack = it->first;
+        std::map<string, long>::const_iterator total = m_oldPackChunks.find(pack);
+        if (total == m_oldPackChunks.end() ||
+            it->second * 2 < total->second) {
+            copy.insert(pack);
+            continue;
+        }
+        string oldfilename = m_dirname + "/" + pack;
+        string newfilename = m_backup.m_dirname + "/" + pack;
+        if (link(oldfilename.c_str(), newfilename.c_str())) {
+            SE_LOG_DEBUG(NULL, "hard linking old %s new %s: %s",
+                         oldfilename.c_str(),
+                         newfilename.c_str(),
+                         strerror(errno));
+            copy.insert(pack);
+        } else {
+            m_backup.m_node->setProperty("pack-" + pack, total->second);
+        }
+    }
+
+    if (!copy.empty()) {
+        BackupPackReader reader(m_dirname);
+        std::map<string, string> copied;
+        string chunk;
+        BOOST_FOREACH (string &location, m_locations) {
+            string pack;
+            size_t offset;
+            BackupPackReader::parseLocation(location, pack, offset);
+            if (copy.find(pack) != copy.end()) {
+                std::map<string, string>::iterator it = copied.find(location);
+                if (it == copied.end()) {
+                    reader.readChunk(pack, offset, chunk);
+                    string newlocation = StringPrintf("%s:%lu", m_packName.c_str(),
+                                                      (unsigned long)m_packWriter->appendChunk(chunk));
+                    it = copied.insert(std::make_pair(location, newlocation)).first;
+                }
+                location = it->second;
+            }
+        }
+    }
+
+    m_packWriter->close();
+    long ownChunks = m_packWriter->getNumChunks();
+    m_packWriter.reset();
+    string packFilename = m_backup.m_dirname + "/" + m_packName;
+    if (ownChunks) {
+        m_backup.m_node->setProperty("pack-" + m_packName, ownChunks);
+    } else {
+        unlink(packFilename.c_str());
+    }
+
+    m_backup.m_node->setProperty("backupformat", "pack");
+    for (size_t i = 0; i < m_locations.size(); i++) {
+        stringstream key;
+        key << i + 1 << "-chunk";
+        m_backup.m_node->setProperty(key.str(), m_locations[i]);
+    }
 }
 
 void ItemCache::finalize(BackupReport &report)
 {
+    if (m_pack) {
+        finalizePack();
+    }
     stringstream value;
     value << m_counter - 1;
     m_backup.m_node->setProperty("numitems", value.str());
@@ -1176,6 +1335,7 @@ void SyncSourceRevisions::restoreData(const SyncSource::Operations::ConstBackupI
 {
     RevisionMap_t revisions;
     listAllItems(revisions);
+    BackupItemReader reader(oldBackup.m_dirname, oldBackup.m_node);
 
     long numitems;
     string strval;
@@ -1203,7 +1363,7 @@ void SyncSourceRevisions::restoreData(const SyncSource::Operations::ConstBackupI
             stringstream filename;
             filename << oldBackup.m_dirname << "/" << counter;
             string data;
-            if (!ReadFile(filename.str(), data)) {
+            if (!reader.readItem(counter, data)) {
                 throwError(SE_HERE, StringPrintf("restoring %s from %s failed: could not read file",
                                         uid.c_str(),
                                         filename.str().c_str()));
@@ -1571,7 +1731,13 @@ sysync::TSyError SyncSourceAdmin::saveAdminData(const char *adminData)
 bool SyncSourceAdmin::readNextMapItem(sysync::MapID mID, bool aFirst)
 {
     if (aFirst) {
-        resetMap();
+        // loadAdminData() has already read the map, no need
+        // to parse the node again
+        if (!m_mappingLoaded) {
+            resetMap();
+        } else {
+            m_mappingIterator = m_mapping.begin();
+        }
     }
     if (m_mappingIterator != m_mapping.end()) {
         entry2mapid(m_mappingIterator->first, m_mappingIterator->second, mID);
@@ -1598,6 +1764,7 @@ sysync::TSyError SyncSourceAdmin::insertMapItem(sysync::cMapID mID)
     }
 #else
     m_mapping[key] = value;
+    m_mappingChanged = true;
     return sysync::LOCERR_OK;
 #endif
 }
@@ -1612,7 +1779,10 @@ sysync::TSyError SyncSourceAdmin::updateMapItem(sysync::cMapID mID)
         // error, does not exist
         return sysync::DB_Forbidden;
     } else {
-        m_mapping[key] = value;
+        if (it->second != value) {
+            it->second = value;
+            m_mappingChanged = true;
+        }
         return sysync::LOCERR_OK;
     }
 }
@@ -1628,6 +1798,7 @@ sysync::TSyError SyncSourceAdmin::deleteMapItem(sysync::cMapID mID)
         return sysync::DB_Forbidden;
     } else {
         m_mapping.erase(it);
+        m_mappingChanged = true;
         return sysync::LOCERR_OK;
     }
 }
@@ -1635,10 +1806,14 @@ sysync::TSyError SyncSourceAdmin::deleteMapItem(sysync::cMapID mID)
 SyncMLStatus SyncSourceAdmin::flush()
 {
     m_configNode->flush();
-    if (m_mappingLoaded) {
+    // only rewrite the map when it really changed, an unchanged map
+    // of a large database would otherwise be serialized again
+    // at the end of each session
+    if (m_mappingLoaded && m_mappingChanged) {
         m_mappingNode->clear();
         m_mappingNode->writeProperties(m_mapping);
         m_mappingNode->flush();
+        m_mappingChanged = false;
     }
     return STATUS_OK;
 }
@@ -1649,6 +1824,7 @@ void SyncSourceAdmin::resetMap()
     m_mappingNode->readProperties(m_mapping);
     m_mappingIterator = m_mapping.begin();
     m_mappingLoaded = true;
+    m_mappingChanged = false;
 }
 
 
@@ -1697,6 +1873,7 @@ void SyncSourceAdmin::init(SyncSource::Operations &ops,
     m_adminPropertyName = adminPropertyName;
     m_mappingNode = mapping;
     m_mappingLoaded = false;
+    m_mappingChanged = false;
 
     ops.m_loadAdminData = boost::bind(&SyncSourceAdmin::loadAdminData,
                                       this, _1, _2, _3);
@@ -2609,10 +2609,16 @@ class SyncSourceSerialize : virtual public SyncSourceBase, virtual public SyncSo
     sysync::TSyError insertContinue(sysync::ItemID newID, const InsertItemResult::Continue_t &cont);
 };
 
+class BackupPackWriter;
+
 /**
  * Mapping from Hash() value to file.
  * Used by SyncSourceRevisions, but may be of use for
  * other backup implementations.
+ *
+ * With SYNCEVOLUTION_BACKUP_FORMAT=pack the item data is stored in
+ * pack files instead of one file per item, see BackupPack.h.
+ * BackupItemReader reads both formats.
  */
 class ItemCache
 {
@@ -2679,6 +2685,25 @@ private:
     SyncSource::Operations::BackupInfo m_backup;
     bool m_legacy;
     unsigned long m_counter;
+
+    /** write pack files instead of one file per item */
+    bool m_pack;
+    /** pack file of the new backup */
+    string m_packName;
+    boost::shared_ptr<BackupPackWriter> m_packWriter;
+    /** item locations ("<pack>:<offset>") of the old backup, if it used packs */
+    std::map<Hash_t, string> m_hash2location;
+    /** total number of chunks in the packs of the old backup */
+    std::map<string, long> m_oldPackChunks;
+    /** items stored in the new backup so far */
+    std::map<Hash_t, string> m_newHash2location;
+    /** location of each item in the new backup, index is counter - 1 */
+    std::vector<string> m_locations;
+
+    void startPack();
+    void backupItemFile(const Hash_t &hash, const std::string &item);
+    void backupItemPack(const Hash_t &hash, const std::string &item);
+    void finalizePack();
 };
 
 /**
@@ -2706,7 +2731,7 @@ private:
  *   Both can be arbitrary strings, but keeping them simple (printable
  *   ASCII, no white spaces, no equal sign) makes debugging simpler
  *   because they can be stored as they are as key/value pairs in the
- *   sync source's change tracking config node (the .other.ini files when
+ *   sync source's change tracking config node (the .other.bin files when
  *   using file-based configuration). More complex strings use escape
  *   sequences introduced with an exclamation mark for unsafe characters.
  *
@@ -2965,6 +2990,8 @@ class SyncSourceAdmin : public virtual SyncSourceBase
     std::string m_adminPropertyName;
     boost::shared_ptr<ConfigNode> m_mappingNode;
     bool m_mappingLoaded;
+    /** true if m_mapping was modified since it was read or written */
+    bool m_mappingChanged;
 
     ConfigProps m_mapping;
     ConfigProps::const_iterator m_mappingIterator;
@@ -118,6 +118,7 @@ class Cond
     ~Cond() { g_cond_clear(&m_cond); }
 
     void signal() { g_cond_signal(&m_cond); }
+    void broadcast() { g_cond_broadcast(&m_cond); }
     template<class M> void wait(M &m) { g_cond_wait(&m_cond, m); }
 };
 
@@ -149,6 +150,7 @@ class Cond
 {
  public:
     void signal() {}
+    void broadcast() {}
     template<class M> void wait(M &m) {}
 };
 
@@ -45,7 +45,7 @@ SE_BEGIN_CXX
  *   Both can be arbitrary strings, but keeping them simple (printable
  *   ASCII, no white spaces, no equal sign) makes debugging simpler
  *   because they can be stored as they are as key/value pairs in the
- *   sync source's change tracking config node (the .other.ini files when
+ *   sync source's change tracking config node (the .other.bin files when
  *   using file-based configuration). More complex strings use escape
  *   sequences introduced with an exclamation mark for unsafe characters.
  * - import/export/update single items
@@ -256,6 +256,7 @@ class TrackingSyncSource : public TestingSyncSource,
     /**
      * Stores meta information besides the item list:
      * - "databaseRevision" = result of databaseRevision() at end of last sync
+     * - additional properties of derived classes, see getMetaNode()
      *
      * Shares the same key/value store as m_trackingNode,
      * which uses the "item-" prefix in its keys to
@@ -264,6 +265,15 @@ class TrackingSyncSource : public TestingSyncSource,
     boost::shared_ptr<ConfigNode> m_metaNode;
 
  protected:
+    /**
+     * Derived classes may store additional information about the
+     * state of the item list here, for example a server-side sync
+     * token. Property names must not start with "item-" and must not
+     * be "databaseRevision". Flushed together with the item list at
+     * the end of a successful sync.
+     */
+    ConfigNode &getMetaNode() { return *m_metaNode; }
+
     /* implementations of SyncSource callbacks */
     virtual void beginSync(const std::string &lastToken, const std::string &resumeToken);
     virtual std::string endSync(bool success);
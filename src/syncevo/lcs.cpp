@@ -31,6 +31,7 @@
 #include <string>
 #include <utility>
 #include <sstream>
+#include <stdlib.h>
 
 #include <config.h>
 #include <syncevo/declarations.h>
@@ -102,6 +103,8 @@ make_enumerate_chunks(const std::string &keyword, IT out, C count)
 class LCSTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(LCSTest);
     CPPUNIT_TEST(lcs);
+    CPPUNIT_TEST(linear);
+    CPPUNIT_TEST(sorted);
     CPPUNIT_TEST_SUITE_END();
  
 public:
@@ -125,15 +128,99 @@ public:
                              out.str());
         CPPUNIT_ASSERT_EQUAL((size_t)3, result.size());
     }
+
+    void linear()
+    {
+        std::string a("xabcbdab"), b("ybdcabay");
+        std::vector< LCS::Entry<char> > full, linear;
+        LCS::lcs(a, b, std::back_inserter(full), LCS::accessor_sequence<std::string>());
+        LCS::lcs_linear(a, b, std::back_inserter(linear), LCS::accessor_sequence<std::string>());
+        CPPUNIT_ASSERT_EQUAL((size_t)4, full.size());
+        CPPUNIT_ASSERT_EQUAL(full.size(), linear.size());
+        for (size_t i = 0; i < linear.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL(a[linear[i].index_a - 1], b[linear[i].index_b - 1]);
+            CPPUNIT_ASSERT_EQUAL(a[linear[i].index_a - 1], linear[i].element);
+            if (i) {
+                CPPUNIT_ASSERT(linear[i - 1].index_a < linear[i].index_a);
+                CPPUNIT_ASSERT(linear[i - 1].index_b < linear[i].index_b);
+            }
+        }
+
+        linear.clear();
+        LCS::lcs_linear(std::string(""), b, std::back_inserter(linear), LCS::accessor_sequence<std::string>());
+        CPPUNIT_ASSERT(linear.empty());
+    }
+
+    void sorted()
+    {
+        static const int old[] = { 10, 20, 30, 50, 70 };
+        static const int now[] = { 10, 30, 40, 50, 60, 70, 80 };
+        std::vector<int> a(old, old + sizeof(old) / sizeof(old[0])),
+            b(now, now + sizeof(now) / sizeof(now[0]));
+        std::vector< LCS::Entry<int> > full, sorted;
+        LCS::lcs(a, b, std::back_inserter(full), LCS::accessor_sequence< std::vector<int> >());
+        LCS::lcs_sorted(a, b, std::back_inserter(sorted), LCS::accessor_sequence< std::vector<int> >());
+
+        std::ostringstream fullOut, sortedOut;
+        std::copy(full.begin(), full.end(), std::ostream_iterator< LCS::Entry<int> >(fullOut));
+        std::copy(sorted.begin(), sorted.end(), std::ostream_iterator< LCS::Entry<int> >(sortedOut));
+        CPPUNIT_ASSERT_EQUAL(std::string("1, 1: 10\n"
+                                         "3, 2: 30\n"
+                                         "4, 4: 50\n"
+                                         "5, 6: 70\n"),
+                             sortedOut.str());
+        CPPUNIT_ASSERT_EQUAL(fullOut.str(), sortedOut.str());
+    }
 };
 
 SYNCEVOLUTION_TEST_SUITE_REGISTRATION(LCSTest);
 
 #ifdef MAIN
+/**
+ * Compares run time of the different LCS implementations for two
+ * sorted sequences of n integers, each containing roughly 2/3
+ * of all numbers in 0 to 1.5 * n, like the old and new content of a
+ * FilteredView.
+ */
+static int benchmark(size_t n)
+{
+    std::vector<int> a, b;
+    for (int i = 0; a.size() < n || b.size() < n; i++) {
+        if (i % 3 != 0 && a.size() < n) {
+            a.push_back(i);
+        }
+        if (i % 3 != 1 && b.size() < n) {
+            b.push_back(i);
+        }
+    }
+
+    typedef std::vector< LCS::Entry<int> > result;
+    result full, linear, sorted;
+    Timespec start = Timespec::monotonic();
+    // Calls lcs_linear() when there are more than
+    // LCS_MAX_MATRIX pairs of entries.
+    LCS::lcs(a, b, std::back_inserter(full), LCS::accessor_sequence< std::vector<int> >());
+    Timespec afterFull = Timespec::monotonic();
+    LCS::lcs_linear(a, b, std::back_inserter(linear), LCS::accessor_sequence< std::vector<int> >());
+    Timespec afterLinear = Timespec::monotonic();
+    LCS::lcs_sorted(a, b, std::back_inserter(sorted), LCS::accessor_sequence< std::vector<int> >());
+    Timespec afterSorted = Timespec::monotonic();
+
+    std::cout << "n = " << n << ", LCS length " << sorted.size() << std::endl
+              << "lcs():        " << (afterFull - start).duration() << "s" << std::endl
+              << "lcs_linear(): " << (afterLinear - afterFull).duration() << "s" << std::endl
+              << "lcs_sorted(): " << (afterSorted - afterLinear).duration() << "s" << std::endl;
+    return full.size() == sorted.size() && linear.size() == sorted.size() ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
+    if (argc == 3 && std::string(argv[1]) == "--benchmark") {
+        return benchmark(atoi(argv[2]));
+    }
     if (argc != 3) {
-        std::cerr << "Usage: lcs file1 file2" << std::endl;
+        std::cerr << "Usage: lcs file1 file2" << std::endl
+                  << "       lcs --benchmark <number of entries>" << std::endl;
         return 1;
     }
 
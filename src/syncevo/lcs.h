@@ -110,6 +110,150 @@ public:
 };
 
 
+/**
+ * The full lcs() algorithm needs one Sub<C> per pair of entries.
+ * Beyond this number of pairs, lcs() falls back to lcs_linear(),
+ * which needs only O(n + m) memory but ignores the cost.
+ */
+static const size_t LCS_MAX_MATRIX = 4 * 1024 * 1024;
+
+/**
+ * Forward (reverse == false) or backward pass of Hirschberg's
+ * algorithm: calculates in row[k] the length of the LCS of
+ * a[aStart, aEnd[ and the first (forward) resp. last (backward) k
+ * entries of b[bStart, bEnd[.
+ */
+template <class T, class A>
+void lcs_row(const T &a, size_t aStart, size_t aEnd,
+             const T &b, size_t bStart, size_t bEnd,
+             bool reverse, A access,
+             std::vector<size_t> &row)
+{
+    size_t m = bEnd - bStart;
+    row.assign(m + 1, 0);
+    for (size_t i = 0; i < aEnd - aStart; i++) {
+        const typename A::F &entry = access.entry_at(a, reverse ? aEnd - 1 - i : aStart + i);
+        // row[k - 1] from the previous iteration
+        size_t diagonal = 0;
+        for (size_t k = 1; k <= m; k++) {
+            size_t above = row[k];
+            if (entry == access.entry_at(b, reverse ? bEnd - k : bStart + k - 1)) {
+                row[k] = diagonal + 1;
+            } else if (row[k - 1] > row[k]) {
+                row[k] = row[k - 1];
+            }
+            diagonal = above;
+        }
+    }
+}
+
+/**
+ * recursive part of lcs_linear(), stores pairs of 1-based
+ * indices like lcs()
+ */
+template <class T, class A>
+void lcs_linear_sub(const T &a, size_t aStart, size_t aEnd,
+                    const T &b, size_t bStart, size_t bEnd,
+                    A access,
+                    std::vector< std::pair<size_t, size_t> > &indices)
+{
+    // Common prefix and suffix are part of the LCS. Cheap
+    // to check and typical for real data.
+    while (aStart < aEnd && bStart < bEnd &&
+           access.entry_at(a, aStart) == access.entry_at(b, bStart)) {
+        indices.push_back(std::make_pair(aStart + 1, bStart + 1));
+        aStart++;
+        bStart++;
+    }
+    size_t suffix = 0;
+    while (aStart < aEnd - suffix && bStart < bEnd - suffix &&
+           access.entry_at(a, aEnd - suffix - 1) == access.entry_at(b, bEnd - suffix - 1)) {
+        suffix++;
+    }
+    aEnd -= suffix;
+    bEnd -= suffix;
+
+    if (aStart < aEnd && bStart < bEnd) {
+        if (aEnd - aStart == 1) {
+            for (size_t j = bStart; j < bEnd; j++) {
+                if (access.entry_at(a, aStart) == access.entry_at(b, j)) {
+                    indices.push_back(std::make_pair(aStart + 1, j + 1));
+                    break;
+                }
+            }
+        } else {
+            // split a in the middle, find the split point in b
+            // where both halves together have the longest LCS
+            size_t aMid = aStart + (aEnd - aStart) / 2;
+            size_t m = bEnd - bStart;
+            std::vector<size_t> front, back;
+            lcs_row(a, aStart, aMid, b, bStart, bEnd, false, access, front);
+            lcs_row(a, aMid, aEnd, b, bStart, bEnd, true, access, back);
+            size_t best = 0, bestLength = 0;
+            for (size_t k = 0; k <= m; k++) {
+                size_t length = front[k] + back[m - k];
+                if (length > bestLength) {
+                    best = k;
+                    bestLength = length;
+                }
+            }
+            // free memory before recursing
+            std::vector<size_t>().swap(front);
+            std::vector<size_t>().swap(back);
+            lcs_linear_sub(a, aStart, aMid, b, bStart, bStart + best, access, indices);
+            lcs_linear_sub(a, aMid, aEnd, b, bStart + best, bEnd, access, indices);
+        }
+    }
+
+    for (size_t i = 0; i < suffix; i++) {
+        indices.push_back(std::make_pair(aEnd + i + 1, bEnd + i + 1));
+    }
+}
+
+/**
+ * Calculates a longest common subsequence in O(n * m) time like
+ * lcs(), but only needs O(n + m) memory (Hirschberg's
+ * algorithm). Ignores the cost of gaps, so when more than one LCS
+ * exists, the result may be a different one than the one picked by
+ * lcs(). Output is in the same format as for lcs().
+ */
+template <class T, class ITO, class A>
+void lcs_linear(const T &a, const T &b, ITO out, A access)
+{
+    std::vector< std::pair<size_t, size_t> > indices;
+    lcs_linear_sub(a, 0, a.size(), b, 0, b.size(), access, indices);
+    for (size_t i = 0; i < indices.size(); i++) {
+        *out++ = Entry<typename A::F>(indices[i].first, indices[i].second, access.entry_at(a, indices[i].first - 1));
+    }
+}
+
+/**
+ * Calculates the longest common subsequence of two sequences whose
+ * entries are strictly increasing (for example, sorted indices
+ * without duplicates). In that case the LCS is simply the set of
+ * entries found in both sequences, which can be determined by
+ * merging the two sequences in O(n + m) time and without additional
+ * memory. Output is in the same format as for lcs().
+ */
+template <class T, class ITO, class A>
+void lcs_sorted(const T &a, const T &b, ITO out, A access)
+{
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        const typename A::F &entry_a = access.entry_at(a, i);
+        const typename A::F &entry_b = access.entry_at(b, j);
+        if (entry_a < entry_b) {
+            i++;
+        } else if (entry_b < entry_a) {
+            j++;
+        } else {
+            *out++ = Entry<typename A::F>(i + 1, j + 1, entry_a);
+            i++;
+            j++;
+        }
+    }
+}
+
 /**
  * Calculates the longest common subsequence (LCS) of two
  * sequences stored in vectors. The result specifies the common
@@ -147,10 +291,18 @@ public:
  * "substracting" the cost number at the beginning of the gap from the
  * cost number at the end. Both cost number and substraction are
  * template parameters.
+ *
+ * Indices in the output are 1-based. Very large inputs (more than
+ * LCS_MAX_MATRIX pairs of entries) are handed over to lcs_linear().
  */
 template <class T, class ITO, class A>
 void lcs(const T &a, const T &b, ITO out, A access)
 {
+    if (a.size() && b.size() > LCS_MAX_MATRIX / a.size()) {
+        lcs_linear(a, b, out, access);
+        return;
+    }
+
     // reserve two-dimensonal array for sub-problem solutions,
     // adding rows as we go
     typedef typename A::C C;
@@ -1855,8 +1855,7 @@ localstatus TPluginApiDS::apiSaveAdminData(bool aDataCommitted, bool aSessionFin
           if (sta!=LOCERR_OK) break;
         }
         // now remove it from the list, such that we don't try to delete it again
-        TMapContainer::iterator delpos=pos++; // that's the next to have a look at
-        fMapTable.erase(delpos); // remove it now
+        pos=eraseMapEntry(pos); // that's the next to have a look at
         continue; // pos is already updated
       } // deleted
       else if ((*pos).added) {
@@ -2029,8 +2028,9 @@ localstatus TPluginApiDS::apiSaveAdminData(bool aDataCommitted, bool aSessionFin
 ///                         only be saved if derived datastore cannot work with timestamps and has its own identifier.
 ///   - fMapTable         = list<TMapEntry> containing map entries. The implementation must load all map entries
 ///                         related to the current sync target identified by the triple of (aDeviceID,aDatabaseID,aRemoteDBID)
-///                         or by fTargetKey. The entries added to fMapTable must have "changed", "added" and "deleted" flags
-///                         set to false.
+///                         or by fTargetKey. Entries must be added with addMapEntry(), not directly to fMapTable,
+///                         so that the localID/remoteID indexes stay in sync. They must have "changed", "added" and
+///                         "deleted" flags set to false.
 ///   For resumable datastores (fConfigP->fResumeSupport==true):
 ///   - fMapTable         = In addition to the above, the markforresume flag must be saved in the mapflags
 //                          when it is not equal to the savedmark flag - independently of added/deleted/changed.
@@ -2314,7 +2314,7 @@ localstatus TPluginApiDS::apiLoadAdminData(
   };
   // then read maps
   bool firstEntry=true;
-  fMapTable.clear();
+  clearMapTable();
   TDB_Api_MapID mapid;
   TMapEntry mapEntry;
   while (fDBApi_Admin.ReadNextMapItem(mapid, firstEntry)) {
@@ -2349,7 +2349,7 @@ localstatus TPluginApiDS::apiLoadAdminData(
     // next save if needed
     mapEntry.deleted = mapEntry.entrytype!=mapentry_normal; // only normal ones may be saved as existing in the main map
     // save to main map list anyway to allow differential updates to map table (instead of writing everything all the time)
-    fMapTable.push_back(mapEntry);
+    addMapEntry(mapEntry);
     // now save special maps to extra lists according to type
     // Note: in the main map, these are marked deleted. Before the next saveAdminData, these will
     //       be re-added (=re-activated) from the extra lists if they still exist.
@@ -3059,8 +3059,7 @@ localstatus TODBCApiDS::updateODBCMap(SQLHSTMT aStatement, bool aSessionFinished
             IssueMapSQL(aStatement,fConfigP->fMapDeleteSQL,"deleting a map entry",(*pos).entrytype,(*pos).localid.c_str(),NULL,newmapflags);
           }
           // now remove it from the list, such that we don't try to delete it again
-          TMapContainer::iterator delpos=pos++; // that's the next to have a look at
-          fMapTable.erase(delpos); // remove it now
+          pos=eraseMapEntry(pos); // that's the next to have a look at
           continue; // pos is already updated
         } // deleted
         else if ((*pos).added) {
@@ -4148,7 +4147,7 @@ localstatus TODBCApiDS::apiLoadAdminData(
             // next save if needed
             entry.deleted = entry.entrytype!=mapentry_normal; // only normal ones may be saved as existing in the main map
             // save to main map list anyway to allow differential SQL updates to map table (instead of writing everything all the time)
-            fMapTable.push_back(entry);
+            addMapEntry(entry);
             // now save special maps to extra lists according to type
             // Note: in the main map, these are marked deleted. Before the next saveAdminData, these will
             //       be re-added (=re-activated) from the extra lists if they still exist.
@@ -360,8 +360,9 @@ public:
   ///                         if derived datastore cannot work with timestamps and has its own identifier.
   ///   - fMapTable         = list<TMapEntry> containing map entries. The implementation must load all map entries
   ///                         related to the current sync target identified by the triple of (aDeviceID,aDatabaseID,aRemoteDBID)
-  ///                         or by fTargetKey. The entries added to fMapTable must have "changed", "added" and "deleted" flags
-  ///                         set to false.
+  ///                         or by fTargetKey. Entries must be added with addMapEntry(), not directly to fMapTable,
+  ///                         so that the localID/remoteID indexes stay in sync. They must have "changed", "added" and
+  ///                         "deleted" flags set to false.
   ///   For resumable datastores:
   ///   - fMapTable         = In addition to the above, the markforresume flag must be saved in the mapflags
   //                          when it is not equal to the savedmark flag - independently of added/deleted/changed.
@@ -216,6 +216,7 @@ void finalizeSystemZoneDefinitions(GZones* aGZones)
         t.name = t.location;
       }
       aGZones->tzP.push_back(t);
+      aGZones->ResetRulesCache();
     }
     ICAL_FREE(vtimezone);
   }
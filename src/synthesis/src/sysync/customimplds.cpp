@@ -993,7 +993,7 @@ void TCustomImplDS::InternalResetDataStore(void)
   fGetPhase=gph_done; // must be initialized first by startDataRead
   fGetPhasePrepared=false;
   // Clear map table and sync set lists
-  fMapTable.clear();
+  clearMapTable();
   #endif // BINFILE_ALWAYS_ACTIVE
   #ifdef BASED_ON_BINFILE_CLIENT
   fSyncSetLoaded=false;
@@ -1141,14 +1141,75 @@ bool TCustomImplDS::deleteAllMaps(void)
 } // TCustomImplDS::deleteAllMaps
 
 
+// add entry to map table and its indexes
+TMapContainer::iterator TCustomImplDS::addMapEntry(const TMapEntry &aEntry, bool aAtFront)
+{
+  TMapContainer::iterator pos;
+  if (aAtFront) {
+    fMapTable.push_front(aEntry);
+    pos=fMapTable.begin();
+  }
+  else {
+    pos=fMapTable.insert(fMapTable.end(),aEntry);
+  }
+  fMapByLocalID.insert(TMapIndex::value_type((*pos).localid,pos));
+  fMapByRemoteID.insert(TMapIndex::value_type((*pos).remoteid,pos));
+  return pos;
+} // TCustomImplDS::addMapEntry
+
+
+// helper to remove a map table entry from one of the indexes
+static void removeFromMapIndex(TMapIndex &aIndex, const string &aKey, TMapContainer::iterator aPos)
+{
+  pair<TMapIndex::iterator,TMapIndex::iterator> range = aIndex.equal_range(aKey);
+  for (TMapIndex::iterator ipos=range.first; ipos!=range.second; ++ipos) {
+    if (ipos->second==aPos) {
+      aIndex.erase(ipos);
+      return;
+    }
+  }
+} // removeFromMapIndex
+
+
+// remove entry from map table and its indexes
+TMapContainer::iterator TCustomImplDS::eraseMapEntry(TMapContainer::iterator aPos)
+{
+  removeFromMapIndex(fMapByLocalID,(*aPos).localid,aPos);
+  removeFromMapIndex(fMapByRemoteID,(*aPos).remoteid,aPos);
+  return fMapTable.erase(aPos);
+} // TCustomImplDS::eraseMapEntry
+
+
+// change remoteID of a map table entry
+void TCustomImplDS::setMapRemoteID(TMapContainer::iterator aPos, const string &aRemoteID)
+{
+  if ((*aPos).remoteid==aRemoteID) return; // no change
+  removeFromMapIndex(fMapByRemoteID,(*aPos).remoteid,aPos);
+  (*aPos).remoteid=aRemoteID;
+  fMapByRemoteID.insert(TMapIndex::value_type((*aPos).remoteid,aPos));
+} // TCustomImplDS::setMapRemoteID
+
+
+// empty map table and its indexes
+void TCustomImplDS::clearMapTable(void)
+{
+  fMapByLocalID.clear();
+  fMapByRemoteID.clear();
+  fMapTable.clear();
+} // TCustomImplDS::clearMapTable
+
+
 // find non-deleted map entry by local ID/maptype
+// Note: localID/entrytype is unique among map entries created by modifyMap(). Should a
+//       loaded map table contain duplicates, the earliest added one is found.
 TMapContainer::iterator TCustomImplDS::findMapByLocalID(const char *aLocalID,TMapEntryType aEntryType, bool aDeletedAsWell)
 {
-  TMapContainer::iterator pos;
   if (aLocalID) {
-    for (pos=fMapTable.begin();pos!=fMapTable.end();pos++) {
+    pair<TMapIndex::iterator,TMapIndex::iterator> range = fMapByLocalID.equal_range(aLocalID);
+    for (TMapIndex::iterator ipos=range.first; ipos!=range.second; ++ipos) {
+      TMapContainer::iterator pos = ipos->second;
       if (
-        (*pos).localid==aLocalID && (*pos).entrytype==aEntryType
+        (*pos).entrytype==aEntryType
         // && !(*pos).remoteid.empty() // Note: was ok in old versions, but now we can have map entries from resume with empty localID
         && (aDeletedAsWell || !(*pos).deleted) // if selected, don't show deleted entries
       ) {
@@ -1164,11 +1225,12 @@ TMapContainer::iterator TCustomImplDS::findMapByLocalID(const char *aLocalID,TMa
 // find map entry by remote ID
 TMapContainer::iterator TCustomImplDS::findMapByRemoteID(const char *aRemoteID)
 {
-  TMapContainer::iterator pos;
   if (aRemoteID) {
-    for (pos=fMapTable.begin();pos!=fMapTable.end();pos++) {
+    pair<TMapIndex::iterator,TMapIndex::iterator> range = fMapByRemoteID.equal_range(aRemoteID);
+    for (TMapIndex::iterator ipos=range.first; ipos!=range.second; ++ipos) {
+      TMapContainer::iterator pos = ipos->second;
       if (
-        (*pos).remoteid==aRemoteID && (*pos).entrytype == mapentry_normal && !(*pos).deleted // only plain normal non-deleted maps (no tempid or mapforresume)
+        (*pos).entrytype == mapentry_normal && !(*pos).deleted // only plain normal non-deleted maps (no tempid or mapforresume)
       ) {
         // found
         return pos;
@@ -1229,24 +1291,19 @@ void TCustomImplDS::modifyMap(TMapEntryType aEntryType, const char *aLocalID, co
   ));
   // - if there is a localID, search map entry (even if it is deleted)
   if (aLocalID && *aLocalID!=0) {
-    for (pos=fMapTable.begin();pos!=fMapTable.end();pos++) {
-      if (
-        // localID and entrytype matches
-        (*pos).localid==aLocalID && (*pos).entrytype==aEntryType
-      ) {
-        PDEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,(
-          "- found entry by entrytype/localID='%s' - remoteid='%s', mapflags=0x%lX, changed=%d, deleted=%d, added=%d, markforresume=%d, savedmark=%d",
-          aLocalID,
-          (*pos).remoteid.c_str(),
-          (long)(*pos).mapflags,
-          (int)(*pos).changed,
-          (int)(*pos).deleted,
-          (int)(*pos).added,
-          (int)(*pos).markforresume,
-          (int)(*pos).savedmark
-        ));
-        break;
-      }
+    pos=findMapByLocalID(aLocalID,aEntryType,true);
+    if (pos!=fMapTable.end()) {
+      PDEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,(
+        "- found entry by entrytype/localID='%s' - remoteid='%s', mapflags=0x%lX, changed=%d, deleted=%d, added=%d, markforresume=%d, savedmark=%d",
+        aLocalID,
+        (*pos).remoteid.c_str(),
+        (long)(*pos).mapflags,
+        (int)(*pos).changed,
+        (int)(*pos).deleted,
+        (int)(*pos).added,
+        (int)(*pos).markforresume,
+        (int)(*pos).savedmark
+      ));
     }
   }
   else aLocalID=NULL;
@@ -1279,7 +1336,7 @@ void TCustomImplDS::modifyMap(TMapEntryType aEntryType, const char *aLocalID, co
       // has been added in this session and not yet saved
       // so it does not yet exist in the DB at all
       // - simply forget entry
-      fMapTable.erase(pos);
+      eraseMapEntry(pos);
       // - done, ok
       return;
     }
@@ -1303,8 +1360,7 @@ void TCustomImplDS::modifyMap(TMapEntryType aEntryType, const char *aLocalID, co
       entry.savedmark=false;
       entry.markforresume=false;
       entry.mapflags=0; // none set by default
-      fMapTable.push_front(entry);
-      pos=fMapTable.begin(); // first entry is new entry
+      pos=addMapEntry(entry,true); // first entry is new entry
     }
     else {
       PDEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,(
@@ -1323,7 +1379,7 @@ void TCustomImplDS::modifyMap(TMapEntryType aEntryType, const char *aLocalID, co
       ) {
         // new RemoteID (but not NULL = keep existing) or different mapflags were passed -> this is a real change
         if (aRemoteID)
-          (*pos).remoteid=aRemoteID;
+          setMapRemoteID(pos,aRemoteID);
         (*pos).changed=true; // really changed compared to what is already in DB
       }
     }
@@ -1334,24 +1390,30 @@ void TCustomImplDS::modifyMap(TMapEntryType aEntryType, const char *aLocalID, co
     // now remove all other items with same remoteID (except if we have no or empty remoteID)
     if (aEntryType==mapentry_normal && aRemoteID && *aRemoteID) {
       // %%% note: this is strictly necessary only for add, but cleans up for update
-      TMapContainer::iterator pos2;
-      for (pos2=fMapTable.begin();pos2!=fMapTable.end();pos2++) {
-        if (pos2!=pos && (*pos2).remoteid==aRemoteID && (*pos2).entrytype==aEntryType) {
-          // found another one with same remoteID/entrytype
-          PDEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,(
-            "- cleanup: removing same remoteID from other entry with localid='%s', mapflags=0x%lX, changed=%d, deleted=%d, added=%d, markforresume=%d, savedmark=%d",
-            (*pos2).localid.c_str(),
-            (long)(*pos2).mapflags,
-            (int)(*pos2).changed,
-            (int)(*pos2).deleted,
-            (int)(*pos2).added,
-            (int)(*pos2).markforresume,
-            (int)(*pos2).savedmark
-          ));
-          // this remoteID is invalid for sure as we just have assigned it to another item - remove it
-          (*pos2).remoteid.erase();
-          (*pos2).changed=true; // make sure it gets saved
-        }
+      // - collect first, as removing the remoteID modifies the index
+      list<TMapContainer::iterator> others;
+      pair<TMapIndex::iterator,TMapIndex::iterator> range = fMapByRemoteID.equal_range(aRemoteID);
+      for (TMapIndex::iterator ipos=range.first; ipos!=range.second; ++ipos) {
+        if (ipos->second!=pos && (*(ipos->second)).entrytype==aEntryType)
+          others.push_back(ipos->second);
+      }
+      list<TMapContainer::iterator>::iterator opos;
+      for (opos=others.begin();opos!=others.end();opos++) {
+        TMapContainer::iterator pos2 = *opos;
+        // found another one with same remoteID/entrytype
+        PDEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,(
+          "- cleanup: removing same remoteID from other entry with localid='%s', mapflags=0x%lX, changed=%d, deleted=%d, added=%d, markforresume=%d, savedmark=%d",
+          (*pos2).localid.c_str(),
+          (long)(*pos2).mapflags,
+          (int)(*pos2).changed,
+          (int)(*pos2).deleted,
+          (int)(*pos2).added,
+          (int)(*pos2).markforresume,
+          (int)(*pos2).savedmark
+        ));
+        // this remoteID is invalid for sure as we just have assigned it to another item - remove it
+        setMapRemoteID(pos2,"");
+        (*pos2).changed=true; // make sure it gets saved
       }
     }
   } // modify or add
@@ -1536,7 +1598,7 @@ localstatus TCustomImplDS::implMakeAdminReady(
   fCurrentSyncIdentifier.erase();
 
   #ifndef BINFILE_ALWAYS_ACTIVE
-  fMapTable.clear(); // map is empty to begin with
+  clearMapTable(); // map is empty to begin with
   #endif
   // now get admin data
   SYSYNC_TRY {
@@ -1872,13 +1934,13 @@ void TCustomImplDS::implMarkOnlyUngeneratedForResume(void)
           entry.deleted=false;
           entry.markforresume=true;
           entry.savedmark=false;
-          fMapTable.push_back(entry);
+          addMapEntry(entry);
         }
         else {
           // add flag to existing map item
           if ((*pos).deleted) {
             // undelete (re-use existing, but currently invalid entry)
-            (*pos).remoteid.erase();
+            setMapRemoteID(pos,"");
             (*pos).changed=true;
             (*pos).deleted=false;
             (*pos).mapflags=0;
@@ -2022,7 +2084,7 @@ void TCustomImplDS::implMarkItemForResume(cAppCharP aLocalID, cAppCharP aRemoteI
     // we have an entry for this item, mark it for resume
     if ((*pos).deleted) {
       // undelete (re-use existing, but currently invalid entry)
-      (*pos).remoteid.erase();
+      setMapRemoteID(pos,"");
       (*pos).changed=true;
       (*pos).deleted=false;
       (*pos).mapflags=0;
@@ -2083,7 +2145,7 @@ void TCustomImplDS::implMarkItemForResume(cAppCharP aLocalID, cAppCharP aRemoteI
     entry.deleted=false;
     entry.markforresume=true;
     entry.savedmark=false;
-    fMapTable.push_back(entry);
+    addMapEntry(entry);
   }
 } // TCustomImplDS::implMarkItemForResume
 
@@ -3181,8 +3243,7 @@ localstatus TCustomImplDS::SaveAdminData(bool aSessionFinished, bool aSuccessful
           DEBUGPRINTFX(DBG_ADMIN+DBG_EXOTIC,("LocalID='%s' has no remoteID - cannot be stored in non-DS-1.2 Map DB -> removed map",(*pos).localid.c_str()));
           if ((*pos).added) {
             // was never added to DB, so no need to delete it in DB either - just forget it
-            TMapContainer::iterator delpos=pos++;
-            fMapTable.erase(delpos);
+            pos=eraseMapEntry(pos);
             continue;
           }
           else {
@@ -3209,8 +3270,7 @@ localstatus TCustomImplDS::SaveAdminData(bool aSessionFinished, bool aSuccessful
           // if not mapped, this will be a re-add in the next session, so forget it for now
           if ((*pos).added) {
             // was never added to DB, so no need to delete it in DB either - just forget it
-            TMapContainer::iterator delpos=pos++;
-            fMapTable.erase(delpos);
+            pos=eraseMapEntry(pos);
             continue;
           }
           else {
@@ -3324,7 +3384,7 @@ localstatus TCustomImplDS::implSaveEndOfSession(bool aUpdateAnchors)
     // save admin data myself now
     sta=SaveAdminData(true,aUpdateAnchors); // end of session
     // we can foget the maps now
-    fMapTable.clear();
+    clearMapTable();
   }
   PDEBUGENDBLOCK("SaveEndOfSession");
   return sta;
@@ -312,6 +312,9 @@ typedef struct {
 // container for map entries
 typedef list<TMapEntry> TMapContainer;
 
+// index into map entries container by localID or remoteID
+typedef std::multimap<string,TMapContainer::iterator> TMapIndex;
+
 #endif // BINFILE_ALWAYS_ACTIVE
 
 
@@ -428,8 +431,9 @@ public:
   ///                         if derived datastore cannot work with timestamps and has its own identifier.
   ///   - fMapTable         = list<TMapEntry> containing map entries. The implementation must load all map entries
   ///                         related to the current sync target identified by the triple of (aDeviceID,aDatabaseID,aRemoteDBID)
-  ///                         or by fTargetKey. The entries added to fMapTable must have "changed", "added" and "deleted" flags
-  ///                         set to false.
+  ///                         or by fTargetKey. Entries must be added with addMapEntry(), not directly to fMapTable,
+  ///                         so that the localID/remoteID indexes stay in sync. They must have "changed", "added" and
+  ///                         "deleted" flags set to false.
   ///   For resumable datastores:
   ///   - fMapTable         = In addition to the above, the markforresume flag must be saved in the mapflags
   //                          when it is not equal to the savedmark flag - independently of added/deleted/changed.
@@ -792,6 +796,12 @@ protected:
   TMapContainer::iterator findMapByRemoteID(const char *aRemoteID);
   // - modify map, if remoteID or localID is NULL or empty, map item will be deleted (if it exists at all)
   void modifyMap(TMapEntryType aEntryType, const char *aLocalID, const char *aRemoteID, uInt32 aMapFlags, bool aDelete, uInt32 aClearFlags=0xFFFFFFFF);
+  // - map table maintenance. Entries must only be added, removed or get their remoteID changed
+  //   using these, such that the localID/remoteID indexes remain in sync with fMapTable
+  TMapContainer::iterator addMapEntry(const TMapEntry &aEntry, bool aAtFront=false);
+  TMapContainer::iterator eraseMapEntry(TMapContainer::iterator aPos); // returns iterator to next entry
+  void setMapRemoteID(TMapContainer::iterator aPos, const string &aRemoteID);
+  void clearMapTable(void);
   #endif // not BINFILE_ALWAYS_ACTIVE
   #ifdef SYSYNC_SERVER
   // - called when a item in the sync set changes its localID (due to local DB internals)
@@ -811,6 +821,9 @@ protected:
   #ifndef BINFILE_ALWAYS_ACTIVE
   // local map list
   TMapContainer fMapTable;
+  // - indexes into fMapTable (all entries, including deleted ones)
+  TMapIndex fMapByLocalID;
+  TMapIndex fMapByRemoteID;
   // - iterator for reporting deleted items in GetItem
   TMapContainer::iterator fDeleteMapPos;
   bool fReportDeleted;
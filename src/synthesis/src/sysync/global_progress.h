@@ -49,7 +49,7 @@ typedef enum {
   pev_dsstats_l, // datastore statistics for local (extra1=# added, extra2=# updated, extra3=# deleted)
   pev_dsstats_r, // datastore statistics for remote (extra1=# added, extra2=# updated, extra3=# deleted)
   pev_dsstats_e, // datastore statistics for local/remote rejects (extra1=# locally rejected, extra2=# remotely rejected)
-  pev_dsstats_s, // datastore statistics for server slowsync (extra1=# slowsync matches)
+  pev_dsstats_s, // datastore statistics for server slowsync (extra1=# slowsync matches, extra2=# compares avoided by match index)
   pev_dsstats_c, // datastore statistics for server conflicts (extra1=# server won, extra2=# client won, extra3=# duplicated)
   pev_dsstats_d, // datastore statistics for data volume (extra1=outgoing bytes, extra2=incoming bytes)
   // number of enums
@@ -57,11 +57,151 @@ const TPropDataTypes devInfPropTypes[numFieldTypes] = {
 
 
 
+/*
+ * Implementation of TFieldArena
+ */
+
+// size of the first block, each further block is twice as large as the previous one
+#define FIELDARENA_FIRSTBLOCKSIZE 256
+// maximum size of newly allocated blocks (fields larger than a quarter of that get their own block)
+#define FIELDARENA_BLOCKSIZE 4096
+
+// all field memory starts with this header, which also defines the alignment
+union TFieldHeader {
+  TFieldArena *arenaP; // NULL if allocated on the normal heap
+  double dAlign;
+  sInt64 iAlign;
+};
+
+static size_t fieldArenaAlign(size_t aSize)
+{
+  return (aSize+sizeof(TFieldHeader)-1) / sizeof(TFieldHeader) * sizeof(TFieldHeader);
+} // fieldArenaAlign
+
+
+TFieldArena::TFieldArena() :
+  fBlocksP(NULL),
+  fNextBlockSize(FIELDARENA_FIRSTBLOCKSIZE)
+{
+  for (int i=0; i<numFreeLists; i++) {
+    fFreeLists[i].size=0;
+    fFreeLists[i].headP=NULL;
+  }
+} // TFieldArena::TFieldArena
+
+
+TFieldArena::~TFieldArena()
+{
+  // release all blocks at once
+  while (fBlocksP) {
+    TBlock *blockP = fBlocksP;
+    fBlocksP = blockP->nextP;
+    ::operator delete(blockP);
+  }
+} // TFieldArena::~TFieldArena
+
+
+void *TFieldArena::allocate(size_t aSize)
+{
+  aSize = fieldArenaAlign(aSize);
+  // recycle memory of a deleted field of the same size
+  for (int i=0; i<numFreeLists; i++) {
+    if (fFreeLists[i].size==aSize && fFreeLists[i].headP) {
+      void *p = fFreeLists[i].headP;
+      fFreeLists[i].headP = *static_cast<void **>(p);
+      return p;
+    }
+  }
+  // carve from current block
+  if (!fBlocksP || fBlocksP->size-fBlocksP->used < aSize) {
+    bool dedicated = aSize>FIELDARENA_BLOCKSIZE/4;
+    size_t blocksize = aSize;
+    if (!dedicated) {
+      // start small so that items with few fields do not waste a large block,
+      // then grow so that items with many fields need only a few blocks
+      while (fNextBlockSize<aSize) fNextBlockSize*=2;
+      blocksize = fNextBlockSize;
+      if (fNextBlockSize<FIELDARENA_BLOCKSIZE) fNextBlockSize*=2;
+    }
+    TBlock *blockP = static_cast<TBlock *>(::operator new(fieldArenaAlign(sizeof(TBlock))+blocksize));
+    blockP->size = blocksize;
+    if (dedicated && fBlocksP) {
+      // dedicated block for a large field, keep filling the current block
+      blockP->nextP = fBlocksP->nextP;
+      fBlocksP->nextP = blockP;
+    }
+    else {
+      blockP->nextP = fBlocksP;
+      fBlocksP = blockP;
+    }
+    blockP->used = aSize;
+    return reinterpret_cast<uInt8 *>(blockP)+fieldArenaAlign(sizeof(TBlock));
+  }
+  void *p = reinterpret_cast<uInt8 *>(fBlocksP)+fieldArenaAlign(sizeof(TBlock))+fBlocksP->used;
+  fBlocksP->used += aSize;
+  return p;
+} // TFieldArena::allocate
+
+
+void TFieldArena::release(void *aPtr, size_t aSize)
+{
+  aSize = fieldArenaAlign(aSize);
+  // put into free list for that size, or use a new list
+  for (int i=0; i<numFreeLists; i++) {
+    if (fFreeLists[i].size==aSize || fFreeLists[i].size==0) {
+      fFreeLists[i].size = aSize;
+      *static_cast<void **>(aPtr) = fFreeLists[i].headP;
+      fFreeLists[i].headP = aPtr;
+      return;
+    }
+  }
+  // too many different sizes, memory will be released with the arena
+} // TFieldArena::release
+
+
+/* end of TFieldArena implementation */
+
+
 /*
  * Implementation of TItemField
  */
 
 
+void *TItemField::operator new(size_t aSize)
+{
+  return operator new(aSize,(TFieldArena *)NULL);
+} // TItemField::operator new
+
+
+void *TItemField::operator new(size_t aSize, TFieldArena *aArenaP)
+{
+  size_t total = aSize+sizeof(TFieldHeader);
+  TFieldHeader *hdrP = static_cast<TFieldHeader *>(aArenaP ? aArenaP->allocate(total) : ::operator new(total));
+  hdrP->arenaP = aArenaP;
+  return hdrP+1;
+} // TItemField::operator new
+
+
+void TItemField::operator delete(void *aPtr, size_t aSize)
+{
+  if (!aPtr) return;
+  TFieldHeader *hdrP = static_cast<TFieldHeader *>(aPtr)-1;
+  if (hdrP->arenaP)
+    hdrP->arenaP->release(hdrP,aSize+sizeof(TFieldHeader));
+  else
+    ::operator delete(hdrP);
+} // TItemField::operator delete
+
+
+// only used when a constructor throws
+void TItemField::operator delete(void *aPtr, TFieldArena *aArenaP)
+{
+  // arena memory is released with the arena
+  if (aPtr && !aArenaP)
+    ::operator delete(static_cast<TFieldHeader *>(aPtr)-1);
+} // TItemField::operator delete
+
+
 TItemField::TItemField() :
   fAssigned(false) // unassigned at creation
 {
@@ -246,12 +386,13 @@ size_t TItemField::writeStream(void *aBuffer, size_t aNumBytes)
 
 
 // constructor
-TArrayField::TArrayField(TItemFieldTypes aLeafFieldType, GZones *aGZonesP)
+TArrayField::TArrayField(TItemFieldTypes aLeafFieldType, GZones *aGZonesP, TFieldArena *aArenaP)
 {
   fLeafFieldType=aLeafFieldType;
   fGZonesP = aGZonesP;
+  fArenaP = aArenaP;
   // field for index==0 always exists
-  fFirstField = newItemField(fLeafFieldType,fGZonesP,false);
+  fFirstField = newItemField(fLeafFieldType,fGZonesP,false,fArenaP);
 } // TArrayField::TArrayField
 
 
@@ -302,7 +443,7 @@ TItemField *TArrayField::getArrayField(sInt16 aArrIdx, bool aExistingOnly)
       if (aArrIdx==0)
         fldP = fFirstField;
       else
-        fldP = newItemField(fLeafFieldType,fGZonesP,false);
+        fldP = newItemField(fLeafFieldType,fGZonesP,false,fArenaP);
       fArray[aArrIdx]=fldP;
     }
   }
@@ -320,7 +461,7 @@ TItemField *TArrayField::getArrayField(sInt16 aArrIdx, bool aExistingOnly)
     if (aArrIdx==0)
       fldP = fFirstField;
     else
-      fldP = newItemField(fLeafFieldType,fGZonesP,false);
+      fldP = newItemField(fLeafFieldType,fGZonesP,false,fArenaP);
     fArray[aArrIdx]=fldP;
   }
   // return field
@@ -1803,25 +1944,25 @@ void TIntegerField::getAsString(string &aString)
 
 
 // factory function
-TItemField *newItemField(const TItemFieldTypes aType, GZones *aGZonesP, bool aAsArray)
+TItemField *newItemField(const TItemFieldTypes aType, GZones *aGZonesP, bool aAsArray, TFieldArena *aArenaP)
 {
   #ifdef ARRAYFIELD_SUPPORT
   if (aAsArray) {
-    return new TArrayField(aType,aGZonesP);
+    return new (aArenaP) TArrayField(aType,aGZonesP,aArenaP);
   }
   else
   #endif
   {
     switch (aType) {
-      case fty_string: return new TStringField;
-      case fty_telephone: return new TTelephoneField;
-      case fty_integer: return new TIntegerField;
-      case fty_timestamp: return new TTimestampField(aGZonesP);
-      case fty_date: return new TDateField(aGZonesP);
-      case fty_url: return new TURLField;
-      case fty_multiline: return new TMultilineField;
-      case fty_blob: return new TBlobField;
-      case fty_none: return new TItemField; // base class, can represent EMPTY and UNASSIGNED
+      case fty_string: return new (aArenaP) TStringField;
+      case fty_telephone: return new (aArenaP) TTelephoneField;
+      case fty_integer: return new (aArenaP) TIntegerField;
+      case fty_timestamp: return new (aArenaP) TTimestampField(aGZonesP);
+      case fty_date: return new (aArenaP) TDateField(aGZonesP);
+      case fty_url: return new (aArenaP) TURLField;
+      case fty_multiline: return new (aArenaP) TMultilineField;
+      case fty_blob: return new (aArenaP) TBlobField;
+      case fty_none: return new (aArenaP) TItemField; // base class, can represent EMPTY and UNASSIGNED
       default: return NULL;
     }
   }
@@ -2210,6 +2351,101 @@ TSyError TItemFieldKey::SetValueInternal(
 #endif // ENGINEINTERFACE_SUPPORT
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+
+// field arena tests
+bool test_field_arena(void)
+{
+  bool ok=true;
+  void *p;
+
+  {
+    UNIT_TEST_TITLE("Field arena: reuse per size");
+    TFieldArena arena;
+    void *a = arena.allocate(40);
+    void *b = arena.allocate(40);
+    arena.allocate(72);
+    arena.release(a,40);
+    UNIT_TEST_CALL(p = arena.allocate(72),("p = %p, released %p",p,a),p!=a,ok);
+    UNIT_TEST_CALL(p = arena.allocate(40),("p = %p, released %p",p,a),p==a,ok);
+    UNIT_TEST_CALL(p = arena.allocate(40),("p = %p, released %p",p,a),p!=a && p!=b,ok);
+    // same size after alignment
+    arena.release(b,40);
+    UNIT_TEST_CALL(p = arena.allocate(40-sizeof(void *)+1),("p = %p, released %p",p,b),p==b,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Field arena: block sizes");
+    TFieldArena arena;
+    UNIT_TEST_CALL(arena.allocate(200),("first block %ld",(long)arena.fBlocksP->size),arena.fBlocksP->size==FIELDARENA_FIRSTBLOCKSIZE,ok);
+    UNIT_TEST_CALL(arena.allocate(200),("second block %ld",(long)arena.fBlocksP->size),arena.fBlocksP->size==2*FIELDARENA_FIRSTBLOCKSIZE && arena.fBlocksP->nextP->size==FIELDARENA_FIRSTBLOCKSIZE,ok);
+    for (int i=0; i<50; i++) arena.allocate(FIELDARENA_BLOCKSIZE/4);
+    UNIT_TEST_CALL(,("last block %ld",(long)arena.fBlocksP->size),arena.fBlocksP->size==FIELDARENA_BLOCKSIZE,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Field arena: dedicated blocks");
+    TFieldArena arena;
+    // large field in an empty arena
+    UNIT_TEST_CALL(arena.allocate(FIELDARENA_BLOCKSIZE/4+8),("block %ld",(long)arena.fBlocksP->size),arena.fBlocksP->size==fieldArenaAlign(FIELDARENA_BLOCKSIZE/4+8),ok);
+    void *a = arena.allocate(16);
+    UNIT_TEST_CALL(,("block %ld",(long)arena.fBlocksP->size),arena.fBlocksP->size==FIELDARENA_FIRSTBLOCKSIZE,ok);
+    // large field while a block is being filled
+    UNIT_TEST_CALL(arena.allocate(FIELDARENA_BLOCKSIZE),("block %ld, next %ld",(long)arena.fBlocksP->size,(long)arena.fBlocksP->nextP->size),arena.fBlocksP->size==FIELDARENA_FIRSTBLOCKSIZE && arena.fBlocksP->nextP->size==FIELDARENA_BLOCKSIZE,ok);
+    UNIT_TEST_CALL(p = arena.allocate(16),("p = %p, previous %p",p,a),p==static_cast<uInt8 *>(a)+16,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Field arena: too many sizes");
+    TFieldArena arena;
+    void *first = arena.allocate(16);
+    arena.release(first,16);
+    for (int i=1; i<TFieldArena::numFreeLists; i++)
+      arena.release(arena.allocate(16+i*8),16+i*8);
+    void *x = arena.allocate(16+TFieldArena::numFreeLists*8);
+    arena.release(x,16+TFieldArena::numFreeLists*8);
+    UNIT_TEST_CALL(p = arena.allocate(16+TFieldArena::numFreeLists*8),("p = %p, released %p",p,x),p!=x,ok);
+    UNIT_TEST_CALL(p = arena.allocate(16),("p = %p, released %p",p,first),p==first,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Field arena: deleting fields");
+    TFieldArena arena;
+    TItemField *heapP = newItemField(fty_string,NULL);
+    TItemField *fieldP = newItemField(fty_string,NULL,false,&arena);
+    void *released = fieldP;
+    delete fieldP;
+    UNIT_TEST_CALL(fieldP = newItemField(fty_string,NULL,false,&arena),("field %p, released %p",fieldP,released),(void *)fieldP==released,ok);
+    delete heapP;
+    bool empty = true;
+    for (int i=0; i<TFieldArena::numFreeLists; i++)
+      if (arena.fFreeLists[i].headP) empty = false;
+    UNIT_TEST_CALL(,("heap field ended up in the arena"),empty,ok);
+    delete fieldP;
+  }
+  #ifdef ARRAYFIELD_SUPPORT
+  {
+    UNIT_TEST_TITLE("Field arena: array elements");
+    TFieldArena arena;
+    TItemField *arrayP = newItemField(fty_string,NULL,true,&arena);
+    void *elements[3];
+    for (int i=0; i<3; i++) {
+      elements[i] = arrayP->getArrayField(i);
+      uInt8 *hdrP = static_cast<uInt8 *>(elements[i]);
+      bool inArena = false;
+      for (TFieldArena::TBlock *blockP=arena.fBlocksP; blockP; blockP=blockP->nextP) {
+        uInt8 *startP = reinterpret_cast<uInt8 *>(blockP)+fieldArenaAlign(sizeof(TFieldArena::TBlock));
+        if (hdrP>=startP && hdrP<startP+blockP->used) inArena = true;
+      }
+      UNIT_TEST_CALL(,("element %d at %p is not in the arena",i,elements[i]),inArena,ok);
+    }
+    delete arrayP;
+    // elements are available again
+    UNIT_TEST_CALL(p = newItemField(fty_string,NULL,false,&arena),("p = %p",p),p==elements[0] || p==elements[1] || p==elements[2],ok);
+  }
+  #endif
+  return ok;
+} // test_field_arena
+
+#endif // SYNTHESIS_UNIT_TEST
+
+
 
 } // namespace sysync
 
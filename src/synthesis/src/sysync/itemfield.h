@@ -48,12 +48,51 @@ typedef sInt32 fieldinteger_t;
 #define ITEMFIELD_DYNAMIC_CAST_PTR(ty,tyid,src) (src->isBasedOn(tyid) ? static_cast<ty *>(src) : NULL)
 
 
+// arena for the field objects of one item: fields are carved out of a few larger
+// blocks, memory of deleted fields is recycled for new fields of the same size,
+// and all blocks are released at once when the arena is deleted.
+class TFieldArena : noncopyable
+{
+  #ifdef SYNTHESIS_UNIT_TEST
+  friend bool test_field_arena(void);
+  #endif
+public:
+  TFieldArena();
+  ~TFieldArena();
+  // get memory for a field
+  void *allocate(size_t aSize);
+  // make memory of a deleted field available again
+  void release(void *aPtr, size_t aSize);
+private:
+  // block header, field memory follows
+  struct TBlock {
+    TBlock *nextP;
+    size_t size;
+    size_t used;
+  };
+  TBlock *fBlocksP; // first block is the one currently being filled
+  size_t fNextBlockSize; // size for the next block, grows up to a maximum
+  // lists of deleted fields, by size
+  static const int numFreeLists = 8;
+  struct TFreeList {
+    size_t size;
+    void *headP;
+  };
+  TFreeList fFreeLists[numFreeLists];
+}; // TFieldArena
+
+
 // basically abstract class, but can be used to represent EMPTY and ASSIGNED values
 class TItemField
 {
 public:
   TItemField();
   virtual ~TItemField();
+  // fields can be allocated in a TFieldArena (NULL = normal heap), delete works for both
+  static void *operator new(size_t aSize);
+  static void *operator new(size_t aSize, TFieldArena *aArenaP);
+  static void operator delete(void *aPtr, size_t aSize);
+  static void operator delete(void *aPtr, TFieldArena *aArenaP);
   #ifdef ARRAYFIELD_SUPPORT
   // check array
   virtual bool isArray(void) const { return false; }
@@ -166,7 +205,7 @@ class TArrayField : public TItemField, noncopyable
 {
   typedef TItemField inherited;
 public:
-  TArrayField(TItemFieldTypes aLeafFieldType, GZones *aGZonesP);
+  TArrayField(TItemFieldTypes aLeafFieldType, GZones *aGZonesP, TFieldArena *aArenaP=NULL);
   virtual ~TArrayField();
   // check array
   virtual bool isArray(void) const { return true; }
@@ -212,6 +251,8 @@ protected:
   TItemField *fFirstField;
   // Zones for fields
   GZones *fGZonesP;
+  // arena for leaf fields (NULL if none)
+  TFieldArena *fArenaP;
   // actual field vector
   TFieldArray fArray;
 }; // TArrayField
@@ -612,7 +653,7 @@ protected:
 
 
 // factory function
-TItemField *newItemField(const TItemFieldTypes aType, GZones *aGZonesP, bool aAsArray=false);
+TItemField *newItemField(const TItemFieldTypes aType, GZones *aGZonesP, bool aAsArray=false, TFieldArena *aArenaP=NULL);
 
 
 #ifdef ENGINEINTERFACE_SUPPORT
@@ -678,6 +719,12 @@ private:
 #endif // ENGINEINTERFACE_SUPPORT
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+// field arena tests
+bool test_field_arena(void);
+#endif
+
+
 } // namespace sysync
 
 #endif  // ItemField_H
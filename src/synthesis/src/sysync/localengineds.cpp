@@ -1302,6 +1302,7 @@ void TLocalEngineDS::InternalResetDataStore(void)
   fConflictsDuplicated=0;
   // - slow sync matches
   fSlowSyncMatches=0;
+  fSlowSyncComparesAvoided=0;
   #endif
 
   // Override defaults from ancestor
@@ -4657,6 +4658,7 @@ void TLocalEngineDS::showStatistics(void)
     #ifdef SYSYNC_SERVER
     if (IS_SERVER) {
       CONSOLEPRINTF(("  SlowSync Matches:            %9ld",(long)fSlowSyncMatches));
+      CONSOLEPRINTF(("  SlowSync Compares avoided:   %9ld",(long)fSlowSyncComparesAvoided));
       CONSOLEPRINTF(("  Server won Conflicts:        %9ld",(long)fConflictsServerWins));
       CONSOLEPRINTF(("  Client won Conflicts:        %9ld",(long)fConflictsClientWins));
       CONSOLEPRINTF(("  Conflicts with Duplication:  %9ld",(long)fConflictsDuplicated));
@@ -4670,7 +4672,7 @@ void TLocalEngineDS::showStatistics(void)
   DB_PROGRESS_EVENT(this,pev_dsstats_e,fLocalItemsError,fRemoteItemsError,0);
   #ifdef SYSYNC_SERVER
   if (IS_SERVER) {
-    DB_PROGRESS_EVENT(this,pev_dsstats_s,fSlowSyncMatches,0,0);
+    DB_PROGRESS_EVENT(this,pev_dsstats_s,fSlowSyncMatches,fSlowSyncComparesAvoided,0);
     DB_PROGRESS_EVENT(this,pev_dsstats_c,fConflictsServerWins,fConflictsClientWins,fConflictsDuplicated);
   }
   #endif
@@ -4699,6 +4701,7 @@ void TLocalEngineDS::showStatistics(void)
     #ifdef SYSYNC_SERVER
     if (IS_SERVER) {
       StringObjAppendPrintf(stats,"SlowSync Matches:            %9ld\n",(long)fSlowSyncMatches);
+      StringObjAppendPrintf(stats,"SlowSync Compares avoided:   %9ld\n",(long)fSlowSyncComparesAvoided);
       StringObjAppendPrintf(stats,"Server won Conflicts:        %9ld\n",(long)fConflictsServerWins);
       StringObjAppendPrintf(stats,"Client won Conflicts:        %9ld\n",(long)fConflictsClientWins);
       StringObjAppendPrintf(stats,"Conflicts with Duplication:  %9ld\n\n",(long)fConflictsDuplicated);
@@ -490,6 +490,8 @@ protected:
   sInt32 fConflictsDuplicated;
   /// slow sync matches
   sInt32 fSlowSyncMatches;
+  /// slow sync item comparisons avoided by the match index
+  sInt32 fSlowSyncComparesAvoided;
   #endif
   /// @{ item transmission counts
   sInt32 fItemsSent;
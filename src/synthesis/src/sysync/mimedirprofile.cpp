@@ -24,6 +24,7 @@
 #include "syncagent.h"
 
 #include <ctype.h>
+#include <algorithm>
 
 using namespace sysync;
 
@@ -791,6 +792,8 @@ void TMIMEProfileConfig::localResolve(bool aLastPass)
       static_cast<TAgentConfig *>(static_cast<TRootConfig *>(getRootElement())->fAgentConfigP)
     );
     #endif
+    // build property name indexes for parsing
+    fRootProfileP->buildPropertyIndex();
   }
   // resolve inherited
   inherited::localResolve(aLastPass);
@@ -942,6 +945,7 @@ TParameterDefinition::TParameterDefinition(
   next=NULL;
   TCFG_ASSIGN(paramname,aName);
   defaultparam=aDefault;
+  paramOrdinal=0; // not indexed yet
   extendsname=aExtendsName;
   shownonempty=aShowNonEmpty;
   showInCTCap=aShowInCTCap;
@@ -1008,6 +1012,8 @@ TPropertyDefinition::TPropertyDefinition(const char* aName, sInt16 aNumVals, boo
   allowFoldAtSep = aAllowFoldAtSep; // allow folding at value separators even if it inserts a space at the end of the previous value
   groupFieldID = aGroupFieldID; // fid for field that contains the group tag (prefix to the property name, like "a" in "a.TEL:079122327")
   propGroup = aPropertyGroupID; // property group ID
+  propOrdinal = 0; // not indexed yet
+  paramIndexBuilt = false;
   // check if this is an unprocessed wildcard property
   unprocessed = strchr(aName, '*')!=NULL;
   // check value list
@@ -1095,10 +1101,75 @@ TParameterDefinition *TPropertyDefinition::addParam(
   TParameterDefinition **paramPP = &parameterDefs;
   while(*paramPP!=NULL) paramPP=&((*paramPP)->next); // find last in chain
   *paramPP = new TParameterDefinition(aName,aDefault,aExtendsName,aShowNonEmpty,aShowInCTCap, aModeDep, aSharedField);
+  paramIndexBuilt=false; // index (if any) is outdated now
   return *paramPP;
 } // TPropertyDefinition::addParam
 
 
+// order for the parameter name index: case insensitive name, then position in list
+static bool paramIndexLess(const TParameterDefinition *aParam1P, const TParameterDefinition *aParam2P)
+{
+  sInt16 c = strucmp(TCFG_CSTR(aParam1P->paramname),TCFG_CSTR(aParam2P->paramname));
+  return c==0 ? aParam1P->paramOrdinal<aParam2P->paramOrdinal : c<0;
+} // paramIndexLess
+
+
+// build name index of parameters for findParamDef()
+void TPropertyDefinition::buildParamIndex(void)
+{
+  paramNameIndex.clear();
+  defaultParams.clear();
+  uInt16 ordinal=0;
+  for (TParameterDefinition *paramP=parameterDefs; paramP; paramP=paramP->next) {
+    paramP->paramOrdinal=ordinal++;
+    paramNameIndex.push_back(paramP);
+    if (paramP->defaultparam)
+      defaultParams.push_back(paramP);
+  }
+  std::sort(paramNameIndex.begin(),paramNameIndex.end(),paramIndexLess);
+  paramIndexBuilt=true;
+} // TPropertyDefinition::buildParamIndex
+
+
+// find first parameter definition at or after aStartP in the parameter list which has
+// the name aParamName or, if aDefault is set, is a default parameter.
+// Equivalent to scanning the list, but uses the index if built.
+const TParameterDefinition *TPropertyDefinition::findParamDef(const char *aParamName, bool aDefault, const TParameterDefinition *aStartP) const
+{
+  if (!aStartP) return NULL; // end of list
+  if (!paramIndexBuilt) {
+    // no index, linear search
+    while (aStartP && !((aDefault && aStartP->defaultparam) || strucmp(aParamName,TCFG_CSTR(aStartP->paramname))==0))
+      aStartP=aStartP->next;
+    return aStartP;
+  }
+  // binary search for first entry with same name not before aStartP
+  const TParameterDefinition *foundP = NULL;
+  size_t lo=0, hi=paramNameIndex.size();
+  while (lo<hi) {
+    size_t mid=(lo+hi)/2;
+    const TParameterDefinition *paramP=paramNameIndex[mid];
+    sInt16 c = strucmp(TCFG_CSTR(paramP->paramname),aParamName);
+    if (c<0 || (c==0 && paramP->paramOrdinal<aStartP->paramOrdinal))
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  if (lo<paramNameIndex.size() && strucmp(TCFG_CSTR(paramNameIndex[lo]->paramname),aParamName)==0)
+    foundP=paramNameIndex[lo];
+  // default parameters: an earlier one in the list takes precedence
+  if (aDefault) {
+    for (TParamDefList::const_iterator pos=defaultParams.begin(); pos!=defaultParams.end(); ++pos) {
+      const TParameterDefinition *paramP=*pos;
+      if (foundP && paramP->paramOrdinal>foundP->paramOrdinal) break; // name match comes first
+      if (paramP->paramOrdinal>=aStartP->paramOrdinal)
+        return paramP;
+    }
+  }
+  return foundP;
+} // TPropertyDefinition::findParamDef
+
+
 // find parameter by name
 TParameterDefinition *TPropertyDefinition::findParameter(const char *aNam, sInt16 aLen)
 {
@@ -1134,6 +1205,8 @@ TProfileDefinition::TProfileDefinition(
   propertyDefs=NULL;
   subLevels=NULL;
   ownsProps=true;
+  propsOwnerP=this;
+  propIndexBuilt=false;
   nextRepID=0;
 } // TProfileDefinition::TProfileDefinition
 
@@ -1180,6 +1253,8 @@ TPropertyDefinition *TProfileDefinition::addProperty(
   TPropertyDefinition **propPP=&propertyDefs;
   while (*propPP!=NULL) propPP=&((*propPP)->next);
   *propPP=new TPropertyDefinition(aName,aNumValues,aMandatory,aShowInCTCap,aSuppressEmpty,aDelayedProcessing,aValuesep,aAltValuesep,aPropertyGroupID,aCanFilter,aModeDep,aGroupFieldID,aAllowFoldAtSep);
+  // index (if any) is outdated now, also for all profiles sharing the list
+  propsOwnerP->propIndexBuilt=false;
   // return new property
   return *propPP;
 } // TProfileDefinition::addProperty
@@ -1189,9 +1264,89 @@ void TProfileDefinition::usePropertiesOf(TProfileDefinition *aProfile)
 {
   ownsProps=false;
   propertyDefs=aProfile->propertyDefs;
+  // the owner's index is used, which gets invalidated when properties are added to the list
+  propsOwnerP=aProfile->propsOwnerP;
 } // TProfileDefinition::usePropertiesOf
 
 
+// order for the property name index: case insensitive name, then position in list
+static bool propertyIndexLess(const TPropertyDefinition *aProp1P, const TPropertyDefinition *aProp2P)
+{
+  sInt16 c = strucmp(TCFG_CSTR(aProp1P->propname),TCFG_CSTR(aProp2P->propname));
+  return c==0 ? aProp1P->propOrdinal<aProp2P->propOrdinal : c<0;
+} // propertyIndexLess
+
+
+// build name index of the properties in this profile's own list, and of their parameters
+void TProfileDefinition::indexProperties(void)
+{
+  propNameIndex.clear();
+  wildcardProps.clear();
+  uInt16 ordinal=0;
+  for (TPropertyDefinition *propP=propertyDefs; propP; propP=propP->next) {
+    // number properties in list order
+    propP->propOrdinal=ordinal++;
+    if (strpbrk(TCFG_CSTR(propP->propname),"*?"))
+      wildcardProps.push_back(propP); // must be tested with strwildcmp()
+    else
+      propNameIndex.push_back(propP);
+    propP->buildParamIndex();
+  }
+  std::sort(propNameIndex.begin(),propNameIndex.end(),propertyIndexLess);
+  propIndexBuilt=true;
+} // TProfileDefinition::indexProperties
+
+
+// build name indexes for findPropertyDef(), recursively for all sublevels
+void TProfileDefinition::buildPropertyIndex(void)
+{
+  // profiles sharing the property list of another one use its index
+  if (!propsOwnerP->propIndexBuilt && propsOwnerP->propertyDefs==propertyDefs)
+    propsOwnerP->indexProperties();
+  // sublevels
+  for (TProfileDefinition *profileP=subLevels; profileP; profileP=profileP->next)
+    profileP->buildPropertyIndex();
+} // TProfileDefinition::buildPropertyIndex
+
+
+// find first property definition at or after aStartP in the property list whose name
+// matches aPropName (aLen chars). Property names may contain wildcards.
+// Equivalent to scanning the list with strwildcmp(), but uses the index if built.
+const TPropertyDefinition *TProfileDefinition::findPropertyDef(const char *aPropName, size_t aLen, const TPropertyDefinition *aStartP) const
+{
+  if (!aStartP) return NULL; // end of list
+  const TProfileDefinition *ownerP = propsOwnerP;
+  if (!ownerP->propIndexBuilt || ownerP->propertyDefs!=propertyDefs) {
+    // no index, linear search
+    while (aStartP && strwildcmp(aPropName,TCFG_CSTR(aStartP->propname),aLen)!=0)
+      aStartP=aStartP->next;
+    return aStartP;
+  }
+  // plain names: binary search for first entry with same name not before aStartP
+  const TPropertyDefinition *foundP = NULL;
+  size_t lo=0, hi=ownerP->propNameIndex.size();
+  while (lo<hi) {
+    size_t mid=(lo+hi)/2;
+    const TPropertyDefinition *propP=ownerP->propNameIndex[mid];
+    sInt16 c = strucmp(TCFG_CSTR(propP->propname),aPropName,0,aLen);
+    if (c<0 || (c==0 && propP->propOrdinal<aStartP->propOrdinal))
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  if (lo<ownerP->propNameIndex.size() && strucmp(TCFG_CSTR(ownerP->propNameIndex[lo]->propname),aPropName,0,aLen)==0)
+    foundP=ownerP->propNameIndex[lo];
+  // wildcard names: an earlier match in the list takes precedence
+  for (TPropertyDefList::const_iterator pos=ownerP->wildcardProps.begin(); pos!=ownerP->wildcardProps.end(); ++pos) {
+    const TPropertyDefinition *propP=*pos;
+    if (foundP && propP->propOrdinal>foundP->propOrdinal) break; // plain name match comes first
+    if (propP->propOrdinal>=aStartP->propOrdinal && strwildcmp(aPropName,TCFG_CSTR(propP->propname),aLen)==0)
+      return propP;
+  }
+  return foundP;
+} // TProfileDefinition::findPropertyDef
+
+
 // find (sub)profile by name, recursively
 TProfileDefinition *TProfileDefinition::findProfile(const char *aNam)
 {
@@ -3856,7 +4011,6 @@ bool TMimeDirProfileHandler::parseProperty(
   bool fieldoffsetfound;
   bool notempty = false;
   bool valuelist;
-  sInt16 pidx; // parameter index
   TEncodingTypes encoding;
   TCharSets charset;
   // field storage info vars, defaults are used if property has no TPropNameExtension
@@ -4004,16 +4158,14 @@ bool TMimeDirProfileHandler::parseProperty(
         }
       }
       // find param in list now
-      paramP = aPropP->parameterDefs;
-      pidx=0; // parameter index
+      paramP = aPropP->findParamDef(pname.c_str(),defaultparam,aPropP->parameterDefs);
       while (paramP) {
-        // check for match
+        // name matches (or default param), check for match
         if (
-          mimeModeMatch(paramP->modeDependency) &&
+          mimeModeMatch(paramP->modeDependency)
           #ifndef NO_REMOTE_RULES
-          (!paramP->ruleDependency || isActiveRule(paramP->ruleDependency)) &&
+          && (!paramP->ruleDependency || isActiveRule(paramP->ruleDependency))
           #endif
-          ((defaultparam && paramP->defaultparam) || strucmp(pname.c_str(),TCFG_CSTR(paramP->paramname))==0)
         ) {
           // param name found
           // - process value (list)
@@ -4077,9 +4229,8 @@ bool TMimeDirProfileHandler::parseProperty(
             }
           } // second pass
         } // if (param known)
-        // test next param
-        paramP=paramP->next;
-        pidx++;
+        // test next param with matching name
+        paramP=aPropP->findParamDef(pname.c_str(),defaultparam,paramP->next);
       } // while more params
       // p points to ';' of next param or ':' of value
     } // while more parameters (*p==';')
@@ -4593,7 +4744,7 @@ bool TMimeDirProfileHandler::parseLevels(
         return false;
       }
       // not disabled level
-      const TPropertyDefinition *propP = aProfileP->propertyDefs;
+      const TPropertyDefinition *propP = aProfileP->findPropertyDef(propname,n,aProfileP->propertyDefs);
       #ifndef NO_REMOTE_RULES
       const TPropertyDefinition *otherRulePropP = NULL; // default property which is used if none of the rule-dependent in the group was used
       bool ruleSpecificParsed = false;
@@ -4601,11 +4752,8 @@ bool TMimeDirProfileHandler::parseLevels(
       #endif
       const TPropertyDefinition *parsePropP;
       while(propP) {
-        // compare
-        if (
-          mimeModeMatch(propP->modeDependency) && // none or matching mode dependency
-          strwildcmp(propname,TCFG_CSTR(propP->propname),n)==0 // wildcards allowed (for unprocessed properties for example)
-        ) {
+        // name matches (wildcards allowed, for unprocessed properties for example), compare mode
+        if (mimeModeMatch(propP->modeDependency)) { // none or matching mode dependency
           // found property def with matching name (and MIME mode)
           // check all in group (=all subsequent with same name)
           #ifndef NO_REMOTE_RULES
@@ -4705,13 +4853,15 @@ bool TMimeDirProfileHandler::parseLevels(
           while(false); // if no remote rules, we do not loop
           #endif
           if (propparsed) break; // do not continue outer loop if inner loop has parsed a prop successfully
-        } // if name matches (=start of group found)
+        } // if mode matches (=start of group found)
         else {
           // not start of group
           // - next property
           propP=propP->next;
         }
-      } // while all properties
+        // - next property with matching name
+        propP=aProfileP->findPropertyDef(propname,n,propP);
+      } // while all properties with matching name
     } // else: neither BEGIN nor END
     if (!propparsed) {
       // unknown property
@@ -5675,6 +5825,118 @@ void MakeAllday(TItemField *aStartFldP, TItemField *aEndFldP, timecontext_t aTim
 } // MakeAllday
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+
+// positions (in list order) of all property definitions matching aName
+static string propMatches(const TProfileDefinition &aProfile, const char *aName, size_t aLen=0)
+{
+  string res;
+  const TPropertyDefinition *propP=aProfile.findPropertyDef(aName,aLen,aProfile.propertyDefs);
+  while (propP) {
+    int pos=0;
+    for (const TPropertyDefinition *p=aProfile.propertyDefs; p!=propP; p=p->next) pos++;
+    if (!res.empty()) res+=',';
+    StringObjAppendPrintf(res,"%d",pos);
+    propP=aProfile.findPropertyDef(aName,aLen,propP->next);
+  }
+  return res;
+} // propMatches
+
+
+// positions (in list order) of all parameter definitions matching aName or being default params
+static string paramMatches(const TPropertyDefinition &aProp, const char *aName, bool aDefault)
+{
+  string res;
+  const TParameterDefinition *paramP=aProp.findParamDef(aName,aDefault,aProp.parameterDefs);
+  while (paramP) {
+    int pos=0;
+    for (const TParameterDefinition *p=aProp.parameterDefs; p!=paramP; p=p->next) pos++;
+    if (!res.empty()) res+=',';
+    StringObjAppendPrintf(res,"%d",pos);
+    paramP=aProp.findParamDef(aName,aDefault,paramP->next);
+  }
+  return res;
+} // paramMatches
+
+
+// first property definition named aName which is valid in aMimeMode, like parseMimeDir() selects it
+static const TPropertyDefinition *propForMode(const TProfileDefinition &aProfile, const char *aName, TMimeDirMode aMimeMode)
+{
+  const TPropertyDefinition *propP=aProfile.findPropertyDef(aName,0,aProfile.propertyDefs);
+  while (propP && propP->modeDependency!=numMimeModes && propP->modeDependency!=aMimeMode)
+    propP=aProfile.findPropertyDef(aName,0,propP->next);
+  return propP;
+} // propForMode
+
+
+// property and parameter name index tests
+bool test_property_index(void)
+{
+  bool ok=true;
+  string r;
+  TProfileDefinition root(NULL,"VCARD",0,false,profm_custom,numMimeModes);
+  TProfileDefinition *profileP=root.addSubProfile("OWNER",0,false);
+  profileP->addProperty("X-*",1,false,false,false);                                  // 0
+  TPropertyDefinition *telOldP=profileP->addProperty("TEL",1,false,false,false,0,';',1,false,mimo_old);      // 1
+  TPropertyDefinition *telStdP=profileP->addProperty("TEL",1,false,false,false,0,';',1,false,mimo_standard); // 2
+  profileP->addProperty("X-FOO",1,false,false,false);                                // 3
+  TPropertyDefinition *emailP=profileP->addProperty("EMAIL",1,false,false,false);    // 4
+  profileP->addProperty("*",1,false,false,false);                                    // 5
+  profileP->addProperty("Email",1,false,false,false);                                // 6
+  emailP->addParam("TYPE",true,false);   // 0, default param
+  emailP->addParam("VALUE",false,false); // 1
+  emailP->addParam("type",false,false);  // 2
+  TProfileDefinition *sharerP=root.addSubProfile("SHARER",0,false);
+  sharerP->usePropertiesOf(profileP);
+
+  for (int indexed=0; indexed<2; indexed++) {
+    if (indexed) {
+      UNIT_TEST_TITLE("Property index: indexed lookup");
+      root.buildPropertyIndex();
+    }
+    else {
+      UNIT_TEST_TITLE("Property index: linear lookup");
+    }
+    // wildcards vs. plain names, list order precedence
+    UNIT_TEST_CALL(r=propMatches(*profileP,"X-FOO"),("X-FOO: %s",r.c_str()),r=="0,3,5",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"X-BAR"),("X-BAR: %s",r.c_str()),r=="0,5",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"TEL"),("TEL: %s",r.c_str()),r=="1,2,5",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"TEL;TYPE=HOME:1",3),("TEL (len 3): %s",r.c_str()),r=="1,2,5",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"email"),("email: %s",r.c_str()),r=="4,5,6",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"N"),("N: %s",r.c_str()),r=="5",ok);
+    UNIT_TEST_CALL(r=propMatches(*sharerP,"X-FOO"),("sharer X-FOO: %s",r.c_str()),r=="0,3,5",ok);
+    // mode dependent groups
+    UNIT_TEST_CALL(,("TEL for standard mode"),propForMode(*profileP,"TEL",mimo_standard)==telStdP,ok);
+    UNIT_TEST_CALL(,("TEL for old mode"),propForMode(*profileP,"TEL",mimo_old)==telOldP,ok);
+    // parameters
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"TYPE",false),("TYPE: %s",r.c_str()),r=="0,2",ok);
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"HOME",true),("default HOME: %s",r.c_str()),r=="0",ok);
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"VALUE",true),("default VALUE: %s",r.c_str()),r=="0,1",ok);
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"ENCODING",false),("ENCODING: %s",r.c_str()),r=="",ok);
+  }
+  {
+    UNIT_TEST_TITLE("Property index: adding to shared list");
+    profileP->addProperty("X-LATE",1,false,false,false); // 7
+    UNIT_TEST_CALL(r=propMatches(*sharerP,"X-LATE"),("sharer X-LATE: %s",r.c_str()),r=="0,5,7",ok);
+    UNIT_TEST_CALL(r=propMatches(*profileP,"X-LATE"),("owner X-LATE: %s",r.c_str()),r=="0,5,7",ok);
+    emailP->addParam("X-LATE",false,false); // 3
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"X-LATE",true),("default X-LATE: %s",r.c_str()),r=="0,3",ok);
+    root.buildPropertyIndex();
+    UNIT_TEST_CALL(r=propMatches(*sharerP,"X-LATE"),("sharer X-LATE: %s",r.c_str()),r=="0,5,7",ok);
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"X-LATE",true),("default X-LATE: %s",r.c_str()),r=="0,3",ok);
+    // adding via the sharing profile also invalidates the owner's index
+    sharerP->addProperty("X-LATE",1,false,false,false); // 8
+    UNIT_TEST_CALL(r=propMatches(*profileP,"X-LATE"),("owner X-LATE: %s",r.c_str()),r=="0,5,7,8",ok);
+    // default param after a name match
+    emailP->addParam("X-DEF",true,false); // 4
+    root.buildPropertyIndex();
+    UNIT_TEST_CALL(r=paramMatches(*emailP,"VALUE",true),("default VALUE: %s",r.c_str()),r=="0,1,4",ok);
+  }
+  return ok;
+} // test_property_index
+
+#endif // SYNTHESIS_UNIT_TEST
+
 
 } // namespace sysync
 
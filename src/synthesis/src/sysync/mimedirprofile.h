@@ -21,6 +21,7 @@
 #include "engine_defs.h"
 
 #include <set>
+#include <vector>
 
 namespace sysync {
 
@@ -169,6 +170,8 @@ public:
   TCFG_STRING paramname; // NULL for terminator
   // used as default param, for example for type tags which have no explicit TYPE= in older vXX formats
   bool defaultparam;
+  // position in the parameter list (set by TPropertyDefinition::buildParamIndex())
+  uInt16 paramOrdinal;
   // parameter exists only in specific MIME-DIR mode (set to numMimeModes for non-dependent parameter)
   TMimeDirMode modeDependency;
   // parameter can extend property name by enumerated values with nameextid's
@@ -257,6 +260,8 @@ public:
   );
   TConversionDef *setConvDef(sInt16 aValNum, sInt16 aFieldId=FID_NOT_SUPPORTED,sInt16 aConvMode=0,char aCombSep=0);
   TParameterDefinition *findParameter(const char *aNam, sInt16 aLen=0);
+  const TParameterDefinition *findParamDef(const char *aParamName, bool aDefault, const TParameterDefinition *aStartP) const;
+  void buildParamIndex(void);
   // next in list
   TPropertyDefinition *next;
   // property name
@@ -302,6 +307,15 @@ public:
   sInt16 nextNameExt;
   // property group ID
   uInt16 propGroup; // starting at 1, groups subsequent props that have the same name
+  // position in the property list (set by TProfileDefinition::buildPropertyIndex())
+  uInt16 propOrdinal;
+  // name index for findParamDef(), built with the property name index
+  // - parameters sorted case insensitively by name, then by position
+  typedef std::vector<const TParameterDefinition *> TParamDefList;
+  TParamDefList paramNameIndex;
+  // - default parameters, in list order
+  TParamDefList defaultParams;
+  bool paramIndexBuilt;
   #ifndef NO_REMOTE_RULES
   // set if property enabled only if ruleDependency matches session's applied rule (even if NULL = no rule must be applied)
   bool dependsOnRemoterule;
@@ -364,6 +378,8 @@ public:
   );
   void usePropertiesOf(TProfileDefinition *aProfile);
   TPropertyDefinition *getPropertyDef(const char *aPropName);
+  const TPropertyDefinition *findPropertyDef(const char *aPropName, size_t aLen, const TPropertyDefinition *aStartP) const;
+  void buildPropertyIndex(void);
   sInt16 getPropertyMainFid(const char *aPropName, uInt16 aIndex);
   TProfileDefinition *findProfile(const char *aNam);
   // next in chain
@@ -395,6 +411,17 @@ public:
   TMimeDirMode modeDependency;
 private:
   bool ownsProps;
+  // profile which owns the property list (this one, unless usePropertiesOf() was used)
+  TProfileDefinition *propsOwnerP;
+  void indexProperties(void);
+  // name index for findPropertyDef(), built once at config resolve time
+  // for the profile owning the property list, and used by all sharing it
+  // - properties with plain names, sorted case insensitively by name, then by position
+  typedef std::vector<const TPropertyDefinition *> TPropertyDefList;
+  TPropertyDefList propNameIndex;
+  // - properties with wildcards in their name, in list order
+  TPropertyDefList wildcardProps;
+  bool propIndexBuilt;
 }; // TProfileDefinition
 
 
@@ -742,6 +769,11 @@ void MakeAllday(TItemField *aStartFldP, TItemField *aEndFldP, timecontext_t aTim
 
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+// property and parameter name index tests
+bool test_property_index(void);
+#endif
+
 } // namespace sysync
 
 #endif  // MimeDirProfile_H
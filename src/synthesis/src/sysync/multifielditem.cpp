@@ -588,10 +588,13 @@ TItemField *TMultiFieldItem::getField(sInt16 aFieldIndex)
     // we must create the field first
     fiP=newItemField(
       fFieldDefinitionsP->fFields[aFieldIndex].type,
-      getSessionZones()
+      getSessionZones(),
       #ifdef ARRAYFIELD_SUPPORT
-      ,fFieldDefinitionsP->fFields[aFieldIndex].array
+      fFieldDefinitionsP->fFields[aFieldIndex].array,
+      #else
+      false,
       #endif
+      &fFieldArena
     );
     // save in array
     fFieldsP[aFieldIndex] = fiP;
@@ -1266,6 +1269,75 @@ exit:
   return result;
 } // TMultiFieldItem::standardCompareWith
 
+
+// calculate hash over all fields which must be equal for standardCompareWith()
+// to report equality in aEqMode with an item of aOtherTypeP.
+// - only plain string-type fields that cannot be cut off are used as key, as
+//   these are compared by exact (normalized) value.
+// - returns false if the item cannot be bucketed by a hash and must always be
+//   compared, i.e. if a compare script is used, no key fields exist or a key
+//   field is unassigned (which matches anything in slowsync modes)
+bool TMultiFieldItem::getMatchHash(
+  TEqualityMode aEqMode,
+  TSyncItemType *aOtherTypeP,
+  uInt32 &aHash
+)
+{
+  if (aEqMode==eqm_nocompare || !fItemTypeP || !aOtherTypeP || !aOtherTypeP->isBasedOn(ity_multifield))
+    return false;
+  TMultiFieldItemType *othertypeP = static_cast<TMultiFieldItemType *>(aOtherTypeP);
+  // items with different field lists are not comparable at all
+  if (othertypeP->getFieldDefinitions()!=fFieldDefinitionsP)
+    return false;
+  // scripted compare can have any notion of equality
+  if (fItemTypeP->hasCompareScript() || othertypeP->hasCompareScript())
+    return false;
+  uInt32 hash = 2166136261UL; // FNV-1a offset basis
+  sInt16 numkeys = 0;
+  string val;
+  for (sInt16 i=0; i<fFieldDefinitionsP->numFields(); i++) {
+    TFieldDefinition &fd = fFieldDefinitionsP->fFields[i];
+    // only fields relevant in this mode
+    if (fd.eqRelevant<aEqMode) continue;
+    #ifdef ARRAYFIELD_SUPPORT
+    if (fd.array) continue;
+    #endif
+    // only types where equality is equality of the (normalized) string value
+    if (fd.type!=fty_string && fd.type!=fty_url && fd.type!=fty_telephone && fd.type!=fty_multiline)
+      continue;
+    // only fields compared in both types, and where no cutoff can happen
+    TFieldOptions *ownoptsP = fItemTypeP->getFieldOptions(i);
+    TFieldOptions *otheroptsP = othertypeP->getFieldOptions(i);
+    if (!ownoptsP || !otheroptsP || !ownoptsP->available || !otheroptsP->available)
+      continue;
+    if (ownoptsP->maxsize!=FIELD_OPT_MAXSIZE_NONE || otheroptsP->maxsize!=FIELD_OPT_MAXSIZE_NONE)
+      continue;
+    // this is a key field
+    TItemField *fldP = getField(i);
+    if (!fldP || fldP->isUnassigned()) {
+      // unassigned fields are not compared in slowsync modes, so this item could match anything
+      if (aEqMode>=eqm_slowsync) return false;
+      val.erase(); // otherwise, unassigned compares like empty
+    }
+    else if (fd.type==fty_string || fd.type==fty_url)
+      fldP->getAsString(val);
+    else
+      fldP->getAsNormalizedString(val);
+    // hash value, followed by its length to separate fields
+    // (collisions are harmless, candidates are always fully compared)
+    for (size_t k=0; k<val.size(); k++) {
+      hash ^= (uInt8)val[k];
+      hash *= 16777619UL; // FNV prime
+    }
+    hash ^= (uInt32)val.size();
+    hash *= 16777619UL;
+    numkeys++;
+  }
+  if (numkeys==0) return false; // no key fields at all
+  aHash = hash;
+  return true;
+} // TMultiFieldItem::getMatchHash
+
 #endif // server only
 
 
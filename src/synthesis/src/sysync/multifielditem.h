@@ -268,6 +268,8 @@ public:
   virtual bool isBasedOn(uInt16 aItemTypeID) const { return aItemTypeID==ity_multifield ? true : TSyncItem::isBasedOn(aItemTypeID); };
   // assignment (IDs and contents)
   virtual TSyncItem& operator=(TSyncItem &aSyncItem) { return TSyncItem::operator=(aSyncItem); };
+  // - same for items of this class, the implicit one would copy the field pointers
+  TMultiFieldItem& operator=(TMultiFieldItem &aItem) { TSyncItem::operator=(aItem); return *this; };
   // changelog support
   #if defined(CHECKSUM_CHANGELOG) && !defined(RECORDHASH_FROM_DBAPI)
   virtual uInt16 getDataCRC(uInt16 crc=0, bool aEQRelevantOnly=false);
@@ -344,6 +346,12 @@ public:
     TEqualityMode aEqMode,
     bool aDebugShow
   );
+  // get hash over all fields which must be equal for standardCompareWith() to report equality
+  virtual bool getMatchHash(
+    TEqualityMode aEqMode,
+    TSyncItemType *aOtherTypeP,
+    uInt32 &aHash
+  );
   #endif
   #ifdef SYDEBUG
   // show item contents for debug
@@ -369,6 +377,8 @@ protected:
   TFieldListConfig *fFieldDefinitionsP;
   // contents: array of actual fields
   TItemField **fFieldsP;
+  // memory for the fields, released in bulk with the item
+  TFieldArena fFieldArena;
 private:
   // cast pointer to same type, returns NULL if incompatible
   TMultiFieldItem *castToSameTypeP(TSyncItem *aItemP); // all are compatible TSyncItem
@@ -165,6 +165,12 @@ public:
   #endif
   // comparing and merging
   sInt16 compareItems(TMultiFieldItem &aFirstItem, TMultiFieldItem &aSecondItem, TEqualityMode aEqMode, bool aDebugShow, TLocalEngineDS *aDatastoreP);
+  // - check if compareItems() uses a script (and not just standardCompareWith())
+  #ifdef SCRIPT_SUPPORT
+  bool hasCompareScript(void) { return !getMultifieldTypeConfig()->fCompareScript.empty(); };
+  #else
+  bool hasCompareScript(void) { return false; };
+  #endif
   void mergeItems(
     TMultiFieldItem &aWinningItem,
     TMultiFieldItem &aLoosingItem,
@@ -865,7 +865,7 @@ bool endDateFromCount(
   startwday = lineartime2weekday(dtstart); // get starting weekday
   lineartime2date(dtstart,&startyear,&startmonth,&startday); // year, month, day-in-month
   // calculate interval repetitions (which is what is needed for daily and RRULE v1 calculation)
-  sInt16 ivrep = (cnt-1)*interval;
+  sInt32 ivrep = (sInt32)(cnt-1)*interval;
   // check if daily
   if (freq == 'D') {
     // Daily recurrence is same for occurrence and interval counts
@@ -907,6 +907,7 @@ bool endDateFromCount(
     // - we need the number of days in the month in most cases
     sInt16 lastday = getMonthDays(lineartime2dateonly(dtstart)); // number of days in this month
     sInt16 newYearsPassed;
+    sInt16 perweek;
     switch (freq)
     {
       case 'W':
@@ -914,6 +915,11 @@ bool endDateFromCount(
         // - make sure we have a mask
         if (firstmask==0 && lastmask==0)
           firstmask = 1<<startwday; // set start day in mask
+        // - number of occurrences in every active week
+        perweek=0;
+        for (sInt16 wd=0; wd<7; wd++)
+          if (firstmask & ((uInt64)1<<wd)) perweek++;
+        if (firstmask && perweek==0) return false; // no weekday in mask, cannot ever occur
         // now calculate
         while (firstmask) {
           if (firstmask & ((uInt64)1<<startwday)) {
@@ -929,6 +935,12 @@ bool endDateFromCount(
             startwday=0;
             // skip part of interval which has no occurrence
             until+=(interval-1)*7*linearDateToTimeFactor;
+            // skip entire active weeks (with their inactive part) that do not contain the last occurrence
+            if (cnt>perweek) {
+              sInt16 weeks = (cnt-1)/perweek;
+              cnt -= weeks*perweek;
+              until+=(lineartime_t)weeks*interval*7*linearDateToTimeFactor;
+            }
           }
         }
         return true;
@@ -1187,6 +1199,181 @@ bool test_expand_rrule(void)
   return ok;
 }
 
+
+
+// count calculation as it was before countFromEndDate() searched for the count,
+// calculating the end date for every count from 1 up to the endless limit
+static bool countFromEndDateLinear(
+  sInt16 &cnt, bool countsoccurrences,
+  lineartime_t dtstart,
+  char freq, char freqmod,
+  sInt16 interval,
+  fieldinteger_t firstmask,fieldinteger_t lastmask,
+  lineartime_t until
+)
+{
+  if (dtstart==noLinearTime || interval<1) return false;
+  if (until==noLinearTime) {
+    cnt=0;
+    return true;
+  }
+  lineartime_t occurrence=noLinearTime;
+  cnt=1;
+  while (cnt<500) {
+    if (!endDateFromCount(occurrence,dtstart,freq,freqmod,interval,firstmask,lastmask,cnt,countsoccurrences,NULL))
+      return false;
+    if (occurrence>until) {
+      cnt--;
+      return cnt!=0;
+    }
+    cnt++;
+  }
+  cnt=0;
+  return true;
+}
+
+
+// weekly end date calculation stepping through every day
+static lineartime_t endDateWeeklyByDays(lineartime_t dtstart, sInt16 interval, fieldinteger_t firstmask, sInt16 cnt)
+{
+  lineartime_t until=dtstart;
+  sInt16 wday=lineartime2weekday(dtstart);
+  while (true) {
+    if (firstmask & ((uInt64)1<<wday)) {
+      if (--cnt<=0) return until;
+    }
+    until+=linearDateToTimeFactor;
+    if (++wday>6) {
+      wday=0;
+      until+=(interval-1)*7*linearDateToTimeFactor;
+    }
+  }
+}
+
+
+// simple pseudo random numbers, same sequence on every platform
+static uInt32 rnd(uInt32 aMax)
+{
+  static uInt32 seed=4711;
+  seed=seed*1103515245+12345;
+  return (seed>>16)%aMax;
+}
+
+
+// RRULE count and end date tests
+bool test_rrule_count(void)
+{
+  bool ok=true;
+  lineartime_t lt;
+  sInt16 cnt;
+  bool r;
+
+  {
+    UNIT_TEST_TITLE("Every 2nd week on Mo,We,Fr");
+    // 2009-03-02 is a Monday
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,3,true,NULL),("lt = %s",s(lt)),lt==t("2009-03-06T10:00:00"),ok);
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,4,true,NULL),("lt = %s",s(lt)),lt==t("2009-03-16T10:00:00"),ok);
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,9,true,NULL),("lt = %s",s(lt)),lt==t("2009-04-03T10:00:00"),ok);
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,10,true,NULL),("lt = %s",s(lt)),lt==t("2009-04-13T10:00:00"),ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,t("2009-03-29T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==6,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,t("2009-03-30T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==7,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-02T10:00:00"),'W',' ',2,0x2A,0,t("2009-04-12T23:59:59"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==9,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Every 2nd week on Mo,Th, starting on a Thursday");
+    // 2009-03-05 is a Thursday, the Monday before it does not count
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-05T10:00:00"),'W',' ',2,0x12,0,2,true,NULL),("lt = %s",s(lt)),lt==t("2009-03-16T10:00:00"),ok);
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-05T10:00:00"),'W',' ',2,0x12,0,5,true,NULL),("lt = %s",s(lt)),lt==t("2009-04-02T10:00:00"),ok);
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-05T10:00:00"),'W',' ',2,0x12,0,3,false,NULL),("lt = %s",s(lt)),lt==t("2009-04-04T10:00:00"),ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-05T10:00:00"),'W',' ',2,0x12,0,t("2009-04-01T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==4,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,false,t("2009-03-05T10:00:00"),'W',' ',2,0x12,0,t("2009-04-04T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==3,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Endless limit");
+    // the 499th daily occurrence is on 2010-05-14
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-01-01T10:00:00"),'D',' ',1,0,0,499,true,NULL),("lt = %s",s(lt)),lt==t("2010-05-14T10:00:00"),ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-01-01T10:00:00"),'D',' ',1,0,0,t("2010-05-13T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==498,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-01-01T10:00:00"),'D',' ',1,0,0,t("2010-05-14T09:59:59"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==498,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-01-01T10:00:00"),'D',' ',1,0,0,t("2010-05-14T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==0,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-01-01T10:00:00"),'D',' ',1,0,0,t("2010-05-15T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==0,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-01-01T10:00:00"),'D',' ',1,0,0,t(""),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==0,ok);
+  }
+  {
+    UNIT_TEST_TITLE("UNTIL before first occurrence");
+    // weekly on Monday, starting on Thursday 2009-03-05, first occurrence is 2009-03-09
+    UNIT_TEST_CALL(endDateFromCount(lt,t("2009-03-05T10:00:00"),'W',' ',1,0x2,0,1,true,NULL),("lt = %s",s(lt)),lt==t("2009-03-09T10:00:00"),ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-05T10:00:00"),'W',' ',1,0x2,0,t("2009-03-06T10:00:00"),NULL),("r = %d",r),!r,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-05T10:00:00"),'W',' ',1,0x2,0,t("2009-03-01T10:00:00"),NULL),("r = %d",r),!r,ok);
+    UNIT_TEST_CALL(r = countFromEndDate(cnt,true,t("2009-03-05T10:00:00"),'W',' ',1,0x2,0,t("2009-03-09T10:00:00"),NULL),("r = %d, cnt = %hd",r,cnt),r && cnt==1,ok);
+  }
+  {
+    UNIT_TEST_TITLE("Weekly end dates, compared with day by day calculation");
+    for (int i=0; i<2000; i++) {
+      lineartime_t dtstart = t("2009-01-01T08:00:00")+rnd(1000)*linearDateToTimeFactor;
+      sInt16 interval = 1+rnd(4);
+      fieldinteger_t mask = 1+rnd(0x7F);
+      sInt16 n = 1+rnd(600);
+      UNIT_TEST_CALL(endDateFromCount(lt,dtstart,'W',' ',interval,mask,0,n,true,NULL),("W%hd mask 0x%02X cnt %hd: lt = %s",interval,(int)mask,n,s(lt)),lt==endDateWeeklyByDays(dtstart,interval,mask,n),ok);
+    }
+  }
+  {
+    UNIT_TEST_TITLE("Counts, compared with linear search");
+    static const char freqs[][2] = { {'D',' '}, {'W',' '}, {'M','D'}, {'M','W'}, {'Y','M'}, {'Y',' '} };
+    for (int i=0; i<2000; i++) {
+      sInt16 f = rnd(6);
+      char freq = freqs[f][0], freqmod = freqs[f][1];
+      lineartime_t dtstart = t("2009-01-01T08:00:00")+rnd(1000)*linearDateToTimeFactor;
+      lineartime_t until = dtstart+((sInt32)rnd(4000)-10)*linearDateToTimeFactor+rnd(2)*linearDateToTimeFactor/2;
+      sInt16 interval = 1+rnd(3);
+      fieldinteger_t firstmask = 0, lastmask = 0;
+      if (freq=='W') firstmask = 1+rnd(0x7F);
+      else if (freq=='M' && freqmod=='D') firstmask = ((fieldinteger_t)rnd(0x7FFF)<<rnd(16));
+      else if (freq=='Y') firstmask = rnd(0xFFF);
+      bool countsoccurrences = rnd(4)!=0;
+      sInt16 c1=-1, c2=-1;
+      bool r1 = countFromEndDate(c1,countsoccurrences,dtstart,freq,freqmod,interval,firstmask,lastmask,until,NULL);
+      bool r2 = countFromEndDateLinear(c2,countsoccurrences,dtstart,freq,freqmod,interval,firstmask,lastmask,until);
+      UNIT_TEST_CALL(,("%c%c%hd 0x%llX: %d/%hd, linear %d/%hd",freq,freqmod,interval,(long long)firstmask,r1,c1,r2,c2),r1==r2 && (!r1 || c1==c2),ok);
+    }
+  }
+  {
+    UNIT_TEST_TITLE("Occurrences in range");
+    TRRuleExpandStatus es;
+    vector<lineartime_t> all, parts;
+    lineartime_t dtstart = t("2009-03-05T10:00:00");
+    lineartime_t until = t("2009-12-31T10:00:00"); // a Thursday in an inactive week
+    // all at once
+    initRRuleExpansion(es,dtstart,'W',' ',2,0x12,0);
+    UNIT_TEST_CALL(getOccurrencesInRange(es,noLinearTime,t("2010-01-01"),until,all),("%d occurrences",(int)all.size()),all.size()>0,ok);
+    r = countFromEndDate(cnt,true,dtstart,'W',' ',2,0x12,0,until,NULL);
+    UNIT_TEST_CALL(,("%d occurrences, count %hd",(int)all.size(),cnt),r && cnt==(sInt16)all.size(),ok);
+    if (all.size()>=2) {
+      UNIT_TEST_CALL(,("first = %s",s(all[0])),all[0]==dtstart,ok);
+      UNIT_TEST_CALL(,("second = %s",s(all[1])),all[1]==t("2009-03-16T10:00:00"),ok);
+      UNIT_TEST_CALL(,("last = %s",s(all.back())),all.back()==t("2009-12-24T10:00:00"),ok);
+    }
+    // same in one month windows, continuing with the same cursor
+    initRRuleExpansion(es,dtstart,'W',' ',2,0x12,0);
+    lineartime_t start = t("2009-03-01");
+    for (sInt16 m=4; m<=13; m++) {
+      lineartime_t end = date2lineartime(2009+(m-1)/12,(m-1)%12+1,1);
+      sInt32 n = getOccurrencesInRange(es,start,end,until,parts);
+      UNIT_TEST_CALL(,("month %hd: %ld occurrences, %s",m-1,(long)n,n ? s(parts.back()) : "none"),n==0 || (parts.back()>=start && parts.back()<end),ok);
+      start = end;
+    }
+    UNIT_TEST_CALL(,("%d occurrences in windows, %d at once",(int)parts.size(),(int)all.size()),parts==all,ok);
+    // a window later than the start
+    parts.clear();
+    initRRuleExpansion(es,dtstart,'W',' ',2,0x12,0,t("2009-03-20T00:00:00"));
+    UNIT_TEST_CALL(getOccurrencesInRange(es,t("2009-03-20T00:00:00"),t("2009-04-03T00:00:00"),until,parts),("%d occurrences",(int)parts.size()),parts.size()==2 && parts[0]==t("2009-03-30T10:00:00") && parts[1]==t("2009-04-02T10:00:00"),ok);
+    // a window starting after the occurrence on its first day
+    parts.clear();
+    initRRuleExpansion(es,dtstart,'W',' ',2,0x12,0,t("2009-03-30T12:00:00"));
+    UNIT_TEST_CALL(getOccurrencesInRange(es,t("2009-03-30T12:00:00"),t("2009-04-03T00:00:00"),until,parts),("%d occurrences",(int)parts.size()),parts.size()==1 && parts[0]==t("2009-04-02T10:00:00"),ok);
+  }
+  return ok;
+}
+
 #endif // SYNTHESIS_UNIT_TEST
 
 
@@ -1600,6 +1787,47 @@ done:
 } // getNthNextOccurrence
 
 
+/// @brief get the occurrences of a recurrence within a range
+/// @note es is used as cursor, and is left before the first occurrence at or after
+///       aRangeEnd. As it is a plain struct, it can be kept with an item to continue
+///       with the next range later, without expanding again from the start.
+/// @return number of occurrences appended to aOccurrences
+sInt32 getOccurrencesInRange(
+  TRRuleExpandStatus &es,
+  lineartime_t aRangeStart, lineartime_t aRangeEnd,
+  lineartime_t aUntil,
+  vector<lineartime_t> &aOccurrences
+)
+{
+  TRRuleExpandStatus next;
+  lineartime_t occurrence;
+  sInt32 n=0;
+
+  if (aRangeEnd==noLinearTime && aUntil==noLinearTime && es.expansionEnd==noLinearTime)
+    return 0; // would never end
+  while (true) {
+    // expand on a copy, so the cursor does not move past the end of the range
+    next = es;
+    occurrence = getNextOccurrence(next);
+    if (occurrence==noLinearTime || (aUntil!=noLinearTime && occurrence>aUntil)) {
+      // no more occurrences at all
+      es = next;
+      es.cursor = noLinearTime;
+      break;
+    }
+    if (aRangeEnd!=noLinearTime && occurrence>=aRangeEnd)
+      break; // leave this one for the next range
+    es = next;
+    // expansion may start early on the first day
+    if (occurrence>=aRangeStart) {
+      aOccurrences.push_back(occurrence);
+      n++;
+    }
+  }
+  return n;
+} // getOccurrencesInRange
+
+
 
 
 
@@ -1627,34 +1855,44 @@ bool countFromEndDate(
     cnt=0;
     return true;
   }
-  // iterate until end date is reached
-  cnt=1;
+  // find the highest count with an end date not after until. As the end date grows
+  // with the count, search for it (first doubling the count, then bisecting) instead
+  // of calculating the end date for every count, each one again from the start.
+  const sInt16 maxcnt=500; // 500 and more recurrences count as endless
+  sInt16 lo=0; // highest count known to end not after until (0=none)
+  sInt16 hi=maxcnt; // lowest count known to end after until
+  sInt16 c=1;
   lineartime_t occurrence=noLinearTime;
-  // break after 500 recurrences
-  while (cnt<500) {
+  while (hi-lo>1) {
     if (!endDateFromCount(
       occurrence,
       dtstart,
       freq,freqmod,
       interval,
       firstmask,lastmask,
-      cnt,
+      c,
       countsoccurrences,
       aLogP
     ))
       return false; // error, cannot calc end date
-    if (occurrence>until) {
-      // no more occurrences
-      cnt--;
-      if (cnt==0) return false; // if not endless, but no occurrence found in range -> not repeating
-      return true; // return count
-    }
-    // next occurrence
-    cnt++;
+    if (occurrence>until)
+      hi=c; // no more occurrences from here
+    else
+      lo=c;
+    // next count to check
+    if (hi==maxcnt && lo*2<maxcnt)
+      c=lo*2; // upper bound not found yet
+    else
+      c=lo+(hi-lo)/2;
   }
-  // 500 and more recurrences count as endless
-  cnt=0;
-  return true;
+  if (hi>=maxcnt) {
+    // endless
+    cnt=0;
+    return true;
+  }
+  cnt=lo;
+  if (cnt==0) return false; // if not endless, but no occurrence found in range -> not repeating
+  return true; // return count
 } // countFromEndDate
 
 
@@ -20,6 +20,7 @@
 #include "debuglogger.h"
 #else
 #include <string>
+#include <vector>
 #include "lineartime.h"
 #endif
 
@@ -58,6 +59,8 @@ const int WeeksOfMonth= 5;
 #ifdef SYNTHESIS_UNIT_TEST
 // RRULE expansion tests
 bool test_expand_rrule(void);
+// RRULE count and end date tests
+bool test_rrule_count(void);
 #endif
 
 
@@ -163,6 +166,18 @@ PUBLIC_ENTRY void initRRuleExpansion(
 /// @return noLinearTime if no next occurrence exists, lineartime of next occurrence otherwise
 PUBLIC_ENTRY lineartime_t getNextOccurrence(TRRuleExpandStatus &es);
 
+/// @brief get the occurrences in [aRangeStart,aRangeEnd) which are not after aUntil
+/// @note es must be initialized with initRRuleExpansion() (with aRangeStart as
+///       expansion start to skip the earlier part) and can be kept to continue
+///       with the next range
+/// @return number of occurrences appended to aOccurrences
+sInt32 getOccurrencesInRange(
+  TRRuleExpandStatus &es,
+  lineartime_t aRangeStart, lineartime_t aRangeEnd,
+  lineartime_t aUntil,
+  vector<lineartime_t> &aOccurrences
+);
+
 
 
 /// @brief calculate end date of RRULE when count is specified
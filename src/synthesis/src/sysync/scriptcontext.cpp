@@ -200,12 +200,20 @@ void TScriptConfig::localResolve(bool aLastPass)
 // get script text
 string *TScriptConfig::getFunctionScript(sInt16 aFuncIndex)
 {
-  if (aFuncIndex<0 || aFuncIndex>(sInt16)fFunctionScripts.size())
-    return NULL;
-  return &(fFunctionScripts[aFuncIndex]->fFuncDef);
+  TUserScriptFunction *funcdefP = getFunction(aFuncIndex);
+  return funcdefP ? &(funcdefP->fFuncDef) : NULL;
 } // TScriptConfig::getFunctionScript
 
 
+// get function definition
+TUserScriptFunction *TScriptConfig::getFunction(sInt16 aFuncIndex)
+{
+  if (aFuncIndex<0 || aFuncIndex>=(sInt16)fFunctionScripts.size())
+    return NULL;
+  return fFunctionScripts[aFuncIndex];
+} // TScriptConfig::getFunction
+
+
 // get index of specific function
 sInt16 TScriptConfig::getFunctionIndex(cAppCharP aName, size_t aLen)
 {
@@ -221,6 +229,14 @@ sInt16 TScriptConfig::getFunctionIndex(cAppCharP aName, size_t aLen)
 } // TScriptConfig::getFunctionIndex
 
 
+// user defined function
+
+TUserScriptFunction::~TUserScriptFunction()
+{
+  if (fDefsContextP) delete fDefsContextP;
+} // TUserScriptFunction::~TUserScriptFunction
+
+
 // Script variable definition
 
 // create new scrip variable definition
@@ -2935,7 +2951,9 @@ void TScriptContext::TokenizeAndResolveFunction(TSyncAppBase *aAppBaseP, sInt32
       false, // not rebuild
       &aFuncDef.fFuncName // store name here
     );
-    delete resolvecontextP;
+    // keep the definitions, calls will copy them instead of resolving the script again
+    if (aFuncDef.fDefsContextP) delete aFuncDef.fDefsContextP;
+    aFuncDef.fDefsContextP=resolvecontextP;
   }
   SYSYNC_CATCH (exception &e)
     delete resolvecontextP;
@@ -3444,6 +3462,25 @@ void TScriptContext::defineBuiltInVars(const TBuiltInFuncDef *aFuncDefP)
 } // TScriptContext::defineBuiltInVars
 
 
+// create local variable definitions for calling a user-defined function
+// This copies the definitions ResolveIdentifiers() has built when the function
+// was resolved at config time, which is equivalent to rebuilding them from the
+// function script, but without scanning the script again for every call.
+void TScriptContext::defineFunctionVars(const TScriptContext *aDefsContextP)
+{
+  fNumParams=aDefsContextP->fNumParams;
+  fFuncType=aDefsContextP->fFuncType;
+  TVarDefs::const_iterator pos;
+  for (pos=aDefsContextP->fVarDefs.begin(); pos!=aDefsContextP->fVarDefs.end(); pos++) {
+    TScriptVarDef *vardefP = new TScriptVarDef(
+      (*pos)->fVarName.c_str(), (*pos)->fIdx, (*pos)->fVarType,
+      (*pos)->fIsArray, (*pos)->fIsRef, (*pos)->fIsOpt
+    );
+    fVarDefs.push_back(vardefP);
+  }
+} // TScriptContext::defineFunctionVars
+
+
 // execute built-in function
 void TScriptContext::executeBuiltIn(TItemField *&aTermP, const TBuiltInFuncDef *aFuncDefP)
 {
@@ -3897,6 +3934,7 @@ TItemField *TScriptContext::evalTerm(TItemFieldTypes aResultType)
   TItemField *termP=NULL;
   uInt8 tk;
   TScriptContext *funccontextP;
+  TUserScriptFunction *userfuncP;
   string *funcscript;
   const char *funcname;
   uInt16 funcnamelen;
@@ -4012,14 +4050,28 @@ TItemField *TScriptContext::evalTerm(TItemFieldTypes aResultType)
       funcname=(const char *)p+3;
       funcnamelen=*(p+1)-1;
       SCRIPTDBGMSGX(DBG_SCRIPTS+DBG_EXOTIC+DBG_SCRIPTEXPR,("- User-defined function %.*s call:",funcnamelen,funcname));
-      // - get function text
-      funcscript=getSyncAppBase()->getRootConfig()->fScriptConfigP->getFunctionScript(*(p+2));
-      if (!funcscript)
+      // - get function definition and text
+      userfuncP=getSyncAppBase()->getRootConfig()->fScriptConfigP->getFunction(*(p+2));
+      if (!userfuncP)
         SYSYNC_THROW(TSyncException(DEBUGTEXT("invalid user function index","scri7")));
-      // %%% possibly add caching of function contexts here.
-      //     Now we rebuild a context for every function call. Not extremely efficient...
+      funcscript=&(userfuncP->fFuncDef);
       funccontextP=NULL;
-      rebuildContext(fAppBaseP,*funcscript,funccontextP,fSessionP,true);
+      if (userfuncP->fDefsContextP) {
+        // create context from the variable definitions resolved at config time
+        funccontextP=new TScriptContext(fAppBaseP,fSessionP);
+        SYSYNC_TRY {
+          funccontextP->defineFunctionVars(userfuncP->fDefsContextP);
+          funccontextP->PrepareLocals();
+        }
+        SYSYNC_CATCH (...)
+          delete funccontextP;
+          SYSYNC_RETHROW;
+        SYSYNC_ENDCATCH
+      }
+      else {
+        // no resolved definitions, rebuild context from function script
+        rebuildContext(fAppBaseP,*funcscript,funccontextP,fSessionP,true);
+      }
       if (!funccontextP)
         SYSYNC_THROW(TSyncException(DEBUGTEXT("no context for user-defined function call","scri5")));
       SYSYNC_TRY {
@@ -4926,6 +4978,115 @@ bool TScriptVarKey::getFieldNameFromFid(sInt16 aFid, string &aFieldName)
 #endif // ENGINEINTERFACE_SUPPORT
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+
+// user-defined functions added by test_function_vars()
+static cAppCharP const testFunctions[] = {
+  "integer tst_add(integer a, integer &b, string c) { integer x; x = a + b; b = x; return x * 10 + LENGTH(c); }",
+  "string tst_join(string s, integer n, string sep) { string r; integer i; i = 0; while (i < n) { if (i > 0) r = r + sep; r = r + s; i = i + 1; } return r; }",
+  "integer tst_touch(timestamp &t, integer n) { timestamp loc; string tmp[]; loc = t; tmp[0] = \"x\"; t = loc; return n + SIZE(tmp); }",
+  "integer tst_twice(integer v) { integer dummy; dummy = 0; return tst_add(v, dummy, \"\") + dummy; }",
+  NULL
+};
+
+// script calling the test functions, expected result is 72728
+static cAppCharP const testCallScript =
+  "integer b; string p[]; timestamp t; "
+  "b = 3; p[0] = \"a\"; p[1] = \"b\"; tst_touch(t, 1); "
+  "return tst_add(4, b, \"xy\") * 1000 + b * 100 + LENGTH(tst_join(p[0] + p[1], 2, \"--\")) + tst_twice(2);";
+
+
+// run testCallScript, returns -1 if there is no result
+static fieldinteger_t runCallScript(TSyncAppBase *aAppBaseP)
+{
+  string ts;
+  TScriptContext *ctxP = NULL;
+  TItemField *resP = NULL;
+  fieldinteger_t r = -1;
+
+  TScriptContext::Tokenize(aAppBaseP, "test_function_vars", 1, testCallScript, ts, NULL);
+  TScriptContext::resolveScript(aAppBaseP, ts, ctxP, NULL);
+  TScriptContext::buildVars(ctxP);
+  if (TScriptContext::executeWithResult(resP, ctxP, ts, NULL, NULL, NULL, false, NULL, false) && resP)
+    r = resP->getAsInteger();
+  if (resP) delete resP;
+  if (ctxP) delete ctxP;
+  return r;
+} // runCallScript
+
+
+// The variable definitions defineFunctionVars() copies for a function call
+// must be exactly those rebuildContext() produces from the function script.
+// aAppBaseP must have a root config, the functions already configured there
+// are checked along with a few test functions added temporarily.
+bool test_function_vars(TSyncAppBase *aAppBaseP)
+{
+  bool ok = true;
+  TScriptConfig *cfgP = aAppBaseP->getRootConfig()->fScriptConfigP;
+  size_t numConfigured = cfgP->fFunctionScripts.size();
+
+  UNIT_TEST_TITLE("test_function_vars");
+  // add test functions the same way TScriptConfig does
+  for (sInt16 k=0; testFunctions[k]; k++) {
+    TUserScriptFunction *funcdefP = new TUserScriptFunction;
+    cfgP->fFunctionScripts.push_back(funcdefP);
+    TScriptContext::TokenizeAndResolveFunction(aAppBaseP, 1, testFunctions[k], *funcdefP);
+  }
+  // compare definitions for all functions
+  for (size_t i=0; i<cfgP->fFunctionScripts.size(); i++) {
+    TUserScriptFunction *funcdefP = cfgP->fFunctionScripts[i];
+    cAppCharP name = funcdefP->fFuncName.c_str();
+    TScriptContext *copiedP = new TScriptContext(aAppBaseP, NULL);
+    TScriptContext *rebuiltP = NULL;
+    UNIT_TEST_CALL(, ("%s: no resolved definitions", name), funcdefP->fDefsContextP!=NULL, ok);
+    if (funcdefP->fDefsContextP)
+      copiedP->defineFunctionVars(funcdefP->fDefsContextP);
+    TScriptContext::rebuildContext(aAppBaseP, funcdefP->fFuncDef, rebuiltP, NULL, false);
+    UNIT_TEST_CALL(, ("%s: no rebuilt context", name), rebuiltP!=NULL, ok);
+    if (rebuiltP) {
+      UNIT_TEST_CALL(, ("%s: %d params copied, %d rebuilt", name, copiedP->fNumParams, rebuiltP->fNumParams),
+        copiedP->fNumParams==rebuiltP->fNumParams, ok);
+      UNIT_TEST_CALL(, ("%s: type %d copied, %d rebuilt", name, copiedP->fFuncType, rebuiltP->fFuncType),
+        copiedP->fFuncType==rebuiltP->fFuncType, ok);
+      UNIT_TEST_CALL(, ("%s: %d vars copied, %d rebuilt", name, (int)copiedP->fVarDefs.size(), (int)rebuiltP->fVarDefs.size()),
+        copiedP->fVarDefs.size()==rebuiltP->fVarDefs.size(), ok);
+      for (size_t v=0; v<copiedP->fVarDefs.size() && v<rebuiltP->fVarDefs.size(); v++) {
+        TScriptVarDef *c = copiedP->fVarDefs[v];
+        TScriptVarDef *r = rebuiltP->fVarDefs[v];
+        UNIT_TEST_CALL(, ("%s: var %d copied %s/%d/%d/%d%d%d, rebuilt %s/%d/%d/%d%d%d", name, (int)v,
+            c->fVarName.c_str(), c->fIdx, c->fVarType, c->fIsArray, c->fIsRef, c->fIsOpt,
+            r->fVarName.c_str(), r->fIdx, r->fVarType, r->fIsArray, r->fIsRef, r->fIsOpt),
+          c->fVarName==r->fVarName && c->fIdx==r->fIdx && c->fVarType==r->fVarType &&
+          c->fIsArray==r->fIsArray && c->fIsRef==r->fIsRef && c->fIsOpt==r->fIsOpt, ok);
+      }
+      delete rebuiltP;
+    }
+    delete copiedP;
+  }
+  // calls must give the same results with and without the copied definitions
+  fieldinteger_t r;
+  UNIT_TEST_CALL(r = runCallScript(aAppBaseP), ("call with copied definitions returned %ld", (long)r), r==72728, ok);
+  for (size_t i=numConfigured; i<cfgP->fFunctionScripts.size(); i++) {
+    delete cfgP->fFunctionScripts[i]->fDefsContextP;
+    cfgP->fFunctionScripts[i]->fDefsContextP = NULL;
+  }
+  UNIT_TEST_CALL(r = runCallScript(aAppBaseP), ("call with rebuilt context returned %ld", (long)r), r==72728, ok);
+  // function index bounds
+  sInt16 num = (sInt16)cfgP->fFunctionScripts.size();
+  UNIT_TEST_CALL(, ("last function not found"), cfgP->getFunction(num-1)!=NULL, ok);
+  UNIT_TEST_CALL(, ("function index %d past the end accepted", num), cfgP->getFunctionScript(num)==NULL, ok);
+  UNIT_TEST_CALL(, ("negative function index accepted"), cfgP->getFunctionScript(-1)==NULL, ok);
+  // remove test functions again
+  while (cfgP->fFunctionScripts.size()>numConfigured) {
+    delete cfgP->fFunctionScripts.back();
+    cfgP->fFunctionScripts.pop_back();
+  }
+  return ok;
+} // test_function_vars
+
+#endif // SYNTHESIS_UNIT_TEST
+
+
 } // namespace sysync
 
 
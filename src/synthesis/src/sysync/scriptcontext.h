@@ -182,12 +182,19 @@ public:
 typedef std::vector<TScriptVarDef *> TVarDefs;
 
 
+class TScriptContext;
+
 // user defined script function
-class TUserScriptFunction
+class TUserScriptFunction : noncopyable
 {
 public:
+  TUserScriptFunction() : fDefsContextP(NULL) {};
+  ~TUserScriptFunction();
   string fFuncName;
   string fFuncDef;
+  // context holding the variable definitions resolved at config time,
+  // used as template for the contexts of the actual function calls
+  TScriptContext *fDefsContextP;
 }; // TUserScriptFunction
 
 typedef std::vector<TUserScriptFunction *> TUserScriptList;
@@ -208,6 +215,7 @@ public:
   TStringToStringMap fScriptMacros;
   // accessing user defined functions
   string *getFunctionScript(sInt16 aFuncIndex);
+  TUserScriptFunction *getFunction(sInt16 aFuncIndex);
   sInt16 getFunctionIndex(cAppCharP aName, size_t aLen);
   virtual void clear();
   void clearmacros() { fScriptMacros.clear(); }; // called when config is read, as then templates are no longer needed
@@ -266,6 +274,9 @@ class TMultiFieldItem;
 class TScriptContext
 {
   friend class TScriptVarKey;
+  #ifdef SYNTHESIS_UNIT_TEST
+  friend bool test_function_vars(TSyncAppBase *aAppBaseP);
+  #endif
 public:
   TScriptContext(TSyncAppBase *aAppBaseP, TSyncSession *aSessionP);
   virtual ~TScriptContext();
@@ -342,6 +353,8 @@ public:
     string *aFuncNameP=NULL,
     bool aNoNewLocals=false // if set, declaration of new locals will be suppressed
   );
+  // Copy variable definitions of a user-defined function from the context it was resolved in
+  void defineFunctionVars(const TScriptContext *aDefsContextP);
   // Prepare local variables (create local fields), according to definitions (re-)built with ResolveIdentifiers()
   bool PrepareLocals(void);
   // Execute script
@@ -482,6 +495,12 @@ protected:
 #endif // ENGINEINTERFACE_SUPPORT
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+// user function variable definition tests
+bool test_function_vars(TSyncAppBase *aAppBaseP);
+#endif
+
+
 } // namespace sysync
 
 #endif // SCRIPT_CONTEXT_H
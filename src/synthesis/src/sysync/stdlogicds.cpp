@@ -23,6 +23,8 @@
 #include "multifielditem.h"
 #include "multifielditemtype.h"
 
+#include <algorithm>
+
 using namespace sysync;
 
 namespace sysync {
@@ -96,6 +98,9 @@ void TStdLogicDS::InternalResetDataStore(void)
     fNumRefOnlyItems=0;
     #endif
   }
+  #ifdef SYSYNC_SERVER
+  forgetMatchIndex();
+  #endif
 } // TStdLogicDS::InternalResetDataStore
 
 
@@ -404,6 +409,7 @@ localstatus TStdLogicDS::performStartSync(void)
           }
           // - now add it to my local list
           fItems.push_back(myitemP);
+          addToMatchIndex(myitemP);
           if (sop==sop_reference_only)
             fNumRefOnlyItems++; // count these to avoid them being shown in NOC
         }
@@ -667,42 +673,150 @@ TSyncItem *TStdLogicDS::getConflictingItemByLocalID(TSyncItem *syncitemP)
 
 
 
-// called to check if content-matching item from server exists for slow sync
-TSyncItem *TStdLogicDS::getMatchingItem(TSyncItem *syncitemP, TEqualityMode aEqMode)
+// discard match index
+void TStdLogicDS::forgetMatchIndex(void)
+{
+  fMatchIndexValid=false;
+  fMatchIndexEqMode=eqm_none;
+  fMatchIndexTypeP=NULL;
+  fMatchIndexLocalTypeP=NULL;
+  fMatchIndexNextSerial=0;
+  fMatchIndex.clear();
+  fMatchWildcards.clear();
+  fMatchInfo.clear();
+} // TStdLogicDS::forgetMatchIndex
+
+
+// (re)build slow sync match index over fItems for matching incoming items of aRemoteTypeP
+void TStdLogicDS::buildMatchIndex(TEqualityMode aEqMode, TSyncItemType *aRemoteTypeP)
 {
-  // search for content matching item
+  forgetMatchIndex();
+  fMatchIndexEqMode=aEqMode;
+  fMatchIndexTypeP=aRemoteTypeP;
+  // local items are hashed for comparison against the incoming type,
+  // incoming items against the type of the (first) local item
+  if (!fItems.empty())
+    fMatchIndexLocalTypeP=fItems.front()->getSyncItemType();
+  fMatchIndexValid=true;
   TSyncItemPContainer::iterator pos;
   for (pos=fItems.begin(); pos!=fItems.end(); ++pos) {
-    DEBUGPRINTFX(DBG_DATA+DBG_MATCH+DBG_EXOTIC,(
-      "comparing (this) local item localID='%s' with incoming (other) item remoteID='%s'",
-      (*pos)->getLocalID(),
-      syncitemP->getRemoteID()
-    ));
-    if ((*pos)->compareWith(
-      *syncitemP,aEqMode,this
-      #ifdef SYDEBUG
-      ,PDEBUGTEST(DBG_DATA+DBG_MATCH+DBG_EXOTIC) // only show comparison if exotic AND match is enabled
-      #endif
-    )==0) {
-      // items match in content
-      // - check if item is not already matched
-      if ((*pos)->getSyncOp()!=sop_wants_add && (*pos)->getSyncOp()!=sop_reference_only) {
-        // item has already been matched before, so don't match it again
-        DEBUGPRINTFX(DBG_DATA,(
-          "TStdLogicDS::getMatchingItem, match but already used -> skip it: remoteID='%s' = localID='%s'",
-          syncitemP->getRemoteID(),
-          (*pos)->getLocalID()
-        ));
+    addToMatchIndex(*pos);
+  }
+  PDEBUGPRINTFX(DBG_DATA+DBG_MATCH,(
+    "TStdLogicDS::buildMatchIndex: %ld local items, %ld hashed, %ld must always be compared",
+    (long)fMatchInfo.size(),
+    (long)fMatchIndex.size(),
+    (long)fMatchWildcards.size()
+  ));
+} // TStdLogicDS::buildMatchIndex
+
+
+// add item just appended to fItems to the match index (if index is in use)
+void TStdLogicDS::addToMatchIndex(TSyncItem *aSyncItemP)
+{
+  if (!fMatchIndexValid) return; // index will be built when needed
+  TMatchInfo info;
+  info.serial=fMatchIndexNextSerial++;
+  info.hash=0;
+  info.hashed=
+    aSyncItemP->getSyncItemType()==fMatchIndexLocalTypeP &&
+    aSyncItemP->getMatchHash(fMatchIndexEqMode,fMatchIndexTypeP,info.hash);
+  if (info.hashed)
+    fMatchIndex.insert(TMatchIndex::value_type(info.hash,TMatchCandidate(info.serial,aSyncItemP)));
+  else
+    fMatchWildcards[info.serial]=aSyncItemP;
+  fMatchInfo[aSyncItemP]=info;
+} // TStdLogicDS::addToMatchIndex
+
+
+// remove item from the match index (must be called before item is erased from fItems)
+void TStdLogicDS::removeFromMatchIndex(TSyncItem *aSyncItemP)
+{
+  TMatchInfoMap::iterator pos = fMatchInfo.find(aSyncItemP);
+  if (pos==fMatchInfo.end()) return; // not indexed
+  if (pos->second.hashed) {
+    std::pair<TMatchIndex::iterator,TMatchIndex::iterator> bucket = fMatchIndex.equal_range(pos->second.hash);
+    for (TMatchIndex::iterator ipos=bucket.first; ipos!=bucket.second; ++ipos) {
+      if (ipos->second.second==aSyncItemP) {
+        fMatchIndex.erase(ipos);
+        break;
       }
-      else {
-        // item has not been matched yet (wannabe add or reference-only), return it now
-        PDEBUGPRINTFX(DBG_DATA+DBG_MATCH+DBG_HOT,(
-          "TStdLogicDS::getMatchingItem, found remoteID='%s' is equal in content with localID='%s'",
-          syncitemP->getRemoteID(),
-          (*pos)->getLocalID()
-        ));
+    }
+  }
+  else
+    fMatchWildcards.erase(pos->second.serial);
+  fMatchInfo.erase(pos);
+} // TStdLogicDS::removeFromMatchIndex
+
+
+// check if local item content-matches incoming item and is not yet matched
+bool TStdLogicDS::isUnmatchedMatch(TSyncItem *aLocalItemP, TSyncItem *aSyncItemP, TEqualityMode aEqMode)
+{
+  DEBUGPRINTFX(DBG_DATA+DBG_MATCH+DBG_EXOTIC,(
+    "comparing (this) local item localID='%s' with incoming (other) item remoteID='%s'",
+    aLocalItemP->getLocalID(),
+    aSyncItemP->getRemoteID()
+  ));
+  if (aLocalItemP->compareWith(
+    *aSyncItemP,aEqMode,this
+    #ifdef SYDEBUG
+    ,PDEBUGTEST(DBG_DATA+DBG_MATCH+DBG_EXOTIC) // only show comparison if exotic AND match is enabled
+    #endif
+  )!=0)
+    return false; // no match
+  // items match in content
+  // - check if item is not already matched
+  if (aLocalItemP->getSyncOp()!=sop_wants_add && aLocalItemP->getSyncOp()!=sop_reference_only) {
+    // item has already been matched before, so don't match it again
+    DEBUGPRINTFX(DBG_DATA,(
+      "TStdLogicDS::getMatchingItem, match but already used -> skip it: remoteID='%s' = localID='%s'",
+      aSyncItemP->getRemoteID(),
+      aLocalItemP->getLocalID()
+    ));
+    return false;
+  }
+  // item has not been matched yet (wannabe add or reference-only)
+  PDEBUGPRINTFX(DBG_DATA+DBG_MATCH+DBG_HOT,(
+    "TStdLogicDS::getMatchingItem, found remoteID='%s' is equal in content with localID='%s'",
+    aSyncItemP->getRemoteID(),
+    aLocalItemP->getLocalID()
+  ));
+  return true;
+} // TStdLogicDS::isUnmatchedMatch
+
+
+// called to check if content-matching item from server exists for slow sync
+// - uses the match index to only compare with local items that can possibly
+//   match, checking candidates in the same order as a full scan of fItems would
+TSyncItem *TStdLogicDS::getMatchingItem(TSyncItem *syncitemP, TEqualityMode aEqMode)
+{
+  // make sure index is ready for this mode and incoming type
+  if (!fMatchIndexValid || fMatchIndexEqMode!=aEqMode || fMatchIndexTypeP!=syncitemP->getSyncItemType())
+    buildMatchIndex(aEqMode,syncitemP->getSyncItemType());
+  uInt32 hash;
+  if (fMatchIndex.empty() || !syncitemP->getMatchHash(aEqMode,fMatchIndexLocalTypeP,hash)) {
+    // incoming item can't be bucketed, search all local items for content matching item
+    TSyncItemPContainer::iterator pos;
+    for (pos=fItems.begin(); pos!=fItems.end(); ++pos) {
+      if (isUnmatchedMatch(*pos,syncitemP,aEqMode))
         return (*pos); // return pointer to item in question
-      }
+    }
+  }
+  else {
+    // candidates are the items in the same bucket plus those without hash
+    std::vector<TMatchCandidate> candidates;
+    std::pair<TMatchIndex::iterator,TMatchIndex::iterator> bucket = fMatchIndex.equal_range(hash);
+    for (TMatchIndex::iterator ipos=bucket.first; ipos!=bucket.second; ++ipos)
+      candidates.push_back(ipos->second);
+    for (TMatchWildcards::iterator wpos=fMatchWildcards.begin(); wpos!=fMatchWildcards.end(); ++wpos)
+      candidates.push_back(TMatchCandidate(wpos->first,wpos->second));
+    fSlowSyncComparesAvoided+=fMatchInfo.size()-candidates.size();
+    // compare in fItems order
+    std::sort(candidates.begin(),candidates.end());
+    std::vector<TMatchCandidate>::iterator cpos;
+    for (cpos=candidates.begin(); cpos!=candidates.end(); ++cpos) {
+      if (isUnmatchedMatch(cpos->second,syncitemP,aEqMode))
+        return cpos->second; // return pointer to item in question
     }
   }
   PDEBUGPRINTFX(DBG_DATA+DBG_MATCH,("TStdLogicDS::getMatchingItem, no matching item"));
@@ -722,6 +836,7 @@ void TStdLogicDS::dontSendItemAsServer(TSyncItem *syncitemP)
     if (*pos == syncitemP) {
       // it is in our list
       PDEBUGPRINTFX(DBG_DATA+DBG_HOT,("Item with localID='%s' will NOT be sent to client (slowsync match / duplicate prevention)",syncitemP->getLocalID()));
+      removeFromMatchIndex(*pos);
       delete *pos; // delete item itself
       fItems.erase(pos); // remove from list
       break;
@@ -759,6 +874,7 @@ void TStdLogicDS::SendItemAsServer(TSyncItem *aSyncitemP)
 {
   // add to list of changes
   fItems.push_back(aSyncitemP);
+  addToMatchIndex(aSyncitemP);
 } // TStdLogicDS::SendItemAsServer
 
 
@@ -872,6 +988,7 @@ bool TStdLogicDS::logicGenerateSyncCommandsAsServer(
     if (ignoreitem) {
       // remove item from list
       TSyncItemPContainer::iterator temp_pos = pos++; // make copy and set iterator to next
+      removeFromMatchIndex(syncitemP);
       fItems.erase(temp_pos); // now entry can be deleted (N.M. Josuttis, pg204)
       // delete item itself
       delete syncitemP;
@@ -881,6 +998,7 @@ bool TStdLogicDS::logicGenerateSyncCommandsAsServer(
     // create sync op command (may return NULL in case command cannot be created, e.g. for MaxObjSize limitations)
     TSyncOpCommand *syncopcmdP = newSyncOpCommand(syncitemP,itemtypeP,aLocalIDPrefix);
     // erase item from list
+    removeFromMatchIndex(syncitemP);
     delete syncitemP;
     pos = fItems.erase(pos);
     // issue command now
@@ -1636,6 +1754,7 @@ localstatus TStdLogicDS::dsBeforeStateChange(TLocalEngineDSState aOldState,TLoca
           } else {
             TSyncItemPContainer::iterator next = pos;
             ++next;
+            removeFromMatchIndex(syncitemP);
             delete syncitemP;
             fItems.erase(pos);
             pos = next;
@@ -63,6 +63,24 @@ private:
   #ifdef SYSYNC_SERVER
   TSyncItemPContainer fItems; ///< list of data items
   uInt32 fNumRefOnlyItems;
+  /// @name slow sync match index
+  ///   buckets fItems by TSyncItem::getMatchHash() such that getMatchingItem() only
+  ///   needs to compare incoming items with local items of the same bucket
+  /// @{
+  typedef std::pair<uInt32,TSyncItem *> TMatchCandidate; ///< serial (=position in fItems), item
+  typedef std::multimap<uInt32,TMatchCandidate> TMatchIndex; ///< match hash -> candidate
+  typedef std::map<uInt32,TSyncItem *> TMatchWildcards; ///< serial -> item without match hash
+  typedef struct { uInt32 serial; uInt32 hash; bool hashed; } TMatchInfo;
+  typedef std::map<TSyncItem *,TMatchInfo> TMatchInfoMap; ///< item -> its index info
+  bool fMatchIndexValid; ///< set if index represents fItems for fMatchIndexEqMode/fMatchIndexTypeP
+  TEqualityMode fMatchIndexEqMode; ///< equality mode the index was built for
+  TSyncItemType *fMatchIndexTypeP; ///< type of incoming items the index was built for
+  TSyncItemType *fMatchIndexLocalTypeP; ///< type of the hashed local items
+  uInt32 fMatchIndexNextSerial; ///< serial for next item added to the index
+  TMatchIndex fMatchIndex; ///< hashed local items
+  TMatchWildcards fMatchWildcards; ///< local items that must be compared with every incoming item
+  TMatchInfoMap fMatchInfo; ///< all indexed local items
+  /// @}
   #endif
   // startSync/threading privates
   bool fInitializing;
@@ -272,6 +290,16 @@ private:
   #ifdef SYSYNC_SERVER
   /// called by dsBeforeStateChange to dssta_dataaccessstarted to make sure datastore is ready for being accessed.
   virtual localstatus startDataAccessForServer(void);
+  /// (re)build slow sync match index over fItems for matching incoming items of aRemoteTypeP
+  void buildMatchIndex(TEqualityMode aEqMode, TSyncItemType *aRemoteTypeP);
+  /// add item just appended to fItems to the match index (if index is in use)
+  void addToMatchIndex(TSyncItem *aSyncItemP);
+  /// remove item from the match index (must be called before item is erased from fItems)
+  void removeFromMatchIndex(TSyncItem *aSyncItemP);
+  /// discard match index
+  void forgetMatchIndex(void);
+  /// check if local item content-matches incoming item and is not yet matched
+  bool isUnmatchedMatch(TSyncItem *aLocalItemP, TSyncItem *aSyncItemP, TEqualityMode aEqMode);
   #endif
 
   /// @}
@@ -78,6 +78,8 @@ public:
   virtual bool isBasedOn(uInt16 aItemTypeID) const { return aItemTypeID==ity_syncitem; };
   // get session pointer
   TSyncSession *getSession(void) { return fSyncItemTypeP ? fSyncItemTypeP->getSession() : NULL; };
+  // get item type
+  TSyncItemType *getSyncItemType(void) { return fSyncItemTypeP; };
   // get session zones pointer
   GZones *getSessionZones(void);
   // assignment (IDs and contents)
@@ -158,6 +160,14 @@ public:
     ,bool /* aDebugShow */=false
     #endif
   ) { return SYSYNC_NOT_COMPARABLE; };
+  // get hash over the contents that must be equal for compareWith() to report equality
+  // with an item of aOtherTypeP in aEqMode. Items comparing equal MUST have equal hashes.
+  // Returns false if no such hash can be calculated (item must always be compared).
+  virtual bool getMatchHash(
+    TEqualityMode /* aEqMode */,
+    TSyncItemType * /* aOtherTypeP */,
+    uInt32 & /* aHash */
+  ) { return false; };
   #ifdef SYDEBUG
   // show item contents for debug
   virtual void debugShowItem(uInt32 aDbgMask=DBG_DATA) { /* nop */ };
@@ -44,6 +44,11 @@
 #include "stringutils.h"
 #include "vtimezone.h"
 
+#include <algorithm>
+#ifdef SYNTHESIS_UNIT_TEST
+  #include <time.h>
+#endif
+
 namespace sysync {
 
 static bool tzcmp  ( const tz_entry &t, const tz_entry &tzi, bool olsonSupport );
@@ -741,6 +746,7 @@ bool FoundTZ( const tz_entry &tc,
             tzcmp( t, *pos, olsonSupport )) {
           pos->ident= t.ident; // reactivate the identifier
           aName = pos->name;  // should be the same
+          g->ResetRulesCache();
           ok    = true; break;
         } // if
 
@@ -752,6 +758,7 @@ bool FoundTZ( const tz_entry &tc,
     // no such element => must be created
     if (createIt && !ok) { // create it, if not yet ok
       g->tzP.push_back( t );
+      g->ResetRulesCache(); // a new entry may follow one with the same name (dynYear)
       ok= true;
     } // if
 
@@ -795,6 +802,7 @@ bool RemoveTZ( const tz_entry &t, GZones* g )
         tzcmp( t, *pos, olsonSupport )) {
       pos->ident = "-";
     //gz()->tzP.erase( pos ); // do not remove it, keep it persistent
+      g->ResetRulesCache();
       ok= true; break;
     } // if
   } // for
@@ -985,68 +993,131 @@ lineartime_t DST_Switch( const tz_entry &t, int bias, sInt16 aYear, bool toDST )
 
 
 
-/* Check whether <aValue> of time zone <t> is DST based */
-static bool IsDST( lineartime_t aTime, const tz_entry &t )
+/* Get the local standard time of the switch <c> within <aYear> */
+static lineartime_t SwitchTime( const tChange &c, sInt16 aYear )
 {
-  bool   ok;
-  sInt16 y, m, d, h, min, ds;
+  sInt16 ds= DaySwitch( date2lineartime( aYear, c.wMonth, 1 ), &c );
 
-  if (!DSTCond( t )) return false;
+  return date2lineartime( aYear,   c.wMonth,  ds  )
+       + time2lineartime( c.wHour, c.wMinute, 0,0 );
+} /* SwitchTime */
 
-  lineartime2date( aTime, &y, &m, &d );
-  lineartime2time( aTime, &h, &min, NULL, NULL );
 
-  const tChange*       c= NULL;
-  if (m==t.std.wMonth) c= &t.std;
-  if (m==t.dst.wMonth) c= &t.dst;
+/* Copy the rules of <t>, with the switches precalculated for <year> (if >0) */
+static void SetRules( const tz_entry &t, tz_rules &r, int year )
+{
+  r.unchanged= t.ident == "$";
+  r.bias     = t.bias;
+  r.biasDST  = t.biasDST;
+  r.dst      = t.dst;
+  r.std      = t.std;
+  r.year     = 0;
+  r.dstSwitch= 0;
+  r.stdSwitch= 0;
+  if (year>0 && DSTCond( t )) {
+    r.year     = year;
+    r.dstSwitch= SwitchTime( t.dst, year );
+    r.stdSwitch= SwitchTime( t.std, year );
+  } // if
+} /* SetRules */
 
-  /* calculation is a little bit more tricky within the two switching months */
-  if (c!=NULL) {
-    /*
-    if   (c->wDayOfWeek==-1) {
-      ds= c->wNth;
-    }
-    else {
-      sInt16 wkDay= lineartime2weekday( aTime );
-      ds = ( wkDay +   5*DaysPerWk - (d-1)          ) % DaysPerWk;     // wkday of 1st
-      ds = ( DaysPerWk  - ds       + c->wDayOfWeek  ) % DaysPerWk + 1; // 1st occurance
-      ds+= ( c->wNth-1 )*DaysPerWk;
 
-      AdjustDay( ds, m, y );
-    } // if
-    */
+/* Order of the rules cache */
+static bool RulesLess( const tz_rules &r1, const tz_rules &r2 )
+{
+  if (r1.tzIndex!=r2.tzIndex) return r1.tzIndex<r2.tzIndex;
+  return r1.tzYear<r2.tzYear;
+} /* RulesLess */
 
-    /* <ds> is the day when dst<=>std takes place */
-        ds= DaySwitch( aTime, c );
-    if (ds        < d   ) return c==&t.dst;
-    if (ds        > d   ) return c==&t.std;
 
-    /* day  correct => compare hours */
-    if (c->wHour  < h   ) return c==&t.dst;
-    if (c->wHour  > h   ) return c==&t.std;
+/* Get the rules of time zone <aContext> for <year>, cached in <g> if available */
+static bool GetTZRules( timecontext_t aContext, tz_rules &r, GZones* g, int year )
+{
+  const size_t maxCached= 1000; // more rules than that are not expected, start over then
 
-    /* hour correct => compare minutes */
-    if (c->wMinute< min ) return c==&t.dst;
-    if (c->wMinute> min ) return c==&t.std;
+  r.tzIndex= aContext & TCTX_OFFSETMASK;
+  r.tzYear = year;
 
-    /* decide for the margin, if identical */
-    return c==&t.dst;
+  if (g!=NULL) {
+    #ifdef MUTEX_SUPPORT
+      lockMutex( g->muP );
+    #endif
+    TZRulesCache::const_iterator pos= lower_bound( g->rulesCache.begin(),
+                                                   g->rulesCache.end(), r, RulesLess );
+    bool found= pos!=g->rulesCache.end() && !RulesLess( r, *pos );
+    if (found) r= *pos;
+    #ifdef MUTEX_SUPPORT
+      unlockMutex( g->muP );
+    #endif
+    if (found) return r.ok;
+  } // if
+
+  tz_entry t;
+  r.ok= GetTZ( aContext, t, g, year );
+  SetRules( t, r, r.ok ? year : 0 );
+
+  if (g!=NULL) {
+    #ifdef MUTEX_SUPPORT
+      lockMutex( g->muP );
+    #endif
+    if (g->rulesCache.size()>=maxCached) g->rulesCache.clear();
+    g->rulesCache.insert( upper_bound( g->rulesCache.begin(),
+                                       g->rulesCache.end(), r, RulesLess ), r );
+    #ifdef MUTEX_SUPPORT
+      unlockMutex( g->muP );
+    #endif
+  } // if
+
+  return r.ok;
+} /* GetTZRules */
+
+
+/* Check whether <aValue> of time zone rules <r> is DST based */
+static bool IsDST( lineartime_t aTime, const tz_rules &r )
+{
+  bool   ok;
+  sInt16 y, m;
+
+  if (r.dst.wMonth==0 ||
+      r.std.wMonth==0) return false; // see DSTCond()
+
+  lineartime2date( aTime, &y, &m, NULL );
+
+  /* calculation is a little bit more tricky within the two switching months */
+  /* (if both switch in the same month, only the DST switch is considered)    */
+  if (m==r.dst.wMonth) {
+    lineartime_t ts= y==r.year ? r.dstSwitch : SwitchTime( r.dst, y );
+    return aTime>=ts; /* decide for DST at the margin */
+  } /* if */
+
+  if (m==r.std.wMonth) {
+    lineartime_t ts= y==r.year ? r.stdSwitch : SwitchTime( r.std, y );
+    return aTime<ts;
   } /* if */
 
   /* northern and southern hemnisphere supported */
-  if (t.dst.wMonth<t.std.wMonth)
-         ok= m>t.dst.wMonth && m<t.std.wMonth;
-  else   ok= m<t.std.wMonth || m>t.dst.wMonth;
+  if (r.dst.wMonth<r.std.wMonth)
+         ok= m>r.dst.wMonth && m<r.std.wMonth;
+  else   ok= m<r.std.wMonth || m>r.dst.wMonth;
   return ok;
 } /* IsDST */
 
 
+/* Check whether <aValue> of time zone <t> is DST based */
+static bool IsDST( lineartime_t aTime, const tz_entry &t )
+{
+  tz_rules r;
+  SetRules( t, r, 0 );
+  return IsDST( aTime, r );
+} /* IsDST */
+
+
 
-static sInt32 DST_Offs( lineartime_t aValue, const tz_entry &t, bool backwards )
+static sInt32 DST_Offs( lineartime_t aValue, const tz_rules &r, bool backwards )
 {
-  if (backwards) aValue+= (lineartime_t)(t.bias*SecsPerMin)*secondToLinearTimeFactor;
-  if (IsDST( aValue,t )) return t.bias + t.biasDST;
-  else                   return t.bias;
+  if (backwards) aValue+= (lineartime_t)(r.bias*SecsPerMin)*secondToLinearTimeFactor;
+  if (IsDST( aValue,r )) return r.bias + r.biasDST;
+  else                   return r.bias;
 } /* DST_Offs */
 
 
@@ -1055,16 +1126,16 @@ static sInt32 DST_Offs( lineartime_t aValue, const tz_entry &t, bool backwards )
 static bool TimeZoneToOffs( lineartime_t aValue, timecontext_t aContext,
                                  bool backwards, sInt32 &offs, GZones* g )
 {
-  tz_entry t;
+  tz_rules r;
 
   if (TCTX_IS_TZ( aContext )) {
     offs= 0; // default
 
     sInt16                     year;
     lineartime2date( aValue,  &year, NULL, NULL );
-    if (GetTZ( aContext, t, g, year )) {
-      if (t.ident == "$") return false; // unchanged elements are not yet supported
-      offs= DST_Offs( aValue, t, backwards );
+    if (GetTZRules( aContext, r, g, year )) {
+      if (r.unchanged) return false; // unchanged elements are not yet supported
+      offs= DST_Offs( aValue, r, backwards );
     } // if
   }
   else {
@@ -1231,18 +1302,18 @@ bool ContextForEntry( timecontext_t &aContext, tz_entry &t, bool chkNameFirst, G
 static bool IdenticalRules( timecontext_t aSourceContext,
                             timecontext_t aTargetContext, GZones* g )
 {
-  tz_entry ts, tt;
+  tz_rules ts, tt;
 
   /* only performed in TZ mode */
-  if (!GetTZ( aSourceContext, ts, g, 0 ) ||
-      !GetTZ( aTargetContext, tt, g, 0 )) return false;
+  if (!GetTZRules( aSourceContext, ts, g, 0 ) ||
+      !GetTZRules( aTargetContext, tt, g, 0 )) return false;
 
   TTimeZones asTZ= TCTX_TZENUM( aSourceContext );
   TTimeZones atTZ= TCTX_TZENUM( aTargetContext );
   if  (asTZ==atTZ) return true; // identical
 
-  if (ts.ident == "$" ||
-      tt.ident == "$") return false;
+  if (ts.unchanged ||
+      tt.unchanged) return false;
 
   if              (ts.bias==tt.bias  &&
   // memcmp( &ts.dst, &tt.dst, sizeof(tChange))==0 &&
@@ -1416,6 +1487,260 @@ bool TzConvertTimestamp( lineartime_t &aValue,   timecontext_t aSourceContext,
 } /* TzConvertTimestamp */
 
 
+
+#ifdef SYNTHESIS_UNIT_TEST
+
+/* IsDST() as it was before the rules cache, day/hour/minute comparison within the switch months */
+static bool IsDST_Reference( lineartime_t aTime, const tz_entry &t )
+{
+  bool   ok;
+  sInt16 y, m, d, h, min, ds;
+
+  if (!DSTCond( t )) return false;
+
+  lineartime2date( aTime, &y, &m, &d );
+  lineartime2time( aTime, &h, &min, NULL, NULL );
+
+  const tChange*       c= NULL;
+  if (m==t.std.wMonth) c= &t.std;
+  if (m==t.dst.wMonth) c= &t.dst;
+
+  if (c!=NULL) {
+    ds= DaySwitch( aTime, c );
+    if (ds        < d   ) return c==&t.dst;
+    if (ds        > d   ) return c==&t.std;
+    if (c->wHour  < h   ) return c==&t.dst;
+    if (c->wHour  > h   ) return c==&t.std;
+    if (c->wMinute< min ) return c==&t.dst;
+    if (c->wMinute> min ) return c==&t.std;
+    return c==&t.dst;
+  } /* if */
+
+  if (t.dst.wMonth<t.std.wMonth)
+         ok= m>t.dst.wMonth && m<t.std.wMonth;
+  else   ok= m<t.std.wMonth || m>t.dst.wMonth;
+  return ok;
+} /* IsDST_Reference */
+
+
+/* Offset as TimeZoneToOffs() calculated it before the rules cache */
+static bool TimeZoneToOffs_Reference( lineartime_t aValue, timecontext_t aContext,
+                                      bool backwards, sInt32 &offs, GZones* g )
+{
+  tz_entry t;
+  sInt16   year;
+
+  offs= 0;
+  lineartime2date( aValue, &year, NULL, NULL );
+  if (GetTZ( aContext, t, g, year )) {
+    if (t.ident == "$") return false;
+    if (backwards) aValue+= (lineartime_t)(t.bias*SecsPerMin)*secondToLinearTimeFactor;
+    offs= IsDST_Reference( aValue,t ) ? t.bias + t.biasDST : t.bias;
+  } // if
+  return true;
+} /* TimeZoneToOffs_Reference */
+
+
+/* Compare IsDST() for rules precalculated for <aYear>, for another year, and the reference */
+static bool SameDST( lineartime_t aTime, const tz_entry &t, sInt16 aYear, long &aNum )
+{
+  tz_rules r, rOther;
+  SetRules( t, r,      aYear   );
+  SetRules( t, rOther, aYear+1 );
+  bool dst= IsDST_Reference( aTime, t );
+  aNum++;
+  return IsDST( aTime, r )==dst && IsDST( aTime, rOther )==dst;
+} /* SameDST */
+
+
+/* Compare IsDST() at the switches of <t> in <aYear> (one minute before, at, after)
+ * and on every day of <aYear> at <aHour>
+ */
+static bool SameDSTInYear( const tz_entry &t, sInt16 aYear, sInt16 aHour, long &aNum )
+{
+  const lineartime_t minute= time2lineartime( 0,1,0,0 );
+  bool ok= true;
+
+  if (DSTCond( t )) {
+    lineartime_t sw[2]= { SwitchTime( t.dst, aYear ), SwitchTime( t.std, aYear ) };
+    for (int i=0; i<2; i++) {
+      for (int k=-1; k<=1; k++) {
+        ok= SameDST( sw[i] + k*minute, t, aYear, aNum ) && ok;
+      } // for
+    } // for
+  } // if
+
+  lineartime_t day= date2lineartime( aYear, 1, 1 ) + time2lineartime( aHour, 0,0,0 );
+  lineartime_t end= date2lineartime( aYear+1, 1, 1 );
+  for (; day<end; day+= linearDateToTimeFactor) {
+    ok= SameDST( day, t, aYear, aNum ) && ok;
+  } // for
+  return ok;
+} /* SameDSTInYear */
+
+
+/* Compare TimeZoneToOffs() (cached rules in <g>) with the reference for <aContext> in <aYear> */
+static bool SameOffsInYear( timecontext_t aContext, sInt16 aYear, GZones* g, long &aNum )
+{
+  const lineartime_t minute= time2lineartime( 0,1,0,0 );
+  bool     ok= true;
+  tz_entry t;
+  if (!GetTZ( aContext, t, g, aYear )) return false;
+
+  vector<lineartime_t> times;
+  if (DSTCond( t )) {
+    lineartime_t sw[2]= { SwitchTime( t.dst, aYear ), SwitchTime( t.std, aYear ) };
+    for (int i=0; i<2; i++) {
+      for (int k=-1; k<=1; k++) {
+        times.push_back( sw[i] + k*minute );
+      } // for
+    } // for
+  } // if
+  lineartime_t day= date2lineartime( aYear, 1, 1 ) + time2lineartime( 12, 0,0,0 );
+  lineartime_t end= date2lineartime( aYear+1, 1, 1 );
+  for (; day<end; day+= linearDateToTimeFactor) times.push_back( day );
+
+  for (vector<lineartime_t>::iterator pos= times.begin(); pos!=times.end(); pos++) {
+    for (int backwards=0; backwards<2; backwards++) {
+      sInt32 offs, offsRef;
+      bool   res   = TimeZoneToOffs          ( *pos, aContext, backwards, offs,    g );
+      bool   resRef= TimeZoneToOffs_Reference( *pos, aContext, backwards, offsRef, g );
+      aNum++;
+      if (res!=resRef || offs!=offsRef) {
+        sInt16 y, m, d, h, min;
+        lineartime2date( *pos, &y, &m, &d );
+        lineartime2time( *pos, &h, &min, NULL, NULL );
+        printf( "%s %04d-%02d-%02d %02d:%02d%s: offs=%ld, reference=%ld\n",
+                t.name.c_str(), y, m, d, h, min, backwards ? " (backwards)" : "",
+                (long)offs, (long)offsRef );
+        ok= false;
+      } // if
+    } // for
+  } // for
+  return ok;
+} /* SameOffsInYear */
+
+
+/* Time zone rules cache tests */
+bool test_tz_rules(void)
+{
+  bool ok= true;
+  long num;
+  sInt16 y;
+
+  {
+    UNIT_TEST_TITLE("TZ rules: IsDST, northern and southern hemisphere, same month switches");
+    tz_entry t;
+    t.name   = "TEST/NORTH";
+    t.bias   = 60;
+    t.biasDST= 60;
+    t.dst    = tChange( 3,0,5, 2,0 ); // last Sunday in March 2:00
+    t.std    = tChange(10,0,5, 3,0 ); // last Sunday in October 3:00
+    num= 0;
+    for (y=1990; y<=2040; y++) ok= SameDSTInYear( t, y, 12, num ) && ok;
+    UNIT_TEST_CALL(,("northern, %ld checks",num),ok,ok);
+
+    t.name   = "TEST/SOUTH";
+    t.bias   = 600;
+    t.dst    = tChange(10,0,1, 2,0 ); // first Sunday in October 2:00
+    t.std    = tChange( 4,0,1, 3,0 ); // first Sunday in April 3:00
+    num= 0;
+    for (y=1990; y<=2040; y++) ok= SameDSTInYear( t, y, 2, num ) && ok;
+    UNIT_TEST_CALL(,("southern, %ld checks",num),ok,ok);
+    tz_rules r;
+    SetRules( t, r, 2020 );
+    UNIT_TEST_CALL(,("southern, January"),IsDST( date2lineartime( 2020, 1,15 ), r ),ok);
+    UNIT_TEST_CALL(,("southern, July"),!IsDST( date2lineartime( 2020, 7,15 ), r ),ok);
+
+    t.name   = "TEST/SAMEMONTH";
+    t.dst    = tChange( 3,0,1, 2,0 ); // first Sunday in March 2:00
+    t.std    = tChange( 3,0,4, 3,0 ); // fourth Sunday in March 3:00
+    num= 0;
+    for (y=1990; y<=2040; y++) ok= SameDSTInYear( t, y, 2, num ) && ok;
+    UNIT_TEST_CALL(,("same month, %ld checks",num),ok,ok);
+
+    t.name   = "TEST/DATES";
+    t.dst    = tChange( 4,-1,14, 0,30 ); // April 14th 0:30
+    t.std    = tChange( 9,-1,30, 23,59 ); // September 30th 23:59
+    num= 0;
+    for (y=1990; y<=2040; y++) ok= SameDSTInYear( t, y, 0, num ) && ok;
+    UNIT_TEST_CALL(,("fixed dates, %ld checks",num),ok,ok);
+  }
+  #ifndef NO_BUILTIN_TZ
+  {
+    UNIT_TEST_TITLE("TZ rules: offsets of all built-in zones");
+    GZones g;
+    num= 0;
+    for (int i=0; i<(int)tctx_numtimezones; i++) {
+      timecontext_t ctx= TCTX_ENUMCONTEXT( i );
+      for (y=1990; y<=2040; y++) ok= SameOffsInYear( ctx, y, &g, num ) && ok;
+    } // for
+    UNIT_TEST_CALL(,("%ld conversions, %ld rules cached",num,(long)g.rulesCache.size()),ok && !g.rulesCache.empty(),ok);
+  }
+  #endif
+  {
+    UNIT_TEST_TITLE("TZ rules: cache invalidation");
+    GZones g;
+    tz_entry t;
+    string   name;
+    timecontext_t ctx, ctx2;
+    long     n= 0;
+    t.name   = "TEST/DYNAMIC";
+    t.bias   = 60;
+    t.biasDST= 60;
+    t.dst    = tChange( 3,0,5, 2,0 );
+    t.std    = tChange(10,0,5, 3,0 );
+    UNIT_TEST_CALL(FoundTZ( t, name, ctx, &g, true ),("created"),TCTX_IS_TZ( ctx ),ok);
+    UNIT_TEST_CALL(,("initial"),SameOffsInYear( ctx, 2020, &g, n ) && !g.rulesCache.empty(),ok);
+    // a second entry with the same name and a dynYear overrides the rules up to that year
+    t.bias   = 120;
+    t.dynYear= "2025";
+    UNIT_TEST_CALL(FoundTZ( t, name, ctx2, &g, true ),("dynYear entry"),ctx2!=ctx && g.rulesCache.empty(),ok);
+    sInt32 offs;
+    UNIT_TEST_CALL(TimeZoneToOffs( date2lineartime( 2020,1,15 ), ctx, false, offs, &g ),("offs=%ld",(long)offs),offs==120,ok);
+    UNIT_TEST_CALL(,("dynYear"),SameOffsInYear( ctx, 2020, &g, n ),ok);
+    // removed and reactivated
+    UNIT_TEST_CALL(RemoveTZ( t, &g ),("removed"),g.rulesCache.empty(),ok);
+    t.dynYear= "";
+    t.bias   = 60;
+    UNIT_TEST_CALL(RemoveTZ( t, &g ),("removed"),g.rulesCache.empty(),ok);
+    tz_rules r;
+    UNIT_TEST_CALL(,("lookup after removal"),!GetTZRules( ctx, r, &g, 2020 ),ok);
+    t.ident  = "?"; // search by name, reactivates the removed entry
+    UNIT_TEST_CALL(FoundTZ( t, name, ctx2, &g, true ),("reactivated"),ctx2==ctx && g.rulesCache.empty(),ok);
+    UNIT_TEST_CALL(,("lookup after reactivation"),GetTZRules( ctx, r, &g, 2020 ) && SameOffsInYear( ctx, 2020, &g, n ),ok);
+  }
+  {
+    UNIT_TEST_TITLE("TZ rules: conversion speed");
+    GZones g;
+    timecontext_t ctx;
+    const long conversions= 1000000;
+    if (TimeZoneNameToContext( "CET", ctx, &g )) {
+      lineartime_t start= date2lineartime( 2020,1,1 );
+      lineartime_t step = time2lineartime( 0,37,0,0 ); // spread over some weeks
+      sInt32 offs, sum= 0, sumRef= 0;
+      clock_t c0= clock();
+      for (long i=0; i<conversions; i++) {
+        TimeZoneToOffs( start + (i % 2000)*step, ctx, false, offs, &g );
+        sum+= offs;
+      } // for
+      clock_t c1= clock();
+      for (long i=0; i<conversions; i++) {
+        TimeZoneToOffs_Reference( start + (i % 2000)*step, ctx, false, offs, &g );
+        sumRef+= offs;
+      } // for
+      clock_t c2= clock();
+      printf( "%ld offsets: %.0f ms with rules cache, %.0f ms without\n", conversions,
+              (c1-c0)*1000.0/CLOCKS_PER_SEC, (c2-c1)*1000.0/CLOCKS_PER_SEC );
+      UNIT_TEST_CALL(,("sum=%ld, reference=%ld",(long)sum,(long)sumRef),sum==sumRef,ok);
+    } // if
+  }
+  return ok;
+} /* test_tz_rules */
+
+#endif // SYNTHESIS_UNIT_TEST
+
+
 } // namespace sysync
 
 
@@ -206,6 +206,25 @@ void ClrDST( tz_entry &t );
 
 typedef std::list<tz_entry> TZList;
 
+
+/// offset rules of a time zone for a given year, as used for offset calculation
+typedef struct tzRulesStruct {
+          uInt32       tzIndex;   /**< time zone, index part of the context */
+          int          tzYear;    /**< year used to select the rules, see GetTZ() */
+          bool         ok;        /**< zone found */
+          bool         unchanged; /**< "$" zone, can't be resolved */
+          short        bias;      /**< see tz_entry */
+          short        biasDST;   /**< see tz_entry */
+          tChange      dst;       /**< see tz_entry */
+          tChange      std;       /**< see tz_entry */
+          sInt16       year;      /**< year of <dstSwitch>/<stdSwitch>, 0 if not calculated */
+          lineartime_t dstSwitch; /**< local standard time when DST becomes active in <year> */
+          lineartime_t stdSwitch; /**< local standard time when STD becomes active in <year> */
+        } tz_rules;
+
+/// rules per time zone and year, sorted by <tzIndex>/<tzYear>, cached in GZones
+typedef std::vector<tz_rules> TZRulesCache;
+
 class GZones {
   public:
     GZones() {
@@ -290,10 +309,16 @@ class GZones {
       sysTZ= predefinedSysTZ; // reset cached system time zone to make sure it is re-evaluated
     }
 
+    /*! @brief forget cached rules, must be called whenever <tzP> changes */
+    void ResetRulesCache(void) {
+      rulesCache.clear();
+    }
+
     #ifdef MUTEX_SUPPORT
     #endif
 
     TZList                    tzP; // the list of additional time zones
+    TZRulesCache       rulesCache; // rules already looked up by TzOffsetSeconds()
     timecontext_t predefinedSysTZ; // can be set to a specific zone to override zone returned by OS API
     timecontext_t           sysTZ; // the system's time zone, will be calculated,
                                    // if set to tctx_tz_unknown
@@ -490,6 +515,11 @@ void finalizeSystemZoneDefinitions( GZones* aGZones );
 bool getSystemTimeZoneContext( timecontext_t &aContext, GZones* aGZones );
 
 
+#ifdef SYNTHESIS_UNIT_TEST
+/*! time zone rules cache tests */
+bool test_tz_rules(void);
+#endif
+
 
 } // namespace sysync
 
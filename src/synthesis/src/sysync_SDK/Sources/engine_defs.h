@@ -410,7 +410,8 @@ enum TProgressEventEnum {
   /** datastore statistics for local/remote rejects (extra1=# locally rejected,
       extra2=# remotely rejected) */
   PEV_DSSTATS_E = 27,
-  /** datastore statistics for server slowsync  (extra1=# slowsync matches) */
+  /** datastore statistics for server slowsync  (extra1=# slowsync matches,
+      extra2=# compares avoided by match index) */
   PEV_DSSTATS_S = 28,
   /** datastore statistics for server conflicts (extra1=# server won,
       extra2=# client won,